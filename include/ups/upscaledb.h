@@ -580,6 +580,37 @@ ups_get_version(uint32_t *major, uint32_t *minor,
  *      Environment.
  *     <li>@ref UPS_ENABLE_CRC32</li> Stores (and verifies) CRC32
  *      checksums. Not allowed in combination with @ref UPS_IN_MEMORY.
+ *     <li>@ref UPS_ENABLE_CONCURRENT_READS</li> Lookups, cursor moves,
+ *      counts and UQI queries run in parallel with each other; only
+ *      modifications require exclusive access to the Environment.
+ *      Databases with fixed length keys, inline records (i.e. records
+ *      of up to 8 bytes) and without duplicate keys are an exception:
+ *      @ref ups_db_insert and @ref ups_db_erase run in parallel with
+ *      @ref ups_db_find and @ref ups_db_find_many, but not with each
+ *      other (not with a custom compare function or with
+ *      @ref UPS_NODE_LAYOUT_BTREE). Each Cursor must only be used by one
+ *      thread at a time. Databases with key or record compression are
+ *      always locked exclusively.
+ *      Not allowed in combination with @ref UPS_ENABLE_TRANSACTIONS.
+ *     <li>@ref UPS_ENABLE_GROUP_COMMIT</li> Only in combination with
+ *      @ref UPS_ENABLE_FSYNC: threads which commit Transactions at the
+ *      same time share a single fsync of the journal. @ref ups_txn_commit
+ *      still returns after the Transaction is durable.
+ *     <li>@ref UPS_ENABLE_DIRECT_IO</li> Reads and writes the pages with
+ *      O_DIRECT, bypassing the file system cache. Pages are read into
+ *      aligned buffers which are preallocated for the whole cache; the
+ *      cache size therefore determines the memory usage. Implies
+ *      @ref UPS_DISABLE_MMAP. Requires a page size which is a multiple of
+ *      4096 bytes. Falls back to buffered I/O if the file system does not
+ *      support direct I/O. Not allowed in combination with
+ *      @ref UPS_IN_MEMORY.
+ *     <li>@ref UPS_ENABLE_JOURNAL_DELTAS</li> The journal stores the
+ *      modified byte ranges of a page instead of the full page. A page
+ *      is logged as a full image when it is modified for the first time
+ *      after the journal switched its files, or if its previous image is
+ *      no longer buffered. Requires more memory (the page images of the
+ *      current journal file are buffered), but significantly reduces
+ *      the journal's write volume.
  *    </ul>
  *
  * @param mode File access rights for the new file. This is the @a mode
@@ -595,6 +626,22 @@ ups_get_version(uint32_t *major, uint32_t *minor,
  *      posix_fadvise(). Only on supported platforms. Allowed values are
  *      @ref UPS_POSIX_FADVICE_NORMAL (which is the default) or
  *      @ref UPS_POSIX_FADVICE_RANDOM.
+ *    <li>@ref UPS_PARAM_CACHE_POLICY</li> Sets the eviction policy of
+ *      the cache. Allowed values are @ref UPS_CACHE_POLICY_2Q (which is
+ *      the default; scan-resistant) or @ref UPS_CACHE_POLICY_LRU.
+ *    <li>@ref UPS_PARAM_QUERY_THREADS</li> The number of threads which
+ *      scan the Database for a UQI query (see @ref uqi_select_range).
+ *      Requires @ref UPS_ENABLE_CONCURRENT_READS. The default (0) uses
+ *      one thread per core.
+ *    <li>@ref UPS_PARAM_CHECKPOINT_LOG_SIZE</li> Performs a checkpoint
+ *      when a Txn is committed and the journal grew by this number of
+ *      bytes since the last checkpoint. Disabled by default.
+ *    <li>@ref UPS_PARAM_CHECKPOINT_INTERVAL_SEC</li> Performs a checkpoint
+ *      when a Txn is committed and the last checkpoint is older than this
+ *      number of seconds. Disabled by default.
+ *    <li>@ref UPS_PARAM_JOURNAL_SEGMENT_SIZE</li> Preallocates the
+ *      journal files with this size, and aligns all journal writes to
+ *      4 kb. Disabled by default.
  *    <li>@ref UPS_PARAM_PAGE_SIZE</li> The size of a file page, in
  *      bytes. It is recommended not to change the default size. The
  *      default size depends on hardware and operating system.
@@ -637,6 +684,21 @@ UPS_EXPORT ups_status_t UPS_CALLCONV
 ups_env_create(ups_env_t **env, const char *filename,
             uint32_t flags, uint32_t mode, const ups_parameter_t *param);
 
+/**
+ * Typedef for the progress function of the recovery
+ *
+ * @remark The function is called periodically while @ref ups_env_open
+ * recovers an Environment, and a last time when the recovery is completed.
+ * @a processed and @a total are the number of journal bytes which were
+ * processed so far and which are processed in total. @a eta_msec is the
+ * estimated remaining time, in milliseconds. @a context is the value of
+ * @ref UPS_PARAM_RECOVERY_PROGRESS_CONTEXT.
+ *
+ * The function must not call upscaledb functions.
+ */
+typedef void UPS_CALLCONV (*ups_recovery_progress_func_t)(uint64_t processed,
+                  uint64_t total, uint64_t eta_msec, void *context);
+
 /**
  * Opens an existing Database Environment
  *
@@ -699,6 +761,37 @@ ups_env_create(ups_env_t **env, const char *filename,
  *      if necessary.
  *     <li>@ref UPS_ENABLE_CRC32</li> Stores (and verifies) CRC32
  *      checksums.
+ *     <li>@ref UPS_ENABLE_CONCURRENT_READS</li> Lookups, cursor moves,
+ *      counts and UQI queries run in parallel with each other; only
+ *      modifications require exclusive access to the Environment.
+ *      Databases with fixed length keys, inline records (i.e. records
+ *      of up to 8 bytes) and without duplicate keys are an exception:
+ *      @ref ups_db_insert and @ref ups_db_erase run in parallel with
+ *      @ref ups_db_find and @ref ups_db_find_many, but not with each
+ *      other (not with a custom compare function or with
+ *      @ref UPS_NODE_LAYOUT_BTREE). Each Cursor must only be used by one
+ *      thread at a time. Databases with key or record compression are
+ *      always locked exclusively.
+ *      Not allowed in combination with @ref UPS_ENABLE_TRANSACTIONS.
+ *     <li>@ref UPS_ENABLE_GROUP_COMMIT</li> Only in combination with
+ *      @ref UPS_ENABLE_FSYNC: threads which commit Transactions at the
+ *      same time share a single fsync of the journal. @ref ups_txn_commit
+ *      still returns after the Transaction is durable.
+ *     <li>@ref UPS_ENABLE_DIRECT_IO</li> Reads and writes the pages with
+ *      O_DIRECT, bypassing the file system cache. Pages are read into
+ *      aligned buffers which are preallocated for the whole cache; the
+ *      cache size therefore determines the memory usage. Implies
+ *      @ref UPS_DISABLE_MMAP. Requires a page size which is a multiple of
+ *      4096 bytes. Falls back to buffered I/O if the file system does not
+ *      support direct I/O. Not allowed in combination with
+ *      @ref UPS_IN_MEMORY.
+ *     <li>@ref UPS_ENABLE_JOURNAL_DELTAS</li> The journal stores the
+ *      modified byte ranges of a page instead of the full page. A page
+ *      is logged as a full image when it is modified for the first time
+ *      after the journal switched its files, or if its previous image is
+ *      no longer buffered. Requires more memory (the page images of the
+ *      current journal file are buffered), but significantly reduces
+ *      the journal's write volume.
  *    </ul>
  * @param param An array of ups_parameter_t structures. The following
  *      parameters are available:
@@ -710,6 +803,22 @@ ups_env_create(ups_env_t **env, const char *filename,
  *      posix_fadvise(). Only on supported platforms. Allowed values are
  *      @ref UPS_POSIX_FADVICE_NORMAL (which is the default) or
  *      @ref UPS_POSIX_FADVICE_RANDOM.
+ *    <li>@ref UPS_PARAM_CACHE_POLICY</li> Sets the eviction policy of
+ *      the cache. Allowed values are @ref UPS_CACHE_POLICY_2Q (which is
+ *      the default; scan-resistant) or @ref UPS_CACHE_POLICY_LRU.
+ *    <li>@ref UPS_PARAM_QUERY_THREADS</li> The number of threads which
+ *      scan the Database for a UQI query (see @ref uqi_select_range).
+ *      Requires @ref UPS_ENABLE_CONCURRENT_READS. The default (0) uses
+ *      one thread per core.
+ *    <li>@ref UPS_PARAM_CHECKPOINT_LOG_SIZE</li> Performs a checkpoint
+ *      when a Txn is committed and the journal grew by this number of
+ *      bytes since the last checkpoint. Disabled by default.
+ *    <li>@ref UPS_PARAM_CHECKPOINT_INTERVAL_SEC</li> Performs a checkpoint
+ *      when a Txn is committed and the last checkpoint is older than this
+ *      number of seconds. Disabled by default.
+ *    <li>@ref UPS_PARAM_JOURNAL_SEGMENT_SIZE</li> Preallocates the
+ *      journal files with this size, and aligns all journal writes to
+ *      4 kb. Disabled by default.
  *    <li>@ref UPS_PARAM_FILE_SIZE_LIMIT</li> Sets a file size limit (in bytes).
  *      Disabled by default. If the limit is exceeded, API functions
  *      return @ref UPS_LIMITS_REACHED.
@@ -723,6 +832,12 @@ ups_env_create(ups_env_t **env, const char *filename,
  *    <li>@ref UPS_PARAM_ENCRYPTION_KEY</li> The 16 byte long AES
  *      encryption key; enables AES encryption for the Environment file. Not
  *      allowed for In-Memory Environments. Ignored for remote Environments.
+ *    <li>@ref UPS_PARAM_RECOVERY_PROGRESS_FUNCTION</li> A function of type
+ *      @ref ups_recovery_progress_func_t which reports the progress of
+ *      the recovery (cast to uint64_t). Only used with
+ *      @ref UPS_AUTO_RECOVERY. Ignored for remote Environments.
+ *    <li>@ref UPS_PARAM_RECOVERY_PROGRESS_CONTEXT</li> A pointer which is
+ *      passed to the progress function of the recovery.
  *    </ul>
  *
  * @return @ref UPS_SUCCESS upon success.
@@ -940,6 +1055,9 @@ ups_env_get_parameters(ups_env_t *env, ups_parameter_t *param);
  *    <li>@ref UPS_PARAM_CUSTOM_COMPARE_NAME</li> Specifies the name of the
  *      custom compare function (only if @a UPS_PARAM_KEY_TYPE is @a
  *      UPS_TYPE_CUSTOM).
+ *    <li>@ref UPS_PARAM_INTERNAL_NODE_LAYOUT</li> Sets the search layout
+ *      of internal nodes (@ref UPS_NODE_LAYOUT_SORTED or
+ *      @ref UPS_NODE_LAYOUT_BTREE); only for numeric key types.
  *    </ul>
  *
  * @return @ref UPS_SUCCESS upon success
@@ -991,7 +1109,13 @@ ups_env_create_db(ups_env_t *env, ups_db_t **db,
  *      Operations that need write access (i.e. @ref ups_db_insert) will
  *      return @ref UPS_WRITE_PROTECTED.
  *   </ul>
- * @param params Reserved; set to NULL
+ * @param params An array of ups_parameter_t structures. The following
+ *    parameters are available:
+ *    <ul>
+ *    <li>@ref UPS_PARAM_INTERNAL_NODE_LAYOUT</li> Sets the search layout
+ *      of internal nodes (@ref UPS_NODE_LAYOUT_SORTED or
+ *      @ref UPS_NODE_LAYOUT_BTREE); only for numeric key types.
+ *    </ul>
  *
  * @return @ref UPS_SUCCESS upon success
  * @return @ref UPS_INV_PARAMETER if the @a env pointer is NULL or an
@@ -1078,6 +1202,35 @@ ups_env_erase_db(ups_env_t *env, uint16_t name, uint32_t flags);
 UPS_EXPORT ups_status_t UPS_CALLCONV
 ups_env_flush(ups_env_t *env, uint32_t flags);
 
+/**
+ * Performs a checkpoint
+ *
+ * All committed Transactions are flushed, and all modified pages are
+ * written to disk. Then a checkpoint record with the list of the written
+ * pages and the lsn of the oldest active Transaction is appended to the
+ * journal, and the journal files are truncated unless they still store
+ * committed Transactions which could not yet be flushed (because an older
+ * Transaction is still active). Active Transactions are not affected.
+ *
+ * After a checkpoint, the recovery does not redo the modifications
+ * which were logged before the checkpoint. Checkpoints are also performed
+ * automatically if @ref UPS_PARAM_CHECKPOINT_LOG_SIZE or
+ * @ref UPS_PARAM_CHECKPOINT_INTERVAL_SEC are set.
+ *
+ * In-Memory Environments and Environments which were opened with
+ * @ref UPS_READ_ONLY are not modified; the function returns
+ * @ref UPS_SUCCESS.
+ *
+ * @param env A valid Environment handle
+ * @param flags Optional flags; unused, set to 0
+ *
+ * @return @ref UPS_SUCCESS upon success
+ * @return @ref UPS_INV_PARAMETER if @a env is NULL
+ * @return @ref UPS_NOT_IMPLEMENTED for remote Environments
+ */
+UPS_EXPORT ups_status_t UPS_CALLCONV
+ups_env_checkpoint(ups_env_t *env, uint32_t flags);
+
 /* internal use only - don't lock mutex */
 #define UPS_DONT_LOCK        0xf0000000
 
@@ -1188,7 +1341,12 @@ typedef struct ups_txn_t ups_txn_t;
  *    bitwise OR. Possible flags are:
  *    <ul>
  *     <li>@ref UPS_TXN_READ_ONLY </li> This Txn is read-only and
- *      will not modify the Database.
+ *      will not modify the Database. It reads from a snapshot of the
+ *      data which was committed when the Txn began; changes of other
+ *      Txns which are still active or which commit later are invisible.
+ *      Read-only Txns therefore never fail with @ref UPS_TXN_CONFLICT
+ *      and do not block writers. Inserting or erasing keys fails with
+ *      @ref UPS_WRITE_PROTECTED.
  *    </ul>
  *
  * @return @ref UPS_SUCCESS upon success
@@ -1223,7 +1381,14 @@ ups_txn_get_name(ups_txn_t *txn);
  *
  * @param txn Pointer to a Txn structure
  * @param flags Optional flags for committing the Txn, combined with
- *    bitwise OR. Unused, set to 0.
+ *    bitwise OR. Possible flags are:
+ *    <ul>
+ *     <li>@ref UPS_TXN_ASYNC_COMMIT </li> Returns as soon as the commit
+ *      is appended to the journal's buffer, without writing (or syncing)
+ *      the journal. The commit is lost if the application crashes before
+ *      the buffer is flushed. Use @ref ups_env_wait_for_lsn to make such
+ *      commits durable.
+ *    </ul>
  *
  * @return @ref UPS_SUCCESS upon success
  * @return @ref UPS_IO_ERROR if writing to the file failed
@@ -1233,6 +1398,49 @@ ups_txn_get_name(ups_txn_t *txn);
 UPS_EXPORT ups_status_t
 ups_txn_commit(ups_txn_t *txn, uint32_t flags);
 
+/** Flag for @ref ups_txn_commit */
+#define UPS_TXN_ASYNC_COMMIT                  4
+
+/**
+ * Returns the log sequence numbers (lsn) of the newest committed
+ * Txn and of the newest durable Txn
+ *
+ * A commit is durable once it was written to the journal and synced
+ * to disk. Commits are synced immediately if the Environment was created
+ * or opened with @ref UPS_ENABLE_FSYNC (unless they were committed with
+ * @ref UPS_TXN_ASYNC_COMMIT); otherwise only by @ref ups_env_wait_for_lsn.
+ *
+ * Both values are 0 if the Environment does not have a journal (i.e.
+ * because Transactions are disabled).
+ *
+ * @param env A valid Environment handle
+ * @param committed_lsn Returns the lsn of the newest committed Txn
+ * @param durable_lsn Returns the lsn of the newest durable Txn
+ *
+ * @return @ref UPS_SUCCESS upon success
+ * @return @ref UPS_INV_PARAMETER if one of the parameters is NULL
+ */
+UPS_EXPORT ups_status_t UPS_CALLCONV
+ups_env_get_commit_lsn(ups_env_t *env, uint64_t *committed_lsn,
+            uint64_t *durable_lsn);
+
+/**
+ * Blocks till all Transactions up to a log sequence number are durable
+ *
+ * Writes the journal's buffer and syncs the journal to disk. If several
+ * threads wait at the same time then they share a single sync.
+ *
+ * @param env A valid Environment handle
+ * @param lsn The lsn, i.e. retrieved with @ref ups_env_get_commit_lsn;
+ *      0 waits for all Transactions which were committed so far
+ *
+ * @return @ref UPS_SUCCESS upon success
+ * @return @ref UPS_INV_PARAMETER if @a env is NULL
+ * @return @ref UPS_IO_ERROR if writing to the file failed
+ */
+UPS_EXPORT ups_status_t UPS_CALLCONV
+ups_env_wait_for_lsn(ups_env_t *env, uint64_t lsn);
+
 /**
  * Aborts a Txn
  *
@@ -1275,13 +1483,19 @@ ups_txn_abort(ups_txn_t *txn, uint32_t flags);
  * This flag is non persistent. */
 #define UPS_READ_ONLY                               0x00000004
 
-/* unused                                           0x00000008 */
+/** Flag for @ref ups_env_open, @ref ups_env_create.
+ * This flag is non persistent. */
+#define UPS_ENABLE_CONCURRENT_READS                 0x00000008
 
-/* unused                                           0x00000010 */
+/** Flag for @ref ups_env_open, @ref ups_env_create.
+ * This flag is non persistent. */
+#define UPS_ENABLE_GROUP_COMMIT                     0x00000010
 
 /* reserved                                         0x00000020 */
 
-/* unused                                           0x00000040 */
+/** Flag for @ref ups_env_open, @ref ups_env_create.
+ * This flag is non persistent. */
+#define UPS_ENABLE_DIRECT_IO                        0x00000040
 
 /** Flag for @ref ups_env_create.
  * This flag is non persistent. */
@@ -1293,6 +1507,10 @@ ups_txn_abort(ups_txn_t *txn, uint32_t flags);
  * This flag is non persistent. */
 #define UPS_DISABLE_MMAP                            0x00000200
 
+/** Flag for @ref ups_env_open, @ref ups_env_create.
+ * This flag is non persistent. */
+#define UPS_ENABLE_JOURNAL_DELTAS                   0x00000400
+
 /* deprecated */
 #define UPS_RECORD_NUMBER                           UPS_RECORD_NUMBER64
 
@@ -1485,6 +1703,47 @@ UPS_EXPORT ups_status_t UPS_CALLCONV
 ups_db_find(ups_db_t *db, ups_txn_t *txn, ups_key_t *key,
             ups_record_t *record, uint32_t flags);
 
+/**
+ * Searches several items in a Database
+ *
+ * Looks up the @a count keys in @a keys and returns their records in
+ * @a records. The result is the same as calling @ref ups_db_find for each
+ * key (without approximate matching), but the lookups are interleaved:
+ * all keys descend the Btree together, one level at a time. The pages
+ * of the next level are read from disk with a single batch and are
+ * prefetched into the CPU caches before they are searched. This hides
+ * most of the memory latency if the Btree is larger than the CPU caches.
+ *
+ * The status of each lookup (i.e. 0 or @ref UPS_KEY_NOT_FOUND) is stored
+ * in @a results. The records point to a memory buffer which is valid
+ * until the next lookup in this Database (or in this Transaction), unless
+ * they were allocated by the user (@ref UPS_RECORD_USER_ALLOC).
+ *
+ * If the Database supports duplicate keys then the first duplicate of
+ * each key is returned.
+ *
+ * If Transactions are enabled then the keys are looked up one by one.
+ *
+ * @param db A valid Database handle
+ * @param txn A Txn handle, or NULL
+ * @param keys An array of @a count keys
+ * @param records An array of @a count records which receive the results
+ * @param results An array of @a count status codes
+ * @param count The number of keys
+ * @param flags Optional flags; unused, set to 0
+ *
+ * @return @ref UPS_SUCCESS upon success; the status of each lookup is
+ *        stored in @a results
+ * @return @ref UPS_INV_PARAMETER if @a db, @a keys, @a records or
+ *        @a results is NULL, or if @a flags is not 0
+ * @return @ref UPS_INV_KEY_SIZE if a key does not match the Database
+ *        configuration
+ */
+UPS_EXPORT ups_status_t UPS_CALLCONV
+ups_db_find_many(ups_db_t *db, ups_txn_t *txn, ups_key_t *keys,
+            ups_record_t *records, ups_status_t *results, uint32_t count,
+            uint32_t flags);
+
 /**
  * Inserts a Database item
  *
@@ -1642,6 +1901,127 @@ ups_db_erase(ups_db_t *db, ups_txn_t *txn, ups_key_t *key, uint32_t flags);
 UPS_EXPORT ups_status_t UPS_CALLCONV
 ups_db_count(ups_db_t *db, ups_txn_t *txn, uint32_t flags, uint64_t *count);
 
+/**
+ * Typedef for the input function of @ref ups_db_bulk_load
+ *
+ * @remark The function fills in the next @a key and @a record and returns
+ * 1, or returns 0 if the input is exhausted. A negative value is an error
+ * code which aborts @ref ups_db_bulk_load and is returned to its caller.
+ * The key and record data have to remain valid till the function is called
+ * again.
+ */
+typedef int UPS_CALLCONV (*ups_bulk_load_func_t)(void *context,
+                  ups_key_t *key, ups_record_t *record);
+
+/**
+ * Loads a sorted stream of keys and records into a Database
+ *
+ * This function is much faster than inserting the keys one by one with
+ * @ref ups_db_insert. The keys are appended to the right edge of the
+ * Btree: the leaf pages are packed up to the @a fill_factor, and the
+ * internal levels are built bottom-up. No pages are split.
+ *
+ * The keys supplied by @a func must be sorted in ascending order, and the
+ * first key must be larger than all keys which are already stored in the
+ * Database. If the Database supports duplicate keys
+ * (@ref UPS_ENABLE_DUPLICATE_KEYS) then consecutive equal keys are stored
+ * as duplicates.
+ *
+ * Records of Record Number Databases are loaded with the supplied keys.
+ *
+ * Bulk loading bypasses Transactions: committed Transactions are flushed
+ * before the keys are loaded, and the loaded keys are immediately visible
+ * to all Transactions. If the Environment was created with
+ * @ref UPS_ENABLE_TRANSACTIONS then the modified pages are written to the
+ * journal in batches.
+ *
+ * @remark The load is not atomic. If it fails (i.e. because a key is not
+ * sorted, or because @a func returned an error) then all keys which were
+ * supplied before the failing one remain in the Database, and the
+ * Database remains consistent. The failing key is not stored. Callers
+ * which require all-or-nothing semantics have to erase the loaded keys
+ * (or delete the Database) after an error.
+ *
+ * @param db A valid Database handle
+ * @param func The function which supplies the sorted keys and records
+ * @param context A user-supplied pointer which is forwarded to @a func
+ * @param fill_factor The percentage of each page which is filled
+ *        (1 to 100); 0 selects the default (100). A smaller fill factor
+ *        leaves room for subsequent inserts.
+ * @param flags Optional flags; unused, set to 0
+ *
+ * @return @ref UPS_SUCCESS upon success
+ * @return @ref UPS_INV_PARAMETER if @a db or @a func is NULL, if
+ *        @a fill_factor is larger than 100 or if the keys are not sorted
+ * @return @ref UPS_DUPLICATE_KEY if a key is supplied twice, but the
+ *        Database does not support duplicate keys
+ * @return @ref UPS_WRITE_PROTECTED if the Database is read-only
+ * @return @ref UPS_TXN_STILL_OPEN if the Database is modified by an active
+ *        Transaction
+ * @return @ref UPS_NOT_IMPLEMENTED for remote Databases
+ * @return @ref UPS_INV_KEY_SIZE or @ref UPS_INV_RECORD_SIZE if a key or
+ *        record does not match the Database configuration
+ */
+UPS_EXPORT ups_status_t UPS_CALLCONV
+ups_db_bulk_load(ups_db_t *db, ups_bulk_load_func_t func, void *context,
+            uint32_t fill_factor, uint32_t flags);
+
+/**
+ * Compacts the Btree of a Database
+ *
+ * Merges underfull leaf pages with their siblings and removes empty leaf
+ * pages; the freed pages are returned to the freelist. Leaf pages are
+ * also moved to free pages at the beginning of the file, which allows the
+ * Environment to truncate unused space at the end of the file. The keys
+ * and records are not modified.
+ *
+ * The work can be limited with a budget: the function returns
+ * @ref UPS_LIMITS_REACHED after at least @a max_pages leaf pages were
+ * visited, or after @a max_milliseconds elapsed. The budget is checked
+ * whenever all children of an internal node were processed. The next
+ * call continues where the previous call stopped. @ref UPS_SUCCESS is
+ * returned as soon as the whole Btree was visited.
+ *
+ * If @a flags contains @ref UPS_COMPACT_IN_BACKGROUND then the function
+ * returns immediately, and the compaction is performed by a background
+ * thread. The background thread runs the compaction in small steps limited
+ * by @a max_pages and @a max_milliseconds (if both are 0 then each step
+ * visits 64 pages), and releases the Environment's lock between the steps.
+ * The background compaction is cancelled when the Database is closed.
+ *
+ * Only leaves with the same parent are merged. Leaves with variable length
+ * keys or duplicate keys are only merged if they are empty or nearly
+ * empty.
+ *
+ * The file is only truncated if the Environment is not an In-Memory
+ * Environment and @ref UPS_DISABLE_RECLAIM_INTERNAL was not specified.
+ *
+ * @param db A valid Database handle
+ * @param max_pages The maximum number of leaf pages which are visited,
+ *        or 0 for unlimited
+ * @param max_milliseconds The maximum duration of the call, or 0 for
+ *        unlimited
+ * @param flags Optional flags for compacting; possible flags are:
+ *      <ul>
+ *        <li>@ref UPS_COMPACT_IN_BACKGROUND</li> Performs the compaction
+ *            in a background thread
+ *      </ul>
+ *
+ * @return @ref UPS_SUCCESS upon success
+ * @return @ref UPS_LIMITS_REACHED if the budget was exhausted before the
+ *        whole Btree was visited
+ * @return @ref UPS_INV_PARAMETER if @a db is NULL or @a flags contains an
+ *        invalid flag
+ * @return @ref UPS_WRITE_PROTECTED if the Database is read-only
+ * @return @ref UPS_NOT_IMPLEMENTED for remote Databases
+ */
+UPS_EXPORT ups_status_t UPS_CALLCONV
+ups_db_compact(ups_db_t *db, uint32_t max_pages, uint32_t max_milliseconds,
+            uint32_t flags);
+
+/** Flag for @ref ups_db_compact */
+#define UPS_COMPACT_IN_BACKGROUND             1
+
 /**
  * Retrieve the current value for a given Database setting
  *
@@ -1744,6 +2124,68 @@ ups_db_get_parameters(ups_db_t *db, ups_parameter_t *param);
 /** Value for @ref UPS_PARAM_POSIX_FADVISE */
 #define UPS_POSIX_FADVICE_RANDOM                 1
 
+/** Parameter name for @ref ups_env_create, @ref ups_env_open; sets the
+ * eviction policy of the cache */
+#define UPS_PARAM_CACHE_POLICY          0x00000113
+
+/** Value for @ref UPS_PARAM_CACHE_POLICY: the 2Q algorithm; pages which
+ * are accessed only once (i.e. by a full table scan) do not evict the
+ * working set */
+#define UPS_CACHE_POLICY_2Q                      0
+
+/** Value for @ref UPS_PARAM_CACHE_POLICY: least recently used */
+#define UPS_CACHE_POLICY_LRU                     1
+
+/** Parameter name for @ref ups_env_create_db, @ref ups_env_open_db; sets
+ * the search layout of internal Btree nodes with numeric keys. This
+ * parameter is not persisted. */
+#define UPS_PARAM_INTERNAL_NODE_LAYOUT  0x00000114
+
+/** Value for @ref UPS_PARAM_INTERNAL_NODE_LAYOUT: internal nodes are
+ * searched with a binary search (the default) */
+#define UPS_NODE_LAYOUT_SORTED                   0
+
+/** Value for @ref UPS_PARAM_INTERNAL_NODE_LAYOUT: internal nodes are
+ * searched with a B-tree of cache-line sized blocks, which is kept in
+ * memory. Recommended for read-mostly Databases with large pages. */
+#define UPS_NODE_LAYOUT_BTREE                    1
+
+/** Parameter name for @ref ups_env_create, @ref ups_env_open; sets the
+ * number of threads which scan a Database in parallel for a UQI query.
+ * Only used for Environments with @ref UPS_ENABLE_CONCURRENT_READS.
+ * The default (0) starts one thread per core; 1 disables parallel
+ * queries. */
+#define UPS_PARAM_QUERY_THREADS         0x00000115
+
+/** Parameter name for @ref ups_env_open; sets a function of type
+ * @ref ups_recovery_progress_func_t which reports the progress of the
+ * recovery. This parameter is not persisted. */
+#define UPS_PARAM_RECOVERY_PROGRESS_FUNCTION 0x00000116
+
+/** Parameter name for @ref ups_env_open; sets the context pointer which
+ * is passed to the recovery progress function */
+#define UPS_PARAM_RECOVERY_PROGRESS_CONTEXT  0x00000117
+
+/** Parameter name for @ref ups_env_create, @ref ups_env_open; a checkpoint
+ * (see @ref ups_env_checkpoint) is performed automatically when the journal
+ * grew by this number of bytes since the last checkpoint. The default (0)
+ * disables this trigger. This parameter is not persisted. */
+#define UPS_PARAM_CHECKPOINT_LOG_SIZE        0x00000118
+
+/** Parameter name for @ref ups_env_create, @ref ups_env_open; a checkpoint
+ * (see @ref ups_env_checkpoint) is performed automatically if the last
+ * checkpoint is older than this number of seconds. The default (0)
+ * disables this trigger. This parameter is not persisted. */
+#define UPS_PARAM_CHECKPOINT_INTERVAL_SEC    0x00000119
+
+/** Parameter name for @ref ups_env_create, @ref ups_env_open; preallocates
+ * both journal files with this number of bytes. The files are switched
+ * when they are full, and all writes are padded to 4 kb boundaries,
+ * therefore a commit only writes file data and no file system metadata.
+ * The default (0) disables preallocation. This parameter is not
+ * persisted. */
+#define UPS_PARAM_JOURNAL_SEGMENT_SIZE       0x0000011a
+
 /** Value for unlimited record sizes */
 #define UPS_RECORD_SIZE_UNLIMITED       ((uint32_t)-1)
 
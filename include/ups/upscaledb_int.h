@@ -197,6 +197,27 @@ typedef struct btree_metrics_t {
   min_max_avg_u32_t keylist_block_sizes;
 } btree_metrics_t;
 
+/* cache metrics of a single page type */
+typedef struct cache_metrics_t {
+  /* number of cache hits */
+  uint64_t hits;
+
+  /* number of cache misses (pages which were fetched from disk) */
+  uint64_t misses;
+
+  /* number of pages which were purged from the cache */
+  uint64_t evictions;
+
+  /* number of times a dirty page was selected for purging; the page is
+   * flushed first, and evicted by a later purge. A page can be selected
+   * more than once, therefore this is not the number of evicted pages */
+  uint64_t dirty_purge_candidates;
+
+  /* average time (in microseconds) between storing a page in the cache and
+   * purging it */
+  uint64_t avg_residency_usec;
+} cache_metrics_t;
+
 /**
  * Retrieves collected metrics from the upscaledb Environment. Used mainly
  * for testing.
@@ -209,7 +230,7 @@ typedef struct btree_metrics_t {
  * Metrics marked "global" are stored globally and shared between multiple
  * Environments.
  */
-#define UPS_METRICS_VERSION         9
+#define UPS_METRICS_VERSION         16
 
 typedef struct ups_env_metrics_t {
   /* the version indicator - must be UPS_METRICS_VERSION */
@@ -238,6 +259,21 @@ typedef struct ups_env_metrics_t {
   /* amount of pages written to disk */
   uint64_t page_count_flushed;
 
+  /* amount of pages fetched from disk by the cursor read-ahead */
+  uint64_t page_count_prefetched;
+
+  /* number of page buffers in the pool (not for in-memory Environments) */
+  uint64_t page_buffer_pool_capacity;
+
+  /* number of page buffers which are in use */
+  uint64_t page_buffer_pool_in_use;
+
+  /* number of Page objects in the pool (global) */
+  uint64_t page_object_pool_capacity;
+
+  /* number of Page objects which are in use (global) */
+  uint64_t page_object_pool_in_use;
+
   /* number of index pages in this Environment */
   uint64_t page_count_type_index;
 
@@ -259,6 +295,42 @@ typedef struct ups_env_metrics_t {
   /* number of cache misses */
   uint64_t cache_misses;
 
+  /* cache metrics for the btree root pages */
+  cache_metrics_t cache_root_metrics;
+
+  /* cache metrics for btree index pages (internal nodes and leafs) */
+  cache_metrics_t cache_index_metrics;
+
+  /* cache metrics for blob pages */
+  cache_metrics_t cache_blob_metrics;
+
+  /* cache metrics for page-manager pages */
+  cache_metrics_t cache_page_manager_metrics;
+
+  /* number of dirty pages selected for purging; they are flushed
+   * asynchronously before they can be purged */
+  uint64_t cache_purge_candidates;
+
+  /* number of clean pages selected for purging; they are purged
+   * immediately */
+  uint64_t cache_purge_garbage;
+
+  /* number of background flusher threads */
+  uint32_t flush_thread_count;
+
+  /* number of flush jobs which are currently pending */
+  uint64_t flush_queue_depth;
+
+  /* maximum number of pending flush jobs */
+  uint64_t flush_peak_queue_depth;
+
+  /* (global) number of write calls issued when flushing pages; adjacent
+   * pages are coalesced into a single write */
+  uint64_t flush_write_calls;
+
+  /* (global) average latency of these write calls, in microseconds */
+  uint64_t flush_avg_write_latency_usec;
+
   /* number of blobs allocated */
   uint64_t blob_total_allocated;
 
@@ -271,6 +343,9 @@ typedef struct ups_env_metrics_t {
   /* (global) number of btree page merges */
   uint64_t btree_smo_merge;
 
+  /* (global) number of btree pages moved by ups_db_compact */
+  uint64_t btree_smo_relocate;
+
   /* (global) number of extended keys */
   uint64_t extended_keys;
 
@@ -286,6 +361,27 @@ typedef struct ups_env_metrics_t {
   /* log/journal bytes after compression */
   uint64_t journal_bytes_after_compression;
 
+  /* number of fsyncs performed for group commits */
+  uint64_t journal_group_syncs;
+
+  /* number of commits which were written with a deferred (group) fsync */
+  uint64_t journal_group_commits;
+
+  /* number of pages which were logged as a full image */
+  uint64_t journal_page_images;
+
+  /* number of pages which were logged as modified byte ranges */
+  uint64_t journal_page_deltas;
+
+  /* number of checkpoints */
+  uint64_t checkpoint_count;
+
+  /* total duration of all checkpoints, in microseconds */
+  uint64_t checkpoint_total_usec;
+
+  /* duration of the slowest checkpoint, in microseconds */
+  uint64_t checkpoint_max_usec;
+
   /* record bytes before compression */
   uint64_t record_bytes_before_compression;
 
@@ -178,6 +178,16 @@ typedef int (*uqi_plugin_predicate_function)(void *state,
 /** Assigns the results to an @a uqi_result_t structure */
 typedef void (*uqi_plugin_result_function)(void *state, uqi_result_t *result);
 
+/**
+ * Range predicate function; receives the smallest and the largest value
+ * of a range (i.e. a Btree leaf) of the predicate's stream. Returns false
+ * if none of the values in this range can match the predicate; the range
+ * is then skipped. Otherwise returns true.
+ */
+typedef int (*uqi_plugin_range_predicate_function)(void *state,
+                    const void *min_data, const void *max_data,
+                    uint32_t size);
+
 /** Describes a plugin for predicates */
 #define UQI_PLUGIN_PREDICATE                    1
 
@@ -234,7 +244,10 @@ typedef struct {
    */
   uint32_t flags;
 
-  /** The version of the plugin's interface; always set to 0 */
+  /**
+   * The version of the plugin's interface; set to 0, or to 1 if the
+   * plugin implements @a range_pred
+   */
   uint32_t plugin_version;
 
   /** The initialization function; can be null */
@@ -264,6 +277,18 @@ typedef struct {
   /** Assigns the result to a @a uqi_result_t structure; must not be null */
   uqi_plugin_result_function results;
 
+  /**
+   * The range predicate function; optional for plugins of type
+   * @a UQI_PLUGIN_PREDICATE, otherwise set to null. Only read if
+   * @a plugin_version is 1.
+   *
+   * It is called for leaves with numeric keys (if the predicate is
+   * applied to @a UQI_STREAM_KEY) or numeric records (if it is applied
+   * to @a UQI_STREAM_RECORD), and allows the query engine to skip
+   * whole leaves without calling @a pred for each value.
+   */
+  uqi_plugin_range_predicate_function range_pred;
+
 } uqi_plugin_t;
 
 
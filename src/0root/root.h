@@ -73,6 +73,13 @@
 #   define unlikely(x) (x)
 #endif
 
+// helper macro to load memory into the CPU caches before it is accessed
+#if defined __GNUC__
+#   define prefetch_memory(x) __builtin_prefetch ((x), 0, 3)
+#else
+#   define prefetch_memory(x) ((void)(x))
+#endif
+
 // MSVC: disable warning about use of 'this' in base member initializer list
 #ifdef WIN32
 #  pragma warning(disable:4355)
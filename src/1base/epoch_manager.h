@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * Epoch-based reclamation.
+ *
+ * Optimistic readers (see optimistic_lock.h) do not lock the data they
+ * read, therefore a writer must not reuse memory which was unlinked while
+ * a reader might still access it.
+ *
+ * Readers enter the current epoch before they start, and leave it when
+ * they are done. Memory which is unlinked by a writer is tagged with the
+ * current epoch, and can be reused as soon as all readers which were
+ * active in (or before) this epoch have left.
+ */
+
+#ifndef UPS_EPOCH_MANAGER_H
+#define UPS_EPOCH_MANAGER_H
+
+#include "0root/root.h"
+
+#include <boost/atomic.hpp>
+#include <boost/functional/hash.hpp>
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/mutex.h"
+#include "1base/spinlock.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+class EpochManager {
+  public:
+    enum {
+      // The number of concurrently active readers without contention
+      kSlots = 64
+    };
+
+    // The value of an unused slot
+    static const uint64_t kIdle = ~0ull;
+
+    EpochManager()
+      : m_epoch(1) {
+      for (int i = 0; i < kSlots; i++)
+        m_slots[i].epoch.store(kIdle, boost::memory_order_relaxed);
+    }
+
+    // Returns the current epoch
+    uint64_t current() const {
+      return m_epoch.load(boost::memory_order_seq_cst);
+    }
+
+    // Enters the current epoch; returns the slot for |leave()|. Spins if
+    // all slots are in use.
+    int enter() {
+      int start = (int)(boost::hash<boost::thread::id>()(
+                              boost::this_thread::get_id()) % kSlots);
+      int k = 0;
+      while (true) {
+        for (int i = 0; i < kSlots; i++) {
+          int slot = (start + i) % kSlots;
+          uint64_t idle = kIdle;
+          if (m_slots[slot].epoch.compare_exchange_strong(idle, current(),
+                                  boost::memory_order_seq_cst)) {
+            // the slot must be visible before any shared data is read
+            boost::atomic_thread_fence(boost::memory_order_seq_cst);
+            return slot;
+          }
+        }
+        Spinlock::spin(k++);
+      }
+    }
+
+    // Leaves the epoch which was entered with |enter()|
+    void leave(int slot) {
+      m_slots[slot].epoch.store(kIdle, boost::memory_order_release);
+    }
+
+    // Starts a new epoch. Returns the oldest epoch which is still in use;
+    // everything that was tagged with an older epoch can be reused.
+    uint64_t advance() {
+      uint64_t oldest = m_epoch.fetch_add(1, boost::memory_order_seq_cst) + 1;
+      for (int i = 0; i < kSlots; i++) {
+        uint64_t epoch = m_slots[i].epoch.load(boost::memory_order_seq_cst);
+        if (epoch < oldest)
+          oldest = epoch;
+      }
+      return oldest;
+    }
+
+  private:
+    // One slot per active reader; padded to avoid false sharing
+    struct Slot {
+      boost::atomic<uint64_t> epoch;
+      char padding[64 - sizeof(boost::atomic<uint64_t>)];
+    };
+
+    // The current epoch
+    boost::atomic<uint64_t> m_epoch;
+
+    // The epochs of the active readers
+    Slot m_slots[kSlots];
+};
+
+// Enters an epoch for the lifetime of this object. Does nothing if
+// |manager| is null.
+class ScopedEpoch {
+  public:
+    ScopedEpoch(EpochManager *manager)
+      : m_manager(manager), m_slot(manager ? manager->enter() : 0) {
+    }
+
+    ~ScopedEpoch() {
+      if (m_manager)
+        m_manager->leave(m_slot);
+    }
+
+  private:
+    EpochManager *m_manager;
+    int m_slot;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_EPOCH_MANAGER_H */
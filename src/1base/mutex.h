@@ -29,6 +29,7 @@
 #include <boost/version.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/tss.hpp>
 #include <boost/thread/condition.hpp>
@@ -45,6 +46,9 @@ typedef boost::mutex::scoped_lock ScopedLock;
 typedef boost::thread Thread;
 typedef boost::condition Condition;
 typedef boost::recursive_mutex RecursiveMutex;
+typedef boost::shared_mutex ReadWriteMutex;
+typedef boost::unique_lock<ReadWriteMutex> ScopedWriteLock;
+typedef boost::shared_lock<ReadWriteMutex> ScopedReadLock;
 
 struct Mutex : public boost::mutex 
 {
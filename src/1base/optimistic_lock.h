@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * A version lock for optimistic lock coupling (OLC).
+ *
+ * Readers never acquire the lock. They remember the version before they
+ * read the protected data, and afterwards verify that the version did not
+ * change; if it did then the data was modified concurrently, and the reader
+ * has to restart.
+ *
+ * Writers set the "locked" bit while modifying the data. When the lock is
+ * released then the version is incremented.
+ */
+
+#ifndef UPS_OPTIMISTIC_LOCK_H
+#define UPS_OPTIMISTIC_LOCK_H
+
+#include "0root/root.h"
+
+#include <boost/atomic.hpp>
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/spinlock.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+class OptimisticLock {
+    enum {
+      kLocked = 1
+    };
+
+  public:
+    OptimisticLock()
+      : m_version(0) {
+    }
+
+    // Need user-defined copy constructor because boost::atomic<> is not
+    // copyable. Initializes an *unlocked* OptimisticLock.
+    OptimisticLock(const OptimisticLock &other)
+      : m_version(0) {
+    }
+
+    // Returns the current version. Sets |*restart| to true if the lock
+    // is currently held by a writer.
+    uint64_t read_lock(bool *restart) const {
+      uint64_t version = m_version.load(boost::memory_order_acquire);
+      if (version & kLocked)
+        *restart = true;
+      return version;
+    }
+
+    // Returns true if the protected data was not modified since
+    // |version| was retrieved with read_lock()
+    bool validate(uint64_t version) const {
+      boost::atomic_thread_fence(boost::memory_order_acquire);
+      return m_version.load(boost::memory_order_relaxed) == version;
+    }
+
+    // Acquires the lock for writing; spins while another writer holds it.
+    // Not recursive!
+    void write_lock() {
+      int k = 0;
+      uint64_t version = m_version.load(boost::memory_order_relaxed);
+      while (true) {
+        if (!(version & kLocked)
+              && m_version.compare_exchange_weak(version, version | kLocked,
+                      boost::memory_order_acquire)) {
+          // the "locked" bit must be visible before the data is modified
+          boost::atomic_thread_fence(boost::memory_order_release);
+          return;
+        }
+        Spinlock::spin(k++);
+        version = m_version.load(boost::memory_order_relaxed);
+      }
+    }
+
+    // Releases the lock and increments the version
+    void write_unlock() {
+      assert(is_locked());
+      m_version.fetch_add(kLocked, boost::memory_order_release);
+    }
+
+    // Returns true if the lock is held by a writer
+    bool is_locked() const {
+      return (m_version.load(boost::memory_order_relaxed) & kLocked) != 0;
+    }
+
+    // Returns the current version (for testing)
+    uint64_t version() const {
+      return m_version.load(boost::memory_order_relaxed);
+    }
+
+  private:
+    boost::atomic<uint64_t> m_version;
+};
+
+class ScopedOptimisticWriteLock {
+  public:
+    ScopedOptimisticWriteLock(OptimisticLock &lock)
+      : m_lock(lock) {
+      m_lock.write_lock();
+    }
+
+    ~ScopedOptimisticWriteLock() {
+      m_lock.write_unlock();
+    }
+
+  private:
+    OptimisticLock &m_lock;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_OPTIMISTIC_LOCK_H */
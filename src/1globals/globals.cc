@@ -64,6 +64,8 @@ uint64_t Globals::ms_btree_smo_merge;
 
 uint64_t Globals::ms_btree_smo_shift;
 
+uint64_t Globals::ms_btree_smo_relocate;
+
 int Globals::ms_flush_threshold = 10;
 
 } // namespace upscaledb
@@ -91,6 +91,9 @@ struct Globals {
   // usage metrics - number of page shifts
   static uint64_t ms_btree_smo_shift;
 
+  // usage metrics - number of pages moved by ups_db_compact
+  static uint64_t ms_btree_smo_relocate;
+
   // flush threshold for committed transactions
   static int ms_flush_threshold;
 };
@@ -27,6 +27,9 @@
 
 #include <new>
 #include <stdlib.h>
+#ifdef WIN32
+#  include <malloc.h>
+#endif
 #ifdef UPS_USE_TCMALLOC
 #  include <gperftools/tcmalloc.h>
 #endif
@@ -118,6 +121,43 @@ struct Memory {
     return t;
   }
 
+  // allocates |size| bytes aligned to |alignment| (a power of two);
+  // throws if out of memory. The memory has to be released with
+  // |release_aligned|.
+  template<typename T>
+  static T *allocate_aligned(size_t size, size_t alignment) {
+    void *p = 0;
+#ifdef WIN32
+    p = ::_aligned_malloc(size, alignment);
+#elif defined(UPS_USE_TCMALLOC)
+    if (::tc_posix_memalign(&p, alignment, size) != 0)
+      p = 0;
+#else
+    if (::posix_memalign(&p, alignment, size) != 0)
+      p = 0;
+#endif
+    if (unlikely(!p))
+      throw Exception(UPS_OUT_OF_MEMORY);
+    ms_total_allocations++;
+    ms_current_allocations++;
+    return (T *)p;
+  }
+
+  // releases a memory block which was allocated with |allocate_aligned|;
+  // can deal with NULL pointers.
+  static void release_aligned(void *ptr) {
+    if (likely(ptr != 0)) {
+      ms_current_allocations--;
+#ifdef WIN32
+      ::_aligned_free(ptr);
+#elif defined(UPS_USE_TCMALLOC)
+      ::tc_free(ptr);
+#else
+      ::free(ptr);
+#endif
+    }
+  }
+
   // releases a memory block; can deal with NULL pointers.
   static void release(void *ptr) {
     if (likely(ptr != 0)) {
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * A pool for objects of a fixed size. The objects are carved from slabs
+ * which are allocated with Memory::allocate; released objects are kept in
+ * a free list and recycled. As soon as the pool is no longer in use, all
+ * slabs but the first one are returned to the heap; the first slab is kept
+ * to avoid allocating and releasing it for each single object.
+ *
+ * @exception_safe: strong
+ * @thread_safe: yes
+ */
+
+#ifndef UPS_SLAB_POOL_H
+#define UPS_SLAB_POOL_H
+
+#include "0root/root.h"
+
+#include <vector>
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/spinlock.h"
+#include "1mem/mem.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+struct SlabPool {
+  enum {
+    // objects are aligned to this boundary
+    kAlignment = 16
+  };
+
+  // Constructor; each slab stores |slab_objects_| objects of
+  // |object_size_| bytes
+  SlabPool(size_t object_size_, size_t slab_objects_)
+    : object_size((object_size_ + kAlignment - 1) & ~(kAlignment - 1)),
+      slab_objects(slab_objects_), capacity(0), in_use(0) {
+  }
+
+  // Destructor; releases all slabs unless objects are still in use
+  ~SlabPool() {
+    if (in_use == 0)
+      clear();
+  }
+
+  // Returns memory for a single object; grows the pool if all objects are
+  // in use
+  void *allocate() {
+    ScopedSpinlock lock(mutex);
+    if (free_list.empty())
+      grow();
+    uint8_t *p = free_list.back();
+    free_list.pop_back();
+    in_use++;
+    return p;
+  }
+
+  // Returns an object to the pool; shrinks the pool to a single slab if
+  // it's no longer in use
+  void release(void *p) {
+    ScopedSpinlock lock(mutex);
+    assert(in_use > 0);
+    free_list.push_back((uint8_t *)p);
+    if (--in_use == 0 && slabs.size() > 1)
+      shrink();
+  }
+
+  // Returns the number of objects which can be stored without growing
+  // the pool
+  size_t get_capacity() {
+    ScopedSpinlock lock(mutex);
+    return capacity;
+  }
+
+  // Returns the number of objects which are currently in use
+  size_t get_in_use() {
+    ScopedSpinlock lock(mutex);
+    return in_use;
+  }
+
+  // Allocates a new slab; the caller has to lock the pool
+  void grow() {
+    uint8_t *slab = Memory::allocate<uint8_t>(slab_objects * object_size);
+    slabs.push_back(slab);
+    free_list.reserve(free_list.size() + slab_objects);
+    for (size_t i = slab_objects; i > 0; i--)
+      free_list.push_back(slab + (i - 1) * object_size);
+    capacity += slab_objects;
+  }
+
+  // Releases all slabs but the first one; the caller has to lock the pool
+  void shrink() {
+    assert(in_use == 0);
+    for (size_t i = 1; i < slabs.size(); i++)
+      Memory::release(slabs[i]);
+    slabs.resize(1);
+    free_list.clear();
+    for (size_t i = slab_objects; i > 0; i--)
+      free_list.push_back(slabs[0] + (i - 1) * object_size);
+    capacity = slab_objects;
+  }
+
+  // Releases all slabs; the caller has to lock the pool
+  void clear() {
+    assert(in_use == 0);
+    for (size_t i = 0; i < slabs.size(); i++)
+      Memory::release(slabs[i]);
+    slabs.clear();
+    free_list.clear();
+    capacity = 0;
+  }
+
+  // For serializing access
+  Spinlock mutex;
+
+  // The size of each object (including padding)
+  size_t object_size;
+
+  // Number of objects per slab
+  size_t slab_objects;
+
+  // The slabs
+  std::vector<uint8_t *> slabs;
+
+  // The unused objects
+  std::vector<uint8_t *> free_list;
+
+  // Total number of objects
+  size_t capacity;
+
+  // Number of objects which are currently in use
+  size_t in_use;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_SLAB_POOL_H */
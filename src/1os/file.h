@@ -49,13 +49,16 @@ class File
       kSeekSet = SEEK_SET,
       kSeekEnd = SEEK_END,
       kSeekCur = SEEK_CUR,
-      kMaxPath = PATH_MAX
+      kMaxPath = PATH_MAX,
 #else
       kSeekSet = FILE_BEGIN,
       kSeekEnd = FILE_END,
       kSeekCur = FILE_CURRENT,
-      kMaxPath = MAX_PATH
+      kMaxPath = MAX_PATH,
 #endif
+
+      // alignment of offsets, sizes and buffers with direct I/O
+      kDirectIoAlignment = 4096
     };
 
     // Constructor: creates an empty File handle
@@ -94,12 +97,25 @@ class File
       return m_fd != UPS_INVALID_FD;
     }
 
+    // Returns the file handle
+    ups_fd_t fd() const {
+      return m_fd;
+    }
+
     // Flushes a file
     void flush();
 
     // Sets the parameter for posix_fadvise()
     void set_posix_advice(int parameter);
 
+    // Opens an existing file with direct I/O (O_DIRECT), bypassing the
+    // file system cache. With direct I/O, offsets, sizes and buffers of
+    // reads and writes have to be aligned to |kDirectIoAlignment|.
+    // The file is not locked; it is supposed to be a second handle of a
+    // file which is already open. Returns false if direct I/O is not
+    // supported.
+    bool open_direct(const char *filename, bool read_only);
+
     // Maps a file in memory
     //
     // mmap is called with MAP_PRIVATE - the allocated buffer
@@ -117,6 +133,10 @@ class File
     // Positional write to a file
     void pwrite(uint64_t addr, const void *buffer, size_t len);
 
+    // Positional write of |count| buffers to consecutive file positions
+    void pwritev(uint64_t addr, void **buffers, size_t *lengths,
+                    size_t count);
+
     // Write data to a file; uses the current file position
     void write(const void *buffer, size_t len);
 
@@ -135,6 +155,11 @@ class File
     // Truncate/resize the file
     void truncate(uint64_t newsize);
 
+    // Resizes the file and allocates its blocks (posix_fallocate), therefore
+    // subsequent writes do not have to update the file system metadata.
+    // Falls back to truncate() if preallocation is not supported
+    void preallocate(uint64_t size);
+
     // Closes the file descriptor
     void close();
 
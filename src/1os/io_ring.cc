@@ -0,0 +1,460 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+#include "0root/root.h"
+
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <sys/uio.h>
+#  include <linux/io_uring.h>
+#  if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) \
+        && defined(__NR_io_uring_register)
+#    define UPS_HAVE_IO_URING 1
+#  endif
+#endif
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/error.h"
+#include "1os/io_ring.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+#ifdef UPS_HAVE_IO_URING
+
+enum {
+  // The maximum number of requests which are merged into a single
+  // vectored read or write
+  kMaxIovecs = 64
+};
+
+struct IoRingState {
+  IoRingState()
+    : fd(-1), sq_ptr(0), sq_size(0), cq_ptr(0), cq_size(0), sqes(0),
+      sqes_size(0), sq_head(0), sq_tail(0), sq_mask(0), sq_array(0),
+      cq_head(0), cq_tail(0), cq_mask(0), cqes(0), entries(0) {
+  }
+
+  // the file descriptor of the ring
+  int fd;
+
+  // the mapped submission queue
+  void *sq_ptr;
+  size_t sq_size;
+
+  // the mapped completion queue; can be identical to |sq_ptr|
+  void *cq_ptr;
+  size_t cq_size;
+
+  // the mapped array of submission queue entries
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+
+  // pointers into the submission queue
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+
+  // pointers into the completion queue
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+
+  // the number of submission queue entries
+  uint32_t entries;
+
+  // the registered memory regions
+  std::vector<struct iovec> registered;
+};
+
+// A merged run of requests with adjacent file offsets
+struct IoOperation {
+  IoOperation(size_t first_, uint64_t offset_, size_t length_)
+    : first(first_), count(1), offset(offset_), length(length_),
+      result(-EIO) {
+  }
+
+  // index of the first request
+  size_t first;
+
+  // number of requests
+  size_t count;
+
+  // the file offset of the first request
+  uint64_t offset;
+
+  // the accumulated length of all requests
+  size_t length;
+
+  // the result of the completed operation (bytes or -errno); operations
+  // which were not completed by the ring fail with -EIO
+  int result;
+};
+
+static void
+release_state(IoRingState *s)
+{
+  if (s->sqes)
+    ::munmap(s->sqes, s->sqes_size);
+  if (s->cq_ptr && s->cq_ptr != s->sq_ptr)
+    ::munmap(s->cq_ptr, s->cq_size);
+  if (s->sq_ptr)
+    ::munmap(s->sq_ptr, s->sq_size);
+  if (s->fd >= 0)
+    ::close(s->fd);
+  delete s;
+}
+
+static void *
+map_ring(int fd, size_t size, uint64_t offset)
+{
+  void *p = ::mmap(0, size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, (off_t)offset);
+  return p == MAP_FAILED ? 0 : p;
+}
+
+// Returns the index of the registered region which contains |buffer|,
+// or -1
+static int
+registered_index(IoRingState *s, void *buffer, size_t length)
+{
+  uint8_t *p = (uint8_t *)buffer;
+  for (size_t i = 0; i < s->registered.size(); i++) {
+    uint8_t *base = (uint8_t *)s->registered[i].iov_base;
+    if (p >= base && p + length <= base + s->registered[i].iov_len)
+      return (int)i;
+  }
+  return -1;
+}
+
+// Completes an operation with synchronous I/O if the kernel failed it
+// or transferred less than the requested bytes
+static void
+complete_operation(File *file, bool is_write, IoRing::Request *requests,
+                IoOperation &op)
+{
+  if (op.result >= 0 && (size_t)op.result == op.length)
+    return;
+
+  size_t done = op.result > 0 ? (size_t)op.result : 0;
+  size_t position = 0;
+  for (size_t i = op.first; i < op.first + op.count; i++) {
+    IoRing::Request &r = requests[i];
+    if (position + r.length > done) {
+      size_t skip = done > position ? done - position : 0;
+      if (is_write)
+        file->pwrite(r.offset + skip, (uint8_t *)r.buffer + skip,
+                        r.length - skip);
+      else
+        file->pread(r.offset + skip, (uint8_t *)r.buffer + skip,
+                        r.length - skip);
+    }
+    position += r.length;
+  }
+}
+
+IoRing::IoRing()
+  : state_(0)
+{
+}
+
+IoRing::~IoRing()
+{
+  close();
+}
+
+bool
+IoRing::initialize(uint32_t entries)
+{
+  ScopedLock lock(mutex_);
+  if (state_)
+    return true;
+
+  struct io_uring_params params;
+  ::memset(&params, 0, sizeof(params));
+
+  IoRingState *s = new IoRingState;
+  s->fd = (int)::syscall(__NR_io_uring_setup, entries, &params);
+  if (s->fd < 0) {
+    release_state(s);
+    return false;
+  }
+
+  s->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  s->cq_size = params.cq_off.cqes
+                  + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    single_mmap = true;
+    s->sq_size = s->cq_size = std::max(s->sq_size, s->cq_size);
+  }
+#endif
+
+  s->sq_ptr = map_ring(s->fd, s->sq_size, IORING_OFF_SQ_RING);
+  if (s->sq_ptr) {
+    s->cq_ptr = single_mmap
+                  ? s->sq_ptr
+                  : map_ring(s->fd, s->cq_size, IORING_OFF_CQ_RING);
+    s->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    s->sqes = (struct io_uring_sqe *)map_ring(s->fd, s->sqes_size,
+                  IORING_OFF_SQES);
+  }
+  if (!s->sq_ptr || !s->cq_ptr || !s->sqes) {
+    ups_log(("io_uring: mapping the queues failed (%s)", strerror(errno)));
+    release_state(s);
+    return false;
+  }
+
+  uint8_t *sq = (uint8_t *)s->sq_ptr;
+  s->sq_head = (unsigned *)(sq + params.sq_off.head);
+  s->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+  s->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+  s->sq_array = (unsigned *)(sq + params.sq_off.array);
+
+  uint8_t *cq = (uint8_t *)s->cq_ptr;
+  s->cq_head = (unsigned *)(cq + params.cq_off.head);
+  s->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+  s->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+  s->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+  s->entries = params.sq_entries;
+  state_ = s;
+  return true;
+}
+
+bool
+IoRing::register_buffers(void **buffers, size_t *lengths, size_t count)
+{
+  ScopedLock lock(mutex_);
+  if (!state_)
+    return false;
+
+  if (!state_->registered.empty()) {
+    ::syscall(__NR_io_uring_register, state_->fd, IORING_UNREGISTER_BUFFERS,
+                    0, 0);
+    state_->registered.clear();
+  }
+
+  if (count == 0)
+    return true;
+
+  std::vector<struct iovec> iov(count);
+  for (size_t i = 0; i < count; i++) {
+    iov[i].iov_base = buffers[i];
+    iov[i].iov_len = lengths[i];
+  }
+
+  if (::syscall(__NR_io_uring_register, state_->fd, IORING_REGISTER_BUFFERS,
+                  &iov[0], (unsigned)count) < 0)
+    return false;
+
+  state_->registered.swap(iov);
+  return true;
+}
+
+size_t
+IoRing::read(File *file, Request *requests, size_t count)
+{
+  return submit(file, false, requests, count);
+}
+
+size_t
+IoRing::write(File *file, Request *requests, size_t count)
+{
+  return submit(file, true, requests, count);
+}
+
+size_t
+IoRing::submit(File *file, bool is_write, Request *requests, size_t count)
+{
+  if (count == 0)
+    return 0;
+
+  // merge requests with adjacent file offsets
+  std::vector<struct iovec> iov(count);
+  std::vector<IoOperation> ops;
+  ops.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    iov[i].iov_base = requests[i].buffer;
+    iov[i].iov_len = requests[i].length;
+    if (!ops.empty()
+            && ops.back().offset + ops.back().length == requests[i].offset
+            && ops.back().count < (size_t)kMaxIovecs) {
+      ops.back().count++;
+      ops.back().length += requests[i].length;
+    }
+    else
+      ops.push_back(IoOperation(i, requests[i].offset, requests[i].length));
+  }
+
+  ScopedLock lock(mutex_);
+  IoRingState *s = state_;
+  size_t calls = 0;
+  size_t prepared = 0;
+  size_t completed = 0;
+  unsigned unsubmitted = 0;
+
+  while (s && completed < ops.size()) {
+    // fill the submission queue; never have more operations in flight
+    // than the completion queue can hold
+    unsigned tail = *s->sq_tail;
+    while (prepared < ops.size() && prepared - completed < s->entries) {
+      IoOperation &op = ops[prepared];
+      unsigned index = tail & *s->sq_mask;
+      struct io_uring_sqe *sqe = &s->sqes[index];
+      ::memset(sqe, 0, sizeof(*sqe));
+      sqe->fd = file->fd();
+      sqe->off = op.offset;
+      sqe->user_data = prepared;
+
+      int buf_index = op.count == 1
+                        ? registered_index(s, requests[op.first].buffer,
+                                op.length)
+                        : -1;
+      if (buf_index >= 0) {
+        sqe->opcode = is_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t)requests[op.first].buffer;
+        sqe->len = (uint32_t)op.length;
+        sqe->buf_index = (uint16_t)buf_index;
+      }
+      else {
+        sqe->opcode = is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe->addr = (uint64_t)(uintptr_t)&iov[op.first];
+        sqe->len = (uint32_t)op.count;
+      }
+
+      s->sq_array[index] = index;
+      tail++;
+      prepared++;
+      unsubmitted++;
+    }
+    __atomic_store_n(s->sq_tail, tail, __ATOMIC_RELEASE);
+
+    // submit and wait for at least one completion
+    int r = (int)::syscall(__NR_io_uring_enter, s->fd, unsubmitted, 1,
+                    IORING_ENTER_GETEVENTS, 0, 0);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      // the ring is unusable; complete the remaining operations
+      // synchronously and let the caller fall back to regular I/O
+      ups_log(("io_uring_enter failed with status %u (%s)", errno,
+                  strerror(errno)));
+      release_state(s);
+      state_ = s = 0;
+      break;
+    }
+    unsubmitted -= std::min(unsubmitted, (unsigned)r);
+    calls++;
+
+    // reap the completions
+    unsigned head = *s->cq_head;
+    unsigned cq_tail = __atomic_load_n(s->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != cq_tail; head++) {
+      struct io_uring_cqe *cqe = &s->cqes[head & *s->cq_mask];
+      ops[cqe->user_data].result = cqe->res;
+      completed++;
+    }
+    __atomic_store_n(s->cq_head, head, __ATOMIC_RELEASE);
+  }
+
+  // re-issue failed or partial operations with synchronous I/O
+  for (size_t i = 0; i < ops.size(); i++)
+    complete_operation(file, is_write, requests, ops[i]);
+
+  return calls;
+}
+
+void
+IoRing::close()
+{
+  ScopedLock lock(mutex_);
+  if (state_) {
+    release_state(state_);
+    state_ = 0;
+  }
+}
+
+#else // !UPS_HAVE_IO_URING
+
+struct IoRingState {
+};
+
+IoRing::IoRing()
+  : state_(0)
+{
+}
+
+IoRing::~IoRing()
+{
+}
+
+bool
+IoRing::initialize(uint32_t)
+{
+  return false;
+}
+
+bool
+IoRing::register_buffers(void **, size_t *, size_t)
+{
+  return false;
+}
+
+size_t
+IoRing::read(File *file, Request *requests, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+    file->pread(requests[i].offset, requests[i].buffer, requests[i].length);
+  return count;
+}
+
+size_t
+IoRing::write(File *file, Request *requests, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+    file->pwrite(requests[i].offset, requests[i].buffer, requests[i].length);
+  return count;
+}
+
+size_t
+IoRing::submit(File *, bool, Request *, size_t)
+{
+  return 0;
+}
+
+void
+IoRing::close()
+{
+}
+
+#endif // UPS_HAVE_IO_URING
+
+} // namespace upscaledb
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * A thin wrapper around a Linux io_uring submission/completion queue pair.
+ * Batches of positional reads and writes are submitted with a single
+ * system call. The ring is set up with raw system calls (liburing is not
+ * required).
+ *
+ * If io_uring is not supported (old kernel, disabled by a seccomp filter,
+ * non-Linux platform) then |initialize()| returns false and the caller
+ * has to fall back to the regular File I/O. Requests which are rejected
+ * by the kernel, or which are completed only partially, are (re-)issued
+ * with File::pread/File::pwrite.
+ *
+ * @exception_safe: basic
+ * @thread_safe: yes
+ */
+
+#ifndef UPS_IO_RING_H
+#define UPS_IO_RING_H
+
+#include "0root/root.h"
+
+#include <vector>
+
+#include "ups/types.h"
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/mutex.h"
+#include "1os/file.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+struct IoRingState;
+
+class IoRing
+{
+  public:
+    // A single read or write request
+    struct Request {
+      // the file offset
+      uint64_t offset;
+
+      // the buffer which is read from (or written to)
+      void *buffer;
+
+      // the length of |buffer|
+      size_t length;
+    };
+
+    // Constructor; the ring is not yet initialized
+    IoRing();
+
+    // Destructor; closes the ring
+    ~IoRing();
+
+    // Sets up a ring with |entries| submission slots; returns false if
+    // io_uring is not available
+    bool initialize(uint32_t entries);
+
+    // Returns true if the ring was initialized successfully
+    bool is_active() const {
+      return state_ != 0;
+    }
+
+    // Registers |count| memory regions with the kernel. Requests whose
+    // buffers are inside one of these regions are submitted as
+    // READ_FIXED/WRITE_FIXED and avoid mapping the user pages for every
+    // request. Replaces previously registered regions. Returns false if the
+    // kernel rejected the registration.
+    bool register_buffers(void **buffers, size_t *lengths, size_t count);
+
+    // Reads |count| requests from |file|; returns the number of
+    // io_uring_enter() calls
+    size_t read(File *file, Request *requests, size_t count);
+
+    // Writes |count| requests to |file|. Requests with adjacent file
+    // offsets are merged into a single vectored write. Returns the number
+    // of io_uring_enter() calls
+    size_t write(File *file, Request *requests, size_t count);
+
+    // Closes the ring and releases all resources
+    void close();
+
+  private:
+    // Submits the requests and waits till all of them are completed
+    size_t submit(File *file, bool is_write, Request *requests, size_t count);
+
+    // The ring and its mapped queues
+    IoRingState *state_;
+
+    // Serializes submissions and completions
+    Mutex mutex_;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_IO_RING_H */
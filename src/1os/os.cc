@@ -31,6 +31,11 @@ namespace upscaledb {
 //  Windows
 #  include <intrin.h>
 #  define cpuid    __cpuid
+#  define cpuidex  __cpuidex
+static uint64_t
+xgetbv() {
+  return _xgetbv(0);
+}
 #else
 #  include <cpuid.h>
 static void
@@ -47,8 +52,48 @@ cpuid(int info[4], int level) {
       "a" (infotype)
   );*/
 }
+
+static void
+cpuidex(int info[4], int level, int sublevel) {
+  __cpuid_count(level, sublevel, info[0], info[1], info[2], info[3]);
+}
+
+static uint64_t
+xgetbv() {
+  uint32_t eax, edx;
+  __asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+  return ((uint64_t)edx << 32) | eax;
+}
 #endif
 
+// Returns the register states which are saved by the operating system
+// (the XCR0 register), or 0 if XGETBV is not supported
+static uint64_t
+os_saved_registers()
+{
+  int info[4];
+  cpuid(info, 0);
+  if (info[0] < 1)
+    return 0;
+  cpuid(info, 0x00000001);
+  // OSXSAVE
+  if ((info[2] & ((int)1 << 27)) == 0)
+    return 0;
+  return xgetbv();
+}
+
+// Returns the extended feature flags (cpuid leaf 7, register ebx)
+static uint32_t
+os_extended_features()
+{
+  int info[4];
+  cpuid(info, 0);
+  if (info[0] < 7)
+    return 0;
+  cpuidex(info, 7, 0);
+  return (uint32_t)info[1];
+}
+
 bool
 os_has_avx()
 {
@@ -73,6 +118,43 @@ os_has_avx()
   return available;
 }
 
+bool
+os_has_avx2()
+{
+  static bool available = false;
+  static bool initialized = false;
+  if (!initialized) {
+    initialized = true;
+
+    // the OS has to save the SSE and AVX registers (XCR0 bits 1, 2)
+    if ((os_saved_registers() & 0x06) == 0x06)
+      available = (os_extended_features() & ((uint32_t)1 << 5)) != 0;
+  }
+
+  return available;
+}
+
+bool
+os_has_avx512()
+{
+  static bool available = false;
+  static bool initialized = false;
+  if (!initialized) {
+    initialized = true;
+
+    // the OS has to save the SSE, AVX and AVX-512 registers (opmask,
+    // ZMM0-15 and ZMM16-31; XCR0 bits 1, 2, 5, 6, 7)
+    if ((os_saved_registers() & 0xe6) == 0xe6) {
+      uint32_t features = os_extended_features();
+      // AVX512F and AVX512BW
+      available = (features & ((uint32_t)1 << 16)) != 0
+                    && (features & ((uint32_t)1 << 30)) != 0;
+    }
+  }
+
+  return available;
+}
+
 #else // !HAVE_SSE2
 
 bool
@@ -81,6 +163,18 @@ os_has_avx()
   return false;
 }
 
+bool
+os_has_avx2()
+{
+  return false;
+}
+
+bool
+os_has_avx512()
+{
+  return false;
+}
+
 #endif // HAVE_SSE2
 
 } // namespace upscaledb
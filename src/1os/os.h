@@ -66,6 +66,24 @@ typedef SOCKET             ups_socket_t;
 extern bool
 os_has_avx();
 
+// Returns true if the CPU supports AVX2, and if the operating system
+// saves the AVX registers
+extern bool
+os_has_avx2();
+
+// Returns true if the CPU supports AVX-512 (AVX512F and AVX512BW), and if
+// the operating system saves the AVX-512 registers
+extern bool
+os_has_avx512();
+
+// Returns a monotonic timestamp in microseconds
+extern uint64_t
+os_now_usec();
+
+// Suspends the current thread for |msec| milliseconds
+extern void
+os_sleep_msec(uint32_t msec);
+
 } // namespace upscaledb
 
 #endif /* UPS_OS_H */
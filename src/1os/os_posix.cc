@@ -21,13 +21,14 @@
 
 #include "0root/root.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
 #if HAVE_MMAP
 #  include <sys/mman.h>
 #endif
-#if HAVE_WRITEV
+#if HAVE_WRITEV || HAVE_PWRITEV
 #  include <sys/uio.h>
 #endif
 #include <sys/types.h>
@@ -38,6 +39,7 @@
 #include <netdb.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <time.h>
 
 // Always verify that a file of level N does not include headers > N!
 #include "1base/error.h"
@@ -169,6 +171,44 @@ File::set_posix_advice(int advice)
 #endif
 }
 
+bool
+File::open_direct(const char *filename, bool read_only)
+{
+#if defined(O_DIRECT) || defined(F_NOCACHE)
+  int osflags = read_only ? O_RDONLY : O_RDWR;
+#  if HAVE_O_NOATIME
+  osflags |= O_NOATIME;
+#  endif
+#  if defined(O_DIRECT)
+  osflags |= O_DIRECT;
+#  endif
+
+  ups_fd_t fd = ::open(filename, osflags);
+  if (fd < 0) {
+    ups_log(("opening file %s with O_DIRECT failed with status %u (%s)",
+        filename, errno, strerror(errno)));
+    return false;
+  }
+
+#  if !defined(O_DIRECT)
+  if (::fcntl(fd, F_NOCACHE, 1) != 0) {
+    ups_log(("fcntl(F_NOCACHE) failed with status %u (%s)", errno,
+                strerror(errno)));
+    ::close(fd);
+    return false;
+  }
+#  endif
+
+  /* enable O_LARGEFILE support */
+  enable_largefile(fd);
+
+  m_fd = fd;
+  return true;
+#else
+  return false;
+#endif
+}
+
 void
 File::mmap(uint64_t position, size_t size, bool readonly, uint8_t **buffer)
 {
@@ -280,6 +320,58 @@ File::pwrite(uint64_t addr, const void *buffer, size_t len)
 #endif
 }
 
+void
+File::pwritev(uint64_t addr, void **buffers, size_t *lengths, size_t count)
+{
+  os_log(("File::pwritev: fd=%d, address=%lld, count=%lld", m_fd, addr,
+              count));
+
+#if HAVE_PWRITEV
+  struct iovec iov[64];
+
+  while (count > 0) {
+    int iovcnt = (int)std::min(count, sizeof(iov) / sizeof(iov[0]));
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+      iov[i].iov_base = buffers[i];
+      iov[i].iov_len = lengths[i];
+      len += lengths[i];
+    }
+
+    ssize_t s = ::pwritev(m_fd, iov, iovcnt, addr);
+    if (s < 0) {
+      ups_log(("pwritev() failed with status %u (%s)", errno,
+                strerror(errno)));
+      throw Exception(UPS_IO_ERROR);
+    }
+
+    // short write: write the remaining data of this batch with pwrite()
+    size_t total = (size_t)s;
+    if (total < len) {
+      size_t offset = 0;
+      for (int i = 0; i < iovcnt; i++) {
+        if (offset + lengths[i] > total) {
+          size_t skip = total > offset ? total - offset : 0;
+          pwrite(addr + offset + skip, (uint8_t *)buffers[i] + skip,
+                      lengths[i] - skip);
+        }
+        offset += lengths[i];
+      }
+    }
+
+    addr += len;
+    buffers += iovcnt;
+    lengths += iovcnt;
+    count -= iovcnt;
+  }
+#else
+  for (size_t i = 0; i < count; i++) {
+    pwrite(addr, buffers[i], lengths[i]);
+    addr += lengths[i];
+  }
+#endif
+}
+
 void
 File::write(const void *buffer, size_t len)
 {
@@ -322,6 +414,22 @@ File::truncate(uint64_t newsize)
     throw Exception(UPS_IO_ERROR);
 }
 
+void
+File::preallocate(uint64_t size)
+{
+  os_log(("File::preallocate: fd=%d, size=%lld", m_fd, size));
+#if HAVE_POSIX_FALLOCATE
+  int r = ::posix_fallocate(m_fd, 0, size);
+  if (r == 0)
+    return;
+  if (r != EINVAL && r != EOPNOTSUPP) {
+    ups_log(("posix_fallocate failed with status %u (%s)", r, strerror(r)));
+    throw Exception(UPS_IO_ERROR);
+  }
+#endif
+  truncate(size);
+}
+
 void
 File::create(const char *filename, uint32_t mode)
 {
@@ -475,4 +583,22 @@ Socket::close()
   }
 }
 
+uint64_t
+os_now_usec()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void
+os_sleep_msec(uint32_t msec)
+{
+  struct timespec ts;
+  ts.tv_sec = msec / 1000;
+  ts.tv_nsec = (long)(msec % 1000) * 1000000;
+  while (::nanosleep(&ts, &ts) == -1 && errno == EINTR)
+    ;
+}
+
 } // namespace upscaledb
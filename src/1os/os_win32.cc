@@ -105,6 +105,13 @@ File::set_posix_advice(int advice)
   // Only available for posix platforms
 }
 
+bool
+File::open_direct(const char *filename, bool read_only)
+{
+  // not yet supported (FILE_FLAG_NO_BUFFERING)
+  return false;
+}
+
 void
 File::mmap(uint64_t position, size_t size, bool readonly, uint8_t **buffer)
 {
@@ -231,6 +238,15 @@ File::pwrite(uint64_t addr, const void *buffer, size_t len)
     throw Exception(UPS_IO_ERROR);
 }
 
+void
+File::pwritev(uint64_t addr, void **buffers, size_t *lengths, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+    pwrite(addr, buffers[i], lengths[i]);
+    addr += lengths[i];
+  }
+}
+
 void
 File::write(const void *buffer, size_t len)
 {
@@ -329,6 +345,13 @@ File::truncate(uint64_t newsize)
   assert(newsize == file_size());
 }
 
+void
+File::preallocate(uint64_t size)
+{
+  // SetEndOfFile() allocates the disk space
+  truncate(size);
+}
+
 void
 File::create(const char *filename, uint32_t mode)
 {
@@ -552,4 +575,19 @@ Socket::close()
   }
 }
 
+uint64_t
+os_now_usec()
+{
+  LARGE_INTEGER frequency, counter;
+  ::QueryPerformanceFrequency(&frequency);
+  ::QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart / (frequency.QuadPart / 1000000.0));
+}
+
+void
+os_sleep_msec(uint32_t msec)
+{
+  ::Sleep(msec);
+}
+
 } // namespace upscaledb
@@ -53,7 +53,11 @@ struct EnvConfig
       file_size_limit_bytes(std::numeric_limits<size_t>::max()), 
       remote_timeout_sec(0), journal_compressor(0),
       is_encryption_enabled(false), journal_switch_threshold(0),
-      posix_advice(UPS_POSIX_FADVICE_NORMAL) {
+      posix_advice(UPS_POSIX_FADVICE_NORMAL),
+      cache_policy(UPS_CACHE_POLICY_2Q), query_threads(0),
+      recovery_progress(0), recovery_progress_context(0),
+      checkpoint_log_size(0), checkpoint_interval_sec(0),
+      journal_segment_size(0) {
   }
 
   // the environment's flags
@@ -97,6 +101,29 @@ struct EnvConfig
 
   // parameter for posix_fadvise()
   int posix_advice;
+
+  // the eviction policy of the cache
+  int cache_policy;
+
+  // the number of threads for UQI queries; 0 uses one thread per core
+  uint32_t query_threads;
+
+  // reports the progress of the recovery; can be null
+  ups_recovery_progress_func_t recovery_progress;
+
+  // the context pointer for |recovery_progress|
+  void *recovery_progress_context;
+
+  // performs a checkpoint if the journal grew by this number of bytes;
+  // 0 disables this trigger
+  uint64_t checkpoint_log_size;
+
+  // performs a checkpoint if the last one is older than this number of
+  // seconds; 0 disables this trigger
+  uint32_t checkpoint_interval_sec;
+
+  // the size of the preallocated journal files; 0 disables preallocation
+  uint64_t journal_segment_size;
 };
 
 } // namespace upscaledb
@@ -32,6 +32,7 @@
 #include "ups/upscaledb.h"
 
 // Always verify that a file of level N does not include headers > N!
+#include "1os/io_ring.h"
 #include "2config/env_config.h"
 
 #ifndef UPS_ROOT_H
@@ -41,11 +42,20 @@
 namespace upscaledb {
 
 class Page;
+struct PageBufferPool;
+
+// A positional read or write request for the batched I/O functions
+typedef IoRing::Request IoRequest;
 
 struct Device {
+  enum {
+    // max. number of adjacent buffers which are written with a single write
+    kMaxCoalescedBuffers = 64
+  };
+
   // Constructor
   Device(const EnvConfig &config)
-  : config(config) {
+  : config(config), buffer_pool(0) {
   }
 
   // virtual destructor
@@ -90,6 +100,42 @@ struct Device {
   // Writes to the device; this function does not use mmap
   virtual void write(uint64_t offset, void *buffer, size_t len) = 0;
 
+  // Writes |count| buffers to consecutive positions of the device, starting
+  // at |offset|; this function does not use mmap
+  virtual void writev(uint64_t offset, void **buffers, size_t *lengths,
+                  size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      write(offset, buffers[i], lengths[i]);
+      offset += lengths[i];
+    }
+  }
+
+  // Writes a batch of |count| requests which are sorted by their file
+  // offsets; this function does not use mmap. The default implementation
+  // coalesces requests with adjacent offsets and writes them with
+  // |writev|. Returns the number of issued write calls.
+  virtual size_t write_batch(IoRequest *requests, size_t count) {
+    void *buffers[kMaxCoalescedBuffers];
+    size_t lengths[kMaxCoalescedBuffers];
+    size_t calls = 0;
+
+    size_t i = 0;
+    while (i < count) {
+      uint64_t offset = requests[i].offset;
+      uint64_t next_offset = offset;
+      size_t n = 0;
+      for (; i < count && n < kMaxCoalescedBuffers
+                  && requests[i].offset == next_offset; i++, n++) {
+        buffers[n] = requests[i].buffer;
+        lengths[n] = requests[i].length;
+        next_offset += requests[i].length;
+      }
+      writev(offset, buffers, lengths, n);
+      calls++;
+    }
+    return calls;
+  }
+
   // Allocate storage from this device; this function
   // will *NOT* use mmap. returns the offset of the allocated storage.
   virtual uint64_t alloc(size_t len) = 0;
@@ -97,6 +143,21 @@ struct Device {
   // Reads a page from the device; this function CAN use mmap
   virtual void read_page(Page *page, uint64_t address) = 0;
 
+  // Reads |count| pages from the device (i.e. for read-ahead); this function
+  // CAN use mmap. The default implementation reads one page after the other
+  virtual void read_pages(Page **pages, uint64_t *addresses, size_t count) {
+    for (size_t i = 0; i < count; i++)
+      read_page(pages[i], addresses[i]);
+  }
+
+  // Registers long-lived I/O buffers with the device; batched reads and
+  // writes into these buffers can avoid extra copies. Returns false if
+  // the device does not support registered buffers.
+  virtual bool register_buffers(void **buffers, size_t *lengths,
+                  size_t count) {
+    return false;
+  }
+
   // Allocate storage for a page from this device; this function
   // can use mmap if available
   virtual void alloc_page(Page *page) = 0;
@@ -114,6 +175,10 @@ struct Device {
 
   // the Environment configuration settings
   const EnvConfig &config;
+
+  // the pool for page buffers (only with direct I/O); owned by the
+  // PageManager
+  PageBufferPool *buffer_pool;
 };
 
 } // namespace upscaledb
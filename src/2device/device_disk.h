@@ -42,6 +42,7 @@
 #endif
 #include "2device/device.h"
 #include "2page/page.h"
+#include "2page/page_buffer_pool.h"
 
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
@@ -60,9 +61,13 @@ class DiskDevice : public Device {
       
       State(State&&) = default;
       State& operator=(State&& ) = default;
-      // the database file
+      // the database file; never uses direct I/O
       File file;
 
+      // a second handle of the database file, opened with direct I/O;
+      // only used for requests which are aligned (see use_direct_io())
+      File direct_file;
+
       // pointer to the the mmapped data
       uint8_t *mmapptr;
 
@@ -75,6 +80,9 @@ class DiskDevice : public Device {
       // excess storage at the end of the file
       uint64_t excess_at_end;
 
+      // true if |direct_file| is used
+      bool direct_io;
+
       // Allow state to be swapped
       friend void swap(State& oldState, State& newState) 
       {
@@ -90,6 +98,7 @@ class DiskDevice : public Device {
       state.mapped_size = 0;
       state.file_size = 0;
       state.excess_at_end = 0;
+      state.direct_io = false;
       swap(m_state, state);
     }
 
@@ -101,6 +110,7 @@ class DiskDevice : public Device {
       file.create(config.filename.c_str(), config.file_mode);
       file.set_posix_advice(config.posix_advice);
       m_state.file = std::move(file);
+      m_state.direct_io = open_direct_file(m_state, false);
     }
 
     // opens an existing device
@@ -114,6 +124,7 @@ class DiskDevice : public Device {
       State state = std::move(m_state);
       state.file.open(config.filename.c_str(), read_only);
       state.file.set_posix_advice(config.posix_advice);
+      state.direct_io = open_direct_file(state, read_only);
 
       // the file size which backs the mapped ptr
       state.file_size = state.file.file_size();
@@ -156,6 +167,8 @@ class DiskDevice : public Device {
       if (state.mmapptr)
         state.file.munmap(state.mmapptr, state.mapped_size);
       state.file.close();
+      state.direct_file.close();
+      state.direct_io = false;
 
       swap(m_state, state);
     }
@@ -194,7 +207,7 @@ class DiskDevice : public Device {
     // reads from the device; this function does NOT use mmap
     virtual void read(uint64_t offset, void *buffer, size_t len) {
       ScopedSpinlock lock(m_mutex);
-      m_state.file.pread(offset, buffer, len);
+      file_for(offset, buffer, len).pread(offset, buffer, len);
 #ifdef UPS_ENABLE_ENCRYPTION
       if (config.is_encryption_enabled) {
         AesCipher aes(config.encryption_key, offset);
@@ -216,11 +229,34 @@ class DiskDevice : public Device {
         uint8_t *encryption_buffer = (uint8_t *)::alloca(len);
         AesCipher aes(config.encryption_key, offset);
         aes.encrypt((uint8_t *)buffer, encryption_buffer, len);
-        m_state.file.pwrite(offset, encryption_buffer, len);
+        file_for(offset, encryption_buffer, len).pwrite(offset,
+                        encryption_buffer, len);
         return;
       }
 #endif
-      m_state.file.pwrite(offset, buffer, len);
+      file_for(offset, buffer, len).pwrite(offset, buffer, len);
+    }
+
+    // writes multiple buffers with a single system call (if possible).
+    // Does not lock the device: positional writes are thread-safe, and
+    // the background flushers are supposed to write in parallel
+    virtual void writev(uint64_t offset, void **buffers, size_t *lengths,
+                    size_t count) {
+#ifdef UPS_ENABLE_ENCRYPTION
+      if (config.is_encryption_enabled) {
+        Device::writev(offset, buffers, lengths, count);
+        return;
+      }
+#endif
+      // a single unaligned buffer requires buffered I/O for the whole batch
+      uint64_t position = offset;
+      bool direct_io = m_state.direct_io;
+      for (size_t i = 0; direct_io && i < count; i++) {
+        direct_io = use_direct_io(position, buffers[i], lengths[i]);
+        position += lengths[i];
+      }
+      File &file = direct_io ? m_state.direct_file : m_state.file;
+      file.pwritev(offset, buffers, lengths, count);
     }
 
     // allocate storage from this device; this function
@@ -281,14 +317,14 @@ class DiskDevice : public Device {
 
       // this page is not in the mapped area; allocate a buffer
       if (page->data() == 0) {
-        // note that |p| will not leak if file.pread() throws; |p| is stored
-        // in the |page| object and will be cleaned up by the caller in
-        // case of an exception.
-        uint8_t *p = Memory::allocate<uint8_t>(config.page_size_bytes);
-        page->assign_allocated_buffer(p, address);
+        // note that the buffer will not leak if file.pread() throws; it is
+        // stored in the |page| object and will be cleaned up by the caller
+        // in case of an exception.
+        assign_buffer(page, address);
       }
 
-      m_state.file.pread(address, page->data(), config.page_size_bytes);
+      file_for(address, page->data(), config.page_size_bytes).pread(address,
+                      page->data(), config.page_size_bytes);
 #ifdef UPS_ENABLE_ENCRYPTION
       if (config.is_encryption_enabled) {
         AesCipher aes(config.encryption_key, page->address());
@@ -305,8 +341,7 @@ class DiskDevice : public Device {
       page->set_address(address);
 
       // allocate a memory buffer
-      uint8_t *p = Memory::allocate<uint8_t>(config.page_size_bytes);
-      page->assign_allocated_buffer(p, address);
+      assign_buffer(page, address);
     }
 
     // Frees a page on the device; plays counterpoint to |alloc_page|
@@ -335,7 +370,54 @@ class DiskDevice : public Device {
       return &m_state.mmapptr[address];
     }
 
-  private:
+  protected:
+    // Opens |state.direct_file| if direct I/O was requested; returns false
+    // if direct I/O is not used. The flags of a file handle are never
+    // changed after opening, because other threads (i.e. the background
+    // flushers) use the handles without locking the device.
+    bool open_direct_file(State &state, bool read_only) {
+      if (NOTSET(config.flags, UPS_ENABLE_DIRECT_IO))
+        return false;
+
+      File file;
+      if (!file.open_direct(config.filename.c_str(), read_only)) {
+        ups_log(("direct I/O is not supported, falling back to buffered "
+                    "I/O"));
+        return false;
+      }
+      state.direct_file = std::move(file);
+      return true;
+    }
+
+    // Returns true if a request can be performed with direct I/O
+    bool use_direct_io(uint64_t offset, const void *buffer, size_t len) const {
+      return m_state.direct_io
+              && offset % File::kDirectIoAlignment == 0
+              && len % File::kDirectIoAlignment == 0
+              && (uintptr_t)buffer % File::kDirectIoAlignment == 0;
+    }
+
+    // Returns the file handle for a request; requests which do not satisfy
+    // the alignment restrictions of direct I/O (i.e. the first bytes of
+    // the header page) use the buffered handle
+    File &file_for(uint64_t offset, const void *buffer, size_t len) {
+      return use_direct_io(offset, buffer, len)
+                ? m_state.direct_file
+                : m_state.file;
+    }
+
+    // Allocates a page buffer, either from the |buffer_pool| or from the
+    // heap, and assigns it to |page|
+    void assign_buffer(Page *page, uint64_t address) {
+      if (buffer_pool)
+        page->assign_allocated_buffer(buffer_pool->allocate(), address,
+                        buffer_pool);
+      else
+        page->assign_allocated_buffer(
+                    Memory::allocate<uint8_t>(config.page_size_bytes),
+                    address);
+    }
+
     // truncate/resize the device, sans locking
     void truncate_nolock(uint64_t new_file_size) {
       if (new_file_size > config.file_size_limit_bytes)
@@ -32,6 +32,7 @@
 #include "2config/env_config.h"
 #include "2device/device_disk.h"
 #include "2device/device_inmem.h"
+#include "2device/device_uring.h"
 
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
@@ -44,8 +45,12 @@ struct DeviceFactory {
   static Device *create(const EnvConfig &config) {
     if (ISSET(config.flags, UPS_IN_MEMORY))
       return new InMemoryDevice(config);
-    else
-      return new DiskDevice(config);
+#ifdef HAVE_LINUX_IO_URING_H
+    // falls back to the regular file I/O if io_uring is not available
+    return new UringDevice(config);
+#else
+    return new DiskDevice(config);
+#endif
   }
 };
 
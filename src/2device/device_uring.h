@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * Device-implementation for disk-based files which submits batches of
+ * page reads (cursor read-ahead) and page writes (changeset flushes,
+ * cache purges) through io_uring. All other operations are inherited
+ * from the DiskDevice.
+ *
+ * If io_uring is not available (or fails at runtime) then the device
+ * behaves exactly like a DiskDevice.
+ *
+ * @exception_safe: basic/strong
+ * @thread_safe: no
+ */
+
+#ifndef UPS_DEVICE_URING_H
+#define UPS_DEVICE_URING_H
+
+#include "0root/root.h"
+
+// Always verify that a file of level N does not include headers > N!
+#include "1os/io_ring.h"
+#include "2device/device_disk.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+class UringDevice : public DiskDevice {
+  enum {
+    // number of submission queue entries of the ring
+    kRingEntries = 128
+  };
+
+  public:
+    UringDevice(const EnvConfig &config)
+      : DiskDevice(config) {
+    }
+
+    // Create a new device
+    virtual void create() {
+      DiskDevice::create();
+      initialize_ring();
+    }
+
+    // opens an existing device
+    virtual void open() {
+      DiskDevice::open();
+      initialize_ring();
+    }
+
+    // closes the device
+    virtual void close() {
+      m_ring.close();
+      DiskDevice::close();
+    }
+
+    // Returns true if batches are submitted through io_uring
+    bool is_ring_active() const {
+      return m_ring.is_active();
+    }
+
+    // writes a batch of requests with a single submission. Does not lock
+    // the device (see DiskDevice::writev)
+    virtual size_t write_batch(IoRequest *requests, size_t count) {
+      File *file = use_ring() ? file_for(requests, count) : 0;
+      if (!file)
+        return DiskDevice::write_batch(requests, count);
+      return m_ring.write(file, requests, count);
+    }
+
+    // reads a batch of pages with a single submission; pages in the
+    // mapped area are not read but point directly into mapped memory
+    virtual void read_pages(Page **pages, uint64_t *addresses, size_t count) {
+      if (!use_ring()) {
+        DiskDevice::read_pages(pages, addresses, count);
+        return;
+      }
+
+      std::vector<IoRequest> requests;
+      requests.reserve(count);
+
+      {
+        ScopedSpinlock lock(m_mutex);
+        for (size_t i = 0; i < count; i++) {
+          if (addresses[i] < m_state.mapped_size && m_state.mmapptr != 0) {
+            pages[i]->assign_mapped_buffer(&m_state.mmapptr[addresses[i]],
+                            addresses[i]);
+            continue;
+          }
+
+          // see DiskDevice::read_page: the buffer is owned by the page
+          if (pages[i]->data() == 0)
+            assign_buffer(pages[i], addresses[i]);
+
+          IoRequest request;
+          request.offset = addresses[i];
+          request.buffer = pages[i]->data();
+          request.length = config.page_size_bytes;
+          requests.push_back(request);
+        }
+      }
+
+      if (requests.empty())
+        return;
+
+      // unaligned requests (with direct I/O) are read one by one
+      File *file = file_for(&requests[0], requests.size());
+      if (!file) {
+        for (size_t i = 0; i < requests.size(); i++)
+          DiskDevice::read(requests[i].offset, requests[i].buffer,
+                          requests[i].length);
+        return;
+      }
+
+      m_ring.read(file, &requests[0], requests.size());
+    }
+
+    // registers the buffers with the ring
+    virtual bool register_buffers(void **buffers, size_t *lengths,
+                    size_t count) {
+      return use_ring() && m_ring.register_buffers(buffers, lengths, count);
+    }
+
+  private:
+    // Sets up the ring; failures are not fatal
+    void initialize_ring() {
+      if (!m_ring.initialize(kRingEntries))
+        ups_trace(("io_uring is not available, using regular file I/O"));
+    }
+
+    // Returns the file handle for a batch of requests, or null if direct
+    // I/O is used but not all requests are aligned
+    File *file_for(IoRequest *requests, size_t count) {
+      if (!m_state.direct_io)
+        return &m_state.file;
+      for (size_t i = 0; i < count; i++) {
+        if (!use_direct_io(requests[i].offset, requests[i].buffer,
+                                requests[i].length))
+          return 0;
+      }
+      return &m_state.direct_file;
+    }
+
+    // Returns true if the ring can be used. Encrypted files are handled by
+    // the DiskDevice because the buffers are encrypted page by page.
+    bool use_ring() const {
+#ifdef UPS_ENABLE_ENCRYPTION
+      if (config.is_encryption_enabled)
+        return false;
+#endif
+      return m_ring.is_active();
+    }
+
+    // The io_uring instance
+    IoRing m_ring;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_DEVICE_URING_H */
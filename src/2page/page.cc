@@ -19,6 +19,7 @@
 #include "0root/root.h"
 
 #include <string.h>
+#include <algorithm>
 #include "3rdparty/murmurhash3/MurmurHash3.h"
 
 #include "1base/error.h"
@@ -29,10 +30,21 @@
 
 namespace upscaledb {
 
-uint64_t Page::ms_page_count_flushed = 0;
+boost::atomic<uint64_t> Page::ms_page_count_flushed(0);
+boost::atomic<uint64_t> Page::ms_flush_writes(0);
+boost::atomic<uint64_t> Page::ms_flush_write_usec(0);
+SlabPool Page::ms_object_pool(sizeof(Page), Page::kObjectPoolSlabSize);
+
+struct PageAddressComparator
+{
+  bool operator()(const Page *lhs, const Page *rhs) const {
+    return lhs->persisted_data.address < rhs->persisted_data.address;
+  }
+};
 
 Page::Page(Device *device, LocalDb *db)
-  : device_(device), db_(db), node_proxy_(0)
+  : device_(device), db_(db), node_proxy_(0), cache_queue_(0),
+    cache_timestamp_(0)
 {
   persisted_data.raw_data = 0;
   persisted_data.is_dirty = false;
@@ -79,27 +91,75 @@ void
 Page::flush()
 {
   if (persisted_data.is_dirty) {
-    // update crc32
-    if (ISSET(device_->config.flags, UPS_ENABLE_CRC32)
-        && likely(!persisted_data.is_without_header)) {
-      MurmurHash3_x86_32(persisted_data.raw_data->header.payload,
-                         persisted_data.size - (sizeof(PPageHeader) - 1),
-                         (uint32_t)persisted_data.address,
-                         &persisted_data.raw_data->header.crc32);
-    }
+    update_crc32();
+    uint64_t start = os_now_usec();
     device_->write(persisted_data.address, persisted_data.raw_data,
                     persisted_data.size);
+    ms_flush_write_usec += os_now_usec() - start;
+    ms_flush_writes++;
     persisted_data.is_dirty = false;
     ms_page_count_flushed++;
   }
 }
 
+void
+Page::flush(Device *device, std::vector<Page *> &pages)
+{
+  std::sort(pages.begin(), pages.end(), PageAddressComparator());
+
+  std::vector<Page *> dirty;
+  std::vector<IoRequest> requests;
+  dirty.reserve(pages.size());
+  requests.reserve(pages.size());
+
+  for (std::vector<Page *>::iterator it = pages.begin();
+                  it != pages.end();
+                  it++) {
+    Page *page = *it;
+    if (!page->persisted_data.is_dirty)
+      continue;
+    page->update_crc32();
+    IoRequest request;
+    request.offset = page->persisted_data.address;
+    request.buffer = page->persisted_data.raw_data;
+    request.length = page->persisted_data.size;
+    requests.push_back(request);
+    dirty.push_back(page);
+  }
+
+  if (requests.empty())
+    return;
+
+  // the device coalesces adjacent pages and submits the whole batch
+  uint64_t start = os_now_usec();
+  ms_flush_writes += device->write_batch(&requests[0], requests.size());
+  ms_flush_write_usec += os_now_usec() - start;
+
+  for (std::vector<Page *>::iterator it = dirty.begin();
+                  it != dirty.end();
+                  it++)
+    (*it)->persisted_data.is_dirty = false;
+  ms_page_count_flushed += dirty.size();
+}
+
+void
+Page::update_crc32()
+{
+  if (ISSET(device_->config.flags, UPS_ENABLE_CRC32)
+      && likely(!persisted_data.is_without_header)) {
+    MurmurHash3_x86_32(persisted_data.raw_data->header.payload,
+                       persisted_data.size - (sizeof(PPageHeader) - 1),
+                       (uint32_t)persisted_data.address,
+                       &persisted_data.raw_data->header.crc32);
+  }
+}
+
 void
 Page::free_buffer()
 {
-  if (node_proxy_) {
-    delete node_proxy_;
-    node_proxy_ = 0;
+  if (node_proxy()) {
+    delete node_proxy();
+    set_node_proxy(0);
   }
 }
 
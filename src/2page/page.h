@@ -21,11 +21,16 @@
 
 #include <string.h>
 #include <stdint.h>
+#include <vector>
 
 #include "1base/error.h"
 #include "1base/spinlock.h"
+#include "1base/optimistic_lock.h"
 #include "1mem/mem.h"
+#include "1mem/slab_pool.h"
 #include "1base/intrusive_list.h"
+#include "2device/device.h"
+#include "2page/page_buffer_pool.h"
 #include "3btree/btree_cursor.h"
 
 namespace upscaledb {
@@ -84,21 +89,26 @@ class Page {
     struct PersistedData {
       PersistedData()
         : address(0), size(0), is_dirty(false), is_allocated(false),
-          is_without_header(false), raw_data(0) {
+          is_without_header(false), raw_data(0), pool(0) {
       }
 
       PersistedData(const PersistedData &other)
         : address(other.address), size(other.size), is_dirty(other.is_dirty),
           is_allocated(other.is_allocated),
-          is_without_header(other.is_without_header), raw_data(other.raw_data) {
+          is_without_header(other.is_without_header), raw_data(other.raw_data),
+          pool(other.pool) {
       }
 
       ~PersistedData() {
 #ifdef NDEBUG
         mutex.safe_unlock();
 #endif
-        if (is_allocated)
-          Memory::release(raw_data);
+        if (is_allocated) {
+          if (pool)
+            pool->release(raw_data);
+          else
+            Memory::release(raw_data);
+        }
         raw_data = 0;
       }
 
@@ -123,6 +133,9 @@ class Page {
 
       // the persistent data of this page
       PPageData *raw_data;
+
+      // the pool which provided |raw_data| (if any)
+      PageBufferPool *pool;
     };
 
     // Misc. enums
@@ -132,6 +145,12 @@ class Page {
 
       // instruct Page::alloc() to reset the page with zeroes
       kInitializeWithZeroes,
+
+      // max. number of adjacent pages which are written with a single write
+      kMaxCoalescedPages      = Device::kMaxCoalescedBuffers,
+
+      // number of Page objects per slab of the |ms_object_pool|
+      kObjectPoolSlabSize     = 256,
     };
 
     // The various linked lists (indices in m_prev, m_next)
@@ -191,6 +210,17 @@ class Page {
     // Asserts that no cursors are attached.
     ~Page();
 
+    // Page objects are allocated from the |ms_object_pool|
+    static void *operator new(size_t size) {
+      assert(size == sizeof(Page));
+      return ms_object_pool.allocate();
+    }
+
+    static void operator delete(void *p) {
+      if (p)
+        ms_object_pool.release(p);
+    }
+
     // Returns the size of the usable persistent payload of a page
     // (page_size minus the overhead of the page header)
     uint32_t usable_page_size();
@@ -200,6 +230,12 @@ class Page {
       return persisted_data.mutex;
     }
 
+    // Returns the version lock; btree writers hold it while they modify
+    // the node, readers use it for optimistic lock coupling
+    OptimisticLock &version_lock() {
+      return version_lock_;
+    }
+
     // Returns the database which manages this page; can be NULL if this
     // page belongs to the Environment (i.e. for freelist-pages)
     LocalDb *db() {
@@ -301,12 +337,15 @@ class Page {
       persisted_data.is_without_header = is_without_header;
     }
 
-    // Assign a buffer which was allocated with malloc()
-    void assign_allocated_buffer(void *buffer, uint64_t address) {
+    // Assign a buffer which was allocated with malloc(), or taken from
+    // the |pool|
+    void assign_allocated_buffer(void *buffer, uint64_t address,
+                    PageBufferPool *pool = 0) {
       free_buffer();
       persisted_data.raw_data = (PPageData *)buffer;
       persisted_data.is_allocated = true;
       persisted_data.address = address;
+      persisted_data.pool = pool;
     }
 
     // Assign a buffer from mmapped storage
@@ -315,6 +354,7 @@ class Page {
       persisted_data.raw_data = (PPageData *)buffer;
       persisted_data.is_allocated = false;
       persisted_data.address = address;
+      persisted_data.pool = 0;
     }
 
     // Free resources associated with the buffer
@@ -330,14 +370,40 @@ class Page {
     // Flushes the page to disk, clears the "dirty" flag
     void flush();
 
+    // Flushes all dirty |pages| to the |device| and clears their "dirty"
+    // flags. The pages are sorted by address and handed to the device as a
+    // single batch; pages with adjacent addresses are written with a single
+    // vectored write (up to |kMaxCoalescedPages| pages per write)
+    static void flush(Device *device, std::vector<Page *> &pages);
+
     // Returns the cached BtreeNodeProxy
     BtreeNodeProxy *node_proxy() {
-      return node_proxy_;
+      return node_proxy_.load(boost::memory_order_acquire);
     }
 
     // Sets the cached BtreeNodeProxy
     void set_node_proxy(BtreeNodeProxy *proxy) {
-      node_proxy_ = proxy;
+      node_proxy_.store(proxy, boost::memory_order_release);
+    }
+
+    // Returns the eviction queue of the Cache which stores this page
+    int cache_queue() const {
+      return cache_queue_;
+    }
+
+    // Sets the eviction queue of the Cache which stores this page
+    void set_cache_queue(int queue) {
+      cache_queue_ = queue;
+    }
+
+    // Returns the time when the page was stored in the Cache
+    uint64_t cache_timestamp() const {
+      return cache_timestamp_;
+    }
+
+    // Sets the time when the page was stored in the Cache
+    void set_cache_timestamp(uint64_t timestamp) {
+      cache_timestamp_ = timestamp;
     }
 
     // Returns the next page in a linked list
@@ -351,7 +417,16 @@ class Page {
     }
 
     // tracks number of flushed pages
-    static uint64_t ms_page_count_flushed;
+    static boost::atomic<uint64_t> ms_page_count_flushed;
+
+    // tracks number of write calls issued by flush()
+    static boost::atomic<uint64_t> ms_flush_writes;
+
+    // tracks the accumulated latency of these writes (in microseconds)
+    static boost::atomic<uint64_t> ms_flush_write_usec;
+
+    // recycles the memory of deleted Page objects
+    static SlabPool ms_object_pool;
 
     // the persistent data of this page
     PersistedData persisted_data;
@@ -363,14 +438,27 @@ class Page {
     IntrusiveList<BtreeCursor> cursor_list;
 
   private:
+    // Updates the crc32 of the persisted page (if enabled)
+    void update_crc32();
+
     // the Device for allocating storage
     Device *device_;
 
     // the Database handle (can be NULL)
     LocalDb *db_;
 
-    // the cached BtreeNodeProxy object
-    BtreeNodeProxy *node_proxy_;
+    // the cached BtreeNodeProxy object; atomic because concurrent readers
+    // create it lazily
+    boost::atomic<BtreeNodeProxy *> node_proxy_;
+
+    // the version lock of the btree node stored in this page
+    OptimisticLock version_lock_;
+
+    // the eviction queue of the Cache; managed by the Cache
+    int cache_queue_;
+
+    // the time when the page was stored in the Cache (in microseconds)
+    uint64_t cache_timestamp_;
 };
 
 } // namespace upscaledb
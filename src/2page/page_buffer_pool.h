@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * A pool of aligned page buffers. The buffers are allocated in large slabs
+ * and recycled when pages are evicted from the cache, which avoids a
+ * malloc/free pair for each fetched page. The capacity follows the peak
+ * number of cached pages; when the cache is purged, slabs without used
+ * buffers are released till the capacity fits the cache size again.
+ *
+ * With direct I/O (UPS_ENABLE_DIRECT_IO), the first slab is preallocated
+ * for the whole cache and registered with the Device (see
+ * Device::register_buffers) to avoid mapping the buffers for each I/O
+ * request. Slabs which are added later are not registered; their buffers
+ * use regular I/O requests. Registering them would block the Device
+ * while it submits requests, and re-register all slabs with each growth.
+ *
+ * The pool is owned by the PageManager and must outlive all pages whose
+ * buffers it provided.
+ *
+ * @exception_safe: strong
+ * @thread_safe: yes
+ */
+
+#ifndef UPS_PAGE_BUFFER_POOL_H
+#define UPS_PAGE_BUFFER_POOL_H
+
+#include "0root/root.h"
+
+#include <vector>
+#include <algorithm>
+
+#include "ups/upscaledb_int.h"
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/spinlock.h"
+#include "1mem/mem.h"
+#include "1os/file.h"
+#include "2device/device.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+struct PageBufferPool {
+  enum {
+    // alignment of the slabs (and of the buffers, if the buffer size is
+    // a multiple of the alignment)
+    kAlignment = File::kDirectIoAlignment,
+
+    // number of buffers which are allocated when the pool grows
+    kSlabBuffers = 64
+  };
+
+  // Constructor; preallocates |preallocated| buffers of |buffer_size|
+  // bytes and attaches the pool to the |device|. If |register_slabs_| is
+  // true then the preallocated slab is registered with the |device|.
+  PageBufferPool(Device *device_, size_t buffer_size_, size_t preallocated,
+                  bool register_slabs_)
+    : device(device_), buffer_size(buffer_size_),
+      register_slabs(register_slabs_), capacity(0), in_use(0) {
+    device->buffer_pool = this;
+    if (preallocated > 0) {
+      grow(std::max(preallocated, (size_t)kSlabBuffers));
+      if (register_slabs)
+        device->register_buffers((void **)&slabs[0], &slab_sizes[0], 1);
+    }
+  }
+
+  // Destructor; releases all slabs. All buffers must have been returned.
+  ~PageBufferPool() {
+    assert(in_use == 0);
+    if (device->buffer_pool == this) {
+      if (register_slabs && !slabs.empty())
+        device->register_buffers(0, 0, 0);
+      device->buffer_pool = 0;
+    }
+    for (size_t i = 0; i < slabs.size(); i++)
+      Memory::release_aligned(slabs[i]);
+  }
+
+  // Returns an unused buffer; grows the pool if all buffers are in use
+  uint8_t *allocate() {
+    ScopedSpinlock lock(mutex);
+    if (free_list.empty())
+      grow(kSlabBuffers);
+    uint8_t *p = free_list.back();
+    free_list.pop_back();
+    in_use++;
+    return p;
+  }
+
+  // Returns a buffer to the pool
+  void release(void *buffer) {
+    ScopedSpinlock lock(mutex);
+    assert(in_use > 0);
+    free_list.push_back((uint8_t *)buffer);
+    in_use--;
+  }
+
+  // Releases slabs which have no buffers in use, till the capacity drops
+  // to |limit| buffers. The oldest slab (which is preallocated for direct
+  // I/O) is never released.
+  void trim(size_t limit) {
+    ScopedSpinlock lock(mutex);
+    if (capacity <= limit || slabs.size() <= 1)
+      return;
+
+    // count the unused buffers of each slab
+    std::vector<std::pair<uint8_t *, size_t> > ranges(slabs.size());
+    for (size_t i = 0; i < slabs.size(); i++)
+      ranges[i] = std::make_pair(slabs[i], i);
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<size_t> unused(slabs.size(), 0);
+    for (size_t i = 0; i < free_list.size(); i++)
+      unused[slab_of(ranges, free_list[i])]++;
+
+    // release the newest slabs first
+    std::vector<bool> released(slabs.size(), false);
+    bool any = false;
+    for (size_t i = slabs.size() - 1; i > 0 && capacity > limit; i--) {
+      size_t count = slab_sizes[i] / buffer_size;
+      if (unused[i] == count) {
+        released[i] = true;
+        capacity -= count;
+        any = true;
+      }
+    }
+    if (!any)
+      return;
+
+    size_t j = 0;
+    for (size_t i = 0; i < free_list.size(); i++) {
+      if (!released[slab_of(ranges, free_list[i])])
+        free_list[j++] = free_list[i];
+    }
+    free_list.resize(j);
+
+    j = 0;
+    for (size_t i = 0; i < slabs.size(); i++) {
+      if (released[i]) {
+        Memory::release_aligned(slabs[i]);
+        continue;
+      }
+      slabs[j] = slabs[i];
+      slab_sizes[j] = slab_sizes[i];
+      j++;
+    }
+    slabs.resize(j);
+    slab_sizes.resize(j);
+  }
+
+  // Returns the index of the slab which stores |buffer|; |ranges| are the
+  // slabs and their indices, sorted by address
+  static size_t slab_of(const std::vector<std::pair<uint8_t *, size_t> >
+                  &ranges, uint8_t *buffer) {
+    std::vector<std::pair<uint8_t *, size_t> >::const_iterator it
+            = std::upper_bound(ranges.begin(), ranges.end(),
+                    std::make_pair(buffer, ~(size_t)0));
+    assert(it != ranges.begin());
+    return (--it)->second;
+  }
+
+  // Fills in the current metrics
+  void fill_metrics(ups_env_metrics_t *metrics) {
+    ScopedSpinlock lock(mutex);
+    metrics->page_buffer_pool_capacity = capacity;
+    metrics->page_buffer_pool_in_use = in_use;
+  }
+
+  // Allocates a new slab with |count| buffers; the caller has to lock the
+  // pool (or own it exclusively)
+  void grow(size_t count) {
+    uint8_t *slab = Memory::allocate_aligned<uint8_t>(count * buffer_size,
+                    kAlignment);
+    slabs.push_back(slab);
+    slab_sizes.push_back(count * buffer_size);
+    free_list.reserve(free_list.size() + count);
+    for (size_t i = count; i > 0; i--)
+      free_list.push_back(slab + (i - 1) * buffer_size);
+    capacity += count;
+  }
+
+  // For serializing access
+  Spinlock mutex;
+
+  // The device which reads and writes the buffers
+  Device *device;
+
+  // The size of each buffer
+  size_t buffer_size;
+
+  // True if the preallocated slab is registered with the device
+  bool register_slabs;
+
+  // The slabs and their sizes
+  std::vector<uint8_t *> slabs;
+  std::vector<size_t> slab_sizes;
+
+  // The unused buffers
+  std::vector<uint8_t *> free_list;
+
+  // Total number of buffers
+  size_t capacity;
+
+  // Number of buffers which are currently in use
+  size_t in_use;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_PAGE_BUFFER_POOL_H */
@@ -0,0 +1,514 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+#include "0root/root.h"
+
+#ifdef HAVE_SSE2
+#  ifdef WIN32
+#    include <intrin.h>
+#  else
+#    include <x86intrin.h>
+#  endif
+#endif
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/error.h"
+#include "1os/os.h"
+#include "2simd/simd.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+#ifdef HAVE_SSE2
+
+// The kernels are compiled for their instruction set, independent of the
+// compiler flags. MSVC does not need this.
+#  ifdef WIN32
+#    define UPS_TARGET(isa)
+static inline int
+popcount32(uint32_t value)
+{
+  return (int)__popcnt(value);
+}
+#  else
+#    define UPS_TARGET(isa)   __attribute__((target(isa)))
+#    define popcount32(x)     __builtin_popcount(x)
+#  endif
+
+static inline int
+popcount64(uint64_t value)
+{
+  return popcount32((uint32_t)value) + popcount32((uint32_t)(value >> 32));
+}
+
+// The POPCNT instruction is not available on all SSE2 CPUs; the SSE2
+// kernels count the bits of their (16bit) masks without it
+static inline int
+popcount16(uint32_t value)
+{
+  value = value - ((value >> 1) & 0x5555);
+  value = (value & 0x3333) + ((value >> 2) & 0x3333);
+  value = (value + (value >> 4)) & 0x0f0f;
+  return (int)((value + (value >> 8)) & 0x1f);
+}
+
+#endif // HAVE_SSE2
+
+template<typename T>
+static int
+count_less_scalar(const T *data, int count, T key)
+{
+  int c = 0;
+  for (int i = 0; i < count; i++)
+    c += data[i] < key;
+  return c;
+}
+
+#ifdef HAVE_SSE2
+
+//
+// SSE2 kernels. SSE2 only has signed integer comparisons; unsigned
+// integers are compared after flipping their sign bit. SSE2 cannot compare
+// 64bit integers, therefore uint64_t uses the scalar kernel.
+//
+UPS_TARGET("sse2")
+static int
+count_less_sse2_u8(const uint8_t *data, int count, uint8_t key)
+{
+  __m128i bias = _mm_set1_epi8((char)0x80);
+  __m128i k = _mm_xor_si128(_mm_set1_epi8((char)key), bias);
+  int c = 0, i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&data[i]),
+                    bias);
+    c += popcount16(_mm_movemask_epi8(_mm_cmplt_epi8(v, k)));
+  }
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+UPS_TARGET("sse2")
+static int
+count_less_sse2_u16(const uint16_t *data, int count, uint16_t key)
+{
+  __m128i bias = _mm_set1_epi16((short)0x8000);
+  __m128i k = _mm_xor_si128(_mm_set1_epi16((short)key), bias);
+  int c = 0, i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&data[i]),
+                    bias);
+    // two mask bits per element
+    c += popcount16(_mm_movemask_epi8(_mm_cmplt_epi16(v, k))) / 2;
+  }
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+UPS_TARGET("sse2")
+static int
+count_less_sse2_u32(const uint32_t *data, int count, uint32_t key)
+{
+  __m128i bias = _mm_set1_epi32((int)0x80000000);
+  __m128i k = _mm_xor_si128(_mm_set1_epi32((int)key), bias);
+  int c = 0, i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&data[i]),
+                    bias);
+    c += popcount16(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, k))));
+  }
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+UPS_TARGET("sse2")
+static int
+count_less_sse2_float(const float *data, int count, float key)
+{
+  __m128 k = _mm_set1_ps(key);
+  int c = 0, i = 0;
+  for (; i + 4 <= count; i += 4)
+    c += popcount16(_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(&data[i]), k)));
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+UPS_TARGET("sse2")
+static int
+count_less_sse2_double(const double *data, int count, double key)
+{
+  __m128d k = _mm_set1_pd(key);
+  int c = 0, i = 0;
+  for (; i + 2 <= count; i += 2)
+    c += popcount16(_mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd(&data[i]), k)));
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+//
+// AVX2 kernels; like SSE2, but with 256bit registers and with support for
+// 64bit integers
+//
+UPS_TARGET("avx2,popcnt")
+static int
+count_less_avx2_u8(const uint8_t *data, int count, uint8_t key)
+{
+  __m256i bias = _mm256_set1_epi8((char)0x80);
+  __m256i k = _mm256_xor_si256(_mm256_set1_epi8((char)key), bias);
+  int c = 0, i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i v = _mm256_xor_si256(
+                    _mm256_loadu_si256((const __m256i *)&data[i]), bias);
+    c += popcount32(_mm256_movemask_epi8(_mm256_cmpgt_epi8(k, v)));
+  }
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+UPS_TARGET("avx2,popcnt")
+static int
+count_less_avx2_u16(const uint16_t *data, int count, uint16_t key)
+{
+  __m256i bias = _mm256_set1_epi16((short)0x8000);
+  __m256i k = _mm256_xor_si256(_mm256_set1_epi16((short)key), bias);
+  int c = 0, i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i v = _mm256_xor_si256(
+                    _mm256_loadu_si256((const __m256i *)&data[i]), bias);
+    // two mask bits per element
+    c += popcount32(_mm256_movemask_epi8(_mm256_cmpgt_epi16(k, v))) / 2;
+  }
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+UPS_TARGET("avx2,popcnt")
+static int
+count_less_avx2_u32(const uint32_t *data, int count, uint32_t key)
+{
+  __m256i bias = _mm256_set1_epi32((int)0x80000000);
+  __m256i k = _mm256_xor_si256(_mm256_set1_epi32((int)key), bias);
+  int c = 0, i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_xor_si256(
+                    _mm256_loadu_si256((const __m256i *)&data[i]), bias);
+    c += popcount32(_mm256_movemask_ps(
+                    _mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v))));
+  }
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+UPS_TARGET("avx2,popcnt")
+static int
+count_less_avx2_u64(const uint64_t *data, int count, uint64_t key)
+{
+  __m256i bias = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+  __m256i k = _mm256_xor_si256(_mm256_set1_epi64x((long long)key), bias);
+  int c = 0, i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i v = _mm256_xor_si256(
+                    _mm256_loadu_si256((const __m256i *)&data[i]), bias);
+    c += popcount32(_mm256_movemask_pd(
+                    _mm256_castsi256_pd(_mm256_cmpgt_epi64(k, v))));
+  }
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+UPS_TARGET("avx2,popcnt")
+static int
+count_less_avx2_float(const float *data, int count, float key)
+{
+  __m256 k = _mm256_set1_ps(key);
+  int c = 0, i = 0;
+  for (; i + 8 <= count; i += 8)
+    c += popcount32(_mm256_movemask_ps(
+                    _mm256_cmp_ps(_mm256_loadu_ps(&data[i]), k, _CMP_LT_OQ)));
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+UPS_TARGET("avx2,popcnt")
+static int
+count_less_avx2_double(const double *data, int count, double key)
+{
+  __m256d k = _mm256_set1_pd(key);
+  int c = 0, i = 0;
+  for (; i + 4 <= count; i += 4)
+    c += popcount32(_mm256_movemask_pd(
+                    _mm256_cmp_pd(_mm256_loadu_pd(&data[i]), k, _CMP_LT_OQ)));
+  return c + count_less_scalar(&data[i], count - i, key);
+}
+
+//
+// AVX-512 kernels. AVX-512 compares unsigned integers directly, and the
+// remaining elements are processed with masked loads (which do not fault
+// on the masked elements).
+//
+UPS_TARGET("avx512f,avx512bw,popcnt")
+static int
+count_less_avx512_u8(const uint8_t *data, int count, uint8_t key)
+{
+  __m512i k = _mm512_set1_epi8((char)key);
+  int c = 0, i = 0;
+  for (; i + 64 <= count; i += 64)
+    c += popcount64(_mm512_cmplt_epu8_mask(_mm512_loadu_si512(&data[i]), k));
+  if (i < count) {
+    __mmask64 m = ((__mmask64)1 << (count - i)) - 1;
+    c += popcount64(_mm512_mask_cmplt_epu8_mask(m,
+                    _mm512_maskz_loadu_epi8(m, &data[i]), k));
+  }
+  return c;
+}
+
+UPS_TARGET("avx512f,avx512bw,popcnt")
+static int
+count_less_avx512_u16(const uint16_t *data, int count, uint16_t key)
+{
+  __m512i k = _mm512_set1_epi16((short)key);
+  int c = 0, i = 0;
+  for (; i + 32 <= count; i += 32)
+    c += popcount32(_mm512_cmplt_epu16_mask(_mm512_loadu_si512(&data[i]), k));
+  if (i < count) {
+    __mmask32 m = ((__mmask32)1 << (count - i)) - 1;
+    c += popcount32(_mm512_mask_cmplt_epu16_mask(m,
+                    _mm512_maskz_loadu_epi16(m, &data[i]), k));
+  }
+  return c;
+}
+
+UPS_TARGET("avx512f,avx512bw,popcnt")
+static int
+count_less_avx512_u32(const uint32_t *data, int count, uint32_t key)
+{
+  __m512i k = _mm512_set1_epi32((int)key);
+  int c = 0, i = 0;
+  for (; i + 16 <= count; i += 16)
+    c += popcount32(_mm512_cmplt_epu32_mask(_mm512_loadu_si512(&data[i]), k));
+  if (i < count) {
+    __mmask16 m = (__mmask16)((1u << (count - i)) - 1);
+    c += popcount32(_mm512_mask_cmplt_epu32_mask(m,
+                    _mm512_maskz_loadu_epi32(m, &data[i]), k));
+  }
+  return c;
+}
+
+UPS_TARGET("avx512f,avx512bw,popcnt")
+static int
+count_less_avx512_u64(const uint64_t *data, int count, uint64_t key)
+{
+  __m512i k = _mm512_set1_epi64((long long)key);
+  int c = 0, i = 0;
+  for (; i + 8 <= count; i += 8)
+    c += popcount32(_mm512_cmplt_epu64_mask(_mm512_loadu_si512(&data[i]), k));
+  if (i < count) {
+    __mmask8 m = (__mmask8)((1u << (count - i)) - 1);
+    c += popcount32(_mm512_mask_cmplt_epu64_mask(m,
+                    _mm512_maskz_loadu_epi64(m, &data[i]), k));
+  }
+  return c;
+}
+
+UPS_TARGET("avx512f,avx512bw,popcnt")
+static int
+count_less_avx512_float(const float *data, int count, float key)
+{
+  __m512 k = _mm512_set1_ps(key);
+  int c = 0, i = 0;
+  for (; i + 16 <= count; i += 16)
+    c += popcount32(_mm512_cmp_ps_mask(_mm512_loadu_ps(&data[i]), k,
+                    _CMP_LT_OQ));
+  if (i < count) {
+    __mmask16 m = (__mmask16)((1u << (count - i)) - 1);
+    c += popcount32(_mm512_mask_cmp_ps_mask(m,
+                    _mm512_maskz_loadu_ps(m, &data[i]), k, _CMP_LT_OQ));
+  }
+  return c;
+}
+
+UPS_TARGET("avx512f,avx512bw,popcnt")
+static int
+count_less_avx512_double(const double *data, int count, double key)
+{
+  __m512d k = _mm512_set1_pd(key);
+  int c = 0, i = 0;
+  for (; i + 8 <= count; i += 8)
+    c += popcount32(_mm512_cmp_pd_mask(_mm512_loadu_pd(&data[i]), k,
+                    _CMP_LT_OQ));
+  if (i < count) {
+    __mmask8 m = (__mmask8)((1u << (count - i)) - 1);
+    c += popcount32(_mm512_mask_cmp_pd_mask(m,
+                    _mm512_maskz_loadu_pd(m, &data[i]), k, _CMP_LT_OQ));
+  }
+  return c;
+}
+
+#endif // HAVE_SSE2
+
+//
+// The kernels and thresholds of a key type, indexed by the instruction set
+//
+template<typename T>
+struct SimdKernels {
+  typedef int (*CountLess)(const T *data, int count, T key);
+
+  // The kernels
+  static CountLess count_less[kSimdMax];
+
+  // Ranges with less elements are searched with the kernel
+  static int threshold[kSimdMax];
+};
+
+#ifdef HAVE_SSE2
+#  define SIMD_KERNELS(type, sse2, avx2, avx512)                          \
+  template<> SimdKernels<type>::CountLess                                 \
+  SimdKernels<type>::count_less[kSimdMax] = {                             \
+    count_less_scalar<type>, sse2, avx2, avx512                           \
+  };
+#else
+#  define SIMD_KERNELS(type, sse2, avx2, avx512)                          \
+  template<> SimdKernels<type>::CountLess                                 \
+  SimdKernels<type>::count_less[kSimdMax] = {                             \
+    count_less_scalar<type>, count_less_scalar<type>,                     \
+    count_less_scalar<type>, count_less_scalar<type>                      \
+  };
+#endif
+
+SIMD_KERNELS(uint8_t, count_less_sse2_u8, count_less_avx2_u8,
+                count_less_avx512_u8)
+SIMD_KERNELS(uint16_t, count_less_sse2_u16, count_less_avx2_u16,
+                count_less_avx512_u16)
+SIMD_KERNELS(uint32_t, count_less_sse2_u32, count_less_avx2_u32,
+                count_less_avx512_u32)
+SIMD_KERNELS(uint64_t, count_less_scalar<uint64_t>, count_less_avx2_u64,
+                count_less_avx512_u64)
+SIMD_KERNELS(float, count_less_sse2_float, count_less_avx2_float,
+                count_less_avx512_float)
+SIMD_KERNELS(double, count_less_sse2_double, count_less_avx2_double,
+                count_less_avx512_double)
+
+// The thresholds for scalar, SSE2, AVX2 and AVX-512 (determined with
+// unittests/simd_bench)
+#define SIMD_THRESHOLDS(type, scalar, sse2, avx2, avx512)                 \
+  template<> int                                                          \
+  SimdKernels<type>::threshold[kSimdMax] = {scalar, sse2, avx2, avx512};
+
+SIMD_THRESHOLDS(uint8_t,    32,  64, 256, 256)
+SIMD_THRESHOLDS(uint16_t,   32,  64, 128, 256)
+SIMD_THRESHOLDS(uint32_t,   16,  32,  64, 128)
+SIMD_THRESHOLDS(uint64_t,   32,  32,  64,  64)
+SIMD_THRESHOLDS(float,      16,  16,  64, 128)
+SIMD_THRESHOLDS(double,     16,  16,  64, 128)
+
+int
+simd_detect_isa()
+{
+#ifdef HAVE_SSE2
+  if (os_has_avx512())
+    return kSimdAvx512;
+  if (os_has_avx2())
+    return kSimdAvx2;
+  return kSimdSse2;
+#else
+  return kSimdScalar;
+#endif
+}
+
+// The selected instruction set
+static int g_isa = simd_detect_isa();
+
+int
+simd_isa()
+{
+  return g_isa;
+}
+
+void
+simd_select_isa(int isa)
+{
+  int detected = simd_detect_isa();
+  g_isa = isa < 0 ? kSimdScalar : (isa > detected ? detected : isa);
+}
+
+const char *
+simd_isa_name(int isa)
+{
+  switch (isa) {
+    case kSimdScalar:
+      return "scalar";
+    case kSimdSse2:
+      return "sse2";
+    case kSimdAvx2:
+      return "avx2";
+    case kSimdAvx512:
+      return "avx512";
+    default:
+      return "unknown";
+  }
+}
+
+template<typename T>
+int
+simd_threshold(int isa)
+{
+  return SimdKernels<T>::threshold[isa];
+}
+
+template<typename T>
+void
+simd_set_threshold(int isa, int threshold)
+{
+  SimdKernels<T>::threshold[isa] = threshold;
+}
+
+template<typename T>
+int
+simd_count_less(int isa, const T *data, int count, T key)
+{
+  assert(isa <= simd_detect_isa());
+  return SimdKernels<T>::count_less[isa](data, count, key);
+}
+
+template<typename T>
+int
+simd_lower_bound(const T *data, int count, T key)
+{
+  int isa = g_isa;
+  int threshold = SimdKernels<T>::threshold[isa];
+
+  // binary search till the remaining range is small enough
+  int l = 0, r = count;
+  while (r - l > threshold) {
+    int middle = (l + r) / 2;
+    if (data[middle] < key)
+      l = middle + 1;
+    else
+      r = middle;
+  }
+
+  // then count the smaller keys in the remaining range
+  return l + SimdKernels<T>::count_less[isa](&data[l], r - l, key);
+}
+
+#define SIMD_INSTANTIATE(type)                                            \
+  template int simd_threshold<type>(int);                                 \
+  template void simd_set_threshold<type>(int, int);                       \
+  template int simd_count_less<type>(int, const type *, int, type);       \
+  template int simd_lower_bound<type>(const type *, int, type);
+
+SIMD_INSTANTIATE(uint8_t)
+SIMD_INSTANTIATE(uint16_t)
+SIMD_INSTANTIATE(uint32_t)
+SIMD_INSTANTIATE(uint64_t)
+SIMD_INSTANTIATE(float)
+SIMD_INSTANTIATE(double)
+
+} // namespace upscaledb
@@ -17,7 +17,11 @@
  */
 
 /*
- * The worker thread
+ * The worker threads
+ *
+ * The pool has several queues (boost::asio strands). Jobs in the same
+ * queue are executed one after another, jobs in different queues are
+ * executed in parallel.
  */
 
 #ifndef UPS_WORKER_H
@@ -26,9 +30,11 @@
 #include "0root/root.h"
 
 #include <boost/asio.hpp>
+#include <boost/atomic.hpp>
 #include <boost/thread/thread.hpp>
 
 // Always verify that a file of level N does not include headers > N!
+#include "1base/mutex.h"
 #include "2worker/workitem.h"
 
 #ifndef UPS_ROOT_H
@@ -52,27 +58,101 @@ struct WorkerThread {
  
 // the actual thread pool
 struct WorkerPool {
-  // the constructor just launches some amount of workers
+#if BOOST_VERSION < 106600
+  typedef boost::asio::strand Strand;
+#else
+  typedef boost::asio::io_context::strand Strand;
+#endif
+
+  // Wraps a job; keeps track of the number of pending jobs
+  template<typename F>
+  struct Job {
+    Job(WorkerPool *pool_, const F &f_)
+      : pool(pool_), f(f_) {
+    }
+
+    void operator()() {
+      try {
+        f();
+      }
+      catch (...) {
+        pool->job_done();
+        throw;
+      }
+      pool->job_done();
+    }
+
+    WorkerPool *pool;
+    F f;
+  };
+
+  // the constructor launches |num_threads| workers; each of them has its
+  // own queue
   WorkerPool(size_t num_threads)
-    : working(service), strand(service) {
+    : working(service), next_queue(0), pending(0), peak_pending(0) {
+    for (size_t i = 0; i < num_threads; ++i)
+      strands.push_back(new Strand(service));
     for (size_t i = 0; i < num_threads; ++i)
       workers.push_back(new boost::thread(WorkerThread(*this)));
   }
 
-  // Add a new work item to the pool
-  template<typename F>
-  void enqueue(F &f) {
-    strand.post(f);
-  }
-
-  // the destructor joins all threads
+  // the destructor waits till all jobs are completed, then joins all threads
   ~WorkerPool() {
+    wait();
     service.stop();
 
     for (size_t i = 0; i < workers.size(); ++i) {
       workers[i]->join();
       delete workers[i];
     }
+    for (size_t i = 0; i < strands.size(); ++i)
+      delete strands[i];
+  }
+
+  // Adds a new work item to the pool; the queues are used round-robin
+  template<typename F>
+  void enqueue(const F &f) {
+    enqueue(next_queue++, f);
+  }
+
+  // Adds a new work item to a specific queue
+  template<typename F>
+  void enqueue(size_t queue, const F &f) {
+    size_t depth = ++pending;
+    size_t peak = peak_pending;
+    while (depth > peak && !peak_pending.compare_exchange_weak(peak, depth))
+      ;
+    strands[queue % strands.size()]->post(Job<F>(this, f));
+  }
+
+  // Returns the number of queues
+  size_t queue_count() const {
+    return strands.size();
+  }
+
+  // Returns the number of jobs which were not yet completed
+  size_t queue_depth() const {
+    return pending;
+  }
+
+  // Returns the maximum number of pending jobs
+  size_t peak_queue_depth() const {
+    return peak_pending;
+  }
+
+  // Blocks till all pending jobs were completed
+  void wait() {
+    ScopedLock lock(mutex);
+    while (pending > 0)
+      idle.wait(lock);
+  }
+
+  // Called by Job when a job was completed
+  void job_done() {
+    if (--pending == 0) {
+      ScopedLock lock(mutex);
+      idle.notify_all();
+    }
   }
 
   // keep track of the threads so we can join them
@@ -81,11 +161,22 @@ struct WorkerPool {
   // the io_service we are wrapping
   boost::asio::io_service service;
   boost::asio::io_service::work working;
-#if BOOST_VERSION < 106600
-  boost::asio::strand strand;
-#else
-  boost::asio::io_context::strand strand;
-#endif
+
+  // the queues
+  std::vector<Strand *> strands;
+
+  // the queue for the next job (for round-robin scheduling)
+  boost::atomic<size_t> next_queue;
+
+  // the number of pending jobs
+  boost::atomic<size_t> pending;
+
+  // the maximum number of pending jobs
+  boost::atomic<size_t> peak_pending;
+
+  // for waiting till all jobs are completed
+  Mutex mutex;
+  Condition idle;
 };
 
 inline void
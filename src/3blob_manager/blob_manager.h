@@ -179,8 +179,9 @@ struct BlobManager {
   // Usage tracking - number of blobs allocated
   uint64_t metric_total_allocated;
 
-  // Usage tracking - number of blobs read
-  uint64_t metric_total_read;
+  // Usage tracking - number of blobs read; atomic because concurrent
+  // readers update it
+  boost::atomic<uint64_t> metric_total_read;
 };
 
 } // namespace upscaledb
@@ -65,8 +65,8 @@ check_integrity(DiskBlobManager *dbm, PBlobPageHeader *header)
       continue;
     }
     total_sizes += header->freelist[i].size;
-    ranges.push_back(std::make_pair(header->freelist[i].offset,
-                header->freelist[i].size));
+    ranges.push_back(Range((uint32_t)header->freelist[i].offset,
+                (uint32_t)header->freelist[i].size));
   }
 
   // the sum of freelist chunks must not exceed total number of free bytes
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+#include "0root/root.h"
+
+#include <algorithm>
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/error.h"
+#include "2page/page.h"
+#include "3page_manager/page_manager.h"
+#include "3btree/btree_index.h"
+#include "3btree/btree_node_proxy.h"
+#include "3btree/btree_bulk_load.h"
+#include "4db/db_local.h"
+#include "4env/env_local.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+BtreeBulkLoader::BtreeBulkLoader(BtreeIndex *btree_, Context *context_,
+                uint32_t fill_factor_)
+  : BtreeUpdateAction(btree_, context_, 0, 0), fill_factor(fill_factor_),
+    has_last_key(false), page_counter(0)
+{
+  if (fill_factor == 0 || fill_factor > 100)
+    fill_factor = kDefaultFillFactor;
+  ::memset(&last_key, 0, sizeof(last_key));
+  ::memset(&hints, 0, sizeof(hints));
+  load_spine();
+}
+
+ups_status_t
+BtreeBulkLoader::append(ups_key_t *key, ups_record_t *record)
+{
+  if (has_last_key) {
+    int cmp = btree->compare_keys(key, &last_key);
+    if (unlikely(cmp < 0)) {
+      ups_trace(("keys are not sorted"));
+      return UPS_INV_PARAMETER;
+    }
+    if (unlikely(cmp == 0))
+      return append_duplicate(key, record);
+  }
+
+  append_to_level(0, key, record);
+
+  last_key_arena.copy((uint8_t *)key->data, key->size);
+  last_key.data = last_key_arena.data();
+  last_key.size = key->size;
+  has_last_key = true;
+  return 0;
+}
+
+void
+BtreeBulkLoader::load_spine()
+{
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+
+  // descend along the right edge of the tree
+  std::vector<uint64_t> path;
+  Page *page = btree->root_page(context);
+  BtreeNodeProxy *node = btree->get_node_from_page(page);
+  while (true) {
+    path.push_back(page->address());
+    if (node->is_leaf())
+      break;
+    uint64_t child = node->length() > 0
+                        ? node->record_id(context, node->length() - 1)
+                        : node->left_child();
+    page = env->page_manager->fetch(context, child);
+    node = btree->get_node_from_page(page);
+  }
+  spine.assign(path.rbegin(), path.rend());
+
+  // the largest key is stored in the right-most leaf which is not empty
+  while (node->length() == 0 && node->left_sibling() != 0) {
+    page = env->page_manager->fetch(context, node->left_sibling());
+    node = btree->get_node_from_page(page);
+  }
+  has_last_key = node->length() > 0;
+  if (has_last_key)
+    node->key(context, node->length() - 1, &last_key_arena, &last_key);
+}
+
+ups_status_t
+BtreeBulkLoader::append_duplicate(ups_key_t *key, ups_record_t *record)
+{
+  if (NOTSET(btree->db()->flags(), UPS_ENABLE_DUPLICATE_KEYS))
+    return UPS_DUPLICATE_KEY;
+
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+  Page *page = env->page_manager->fetch(context, spine[0]);
+
+  ups_status_t st = UPS_LIMITS_REACHED;
+  if (btree->get_node_from_page(page)->length() > 0) {
+    hints.flags = UPS_DUPLICATE | UPS_DUPLICATE_INSERT_LAST;
+    try {
+      st = insert_in_page(page, key, record, hints);
+    }
+    catch (Exception &ex) {
+      if (ex.code != UPS_LIMITS_REACHED)
+        throw ex;
+    }
+  }
+
+  // the duplicate does not fit into the right-most leaf (or the key is
+  // stored in a different leaf): perform a regular insert, which might
+  // split the leaf, and re-read the spine
+  if (st == UPS_LIMITS_REACHED) {
+    st = btree->insert(context, 0, key, record,
+                    UPS_DUPLICATE | UPS_DUPLICATE_INSERT_LAST);
+    load_spine();
+  }
+  return st;
+}
+
+void
+BtreeBulkLoader::append_to_level(size_t level, ups_key_t *key,
+                ups_record_t *record)
+{
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+  Page *page = env->page_manager->fetch(context, spine[level]);
+
+  if (!is_full(page)) {
+    ups_status_t st = append_to_page(page, key, record);
+    if (likely(st == 0))
+      return;
+    if (st != UPS_LIMITS_REACHED)
+      throw Exception(st);
+  }
+
+  page = start_page(level, key, record);
+
+  // leaf pages store the key; internal pages store the record as their
+  // left child, and |key| was moved to the next level
+  if (level == 0) {
+    ups_status_t st = append_to_page(page, key, record);
+    if (unlikely(st != 0))
+      throw Exception(st);
+  }
+}
+
+ups_status_t
+BtreeBulkLoader::append_to_page(Page *page, ups_key_t *key,
+                ups_record_t *record)
+{
+  hints.flags = 0;
+  try {
+    return insert_in_page(page, key, record, hints, false, true);
+  }
+  catch (Exception &ex) {
+    if (ex.code == UPS_LIMITS_REACHED)
+      return UPS_LIMITS_REACHED;
+    throw ex;
+  }
+}
+
+Page *
+BtreeBulkLoader::start_page(size_t level, ups_key_t *key,
+                ups_record_t *record)
+{
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+  Page *old_page = env->page_manager->fetch(context, spine[level]);
+  BtreeNodeProxy *old_node = btree->get_node_from_page(old_page);
+
+  Page *new_page = env->page_manager->alloc(context, Page::kTypeBindex);
+  {
+    ScopedOptimisticWriteLock new_lock(new_page->version_lock());
+    PBtreeNode *node = PBtreeNode::from_page(new_page);
+    node->set_flags(level == 0 ? PBtreeNode::kLeafNode : 0);
+
+    BtreeNodeProxy *new_node = btree->get_node_from_page(new_page);
+    if (level > 0) {
+      assert(record->size == sizeof(uint64_t));
+      new_node->set_left_child(*(uint64_t *)record->data);
+    }
+    new_node->set_left_sibling(old_page->address());
+
+    ScopedOptimisticWriteLock old_lock(old_page->version_lock());
+    old_node->set_right_sibling(new_page->address());
+    old_page->set_dirty(true);
+  }
+
+  spine[level] = new_page->address();
+  page_counter++;
+
+  // the old page was the root? then allocate a new root
+  if (level + 1 == spine.size())
+    spine.push_back(allocate_new_root(old_page)->address());
+
+  // push the separator to the next level
+  uint64_t rid = new_page->address();
+  ups_record_t separator = ups_make_record(&rid, sizeof(rid));
+  append_to_level(level + 1, key, &separator);
+
+  return new_page;
+}
+
+bool
+BtreeBulkLoader::is_full(Page *page)
+{
+  // a completely filled page is detected when the insert fails; the
+  // estimated capacity is not precise for all layouts
+  if (fill_factor == 100)
+    return false;
+
+  BtreeNodeProxy *node = btree->get_node_from_page(page);
+  size_t length = node->length();
+  if (length == 0)
+    return false;
+  size_t limit = node->estimate_capacity() * fill_factor / 100;
+  return length >= std::max(limit, (size_t)1);
+}
+
+} // namespace upscaledb
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * Bulk loading of sorted key/record pairs (ups_db_bulk_load).
+ *
+ * The loader appends the keys to the right edge of the btree. Leaf pages
+ * are packed up to a fill factor; whenever a page is full, a new sibling is
+ * started and its first key is pushed as a separator to the next level.
+ * The internal levels are therefore built bottom-up, without descending
+ * from the root and without splitting pages.
+ *
+ * The right-most page of each level (the "spine") is tracked by address,
+ * which allows the caller to release the pages (i.e. by flushing the
+ * Changeset) between two calls to append().
+ */
+
+#ifndef UPS_BTREE_BULK_LOAD_H
+#define UPS_BTREE_BULK_LOAD_H
+
+#include "0root/root.h"
+
+#include <vector>
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/dynamic_array.h"
+#include "3btree/btree_stats.h"
+#include "3btree/btree_update.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+struct BtreeBulkLoader : public BtreeUpdateAction {
+  enum {
+    // the default fill factor (in percent)
+    kDefaultFillFactor = 100
+  };
+
+  // Constructor; the pages are filled up to |fill_factor| percent of
+  // their estimated capacity
+  BtreeBulkLoader(BtreeIndex *btree, Context *context, uint32_t fill_factor);
+
+  // Appends a key/record pair. The |key| must not be smaller than the
+  // previously appended key (or than any key which is already stored in
+  // the btree). If it is equal then it's stored as a duplicate.
+  ups_status_t append(ups_key_t *key, ups_record_t *record);
+
+  // Returns the number of pages which were started by the loader
+  uint64_t page_count() const {
+    return page_counter;
+  }
+
+  private:
+    // Reads the right-most page of each level and the largest key
+    void load_spine();
+
+    // Appends a duplicate of the previous key
+    ups_status_t append_duplicate(ups_key_t *key, ups_record_t *record);
+
+    // Appends |key| and |record| to the right-most page of |level|. Starts
+    // a new page if the current one is full.
+    void append_to_level(size_t level, ups_key_t *key, ups_record_t *record);
+
+    // Tries to append |key| and |record| to |page|; returns
+    // UPS_LIMITS_REACHED if the page is full
+    ups_status_t append_to_page(Page *page, ups_key_t *key,
+                    ups_record_t *record);
+
+    // Starts a new right-most page at |level| and pushes |key| as the
+    // separator to the next level. Internal pages do not store |key|;
+    // their left child is set to |record|.
+    Page *start_page(size_t level, ups_key_t *key, ups_record_t *record);
+
+    // Returns true if |page| is filled up to the fill factor
+    bool is_full(Page *page);
+
+    // The fill factor (in percent)
+    uint32_t fill_factor;
+
+    // Addresses of the right-most page of each level; the leaf is at index 0
+    std::vector<uint64_t> spine;
+
+    // A copy of the last key, for verifying the sort order
+    ByteArray last_key_arena;
+    ups_key_t last_key;
+    bool has_last_key;
+
+    // Number of started pages
+    uint64_t page_counter;
+
+    // The hints for BtreeUpdateAction::insert_in_page()
+    BtreeStatistics::InsertHints hints;
+};
+
+} // namespace upscaledb
+
+#endif // UPS_BTREE_BULK_LOAD_H
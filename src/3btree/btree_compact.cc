@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+#include "0root/root.h"
+
+#include <string.h>
+#include <vector>
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/error.h"
+#include "2page/page.h"
+#include "3page_manager/page_manager.h"
+#include "3btree/btree_index.h"
+#include "3btree/btree_node_proxy.h"
+#include "3btree/btree_compact.h"
+#include "4db/db_local.h"
+#include "4env/env_local.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+BtreeCompactAction::BtreeCompactAction(BtreeIndex *btree_, Context *context_)
+  : BtreeUpdateAction(btree_, context_, 0, 0), page_counter(0)
+{
+}
+
+bool
+BtreeCompactAction::run()
+{
+  Page *parent = find_parent();
+  if (!parent) {
+    btree->state.has_compaction_key = false;
+    return false;
+  }
+
+  compact_children(parent);
+
+  if (store_position(parent))
+    return true;
+
+  // the right edge was reached; if all leaves were merged into a single
+  // page then it becomes the new root
+  if (parent == btree->root_page(context)
+        && btree->get_node_from_page(parent)->length() == 0)
+    collapse_root(parent);
+  return false;
+}
+
+Page *
+BtreeCompactAction::find_parent()
+{
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+
+  Page *page = btree->root_page(context);
+  BtreeNodeProxy *node = btree->get_node_from_page(page);
+
+  // if the root page is empty with children then collapse it
+  while (!node->is_leaf() && node->length() == 0) {
+    page = collapse_root(page);
+    node = btree->get_node_from_page(page);
+  }
+
+  if (node->is_leaf())
+    return 0;
+
+  ups_key_t key = {0};
+  key.data = btree->state.compaction_key.data();
+  key.size = (uint16_t)btree->state.compaction_key.size();
+
+  // descend till the children are leaves
+  while (true) {
+    Page *child;
+    if (btree->state.has_compaction_key)
+      child = btree->find_lower_bound(context, page, &key, 0, 0);
+    else
+      child = env->page_manager->fetch(context, node->left_child());
+
+    if (btree->get_node_from_page(child)->is_leaf())
+      return page;
+
+    page = child;
+    node = btree->get_node_from_page(page);
+  }
+}
+
+void
+BtreeCompactAction::compact_children(Page *parent)
+{
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+  BtreeNodeProxy *parent_node = btree->get_node_from_page(parent);
+
+  // read all children with a single batch
+  if (NOTSET(env->config.flags, UPS_IN_MEMORY)) {
+    std::vector<uint64_t> children;
+    children.reserve(parent_node->length() + 1);
+    children.push_back(parent_node->left_child());
+    for (uint32_t i = 0; i < parent_node->length(); i++)
+      children.push_back(parent_node->record_id(context, i));
+    env->page_manager->prefetch(context, &children[0], children.size());
+  }
+
+  // |page| is the child at |slot|; the left child has slot -1
+  int slot = -1;
+  Page *page = env->page_manager->fetch(context, parent_node->left_child());
+  page_counter++;
+
+  while (slot + 1 < (int)parent_node->length()) {
+    Page *sibling = env->page_manager->fetch(context,
+                    parent_node->record_id(context, slot + 1));
+    page_counter++;
+
+    BtreeNodeProxy *node = btree->get_node_from_page(page);
+    BtreeNodeProxy *sib_node = btree->get_node_from_page(sibling);
+
+    // move the keys of the sibling to this page, then continue with the
+    // next sibling
+    if (node->can_merge_from(sib_node)) {
+      ScopedOptimisticWriteLock lock(parent->version_lock());
+      merge_page(page, sibling);
+      parent_node->erase(context, slot + 1);
+      parent->set_dirty(true);
+      continue;
+    }
+
+    // the sibling does not fit into this (empty) page; remove the page
+    // instead. The sibling then moves to |slot|.
+    if (node->length() == 0) {
+      remove_leaf(parent, slot, page);
+      page = sibling;
+      continue;
+    }
+
+    relocate_leaf(parent, slot, page);
+    page = sibling;
+    slot++;
+  }
+
+  relocate_leaf(parent, slot, page);
+}
+
+void
+BtreeCompactAction::remove_leaf(Page *parent, int slot, Page *page)
+{
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+  BtreeNodeProxy *parent_node = btree->get_node_from_page(parent);
+  BtreeNodeProxy *node = btree->get_node_from_page(page);
+  assert(node->length() == 0);
+
+  ScopedOptimisticWriteLock parent_lock(parent->version_lock());
+  ScopedOptimisticWriteLock page_lock(page->version_lock());
+
+  BtreeCursor::uncouple_all_cursors(context, page, 0);
+
+  // the right sibling takes over the range of the removed page
+  if (slot == -1) {
+    parent_node->set_left_child(parent_node->record_id(context, 0));
+    parent_node->erase(context, 0);
+  }
+  else
+    parent_node->erase(context, slot);
+  parent->set_dirty(true);
+
+  // fix the linked list
+  if (node->left_sibling()) {
+    Page *p = env->page_manager->fetch(context, node->left_sibling());
+    ScopedOptimisticWriteLock lock(p->version_lock());
+    btree->get_node_from_page(p)->set_right_sibling(node->right_sibling());
+    p->set_dirty(true);
+  }
+  if (node->right_sibling()) {
+    Page *p = env->page_manager->fetch(context, node->right_sibling());
+    ScopedOptimisticWriteLock lock(p->version_lock());
+    btree->get_node_from_page(p)->set_left_sibling(node->left_sibling());
+    p->set_dirty(true);
+  }
+
+  btree->reset_batch_leaf();
+  btree->statistics()->reset_page(page->address());
+  env->page_manager->del(context, page);
+
+  Globals::ms_btree_smo_merge++;
+}
+
+Page *
+BtreeCompactAction::relocate_leaf(Page *parent, int slot, Page *page)
+{
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+
+  // only move the page if this frees space at the end of the file
+  uint64_t address = env->page_manager->first_free_page();
+  if (address == 0 || address > page->address())
+    return page;
+
+  BtreeNodeProxy *parent_node = btree->get_node_from_page(parent);
+  Page *new_page = env->page_manager->alloc(context, Page::kTypeBindex);
+
+  ScopedOptimisticWriteLock parent_lock(parent->version_lock());
+  ScopedOptimisticWriteLock page_lock(page->version_lock());
+  ScopedOptimisticWriteLock new_lock(new_page->version_lock());
+
+  BtreeCursor::uncouple_all_cursors(context, page, 0);
+
+  ::memcpy(new_page->payload(), page->payload(), page->usable_page_size());
+  new_page->set_dirty(true);
+
+  if (slot == -1)
+    parent_node->set_left_child(new_page->address());
+  else
+    parent_node->set_record_id(context, slot, new_page->address());
+  parent->set_dirty(true);
+
+  // fix the linked list
+  BtreeNodeProxy *node = btree->get_node_from_page(new_page);
+  if (node->left_sibling()) {
+    Page *p = env->page_manager->fetch(context, node->left_sibling());
+    ScopedOptimisticWriteLock lock(p->version_lock());
+    btree->get_node_from_page(p)->set_right_sibling(new_page->address());
+    p->set_dirty(true);
+  }
+  if (node->right_sibling()) {
+    Page *p = env->page_manager->fetch(context, node->right_sibling());
+    ScopedOptimisticWriteLock lock(p->version_lock());
+    btree->get_node_from_page(p)->set_left_sibling(new_page->address());
+    p->set_dirty(true);
+  }
+
+  btree->reset_batch_leaf();
+  btree->statistics()->reset_page(page->address());
+  env->page_manager->del(context, page);
+
+  Globals::ms_btree_smo_relocate++;
+  return new_page;
+}
+
+bool
+BtreeCompactAction::store_position(Page *parent)
+{
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+  BtreeNodeProxy *node = btree->get_node_from_page(parent);
+
+  // skip internal nodes without keys; their only child cannot be merged
+  uint64_t address = node->right_sibling();
+  while (address) {
+    Page *page = env->page_manager->fetch(context, address,
+                    PageManager::kReadOnly);
+    node = btree->get_node_from_page(page);
+    if (node->length() > 0) {
+      ups_key_t key = {0};
+      node->key(context, 0, &btree->state.compaction_key, &key);
+      btree->state.compaction_key.set_size(key.size);
+      btree->state.has_compaction_key = true;
+      return true;
+    }
+    address = node->right_sibling();
+  }
+
+  btree->state.has_compaction_key = false;
+  return false;
+}
+
+} // namespace upscaledb
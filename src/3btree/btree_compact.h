@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * Online compaction of the btree leaves (ups_db_compact).
+ *
+ * The compaction walks the internal nodes on the level above the leaves
+ * from left to right. The children of each of these nodes are merged
+ * with their left sibling if the keys fit, and empty leaves are removed.
+ * The freed pages are returned to the Freelist. The remaining leaves are
+ * moved to free pages at the beginning of the file, which allows the
+ * PageManager to truncate the file.
+ *
+ * Each call of run() processes a single internal node. The first key of
+ * the next internal node is stored in the BtreeIndexState, therefore the
+ * compaction can be interrupted between two calls and continues with
+ * a new BtreeCompactAction.
+ */
+
+#ifndef UPS_BTREE_COMPACT_H
+#define UPS_BTREE_COMPACT_H
+
+#include "0root/root.h"
+
+// Always verify that a file of level N does not include headers > N!
+#include "3btree/btree_stats.h"
+#include "3btree/btree_update.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+struct BtreeCompactAction : public BtreeUpdateAction {
+  // Constructor
+  BtreeCompactAction(BtreeIndex *btree, Context *context);
+
+  // Compacts the leaves of the next internal node. Returns false if the
+  // right edge of the btree was reached; the next call then starts again
+  // at the left edge.
+  bool run();
+
+  // Returns the number of leaf pages which were visited
+  uint64_t page_count() const {
+    return page_counter;
+  }
+
+  private:
+    // Descends to the internal node where the compaction continues; returns
+    // null if the btree does not have internal nodes
+    Page *find_parent();
+
+    // Merges and moves the children of |parent|
+    void compact_children(Page *parent);
+
+    // Removes the empty leaf |page| at |slot| (-1 for the left child)
+    // from |parent| and from the linked list of leaves
+    void remove_leaf(Page *parent, int slot, Page *page);
+
+    // Moves the leaf |page| at |slot| (-1 for the left child) of |parent|
+    // to the first free page, if that page is located before |page| in
+    // the file. Returns the new page.
+    Page *relocate_leaf(Page *parent, int slot, Page *page);
+
+    // Stores the first key of the internal node which follows |parent|;
+    // returns false if there is no such node
+    bool store_position(Page *parent);
+
+    // Number of visited leaf pages
+    uint64_t page_counter;
+};
+
+} // namespace upscaledb
+
+#endif // UPS_BTREE_COMPACT_H
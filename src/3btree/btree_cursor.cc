@@ -39,10 +39,78 @@ namespace upscaledb {
 static inline void
 remove_cursor_from_page(BtreeCursor *cursor, Page *page)
 {
+  BtreeCursorState &st_ = cursor->st_;
+
+  ScopedSpinlock lock(st_.btree->state.mutex);
   page->cursor_list.del(cursor);
+  st_.coupled_page = 0;
+}
 
+// Prefetches the right sibling of the leaf |page| and up to
+// |kReadAheadPages - 1| of the following leafs. Their addresses are read
+// from the parent of |page|, which is looked up by descending from the
+// root with the first key of |page|.
+static inline void
+read_ahead(BtreeCursor *cursor, Context *context, Page *page)
+{
   BtreeCursorState &st_ = cursor->st_;
-  st_.coupled_page = 0;
+  LocalEnv *env = (LocalEnv *)st_.parent->db->env;
+  BtreeNodeProxy *node = st_.btree->get_node_from_page(page);
+
+  uint64_t addresses[BtreeCursor::kReadAheadPages];
+  size_t count = 0;
+  addresses[count++] = node->right_sibling();
+
+  Page *parent = st_.btree->root_page(context);
+  BtreeNodeProxy *pnode = st_.btree->get_node_from_page(parent);
+  if (node->length() > 0 && !pnode->is_leaf()) {
+    ByteArray arena;
+    ups_key_t key = {0};
+    node->key(context, 0, &arena, &key);
+
+    while (true) {
+      uint64_t child_id;
+      int slot = pnode->find_lower_bound(context, &key, &child_id);
+      if (child_id == page->address()) {
+        // the siblings are only collected if they share the same parent
+        if (slot + 1 < (int)pnode->length()
+              && pnode->record_id(context, slot + 1) == addresses[0]) {
+          for (int i = slot + 2; i < (int)pnode->length()
+                  && count < BtreeCursor::kReadAheadPages; i++)
+            addresses[count++] = pnode->record_id(context, i);
+        }
+        break;
+      }
+
+      Page *child = env->page_manager->fetch(context, child_id,
+                      PageManager::kReadOnly);
+      BtreeNodeProxy *cnode = st_.btree->get_node_from_page(child);
+      if (cnode->is_leaf())
+        break;
+      pnode = cnode;
+    }
+  }
+
+  env->page_manager->prefetch(context, addresses, count);
+}
+
+// Fetches the right sibling of the leaf |page|; if the sibling is not
+// cached then the following leafs are read ahead
+static inline Page *
+fetch_right_sibling(BtreeCursor *cursor, Context *context, Page *page)
+{
+  BtreeCursorState &st_ = cursor->st_;
+  LocalEnv *env = (LocalEnv *)st_.parent->db->env;
+  BtreeNodeProxy *node = st_.btree->get_node_from_page(page);
+
+  Page *sibling = env->page_manager->fetch(context, node->right_sibling(),
+                  PageManager::kReadOnly | PageManager::kOnlyFromCache);
+  if (sibling)
+    return sibling;
+
+  read_ahead(cursor, context, page);
+  return env->page_manager->fetch(context, node->right_sibling(),
+                  PageManager::kReadOnly);
 }
 
 // Couples the cursor to the current page/key
@@ -169,8 +237,6 @@ static inline ups_status_t
 move_next(BtreeCursor *cursor, Context *context, uint32_t flags)
 {
   BtreeCursorState &st_ = cursor->st_;
-  LocalDb *db = (LocalDb *)st_.parent->db;
-  LocalEnv *env = (LocalEnv *)db->env;
 
   // uncoupled cursor: couple it
   couple_or_throw(cursor, context);
@@ -201,8 +267,7 @@ move_next(BtreeCursor *cursor, Context *context, uint32_t flags)
   if (unlikely(!node->right_sibling()))
     return UPS_KEY_NOT_FOUND;
 
-  Page *page = env->page_manager->fetch(context, node->right_sibling(),
-                    PageManager::kReadOnly);
+  Page *page = fetch_right_sibling(cursor, context, st_.coupled_page);
   node = st_.btree->get_node_from_page(page);
 
   // if the right node is empty then continue searching for the next
@@ -210,8 +275,7 @@ move_next(BtreeCursor *cursor, Context *context, uint32_t flags)
   while (node->length() == 0) {
     if (unlikely(!node->right_sibling()))
       return UPS_KEY_NOT_FOUND;
-    page = env->page_manager->fetch(context, node->right_sibling(),
-                    PageManager::kReadOnly);
+    page = fetch_right_sibling(cursor, context, page);
     node = st_.btree->get_node_from_page(page);
   }
 
@@ -349,6 +413,7 @@ BtreeCursor::couple_to(Page *page, uint32_t index, int duplicate_index)
   st_.coupled_page = page;
 
   // add the cursor to the page
+  ScopedSpinlock lock(st_.btree->state.mutex);
   page->cursor_list.put(this);
 }
 
@@ -405,6 +470,7 @@ BtreeCursor::overwrite(Context *context, ups_record_t *record, uint32_t flags)
 
   // copy the key flags, and remove all flags concerning the key size
   BtreeNodeProxy *node = st_.btree->get_node_from_page(st_.coupled_page);
+  ScopedOptimisticWriteLock lock(st_.coupled_page->version_lock());
   node->set_record(context, st_.coupled_index, record, st_.duplicate_index,
                     flags | UPS_OVERWRITE, 0);
 
@@ -497,8 +563,6 @@ BtreeCursor::points_to(Context *context, ups_key_t *key)
 ups_status_t
 BtreeCursor::move_to_next_page(Context *context)
 {
-  LocalEnv *env = (LocalEnv *)st_.parent->db->env;
-
   // uncoupled cursor: couple it
   couple_or_throw(this, context);
 
@@ -512,8 +576,7 @@ BtreeCursor::move_to_next_page(Context *context)
     return UPS_KEY_NOT_FOUND;
   }
 
-  Page *page = env->page_manager->fetch(context, node->right_sibling(),
-                        PageManager::kReadOnly);
+  Page *page = fetch_right_sibling(this, context, st_.coupled_page);
   couple_to(page, 0, 0);
   return 0;
 }
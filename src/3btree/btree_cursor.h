@@ -103,7 +103,11 @@ struct BtreeCursor {
     // Cursor flag: the cursor is coupled
     kStateCoupled   = 1,
     // Cursor flag: the cursor is uncoupled
-    kStateUncoupled = 2
+    kStateUncoupled = 2,
+
+    // Number of leaf pages which are read ahead if the cursor moves to a
+    // right sibling which is not cached
+    kReadAheadPages = 8
   };
 
   // Constructor
@@ -75,7 +75,8 @@ struct BtreeEraseAction : public BtreeUpdateAction
             throw ex;
           goto fall_through;
         }
-        // TODO if the page is empty then move it to the freelist
+        // empty leaves are merged when the tree is traversed, or
+        // by ups_db_compact
         return 0;
 
 fall_through:
@@ -89,10 +90,17 @@ fall_through:
   }
 
   ups_status_t erase() {
-    // traverse the tree to the leaf, splitting/merging nodes as required
-    Page *parent;
-    BtreeStatistics::InsertHints hints;
-    Page *page = traverse_tree(context, key, hints, &parent);
+    // in batch mode: skip the traversal if the key belongs to the leaf
+    // of the previous operation. The parent is then unknown; see the
+    // split in remove_entry().
+    Page *parent = 0;
+    Page *page = cursor ? 0 : btree->batch_leaf(context, key, 0);
+    if (!page) {
+      // traverse the tree to the leaf, splitting/merging nodes as required
+      BtreeStatistics::InsertHints hints;
+      page = traverse_tree(context, key, hints, &parent);
+      btree->set_batch_leaf(page);
+    }
     BtreeNodeProxy *node = btree->get_node_from_page(page);
 
     // we have reached the leaf; search the leaf for the key
@@ -118,6 +126,7 @@ fall_through:
     // those.
     bool has_duplicates_left = false;
     if (node->is_leaf()) {
+      ScopedOptimisticWriteLock lock(page->version_lock());
       // only delete a duplicate?
       if (duplicate_index > 0)
         node->erase_record(context, slot, duplicate_index - 1, false,
@@ -183,12 +192,21 @@ fall_through:
     // We've reached the leaf; it's still possible that we have to
     // split the page, therefore this case has to be handled
     try {
+      // the lock is released before the page is split
+      ScopedOptimisticWriteLock lock(page->version_lock());
       node->erase(context, slot);
     }
     catch (Exception &ex) {
       if (ex.code != UPS_LIMITS_REACHED)
         throw ex;
 
+      // The leaf was taken from the batch and its parent is unknown;
+      // descend from the root
+      if (unlikely(!parent && !cursor && page != btree->root_page(context))) {
+        btree->reset_batch_leaf();
+        return erase();
+      }
+
       // Split the page in the middle. This will invalidate the |node| pointer
       // and the |slot| of the key, therefore restart the whole operation
       BtreeStatistics::InsertHints hints = {0};
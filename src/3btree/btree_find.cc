@@ -23,10 +23,13 @@
 #include "0root/root.h"
 
 #include <string.h>
+#include <algorithm>
+#include <vector>
 
 // Always verify that a file of level N does not include headers > N!
 #include "1base/error.h"
 #include "1base/dynamic_array.h"
+#include "1base/epoch_manager.h"
 #include "2page/page.h"
 #include "3btree/btree_index.h"
 #include "3btree/btree_cursor.h"
@@ -52,14 +55,37 @@ struct BtreeFindAction
       record_arena(record_arena_) {
   }
 
+  // Readers do not lock the pages. They descend with optimistic lock
+  // coupling and restart from the root if a page was modified concurrently.
+  // Concurrent readers enter an epoch; pages which are deleted in the
+  // meantime are not reused until they leave it.
   ups_status_t run() {
+    LocalEnv *env = (LocalEnv *)btree->db()->env;
+    ScopedEpoch epoch(context->shared ? env->page_manager->epochs() : 0);
+
+    for (int k = 0; ; k++) {
+      bool restart = false;
+      ups_status_t st = lookup(&restart);
+      if (likely(!restart))
+        return st;
+      // a writer holds the lock; give it some time
+      Spinlock::spin(k);
+    }
+  }
+
+  // Performs the lookup; sets |*restart| if one of the visited pages was
+  // modified concurrently. The return value is then undefined.
+  ups_status_t lookup(bool *restart) {
     LocalEnv *env = (LocalEnv *)btree->db()->env;
     Page *page = 0;
+    uint64_t version = 0;
     int slot = -1;
     BtreeNodeProxy *node = 0;
 
-    BtreeStatistics *stats = btree->statistics();
-    BtreeStatistics::FindHints hints = stats->find_hints(flags);
+    // concurrent readers do not use the (unsynchronized) statistics
+    BtreeStatistics::FindHints hints = {flags, flags, 0, false};
+    if (!context->shared)
+      hints = btree->statistics()->find_hints(flags);
 
     if (hints.try_fast_track) {
       /*
@@ -74,6 +100,10 @@ struct BtreeFindAction
                                           PageManager::kOnlyFromCache
                                             | PageManager::kReadOnly);
       if (likely(page != 0)) {
+        version = page->version_lock().read_lock(restart);
+        if (unlikely(*restart))
+          return 0;
+
         node = btree->get_node_from_page(page);
         assert(node->is_leaf());
 
@@ -95,28 +125,66 @@ struct BtreeFindAction
 
     uint32_t is_approx_match = 0;
 
+    // in batch mode: check the leaf of the previous operation before
+    // descending from the root (only w/o approx. matching)
+    if (slot == -1
+          && (flags == 0 || flags == LocalCursor::kSyncDontLoadKey)) {
+      Page *leaf = btree->batch_leaf(context, key, PageManager::kReadOnly);
+      if (leaf) {
+        page = leaf;
+        version = page->version_lock().read_lock(restart);
+        if (unlikely(*restart))
+          return 0;
+
+        node = btree->get_node_from_page(page);
+        slot = node->find(context, key);
+        if (unlikely(slot == -1)) {
+          find_failed();
+          return UPS_KEY_NOT_FOUND;
+        }
+
+        goto return_result;
+      }
+    }
+
     if (slot == -1) {
-      /* load the root page */
+      /* load the root page; it is only valid if it was not replaced
+       * by a concurrent writer in the meantime */
       page = btree->root_page(context);
+      version = page->version_lock().read_lock(restart);
+      if (unlikely(*restart))
+        return 0;
+      if (unlikely(page != btree->root_page(context))) {
+        *restart = true;
+        return 0;
+      }
 
       /* now traverse the root to the leaf nodes till we find a leaf */
       node = btree->get_node_from_page(page);
       while (!node->is_leaf()) {
-        page = btree->find_lower_bound(context, page, key,
-                              PageManager::kReadOnly, 0);
+        page = btree->find_child_optimistic(context, page, key,
+                              PageManager::kReadOnly, &version, restart);
+        if (unlikely(*restart))
+          return 0;
         if (unlikely(!page)) {
-          stats->find_failed();
+          find_failed();
           return UPS_KEY_NOT_FOUND;
         }
 
         node = btree->get_node_from_page(page);
       }
 
+      btree->set_batch_leaf(page);
+
       /* check the leaf page for the key (shortcut w/o approx. matching) */
       if (flags == 0 || flags == LocalCursor::kSyncDontLoadKey) {
         slot = node->find(context, key);
         if (unlikely(slot == -1)) {
-          stats->find_failed();
+          if (unlikely(!page->version_lock().validate(version))) {
+            *restart = true;
+            return 0;
+          }
+          find_failed();
           return UPS_KEY_NOT_FOUND;
         }
 
@@ -131,8 +199,10 @@ struct BtreeFindAction
     if (unlikely(slot == -1)) {
       // find the left sibling
       if (node->left_sibling() > 0) {
-        page = env->page_manager->fetch(context, node->left_sibling(),
-                        PageManager::kReadOnly);
+        page = fetch_sibling(env, page, node->left_sibling(), &version,
+                        restart);
+        if (unlikely(*restart))
+          return 0;
         node = btree->get_node_from_page(page);
         slot = node->length() - 1;
         is_approx_match = BtreeKey::kLower;
@@ -141,8 +211,10 @@ struct BtreeFindAction
     else if (unlikely(slot >= (int)node->length())) {
       // find the right sibling
       if (node->right_sibling() > 0) {
-        page = env->page_manager->fetch(context, node->right_sibling(),
-                        PageManager::kReadOnly);
+        page = fetch_sibling(env, page, node->right_sibling(), &version,
+                        restart);
+        if (unlikely(*restart))
+          return 0;
         node = btree->get_node_from_page(page);
         slot = 0;
         is_approx_match = BtreeKey::kGreater;
@@ -152,7 +224,11 @@ struct BtreeFindAction
     }
 
     if (unlikely(slot < 0)) {
-      stats->find_failed();
+      if (unlikely(!page->version_lock().validate(version))) {
+        *restart = true;
+        return 0;
+      }
+      find_failed();
       return UPS_KEY_NOT_FOUND;
     }
 
@@ -169,15 +245,51 @@ return_result:
 
     /* no need to load the key if we have an exact match, or if KEY_DONT_LOAD
      * is set: */
-    if (key && is_approx_match && NOTSET(flags, LocalCursor::kSyncDontLoadKey))
-      node->key(context, slot, key_arena, key);
+    try {
+      if (key && is_approx_match
+              && NOTSET(flags, LocalCursor::kSyncDontLoadKey))
+        node->key(context, slot, key_arena, key);
 
-    if (likely(record != 0))
-      node->record(context, slot, record_arena, record, flags);
+      if (likely(record != 0))
+        node->record(context, slot, record_arena, record, flags);
+    }
+    catch (Exception &) {
+      // the page was modified while the key or record was copied; the
+      // error is bogus
+      if (!page->version_lock().validate(version)) {
+        *restart = true;
+        return 0;
+      }
+      throw;
+    }
 
+    /* the copied key and record are only valid if the leaf was not
+     * modified in the meantime */
+    if (unlikely(!page->version_lock().validate(version)))
+      *restart = true;
     return 0;
   }
 
+  // Moves from |page| to its sibling at |address|. The sibling's address
+  // is only valid if |page| was not modified concurrently.
+  Page *fetch_sibling(LocalEnv *env, Page *page, uint64_t address,
+                  uint64_t *version, bool *restart) {
+    if (unlikely(!page->version_lock().validate(*version))) {
+      *restart = true;
+      return 0;
+    }
+    Page *sibling = env->page_manager->fetch(context, address,
+                    PageManager::kReadOnly);
+    *version = sibling->version_lock().read_lock(restart);
+    return sibling;
+  }
+
+  // Updates the statistics after a failed lookup
+  void find_failed() {
+    if (!context->shared)
+      btree->statistics()->find_failed();
+  }
+
   // Searches a leaf node for a key.
   //
   // !!!
@@ -250,6 +362,224 @@ return_result:
   ByteArray *record_arena;
 };
 
+//
+// Looks up a group of keys with exact matching. The lookups descend the
+// btree together, one level at a time: first the child addresses of all
+// keys are determined, then the uncached children are read with a single
+// batch, and their headers are prefetched into the CPU caches before the
+// next level is searched.
+//
+struct BtreeFindManyAction
+{
+  // the number of lookups which descend together
+  enum { kGroupSize = 16 };
+
+  // marks a record which is not stored in the record arena
+  enum { kNoOffset = ~(size_t)0 };
+
+  BtreeFindManyAction(BtreeIndex *btree_, Context *context_,
+                  ups_key_t *keys_, ups_record_t *records_,
+                  ups_status_t *results_, size_t count_,
+                  ByteArray *record_arena_)
+    : btree(btree_), context(context_), keys(keys_), records(records_),
+      results(results_), count(count_), record_arena(record_arena_),
+      offsets(count_, kNoOffset) {
+  }
+
+  void run() {
+    LocalEnv *env = (LocalEnv *)btree->db()->env;
+    ScopedEpoch epoch(context->shared ? env->page_manager->epochs() : 0);
+
+    for (size_t base = 0; base < count; base += kGroupSize)
+      run_group(base, std::min(count - base, (size_t)kGroupSize));
+
+    // the arena no longer grows; let the records point into it
+    for (size_t i = 0; i < count; i++) {
+      if (offsets[i] != kNoOffset)
+        records[i].data = record_arena->data() + offsets[i];
+    }
+  }
+
+  void run_group(size_t base, size_t length) {
+    LocalEnv *env = (LocalEnv *)btree->db()->env;
+    Page *pages[kGroupSize];
+    uint64_t versions[kGroupSize];
+    uint64_t addresses[kGroupSize];
+    bool active[kGroupSize];
+    size_t remaining = 0;
+
+    // the root is only valid if it was not replaced by a concurrent writer
+    Page *root = btree->root_page(context);
+    for (size_t i = 0; i < length; i++) {
+      bool restart = false;
+      pages[i] = root;
+      versions[i] = root->version_lock().read_lock(&restart);
+      if (unlikely(root != btree->root_page(context)))
+        restart = true;
+      active[i] = !restart;
+      if (unlikely(restart))
+        find_single(base + i);
+      else
+        remaining++;
+    }
+
+    while (remaining > 0) {
+      // search the current node of each lookup; leaves complete the
+      // lookup, internal nodes return the address of the child page
+      for (size_t i = 0; i < length; i++) {
+        if (!active[i])
+          continue;
+
+        BtreeNodeProxy *node = btree->get_node_from_page(pages[i]);
+        if (node->is_leaf()) {
+          find_in_leaf(base + i, pages[i], versions[i]);
+          active[i] = false;
+          remaining--;
+          continue;
+        }
+
+        node->find_lower_bound(context, &keys[base + i], &addresses[i]);
+
+        // the child pointer is only valid if the node was not modified in
+        // the meantime
+        if (unlikely(!pages[i]->version_lock().validate(versions[i]))) {
+          find_single(base + i);
+          active[i] = false;
+          remaining--;
+        }
+      }
+
+      if (remaining == 0)
+        break;
+
+      // read all uncached children with a single batch
+      if (NOTSET(env->flags(), UPS_IN_MEMORY)) {
+        uint64_t missing[kGroupSize];
+        size_t missing_length = 0;
+        for (size_t i = 0; i < length; i++) {
+          if (active[i] && std::find(missing, missing + missing_length,
+                                  addresses[i]) == missing + missing_length)
+            missing[missing_length++] = addresses[i];
+        }
+        if (missing_length > 1)
+          env->page_manager->prefetch(context, missing, missing_length);
+      }
+
+      // fetch the children and start loading their headers into the CPU
+      // caches; they are searched in the next iteration
+      for (size_t i = 0; i < length; i++) {
+        if (!active[i])
+          continue;
+
+        bool restart = false;
+        Page *child = env->page_manager->fetch(context, addresses[i],
+                        PageManager::kReadOnly);
+        uint64_t version = child->version_lock().read_lock(&restart);
+
+        // lock coupling: the parent must still be unchanged, otherwise
+        // the child might have been split or merged
+        if (unlikely(restart
+                || !pages[i]->version_lock().validate(versions[i]))) {
+          find_single(base + i);
+          active[i] = false;
+          remaining--;
+          continue;
+        }
+
+        pages[i] = child;
+        versions[i] = version;
+        prefetch_memory(child->payload());
+      }
+    }
+  }
+
+  // Searches the leaf |page| for the key at |index|
+  void find_in_leaf(size_t index, Page *page, uint64_t version) {
+    BtreeNodeProxy *node = btree->get_node_from_page(page);
+
+    int slot = node->find(context, &keys[index]);
+    if (slot == -1) {
+      if (unlikely(!page->version_lock().validate(version))) {
+        find_single(index);
+        return;
+      }
+      results[index] = UPS_KEY_NOT_FOUND;
+      if (!context->shared)
+        btree->statistics()->find_failed();
+      return;
+    }
+
+    try {
+      node->record(context, slot, &arena, &records[index], 0);
+    }
+    catch (Exception &) {
+      // the page was modified while the record was copied; the error
+      // is bogus
+      if (!page->version_lock().validate(version)) {
+        find_single(index);
+        return;
+      }
+      throw;
+    }
+
+    // the copied record is only valid if the leaf was not modified in
+    // the meantime
+    if (unlikely(!page->version_lock().validate(version))) {
+      find_single(index);
+      return;
+    }
+
+    results[index] = 0;
+    store_record(index);
+  }
+
+  // Performs a regular lookup of the key at |index|; required if one of
+  // the visited pages was modified concurrently
+  void find_single(size_t index) {
+    BtreeFindAction bfa(btree, context, 0, &keys[index], &arena,
+                    &records[index], &arena, 0);
+    results[index] = bfa.run();
+    if (results[index] == 0)
+      store_record(index);
+  }
+
+  // Copies the record at |index| to the record arena
+  void store_record(size_t index) {
+    ups_record_t *record = &records[index];
+    if (ISSET(record->flags, UPS_RECORD_USER_ALLOC))
+      return;
+    offsets[index] = record_arena->size();
+    record_arena->append((uint8_t *)record->data, record->size);
+  }
+
+  // the current btree
+  BtreeIndex *btree;
+
+  // The caller's Context
+  Context *context;
+
+  // the keys that are retrieved
+  ups_key_t *keys;
+
+  // the records that are retrieved
+  ups_record_t *records;
+
+  // the status of each lookup
+  ups_status_t *results;
+
+  // the number of keys
+  size_t count;
+
+  // receives the records
+  ByteArray *record_arena;
+
+  // the offset of each record in |record_arena|
+  std::vector<size_t> offsets;
+
+  // temporary storage for the current record
+  ByteArray arena;
+};
+
 ups_status_t
 BtreeIndex::find(Context *context, LocalCursor *cursor, ups_key_t *key,
               ByteArray *key_arena, ups_record_t *record,
@@ -261,5 +591,14 @@ BtreeIndex::find(Context *context, LocalCursor *cursor, ups_key_t *key,
   return bfa.run();
 }
 
-} // namespace upscaledb
+void
+BtreeIndex::find_many(Context *context, ups_key_t *keys,
+              ups_record_t *records, ups_status_t *results, size_t count,
+              ByteArray *record_arena)
+{
+  BtreeFindManyAction bfa(this, context, keys, records, results, count,
+                  record_arena);
+  bfa.run();
+}
 
+} // namespace upscaledb
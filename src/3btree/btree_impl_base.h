@@ -110,6 +110,11 @@ struct BaseNodeImpl {
                       new_duplicate_index);
     }
 
+    // Returns the smallest and the largest record of this node
+    bool record_range(Context *, const void **pmin, const void **pmax) {
+      return records.record_range(node->length(), pmin, pmax);
+    }
+
     // Iterates all keys, calls the |visitor| on each
     void scan(Context *context, ScanVisitor *visitor,
                     SelectStatement *statement, uint32_t start, bool distinct) {
@@ -129,6 +134,10 @@ struct BaseNodeImpl {
       if (distinct) {
         // only scan keys?
         if (KeyList::kSupportsBlockScans && !requires_records) {
+          if (KeyList::kSupportsCompressedScans) {
+            keys.scan_blocks(visitor, 0, 0, node->length(), start);
+            return;
+          }
           ScanResult sr = keys.scan(key_arena, node->length(), start);
           (*visitor)(sr.first, 0, sr.second);
           return;
@@ -146,6 +155,12 @@ struct BaseNodeImpl {
                 && requires_keys
                 && RecordList::kSupportsBlockScans
                 && requires_records) {
+          if (KeyList::kSupportsCompressedScans) {
+            ScanResult srr = records.scan(rec_arena, node->length(), start);
+            keys.scan_blocks(visitor, (const uint8_t *)srr.first,
+                            records.full_record_size(), node->length(), start);
+            return;
+          }
           ScanResult srk = keys.scan(key_arena, node->length(), start);
           ScanResult srr = records.scan(rec_arena, node->length(), start);
           assert(srr.second == srk.second);
@@ -364,6 +379,14 @@ struct BaseNodeImpl {
       return node->length() <= 3;
     }
 
+    // Returns true if the |other| node can be merged into this node. The
+    // free space of the lists is unknown, therefore this is only assumed
+    // if |other| is empty or if both nodes require a merge
+    bool can_merge_from(BaseNodeImpl<KeyList, RecordList> *other) const {
+      return other->node->length() == 0
+                || (requires_merge() && other->requires_merge());
+    }
+
     // Merges this node with the |other| node
     void merge_from(Context *context,
                     BaseNodeImpl<KeyList, RecordList> *other) {
@@ -100,6 +100,12 @@ struct PaxNodeImpl : public BaseNodeImpl<KeyList, RecordList> {
     return P::node->length() >= P::estimated_capacity;
   }
 
+  // Returns true if the keys of the |other| node fit into this node
+  bool can_merge_from(PaxNodeImpl *other) const {
+    return P::node->length() + other->node->length()
+              <= P::estimated_capacity;
+  }
+
   void initialize() {
     uint32_t usable_nodesize = P::page->usable_page_size()
                   - PBtreeNode::entry_offset();
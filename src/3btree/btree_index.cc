@@ -41,14 +41,46 @@ namespace upscaledb {
 Page *
 BtreeIndex::root_page(Context *context)
 {
-  if (unlikely(state.root_page == 0))
+  if (unlikely(state.root_page == 0)) {
+    // concurrent readers always find a cached root page (see LocalDb::open)
+    assert(!context->shared);
     state.root_page = state.page_manager->fetch(context,
                             state.btree_header->root_address);
-  else
+  }
+  else if (!context->shared)
     context->changeset.put(state.root_page);
   return state.root_page;
 }
 
+Page *
+BtreeIndex::batch_leaf(Context *context, ups_key_t *key,
+                uint32_t page_manager_flags)
+{
+  // concurrent readers do not touch the (unsynchronized) batch state
+  if (!state.batch_mode || state.batch_leaf == 0 || context->shared)
+    return 0;
+
+  Page *page = state.page_manager->fetch(context, state.batch_leaf,
+                        PageManager::kOnlyFromCache | page_manager_flags);
+  if (unlikely(!page))
+    return 0;
+  if (unlikely(page->db() != state.db
+          || (page->type() != Page::kTypeBroot
+              && page->type() != Page::kTypeBindex)))
+    return 0;
+
+  BtreeNodeProxy *node = get_node_from_page(page);
+  if (unlikely(!node->is_leaf() || node->length() == 0))
+    return 0;
+
+  // the key must not be smaller than the first or larger than the last
+  // key of the leaf; otherwise it might belong to one of the siblings
+  if (node->compare(context, key, 0) < 0
+        || node->compare(context, key, node->length() - 1) > 0)
+    return 0;
+  return page;
+}
+
 void
 BtreeIndex::create(Context *context, PBtreeHeader *btree_header,
                     DbConfig *dbconfig)
@@ -130,6 +162,39 @@ BtreeIndex::find_lower_bound(Context *context, Page *page, const ups_key_t *key,
   return state.page_manager->fetch(context, record_id, page_manager_flags);
 }
 
+Page *
+BtreeIndex::find_child_optimistic(Context *context, Page *parent,
+                const ups_key_t *key, uint32_t page_manager_flags,
+                uint64_t *version, bool *restart)
+{
+  BtreeNodeProxy *node = get_node_from_page(parent);
+
+  uint64_t record_id;
+  node->find_lower_bound(context, (ups_key_t *)key, &record_id);
+
+  // the child pointer is only valid if the parent was not modified in
+  // the meantime
+  if (unlikely(!parent->version_lock().validate(*version))) {
+    *restart = true;
+    return 0;
+  }
+
+  Page *child = state.page_manager->fetch(context, record_id,
+                  page_manager_flags);
+  if (unlikely(!child))
+    return 0;
+
+  uint64_t parent_version = *version;
+  *version = child->version_lock().read_lock(restart);
+
+  // lock coupling: the parent must still be unchanged after the version
+  // of the child was retrieved, otherwise the child might have been split
+  // or merged
+  if (unlikely(!parent->version_lock().validate(parent_version)))
+    *restart = true;
+  return child;
+}
+
 //
 // visitor object for estimating / counting the number of keys
 ///
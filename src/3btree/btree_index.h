@@ -22,11 +22,13 @@
 #include "0root/root.h"
 
 #include <algorithm>
+#include <boost/atomic.hpp>
 
 // Always verify that a file of level N does not include headers > N!
 #include "1base/abi.h"
 #include "1base/dynamic_array.h"
 #include "1base/scoped_ptr.h"
+#include "1base/spinlock.h"
 #include "1globals/globals.h"
 #include "3btree/btree_cursor.h"
 #include "3btree/btree_stats.h"
@@ -155,11 +157,32 @@ struct BtreeIndexState {
   // the index of the PBtreeHeader in the Environment's header page
   PBtreeHeader *btree_header;
 
-  // the root page of the Btree
-  Page *root_page;
+  // the root page of the Btree; replaced by concurrent writers while
+  // optimistic readers descend from it
+  boost::atomic<Page *> root_page;
 
   // the btree statistics
   BtreeStatistics statistics;
+
+  // True while a sorted batch of operations is applied (see
+  // LocalDb::bulk_operations)
+  bool batch_mode;
+
+  // The leaf which was visited last in batch mode; it is checked before
+  // descending from the root
+  uint64_t batch_leaf;
+
+  // The first key of the internal node where the next call to
+  // ups_db_compact continues (see BtreeCompactAction)
+  ByteArray compaction_key;
+
+  // True if |compaction_key| is valid; otherwise the compaction starts
+  // at the left edge of the btree
+  bool has_compaction_key;
+
+  // Protects the lazy creation of BtreeNodeProxy objects and the pages'
+  // cursor lists against concurrent readers
+  Spinlock mutex;
 };
 
 //
@@ -180,6 +203,9 @@ struct BtreeIndex {
     state.db = db;
     state.btree_header = 0;
     state.root_page = 0;
+    state.batch_mode = false;
+    state.batch_leaf = 0;
+    state.has_compaction_key = false;
   }
 
   // Returns the database pointer
@@ -202,6 +228,32 @@ struct BtreeIndex {
     state.root_page = root_page;
   }
 
+  // Enables or disables the batch mode. In batch mode, find(), insert()
+  // and erase() first check the leaf which was visited last; the caller
+  // has to supply the keys in sorted order to benefit.
+  void set_batch_mode(bool enabled) {
+    state.batch_mode = enabled;
+    state.batch_leaf = 0;
+  }
+
+  // Returns the leaf of the current batch if |key| is within its range of
+  // keys, otherwise 0. |page_manager_flags| are forwarded to
+  // PageManager::fetch.
+  Page *batch_leaf(Context *context, ups_key_t *key,
+                  uint32_t page_manager_flags);
+
+  // Remembers the leaf which was visited by the current batch operation
+  void set_batch_leaf(Page *page) {
+    if (state.batch_mode)
+      state.batch_leaf = page->address();
+  }
+
+  // Forgets the leaf of the current batch; called when a page of the
+  // btree is freed
+  void reset_batch_leaf() {
+    state.batch_leaf = 0;
+  }
+
   // Returns the hash of the compare function
   uint32_t compare_hash() const {
     return state.btree_header->compare_hash;
@@ -224,6 +276,13 @@ struct BtreeIndex {
                   ByteArray *key_arena, ups_record_t *record,
                   ByteArray *record_arena, uint32_t flags);
 
+  // Looks up |count| keys with exact matching (ups_db_find_many). The
+  // status of each lookup is stored in |results|. Records which are not
+  // allocated by the user are copied to |record_arena|.
+  void find_many(Context *context, ups_key_t *keys, ups_record_t *records,
+                  ups_status_t *results, size_t count,
+                  ByteArray *record_arena);
+
   // Inserts (or updates) a key/record in the index (ups_db_insert)
   ups_status_t insert(Context *context, LocalCursor *cursor, ups_key_t *key,
                   ups_record_t *record, uint32_t flags);
@@ -259,6 +318,17 @@ struct BtreeIndex {
   Page *find_lower_bound(Context *context, Page *parent, const ups_key_t *key,
                   uint32_t page_manager_flags, int *idxptr);
 
+  // Same as above, but for readers which descend with optimistic lock
+  // coupling. |*version| is the version of |parent| (see
+  // OptimisticLock::read_lock()) and is replaced with the version of
+  // the returned child.
+  //
+  // Sets |*restart| to true if |parent| or the child is modified
+  // concurrently; the caller then has to restart from the root.
+  Page *find_child_optimistic(Context *context, Page *parent,
+                  const ups_key_t *key, uint32_t page_manager_flags,
+                  uint64_t *version, bool *restart);
+
   // Compares two keys
   // Returns -1, 0, +1 or higher positive values are the result of a
   // successful key comparison (0 if both keys match, -1 when
@@ -269,10 +339,16 @@ struct BtreeIndex {
 
   // Returns a BtreeNodeProxy for a Page
   BtreeNodeProxy *get_node_from_page(Page *page) {
-    if (likely(page->node_proxy() != 0))
-      return page->node_proxy();
+    BtreeNodeProxy *proxy = page->node_proxy();
+    if (likely(proxy != 0))
+      return proxy;
+
+    // concurrent readers might try to create the same proxy
+    ScopedSpinlock lock(state.mutex);
+    proxy = page->node_proxy();
+    if (proxy)
+      return proxy;
 
-    BtreeNodeProxy *proxy;
     PBtreeNode *node = PBtreeNode::from_page(page);
     if (node->is_leaf())
       proxy = leaf_node_from_page_impl(page);
@@ -287,6 +363,7 @@ struct BtreeIndex {
   static void fill_metrics(ups_env_metrics_t *metrics) {
     metrics->btree_smo_split = Globals::ms_btree_smo_split;
     metrics->btree_smo_merge = Globals::ms_btree_smo_merge;
+    metrics->btree_smo_relocate = Globals::ms_btree_smo_relocate;
     metrics->extended_keys = Globals::ms_extended_keys;
     metrics->extended_duptables = Globals::ms_extended_duptables;
     metrics->key_bytes_before_compression
@@ -166,18 +166,29 @@ struct BtreeInsertAction : public BtreeUpdateAction {
   }
 
   ups_status_t insert() {
+    // in batch mode: skip the traversal if the key belongs to the leaf
+    // of the previous operation, and if that leaf does not have to be split
+    Page *page = btree->batch_leaf(context, key, 0);
+    if (page && !btree->get_node_from_page(page)->requires_split(context,
+                            key)) {
+      ups_status_t st = insert_in_page(page, key, record, hints);
+      if (likely(st != UPS_LIMITS_REACHED))
+        return st;
+    }
+
     // traverse the tree till a leaf is reached
     Page *parent;
-    Page *page = traverse_tree(context, key, hints, &parent);
+    page = traverse_tree(context, key, hints, &parent);
 
     // We've reached the leaf; it's still possible that we have to
     // split the page, therefore this case has to be handled
     ups_status_t st = insert_in_page(page, key, record, hints);
     if (unlikely(st == UPS_LIMITS_REACHED)) {
       page = split_page(page, parent, key, hints);
-      return insert_in_page(page, key, record, hints);
+      st = insert_in_page(page, key, record, hints);
     }
 
+    btree->set_batch_leaf(page);
     return st;
   }
 
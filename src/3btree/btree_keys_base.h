@@ -34,6 +34,8 @@
 
 namespace upscaledb {
 
+struct ScanVisitor;
+
 struct BaseKeyList : BaseList {
   enum {
     // This KeyList cannot reduce its capacity in order to release storage
@@ -53,6 +55,9 @@ struct BaseKeyList : BaseList {
 
     // A flag whether this KeyList has sequential data
     kHasSequentialData = 0,
+
+    // A flag whether this KeyList supports the scan_blocks() call
+    kSupportsCompressedScans = 0,
   };
 
   BaseKeyList(LocalDb *db, PBtreeNode *node)
@@ -76,6 +81,13 @@ struct BaseKeyList : BaseList {
     throw Exception(UPS_NOT_IMPLEMENTED);
   }
 
+  // Passes compressed blocks to a ScanVisitor; only implemented by
+  // KeyLists with compression
+  void scan_blocks(ScanVisitor *visitor, const uint8_t *record_array,
+                  size_t record_size, size_t node_count, uint32_t start) {
+    throw Exception(UPS_NOT_IMPLEMENTED);
+  }
+
   // Fills the btree_metrics structure
   void fill_metrics(btree_metrics_t *metrics, size_t node_count) {
     BtreeStatistics::update_min_max_avg(&metrics->keylist_ranges, range_size);
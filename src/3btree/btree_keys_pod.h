@@ -24,6 +24,12 @@
  * C array of type uint32_t[]. Each key has zero overhead.
  *
  * This KeyList cannot be resized.
+ *
+ * Internal nodes can optionally be searched with a small B-tree of
+ * cache-line sized blocks (UPS_PARAM_INTERNAL_NODE_LAYOUT). Its upper
+ * levels are kept in memory and rebuilt after the node was modified; the
+ * lowest level is the sorted array in the page, therefore the file format
+ * does not change.
  */
 
 #ifndef UPS_BTREE_KEYS_POD_H
@@ -33,11 +39,16 @@
 
 #include <sstream>
 #include <iostream>
+#include <vector>
+
+#include <boost/atomic.hpp>
 
 // Always verify that a file of level N does not include headers > N!
 #include "1globals/globals.h"
 #include "1base/dynamic_array.h"
+#include "1base/spinlock.h"
 #include "2page/page.h"
+#include "2simd/simd.h"
 #include "3btree/btree_node.h"
 #include "3btree/btree_keys_base.h"
 
@@ -65,11 +76,16 @@ struct PodKeyList : BaseKeyList {
 
     // This KeyList has a custom find_lower_bound() implementation
     kCustomFindLowerBound = 1,
+
+    // The number of keys in a block of the search tree (one cache line)
+    kTreeBlockSize = 64 / sizeof(T),
   };
 
   // Constructor
   PodKeyList(LocalDb *db, PBtreeNode *node)
-    : BaseKeyList(db, node), _data(0) {
+    : BaseKeyList(db, node), _data(0),
+      _use_tree(db->config.internal_node_layout == UPS_NODE_LAYOUT_BTREE),
+      _tree_count(0), _tree_valid(false) {
   }
 
   // Creates a new PodKeyList starting at |ptr|, total size is
@@ -77,12 +93,14 @@ struct PodKeyList : BaseKeyList {
   void create(uint8_t *ptr, size_t range_size_) {
     _data = (T *)ptr;
     range_size = range_size_;
+    invalidate_tree();
   }
 
   // Opens an existing PodKeyList starting at |ptr|
   void open(uint8_t *ptr, size_t range_size_, size_t) {
     _data = (T *)ptr;
     range_size = range_size_;
+    invalidate_tree();
   }
 
   // Returns the required size for the current set of keys
@@ -95,59 +113,32 @@ struct PodKeyList : BaseKeyList {
     return sizeof(T);
   }
 
-  // Finds a key
-#ifdef __SSE__
   // Searches the node for the key and returns the slot of this key
   // - only for exact matches!
-  //
-  // This is the SIMD implementation. If SIMD is disabled then the
-  // BaseKeyList::find method is used.
-  template<typename Cmp>
-  int find(Context *, size_t node_count, const ups_key_t *key, Cmp &) {
-    return find_simd_sse<T>(node_count, &_data[0], key);
-  }
-#else
   template<typename Cmp>
   int find(Context *, size_t node_count, const ups_key_t *hkey, Cmp &) {
-    T key = *(T *)hkey->data;
-    T *result = std::lower_bound(&_data[0], &_data[node_count], key);
-    if (unlikely(result == &_data[node_count] || *result != key))
-      return -1;
-    return result - &_data[0];
+    assert(hkey->size == sizeof(T));
+    return simd_find<T>(_data, (int)node_count, *(T *)hkey->data);
   }
-#endif
 
   // Performs a lower-bound search for a key
   template<typename Cmp>
   int find_lower_bound(Context *, size_t node_count, const ups_key_t *hkey,
                   Cmp &, int *pcmp) {
     T key = *(T *)hkey->data;
-    T *result = std::lower_bound(&_data[0], &_data[node_count], key);
-    if (unlikely(result == &_data[node_count])) {
-      if (key > _data[node_count - 1]) {
-        *pcmp = +1;
-        return node_count - 1;
-      }
-      if (key < _data[0]) {
-        *pcmp = -1;
-        return 0;
-      }
-      assert(!"shouldn't be here");
-      throw Exception(UPS_INTERNAL_ERROR);
-    }
-
-    if (key > *result) {
-      *pcmp = +1;
-      return result - &_data[0];
+    int slot;
+    if (uses_tree(node_count))
+      slot = tree_lower_bound(node_count, key);
+    else
+      slot = simd_lower_bound<T>(_data, (int)node_count, key);
+    if (slot < (int)node_count && _data[slot] == key) {
+      *pcmp = 0;
+      return slot;
     }
 
-    if (key < *result) {
-      *pcmp = +1;
-      return (result - 1) - &_data[0];
-    }
-
-    *pcmp = 0;
-    return result - &_data[0];
+    // the key at |slot - 1| is smaller than |key|
+    *pcmp = +1;
+    return slot - 1;
   }
 
   // Copies a key into |dest|
@@ -178,6 +169,7 @@ struct PodKeyList : BaseKeyList {
     if (slot < (int)node_count - 1)
       ::memmove(&_data[slot], &_data[slot + 1],
                       sizeof(T) * (node_count - slot - 1));
+    invalidate_tree();
   }
 
   // Inserts a key
@@ -189,6 +181,7 @@ struct PodKeyList : BaseKeyList {
                       sizeof(T) * (node_count - slot));
     assert(key->size == sizeof(T));
     _data[slot] = *(T *)key->data;
+    invalidate_tree();
     return PBtreeNode::InsertResult(0, slot);
   }
 
@@ -197,6 +190,8 @@ struct PodKeyList : BaseKeyList {
                   size_t other_count, int dstart) {
     ::memcpy(&dest._data[dstart], &_data[sstart],
                     sizeof(T) * (node_count - sstart));
+    invalidate_tree();
+    dest.invalidate_tree();
   }
 
   // Returns true if the |key| no longer fits into the node
@@ -204,7 +199,8 @@ struct PodKeyList : BaseKeyList {
     return (node_count + 1) * sizeof(T) >= range_size;
   }
 
-  // Change the range size; just copy the data from one place to the other
+  // Change the range size; just copy the data from one place to the other.
+  // The search tree stores copies of the keys and remains valid.
   void change_range_size(size_t node_count, uint8_t *new_data_ptr,
           size_t new_range_size, size_t capacity_hint) {
     ::memmove(new_data_ptr, _data, node_count * sizeof(T));
@@ -236,6 +232,123 @@ struct PodKeyList : BaseKeyList {
 
   // The actual array of T's
   T *_data;
+
+  // Returns true if the node is searched with the search tree. Small
+  // nodes are faster with a linear search.
+  bool uses_tree(size_t node_count) const {
+    return _use_tree
+            && node_count > 2 * kTreeBlockSize
+            && !node->is_leaf();
+  }
+
+  // Performs a lower-bound search with the search tree; returns the first
+  // slot with a key >= |key|, or |node_count|. Touches one block per level.
+  int tree_lower_bound(size_t node_count, T key) {
+    if (!_tree_valid.load(boost::memory_order_acquire))
+      build_tree(node_count);
+    assert(_tree_count == node_count);
+
+    const int block_size = kTreeBlockSize;
+    int isa = simd_isa();
+
+    // |position| is the index of the block in the next lower level
+    int position = 0;
+    for (size_t l = 0; l < _tree_levels.size(); l++) {
+      const T *level = &_tree[_tree_levels[l]];
+      int size = (int)_tree_sizes[l];
+      int start = position * block_size;
+      position = start + simd_count_less<T>(isa, &level[start],
+                      std::min(block_size, size - start), key);
+      // only possible in the top level: all keys are smaller
+      if (position == size)
+        return (int)node_count;
+    }
+
+    int start = position * block_size;
+    return start + simd_count_less<T>(isa, &_data[start],
+                    std::min(block_size, (int)node_count - start), key);
+  }
+
+  // Builds the upper levels of the search tree. Each entry of a level is
+  // the largest key of a block in the level below. The blocks are
+  // aligned to cache lines.
+  //
+  // Concurrent readers can call this at the same time; the first one
+  // stores its result, the others discard theirs.
+  void build_tree(size_t node_count) {
+    const size_t block_size = kTreeBlockSize;
+
+    // the sizes of the levels, from the bottom (excluding the keys in the
+    // page) to the top
+    std::vector<uint32_t> sizes;
+    size_t total = block_size; // slack for the alignment
+    for (size_t s = node_count; s > block_size; ) {
+      s = (s + block_size - 1) / block_size;
+      sizes.push_back((uint32_t)s);
+      total += (s + block_size - 1) / block_size * block_size;
+    }
+
+    std::vector<T> tree(total);
+    size_t offset = (64 - (size_t)&tree[0] % 64) % 64 / sizeof(T);
+
+    // store the levels from the top to the bottom
+    std::vector<uint32_t> levels(sizes.size());
+    std::vector<uint32_t> level_sizes(sizes.size());
+    for (size_t i = 0; i < sizes.size(); i++) {
+      size_t l = sizes.size() - 1 - i;
+      levels[l] = (uint32_t)offset;
+      level_sizes[l] = sizes[i];
+      offset += (sizes[i] + block_size - 1) / block_size * block_size;
+    }
+
+    const T *below = _data;
+    size_t below_size = node_count;
+    for (size_t i = 0; i < sizes.size(); i++) {
+      T *level = &tree[levels[sizes.size() - 1 - i]];
+      for (size_t j = 0; j < sizes[i]; j++)
+        level[j] = below[std::min((j + 1) * block_size, below_size) - 1];
+      below = level;
+      below_size = sizes[i];
+    }
+
+    ScopedSpinlock lock(_tree_mutex);
+    if (_tree_valid.load(boost::memory_order_relaxed))
+      return;
+    _tree.swap(tree);
+    _tree_levels.swap(levels);
+    _tree_sizes.swap(level_sizes);
+    _tree_count = node_count;
+    _tree_valid.store(true, boost::memory_order_release);
+  }
+
+  // Discards the search tree; it is rebuilt with the next search. Only
+  // called by writers, which hold the Environment's lock exclusively:
+  // Databases with search trees never allow concurrent writes (see
+  // initialize_concurrent_reads() in db_local.cc).
+  void invalidate_tree() {
+    _tree_valid.store(false, boost::memory_order_relaxed);
+  }
+
+  // True if internal nodes are searched with the search tree
+  bool _use_tree;
+
+  // The upper levels of the search tree
+  std::vector<T> _tree;
+
+  // The offsets of the levels in |_tree|, from the top to the bottom
+  std::vector<uint32_t> _tree_levels;
+
+  // The number of keys in each level
+  std::vector<uint32_t> _tree_sizes;
+
+  // The number of keys in the node when the tree was built
+  size_t _tree_count;
+
+  // True if the search tree is up to date
+  boost::atomic<bool> _tree_valid;
+
+  // Protects the search tree while it is built by concurrent readers
+  Spinlock _tree_mutex;
 };
 
 } // namespace upscaledb
@@ -34,6 +34,17 @@
  * To avoid expensive memcpy-operations, erasing a key only affects this
  * upfront index: the relevant slot is moved to a "freelist". This freelist
  * contains the same meta information as the index table.
+ *
+ * Searching a node with the default (memcmp-based) comparator uses "key
+ * heads": the common prefix of all keys in the node is stripped, and the
+ * next 8 bytes of each key are stored as a big-endian integer. The order
+ * of the heads is the same as the order of the keys, therefore the binary
+ * search compares integers and only falls back to the full keys if the
+ * heads are identical. Extended and compressed keys are not loaded for
+ * building the heads; their head is a placeholder (|kUnresolvedHead|), and
+ * the search compares the full key instead. The heads are not persisted;
+ * they are built when the node is searched for the first time and are then
+ * kept up to date with the node. Their memory is accounted by the Cache.
  */
 
 #ifndef UPS_BTREE_KEYS_VARLEN_H
@@ -46,8 +57,11 @@
 #include <vector>
 #include <map>
 
+#include <boost/atomic.hpp>
+
 // Always verify that a file of level N does not include headers > N!
 #include "1base/dynamic_array.h"
+#include "1base/spinlock.h"
 #include "2compressor/compressor_factory.h"
 #include "3blob_manager/blob_manager.h"
 #include "3btree/btree_node.h"
@@ -62,6 +76,8 @@
 
 namespace upscaledb {
 
+struct VariableSizeCompare;
+
 //
 // Variable length keys
 //
@@ -83,13 +99,26 @@ struct VariableLengthKeyList : BaseKeyList {
   enum {
     // This KeyList can reduce its capacity in order to release storage
     kCanReduceCapacity = 1,
+
+    // This KeyList has a custom find() implementation
+    kCustomFind = 1,
+
+    // This KeyList has a custom find_lower_bound() implementation
+    kCustomFindLowerBound = 1,
   };
 
+  // The head of a key which is not stored inline (extended or compressed
+  // keys); the full key is compared when the search reaches this slot
+  static const uint64_t kUnresolvedHead = ~0ull;
+
   // Constructor
   VariableLengthKeyList(LocalDb *db, PBtreeNode *node)
-    : BaseKeyList(db, node), _index(db), _data(0) {
+    : BaseKeyList(db, node), _index(db), _data(0), _cache(0),
+      _heads_bytes(0), _heads_valid(false) {
     LocalEnv *env = (LocalEnv *)db->env;
     _blob_manager = env->blob_manager.get();
+    if (env->page_manager.get())
+      _cache = &env->page_manager->state->cache;
 
     size_t page_size = env->config.page_size_bytes;
     int algo = db->config.key_compressor;
@@ -110,12 +139,19 @@ struct VariableLengthKeyList : BaseKeyList {
     }
   }
 
+  // Destructor; releases the accounted memory of the key heads
+  ~VariableLengthKeyList() {
+    if (_cache)
+      _cache->account_heap(_heads_bytes, 0);
+  }
+
   // Creates a new KeyList starting at |ptr|, total size is
   // |range_size| (in bytes)
   void create(uint8_t *ptr, size_t range_size_) {
     _data = ptr;
     range_size = range_size_;
     _index.create(_data, range_size, range_size / full_key_size());
+    invalidate_heads();
   }
 
   // Opens an existing KeyList
@@ -123,6 +159,7 @@ struct VariableLengthKeyList : BaseKeyList {
     _data = ptr;
     range_size = range_size_;
     _index.open(_data, range_size);
+    invalidate_heads();
   }
 
   // Calculates the required size for a range
@@ -184,6 +221,80 @@ struct VariableLengthKeyList : BaseKeyList {
     throw Exception(UPS_INTERNAL_ERROR);
   }
 
+  // Searches the node for the |key| and returns the slot of the lower
+  // bound. The compare value is returned in |*pcmp| (see
+  // BaseNodeImpl::find_lower_bound()).
+  template<typename Cmp>
+  int find_lower_bound(Context *context, size_t node_count,
+                  const ups_key_t *key, Cmp &comparator, int *pcmp) {
+    int left = 0;
+    int right = (int)node_count;
+    bool use_heads = uses_key_heads(comparator) && node_count > 0;
+    uint64_t head = 0;
+
+    // strip the common prefix and calculate the head of |key|
+    if (use_heads) {
+      if (!_heads_valid.load(boost::memory_order_acquire))
+        build_heads(context, node_count);
+      assert(_heads.size() == node_count);
+
+      size_t prefix_size = _heads_prefix.size();
+      int m = 0;
+      if (prefix_size > 0)
+        m = ::memcmp(key->data, _heads_prefix.data(),
+                    std::min((size_t)key->size, prefix_size));
+      if (m < 0 || (m == 0 && key->size < prefix_size)) {
+        *pcmp = -1;
+        return -1;
+      }
+      if (m > 0) {
+        *pcmp = +1;
+        return (int)node_count - 1;
+      }
+
+      head = key_head((uint8_t *)key->data + prefix_size,
+                      key->size - prefix_size);
+    }
+
+    // binary search; all keys left of |left| are smaller than |key|, all
+    // keys starting at |right| are greater. The full keys are only
+    // compared if the heads are identical or if the head of the slot is
+    // unresolved.
+    int slot = -1;
+    while (left < right) {
+      int middle = (left + right) / 2;
+      int cmp;
+      if (use_heads && _heads[middle] != head
+              && _heads[middle] != kUnresolvedHead)
+        cmp = head < _heads[middle] ? -1 : +1;
+      else
+        cmp = compare(context, key, middle, comparator);
+      if (cmp == 0) {
+        *pcmp = 0;
+        return middle;
+      }
+      if (cmp < 0)
+        right = middle;
+      else {
+        slot = middle;
+        left = middle + 1;
+      }
+    }
+
+    *pcmp = slot == -1 ? -1 : +1;
+    return slot;
+  }
+
+  // Searches the node for the |key| and returns its slot, or -1 if the
+  // key does not exist
+  template<typename Cmp>
+  int find(Context *context, size_t node_count, const ups_key_t *key,
+                  Cmp &comparator) {
+    int cmp;
+    int slot = find_lower_bound(context, node_count, key, comparator, &cmp);
+    return cmp == 0 ? slot : -1;
+  }
+
   // Erases a key's payload. Does NOT remove the chunk from the UpfrontIndex
   // (see |erase()|).
   void erase_extended_key(Context *context, int slot) {
@@ -195,6 +306,7 @@ struct VariableLengthKeyList : BaseKeyList {
       // the same space as before, when it was extended
       set_key_flags(slot, flags & (~BtreeKey::kExtendedKey));
       set_key_size(slot, sizeof(uint64_t));
+      invalidate_heads();
     }
   }
 
@@ -202,6 +314,13 @@ struct VariableLengthKeyList : BaseKeyList {
   void erase(Context *context, size_t node_count, int slot) {
     erase_extended_key(context, slot);
     _index.erase(node_count, slot);
+
+    if (_heads_valid.load(boost::memory_order_relaxed)) {
+      if (_heads.size() == node_count)
+        _heads.erase(_heads.begin() + slot);
+      else
+        invalidate_heads();
+    }
   }
 
   // Inserts the |key| at the position identified by |slot|.
@@ -211,6 +330,7 @@ struct VariableLengthKeyList : BaseKeyList {
   PBtreeNode::InsertResult insert(Context *context, size_t node_count,
                               const ups_key_t *key, uint32_t flags,
                               Cmp &comparator, int slot) {
+    insert_head(node_count, key, slot);
     _index.insert(node_count, slot);
 
     // now there's one additional slot
@@ -293,6 +413,9 @@ struct VariableLengthKeyList : BaseKeyList {
     // A lot of keys will be invalidated after copying, therefore make
     // sure that the next_offset is recalculated when it's required
     _index.invalidate_next_offset();
+
+    invalidate_heads();
+    dest.invalidate_heads();
   }
 
   // Checks the integrity of this node. Throws an exception if there is a
@@ -425,6 +548,7 @@ struct VariableLengthKeyList : BaseKeyList {
     assert(_index.get_chunk_size(slot) >= size);
     set_key_size(slot, (uint16_t)size);
     ::memcpy(key_data(slot), ptr, size);
+    invalidate_heads();
   }
 
   // Sets the size of a key
@@ -456,27 +580,41 @@ struct VariableLengthKeyList : BaseKeyList {
   // Retrieves the extended key at |blobid| and stores it in |key|; will
   // use the cache.
   void get_extended_key(Context *context, uint64_t blob_id, ups_key_t *key) {
-    if (unlikely(!_extkey_cache))
-      _extkey_cache.reset(new ExtKeyCache());
-    else {
-      ExtKeyCache::iterator it = _extkey_cache->find(blob_id);
-      if (it != _extkey_cache->end()) {
-        key->size = it->second.size();
-        key->data = it->second.data();
+    // the cache is shared by concurrent readers; the lock is not held
+    // while the blob is read
+    {
+      ScopedSpinlock lock(_extkey_mutex);
+      if (unlikely(!_extkey_cache))
+        _extkey_cache.reset(new ExtKeyCache());
+      else if (find_cached_extended_key(blob_id, key))
         return;
-      }
     }
 
     ByteArray arena;
     ups_record_t record = {0};
     _blob_manager->read(context, blob_id, &record, UPS_FORCE_DEEP_COPY,
                     &arena);
+
+    ScopedSpinlock lock(_extkey_mutex);
+    // another reader might have cached the same key in the meantime
+    if (find_cached_extended_key(blob_id, key))
+      return;
     (*_extkey_cache)[blob_id] = arena;
     arena.disown();
     key->data = record.data;
     key->size = record.size;
   }
 
+  // Looks up an extended key in the cache; returns true on success
+  bool find_cached_extended_key(uint64_t blob_id, ups_key_t *key) {
+    ExtKeyCache::iterator it = _extkey_cache->find(blob_id);
+    if (it == _extkey_cache->end())
+      return false;
+    key->size = it->second.size();
+    key->data = it->second.data();
+    return true;
+  }
+
   // Allocates an extended key and stores it in the cache
   uint64_t add_extended_key(Context *context, const ups_key_t *key) {
     if (unlikely(!_extkey_cache))
@@ -532,6 +670,118 @@ struct VariableLengthKeyList : BaseKeyList {
     return true;
   }
 
+  // Compares |lhs| to the key at slot |rhs|
+  template<typename Cmp>
+  int compare(Context *context, const ups_key_t *lhs, int rhs, Cmp &cmp) {
+    ups_key_t tmp = {0};
+    key(context, rhs, 0, &tmp, false);
+    return cmp(lhs->data, lhs->size, tmp.data, tmp.size);
+  }
+
+  // The key heads preserve the order of memcmp(3); they are not used with
+  // other comparators (i.e. with user-supplied compare functions)
+  template<typename Cmp>
+  static bool uses_key_heads(const Cmp &) {
+    return false;
+  }
+
+  static bool uses_key_heads(const VariableSizeCompare &) {
+    return true;
+  }
+
+  // Returns the first 8 bytes of |data| as a big-endian integer; missing
+  // bytes are set to zero
+  static uint64_t key_head(const uint8_t *data, size_t size) {
+    uint64_t head = 0;
+    for (size_t i = 0; i < sizeof(head); i++)
+      head = (head << 8) | (i < size ? data[i] : 0);
+    return head;
+  }
+
+  // Calculates the common prefix and the key heads of all keys. Only the
+  // first and the last key are loaded if they are extended or compressed;
+  // all other extended or compressed keys get the |kUnresolvedHead|.
+  // Concurrent readers can call this at the same time; the first one
+  // stores its result, the others discard theirs.
+  void build_heads(Context *context, size_t node_count) {
+    ByteArray prefix;
+    std::vector<uint64_t> heads(node_count);
+    ups_key_t tmp = {0};
+
+    // the keys are sorted, therefore the common prefix of the first and
+    // the last key is shared by all keys
+    key(context, 0, 0, &tmp, false);
+    prefix.copy((uint8_t *)tmp.data, tmp.size);
+    key(context, (int)node_count - 1, 0, &tmp, false);
+    size_t prefix_size = 0;
+    size_t max_size = std::min(prefix.size(), (size_t)tmp.size);
+    while (prefix_size < max_size
+            && prefix.data()[prefix_size] == ((uint8_t *)tmp.data)[prefix_size])
+      prefix_size++;
+    prefix.set_size(prefix_size);
+
+    for (size_t i = 0; i < node_count; i++) {
+      if (ISSETANY(get_key_flags((int)i),
+                  BtreeKey::kExtendedKey | BtreeKey::kCompressed)) {
+        heads[i] = kUnresolvedHead;
+        continue;
+      }
+      key(context, (int)i, 0, &tmp, false);
+      heads[i] = key_head((uint8_t *)tmp.data + prefix_size,
+                      tmp.size - prefix_size);
+    }
+
+    ScopedSpinlock lock(_heads_mutex);
+    if (_heads_valid.load(boost::memory_order_relaxed))
+      return;
+    _heads.swap(heads);
+    _heads_prefix.steal_from(prefix);
+    account_heads();
+    _heads_valid.store(true, boost::memory_order_release);
+  }
+
+  // Inserts the head of a new |key| at |slot|. If the key does not share
+  // the common prefix then the heads are rebuilt with the next search.
+  void insert_head(size_t node_count, const ups_key_t *key, int slot) {
+    if (!_heads_valid.load(boost::memory_order_relaxed))
+      return;
+
+    size_t prefix_size = _heads_prefix.size();
+    if (_heads.size() != node_count
+          || key->size < prefix_size
+          || (prefix_size > 0
+              && ::memcmp(key->data, _heads_prefix.data(), prefix_size))) {
+      invalidate_heads();
+      return;
+    }
+
+    // keys which are stored as extended or compressed keys are not
+    // resolved
+    uint64_t head = kUnresolvedHead;
+    if (key->size <= _extkey_threshold && !_compressor)
+      head = key_head((uint8_t *)key->data + prefix_size,
+                      key->size - prefix_size);
+    _heads.insert(_heads.begin() + slot, head);
+    account_heads();
+  }
+
+  // Updates the memory of the key heads which is accounted by the Cache
+  void account_heads() {
+    size_t bytes = _heads.capacity() * sizeof(uint64_t)
+                        + _heads_prefix.size();
+    if (_cache)
+      _cache->account_heap(_heads_bytes, bytes);
+    _heads_bytes = bytes;
+  }
+
+  // Discards the key heads. Only called by writers, which hold the
+  // Environment's lock exclusively: Databases with variable length keys
+  // never allow concurrent writes (see initialize_concurrent_reads() in
+  // db_local.cc).
+  void invalidate_heads() {
+    _heads_valid.store(false, boost::memory_order_relaxed);
+  }
+
   void uncompress(const ups_key_t *src, ups_key_t *dest) {
     assert(_compressor != 0);
 
@@ -558,12 +808,34 @@ struct VariableLengthKeyList : BaseKeyList {
   // Cache for extended keys
   ScopedPtr<ExtKeyCache> _extkey_cache;
 
+  // Protects |_extkey_cache| against concurrent readers
+  Spinlock _extkey_mutex;
+
   // Threshold for extended keys; if key size is > threshold then the
   // key is moved to a blob
   size_t _extkey_threshold;
 
   // Compressor for the keys
   ScopedPtr<Compressor> _compressor;
+
+  // The common prefix of all keys; not included in |_heads|
+  ByteArray _heads_prefix;
+
+  // The heads of all keys (see key_head())
+  std::vector<uint64_t> _heads;
+
+  // The Cache which accounts the memory of the key heads
+  Cache *_cache;
+
+  // The accounted memory of |_heads| and |_heads_prefix|
+  size_t _heads_bytes;
+
+  // True if |_heads| and |_heads_prefix| are up to date
+  boost::atomic<bool> _heads_valid;
+
+  // Protects |_heads| and |_heads_prefix| while they are built by
+  // concurrent readers
+  Spinlock _heads_mutex;
 };
 
 } // namespace upscaledb
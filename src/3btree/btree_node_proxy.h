@@ -132,6 +132,12 @@ struct BtreeNodeProxy {
                   SelectStatement *statement, uint32_t start,
                   bool distinct) = 0;
 
+  // Stores pointers to the smallest and the largest record of a leaf in
+  // |pmin| and |pmax|. Returns false if the node does not maintain such
+  // a summary (only leaves with numeric records do).
+  virtual bool record_range(Context *context, const void **pmin,
+                  const void **pmax) = 0;
+
   // Compares the two keys. Returns 0 if both are equal, otherwise -1 (if
   // |lhs| is greater) or +1 (if |rhs| is greater).
   virtual int compare(const ups_key_t *lhs, const ups_key_t *rhs) const = 0;
@@ -228,6 +234,10 @@ struct BtreeNodeProxy {
   // to the parent node instead (by the caller).
   virtual void split(Context *context, BtreeNodeProxy *other, int pivot) = 0;
 
+  // Returns true if all keys of the |other| node fit into this node,
+  // i.e. if |other| can be merged with merge_from()
+  virtual bool can_merge_from(BtreeNodeProxy *other) = 0;
+
   // Merges all keys from the |other| node to this node
   virtual void merge_from(Context *context, BtreeNodeProxy *other) = 0;
 
@@ -352,6 +362,12 @@ struct BtreeNodeProxyImpl : BtreeNodeProxy {
     impl.scan(context, visitor, statement, start, distinct);
   }
 
+  // Returns the smallest and the largest record of this node
+  virtual bool record_range(Context *context, const void **pmin,
+                  const void **pmax) {
+    return impl.record_range(context, pmin, pmax);
+  }
+
   // Compares two internal keys using the supplied comparator
   virtual int compare(const ups_key_t *lhs, const ups_key_t *rhs) const {
     Comparator cmp(page->db());
@@ -544,6 +560,14 @@ struct BtreeNodeProxyImpl : BtreeNodeProxy {
       other->set_length(old_length - pivot - 1);
   }
 
+  // Returns true if the |other| node can be merged into this node
+  virtual bool can_merge_from(BtreeNodeProxy *other_node) {
+    ClassType *other = dynamic_cast<ClassType *>(other_node);
+    assert(other != 0);
+
+    return impl.can_merge_from(&other->impl);
+  }
+
   // Merges all keys from the |other| node into this node
   virtual void merge_from(Context *context, BtreeNodeProxy *other_node) {
     ClassType *other = dynamic_cast<ClassType *>(other_node);
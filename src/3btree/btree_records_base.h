@@ -53,6 +53,14 @@ struct BaseRecordList : BaseList {
                         range_size);
   }
 
+  // Stores pointers to the smallest and the largest record in |pmin| and
+  // |pmax|. Returns false if this RecordList does not maintain a summary
+  // of its records.
+  bool record_range(size_t node_count, const void **pmin,
+                  const void **pmax) {
+    return false;
+  }
+
   // Returns the record id. Only required for internal nodes
   uint64_t record_id(int slot, int duplicate_index = 0) const {
     assert(!"shouldn't be here");
@@ -51,6 +51,7 @@
 #include "1globals/globals.h"
 #include "1base/scoped_ptr.h"
 #include "1base/dynamic_array.h"
+#include "1base/spinlock.h"
 #include "2page/page.h"
 #include "3blob_manager/blob_manager.h"
 #include "3btree/btree_node.h"
@@ -550,6 +551,8 @@ struct DuplicateRecordList : BaseRecordList {
 
   // Returns a duplicate table; uses a cache to speed up access
   DuplicateTable *duplicate_table(Context *context, uint64_t table_id) {
+    // the cache is shared by concurrent readers
+    ScopedSpinlock lock(duptable_mutex_);
     if (unlikely(!duptable_cache_))
       duptable_cache_.reset(new DuplicateTableCache());
     else {
@@ -637,6 +640,9 @@ struct DuplicateRecordList : BaseRecordList {
 
   // A cache for duplicate tables
   ScopedPtr<DuplicateTableCache> duptable_cache_;
+
+  // Protects |duptable_cache_| against concurrent readers
+  Spinlock duptable_mutex_;
 };
 
 //
@@ -30,10 +30,14 @@
 
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+
+#include <boost/atomic.hpp>
 
 // Always verify that a file of level N does not include headers > N!
 #include "1base/array_view.h"
 #include "1base/dynamic_array.h"
+#include "1base/spinlock.h"
 #include "3btree/btree_records_base.h"
 
 #ifndef UPS_ROOT_H
@@ -53,19 +57,21 @@ struct PodRecordList : BaseRecordList {
   };
 
   PodRecordList(LocalDb *db, PBtreeNode *node)
-    : BaseRecordList(db, node) {
+    : BaseRecordList(db, node), range_data(0), summary_valid(false) {
   }
 
   // Sets the data pointer
   void create(uint8_t *ptr, size_t range_size_) {
     range_data = (T *)ptr;
     range_size = range_size_;
+    invalidate_summary();
   }
 
   // Opens an existing RecordList
   void open(uint8_t *ptr, size_t range_size_, size_t node_count) {
     range_data = (T *)ptr;
     range_size = range_size_;
+    invalidate_summary();
   }
 
   // Returns the actual record size including overhead
@@ -113,11 +119,13 @@ struct PodRecordList : BaseRecordList {
                   uint32_t flags, uint32_t * = 0) {
     assert(record->size == sizeof(T));
     range_data[slot] = *(T *)record->data;
+    invalidate_summary();
   }
 
   // Erases the record by nulling it
   void erase_record(Context *, int slot, int = 0, bool = true) {
     range_data[slot] = 0;
+    invalidate_summary();
   }
 
   // Erases a whole slot by shifting all larger records to the "left"
@@ -125,6 +133,7 @@ struct PodRecordList : BaseRecordList {
     if (slot < (int)node_count - 1)
       ::memmove(&range_data[slot], &range_data[slot + 1],
                       sizeof(T) * (node_count - slot - 1));
+    invalidate_summary();
   }
 
   // Creates space for one additional record
@@ -134,6 +143,7 @@ struct PodRecordList : BaseRecordList {
                       sizeof(T) * (node_count - slot));
     }
     range_data[slot] = 0;
+    invalidate_summary();
   }
 
   // Copies |count| records from this[sstart] to dest[dstart]
@@ -141,6 +151,8 @@ struct PodRecordList : BaseRecordList {
                   size_t other_count, int dstart) {
     ::memcpy(&dest.range_data[dstart], &range_data[sstart],
                     sizeof(T) * (node_count - sstart));
+    invalidate_summary();
+    dest.invalidate_summary();
   }
 
   // Returns true if there's not enough space for another record
@@ -176,8 +188,51 @@ struct PodRecordList : BaseRecordList {
     out << range_data[slot];
   }
 
+  // Returns the smallest and the largest record. The summary is
+  // calculated when it is first requested after the records were modified.
+  //
+  // Concurrent readers can call this at the same time; the summary is
+  // then calculated once.
+  bool record_range(size_t node_count, const void **pmin,
+                  const void **pmax) {
+    if (unlikely(node_count == 0))
+      return false;
+
+    if (!summary_valid.load(boost::memory_order_acquire)) {
+      ScopedSpinlock lock(summary_mutex);
+      if (!summary_valid.load(boost::memory_order_relaxed)) {
+        std::pair<T *, T *> p = std::minmax_element(&range_data[0],
+                        &range_data[node_count]);
+        summary_min = *p.first;
+        summary_max = *p.second;
+        summary_valid.store(true, boost::memory_order_release);
+      }
+    }
+
+    *pmin = &summary_min;
+    *pmax = &summary_max;
+    return true;
+  }
+
+  // Discards the summary. The summary is only read by UQI queries, which
+  // hold Env::write_mutex in shared mode; writers either hold it
+  // exclusively, or hold the Environment's lock exclusively.
+  void invalidate_summary() {
+    summary_valid.store(false, boost::memory_order_relaxed);
+  }
+
   // The actual record data
   T *range_data;
+
+  // The smallest and the largest record (not persisted)
+  T summary_min;
+  T summary_max;
+
+  // True if |summary_min| and |summary_max| are up to date
+  boost::atomic<bool> summary_valid;
+
+  // Protects the summary while it is calculated by concurrent readers
+  Spinlock summary_mutex;
 };
 
 } // namespace upscaledb
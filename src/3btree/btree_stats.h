@@ -112,6 +112,10 @@ struct BtreeStatistics {
   // Reports that a ups_erase/ups_cursor_erase failed
   void erase_failed();
 
+  // Forgets the leaf page at |address|; called when the page is freed
+  // or moved
+  void reset_page(uint64_t address);
+
   // Keep track of the KeyList range size
   void set_keylist_range_size(bool leaf, size_t size) {
     state.keylist_range_size[(int)leaf] = size;
@@ -83,17 +83,17 @@ pivot_position(BtreeUpdateAction &state, BtreeNodeProxy *old_node,
 }
 
 // Allocates a new root page and sets it up in the btree
-static inline Page *
-allocate_new_root(BtreeUpdateAction &state, Page *old_root)
+Page *
+BtreeUpdateAction::allocate_new_root(Page *old_root)
 {
-  LocalEnv *env = (LocalEnv *)state.btree->db()->env;
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
 
-  Page *new_root = env->page_manager->alloc(state.context, Page::kTypeBroot);
-  BtreeNodeProxy *new_node = state.btree->get_node_from_page(new_root);
+  Page *new_root = env->page_manager->alloc(context, Page::kTypeBroot);
+  BtreeNodeProxy *new_node = btree->get_node_from_page(new_root);
   new_node->set_left_child(old_root->address());
 
-  state.btree->set_root_page(new_root);
-  Page *header = env->page_manager->fetch(state.context, 0);
+  btree->set_root_page(new_root);
+  Page *header = env->page_manager->fetch(context, 0);
   header->set_dirty(true);
 
   old_root->set_type(Page::kTypeBindex);
@@ -101,51 +101,60 @@ allocate_new_root(BtreeUpdateAction &state, Page *old_root)
   return new_root;
 }
 
-/* Merges the |sibling| into |page|, returns the merged page and moves
- * the sibling to the freelist */ 
-static inline Page *
-merge_page(BtreeUpdateAction &state, Page *page, Page *sibling)
+// Merges the |sibling| into |page|, returns the merged page and moves
+// the sibling to the freelist
+Page *
+BtreeUpdateAction::merge_page(Page *page, Page *sibling)
 {
-  LocalEnv *env = (LocalEnv *)state.btree->db()->env;
-  BtreeNodeProxy *node = state.btree->get_node_from_page(page);
-  BtreeNodeProxy *sib_node = state.btree->get_node_from_page(sibling);
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+  BtreeNodeProxy *node = btree->get_node_from_page(page);
+  BtreeNodeProxy *sib_node = btree->get_node_from_page(sibling);
+
+  ScopedOptimisticWriteLock page_lock(page->version_lock());
+  ScopedOptimisticWriteLock sibling_lock(sibling->version_lock());
 
   if (sib_node->is_leaf())
-    BtreeCursor::uncouple_all_cursors(state.context, sibling, 0);
+    BtreeCursor::uncouple_all_cursors(context, sibling, 0);
 
-  node->merge_from(state.context, sib_node);
+  node->merge_from(context, sib_node);
   page->set_dirty(true);
 
   // fix the linked list
   node->set_right_sibling(sib_node->right_sibling());
   if (node->right_sibling()) {
-    Page *p = env->page_manager->fetch(state.context, node->right_sibling());
-    BtreeNodeProxy *new_right_node = state.btree->get_node_from_page(p);
+    Page *p = env->page_manager->fetch(context, node->right_sibling());
+    BtreeNodeProxy *new_right_node = btree->get_node_from_page(p);
+    ScopedOptimisticWriteLock right_lock(p->version_lock());
     new_right_node->set_left_sibling(page->address());
     p->set_dirty(true);
   }
 
-  env->page_manager->del(state.context, sibling);
+  btree->reset_batch_leaf();
+  btree->statistics()->reset_page(sibling->address());
+  env->page_manager->del(context, sibling);
 
   Globals::ms_btree_smo_merge++;
   return page;
 }
 
-/* collapse the root node; returns the new root */
-static inline Page *
-collapse_root(BtreeUpdateAction &state, Page *root_page)
+// Collapses the empty root node; returns the new root
+Page *
+BtreeUpdateAction::collapse_root(Page *root_page)
 {
-  LocalEnv *env = (LocalEnv *)state.btree->db()->env;
-  BtreeNodeProxy *node = state.btree->get_node_from_page(root_page);
+  LocalEnv *env = (LocalEnv *)btree->db()->env;
+  BtreeNodeProxy *node = btree->get_node_from_page(root_page);
   assert(node->length() == 0);
 
-  Page *header = env->page_manager->fetch(state.context, 0);
+  // concurrent readers which are still in the old root will restart
+  ScopedOptimisticWriteLock lock(root_page->version_lock());
+
+  Page *header = env->page_manager->fetch(context, 0);
   header->set_dirty(true);
 
-  Page *new_root = env->page_manager->fetch(state.context,
-                  node->left_child());
-  state.btree->set_root_page(new_root);
-  env->page_manager->del(state.context, root_page);
+  Page *new_root = env->page_manager->fetch(context, node->left_child());
+  btree->set_root_page(new_root);
+  btree->reset_batch_leaf();
+  env->page_manager->del(context, root_page);
   return new_root;
 }
 
@@ -166,7 +175,7 @@ BtreeUpdateAction::traverse_tree(Context *context, const ups_key_t *key,
 
   // if the root page is empty with children then collapse it
   if (unlikely(node->length() == 0 && !node->is_leaf())) {
-    page = collapse_root(*this, page);
+    page = collapse_root(page);
     node = btree->get_node_from_page(page);
   }
 
@@ -200,7 +209,8 @@ BtreeUpdateAction::traverse_tree(Context *context, const ups_key_t *key,
       if (sibling != 0) {
         BtreeNodeProxy *sib_node = btree->get_node_from_page(sibling);
         if (sib_node->requires_merge()) {
-          merge_page(*this, child_page, sibling);
+          ScopedOptimisticWriteLock lock(page->version_lock());
+          merge_page(child_page, sibling);
           // also remove the link to the sibling from the parent
           node->erase(context, slot + 1);
           page->set_dirty(true);
@@ -222,7 +232,8 @@ BtreeUpdateAction::traverse_tree(Context *context, const ups_key_t *key,
       if (sibling != 0) {
         BtreeNodeProxy *sib_node = btree->get_node_from_page(sibling);
         if (sib_node->requires_merge()) {
-          merge_page(*this, sibling, child_page);
+          ScopedOptimisticWriteLock lock(page->version_lock());
+          merge_page(sibling, child_page);
           // also remove the link to the sibling from the parent
           node->erase(context, slot);
           page->set_dirty(true);
@@ -250,8 +261,13 @@ BtreeUpdateAction::split_page(Page *old_page, Page *parent,
   LocalEnv *env = (LocalEnv *)btree->db()->env;
   BtreeNodeProxy *old_node = btree->get_node_from_page(old_page);
 
+  /* the split page is locked till the linked list is fixed; the parent
+   * is locked in insert_in_page() */
+  ScopedOptimisticWriteLock old_lock(old_page->version_lock());
+
   /* allocate a new page and initialize it */
   Page *new_page = env->page_manager->alloc(context, Page::kTypeBindex);
+  ScopedOptimisticWriteLock new_lock(new_page->version_lock());
   {
     PBtreeNode *node = PBtreeNode::from_page(new_page);
     node->set_flags(old_node->is_leaf() ? PBtreeNode::kLeafNode : 0);
@@ -261,7 +277,7 @@ BtreeUpdateAction::split_page(Page *old_page, Page *parent,
   /* no parent page? then we're splitting the root page. allocate
    * a new root page */
   if (unlikely(!parent))
-    parent = allocate_new_root(*this, old_page);
+    parent = allocate_new_root(old_page);
 
   Page *to_return = 0;
   ByteArray pivot_key_arena;
@@ -321,6 +337,7 @@ BtreeUpdateAction::split_page(Page *old_page, Page *parent,
     Page *sib_page = env->page_manager->fetch(context,
                     old_node->right_sibling());
     BtreeNodeProxy *sib_node = btree->get_node_from_page(sib_page);
+    ScopedOptimisticWriteLock sib_lock(sib_page->version_lock());
     sib_node->set_left_sibling(new_page->address());
     sib_page->set_dirty(true);
   }
@@ -347,6 +364,8 @@ BtreeUpdateAction::insert_in_page(Page *page, ups_key_t *key,
 
   BtreeNodeProxy *node = btree->get_node_from_page(page);
 
+  ScopedOptimisticWriteLock lock(page->version_lock());
+
   int flags = 0;
   if (force_prepend)
     flags |= PBtreeNode::kInsertPrepend;
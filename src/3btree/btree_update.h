@@ -60,6 +60,19 @@ struct BtreeUpdateAction {
   Page *split_page(Page *old_page, Page *parent, const ups_key_t *key,
                       BtreeStatistics::InsertHints &hints);
 
+  // Allocates a new root page with |old_root| as its left child, and
+  // sets it up in the btree
+  Page *allocate_new_root(Page *old_root);
+
+  // Merges the |sibling| into |page|, returns the merged page and moves
+  // the sibling to the freelist. The caller has to remove the sibling
+  // from the parent.
+  Page *merge_page(Page *page, Page *sibling);
+
+  // Collapses the empty root node and returns its only child, which
+  // becomes the new root
+  Page *collapse_root(Page *root_page);
+
   // Inserts a key in a page
   ups_status_t insert_in_page(Page *page, ups_key_t *key,
                       ups_record_t *record,
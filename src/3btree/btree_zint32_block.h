@@ -28,6 +28,7 @@
 // Always verify that a file of level N does not include headers > N!
 #include "3btree/btree_node.h"
 #include "3btree/btree_keys_base.h"
+#include "4uqi/scanvisitor.h"
 
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
@@ -132,6 +133,7 @@ struct BlockCodecBase {
     kHasInsertApi = 0,
     kHasAppendApi = 0,
     kHasSelectApi = 0,
+    kHasSumApi = 0,
     kCompressInPlace = 0,
   };
 
@@ -176,6 +178,11 @@ struct BlockCodecBase {
     assert(!"shouldn't be here");
     throw Exception(UPS_INTERNAL_ERROR);
   }
+
+  static uint64_t sum(Index *index, const uint32_t *block_data) {
+    assert(!"shouldn't be here");
+    throw Exception(UPS_INTERNAL_ERROR);
+  }
 };
 
 template<typename BlockIndex, typename BlockCodec>
@@ -338,6 +345,13 @@ struct Zint32Codec {
     uint32_t *data = uncompress_block(index, block_data, block_cache->data);
     return data[position_in_block - 1];
   }
+
+  // Returns the sum of all keys in the block without decompressing it
+  static uint64_t sum(Index *index, const uint32_t *block_data) {
+    if (unlikely(index->key_count() == 1))
+      return index->value();
+    return index->value() + Codec::sum(index, block_data);
+  }
 };
 
 template<typename Zint32Codec>
@@ -348,6 +362,9 @@ struct BlockKeyList : BaseKeyList {
     // A flag whether this KeyList supports the scan() call
     kSupportsBlockScans = 1,
 
+    // A flag whether this KeyList supports the scan_blocks() call
+    kSupportsCompressedScans = 1,
+
     // This KeyList has a custom find() implementation
     kCustomFind = 1,
 
@@ -751,6 +768,53 @@ struct BlockKeyList : BaseKeyList {
     return std::make_pair(out + start, node_count - start);
   }
 
+  // Passes the keys to the |visitor| block by block, starting at |start|.
+  // A block is first offered in compressed form; if the visitor rejects
+  // it then it is decompressed into a buffer on the stack, which (unlike
+  // the arena in scan()) stays in the L1 cache. |record_array| points to
+  // the records of slot |start|, or is null if records are not required.
+  void scan_blocks(ScanVisitor *visitor, const uint8_t *record_array,
+                  size_t record_size, size_t node_count, uint32_t start) {
+    uint32_t data[Index::kMaxKeysPerBlock + 1];
+
+    Index *it = block_index(0);
+    Index *end = block_index(block_count());
+
+    // if the codec can sum up a block then SUM and AVERAGE do not
+    // require the decompressed keys, either
+    bool use_sum = Zint32Codec::Codec::kHasSumApi
+                        && visitor->accepts_key_sum();
+
+    for (; it < end; it++) {
+      if (start >= it->key_count()) {
+        start -= it->key_count();
+        continue;
+      }
+
+      size_t length = it->key_count() - start;
+      bool done = false;
+      if (start == 0) {
+        done = visitor->visit_compressed_block(it->value(), it->highest(),
+                              record_array, length);
+        if (!done && use_sum) {
+          visitor->visit_key_sum(Zint32Codec::sum(it,
+                              (uint32_t *)block_data(it)), length);
+          done = true;
+        }
+      }
+
+      if (!done) {
+        data[0] = it->value();
+        uncompress_block(it, &data[1]);
+        (*visitor)(&data[start], record_array, length);
+      }
+
+      if (record_array)
+        record_array += length * record_size;
+      start = 0;
+    }
+  }
+
   // Copies all keys from this[sstart] to dest[dstart]; this method
   // is used to split and merge btree nodes.
   void copy_to(int sstart, size_t node_count, BlockKeyList &dest,
@@ -106,6 +106,41 @@ for_select(const uint8_t *in, uint32_t index)
   }
 }
 
+// Returns the sum of the |length| values of a FOR frame: the sum of the
+// packed deltas plus |length| times the reference value. The deltas
+// form a contiguous little-endian bit stream, therefore they are added
+// up without storing them.
+static inline uint64_t
+for_sum(const uint8_t *in, uint32_t length)
+{
+  /* load min and the bits */
+  uint32_t base = *(uint32_t *)(in + 0);
+  uint32_t bits = *(in + 4);
+  in += 5;
+
+  assert(bits <= 32);
+
+  uint64_t sum = (uint64_t)base * length;
+  if (bits == 0)
+    return sum;
+
+  uint64_t mask = ((uint64_t)1 << bits) - 1;
+  uint64_t buffer = 0;
+  uint32_t available = 0;
+
+  for (uint32_t i = 0; i < length; i++) {
+    while (available < bits) {
+      buffer |= (uint64_t)*in++ << available;
+      available += 8;
+    }
+    sum += buffer & mask;
+    buffer >>= bits;
+    available -= bits;
+  }
+
+  return sum;
+}
+
 // This structure is an "index" entry which describes the location
 // of a variable-length block
 #include "1base/packstart.h"
@@ -186,6 +221,7 @@ struct ForCodecImpl : BlockCodecBase<ForIndex> {
     kHasFindLowerBoundApi = 1,
     kHasSelectApi = 1,
     kHasAppendApi = 1,
+    kHasSumApi = 1,
   };
 
   static uint32_t *uncompress_block(ForIndex *index,
@@ -232,6 +268,12 @@ struct ForCodecImpl : BlockCodecBase<ForIndex> {
     return Zint32::for_select((const uint8_t *)block_data, position_in_block);
   }
 
+  // Returns the sum of the compressed values (without the index value)
+  static uint64_t sum(ForIndex *index, const uint32_t *block_data) {
+    return Zint32::for_sum((const uint8_t *)block_data,
+                    index->key_count() - 1);
+  }
+
   static uint32_t estimate_required_size(ForIndex *index, uint8_t *block_data,
                         uint32_t key) {
       uint32_t min = *(uint32_t *)block_data;
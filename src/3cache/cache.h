@@ -19,12 +19,22 @@
 /*
  * The Cache Manager
  *
- * Stores pages in a non-intrusive hash table (each Page instance keeps
- * next/previous pointers for the overflow bucket). Can efficiently purge
- * unused pages, because all pages are also stored in a (non-intrusive)
- * linked list, and whenever a page is accessed it is removed and re-inserted
- * at the head. The tail therefore points to the page which was not used
- * in a long time, and is the primary candidate for purging.
+ * Stores pages in non-intrusive hash tables (each Page instance keeps
+ * next/previous pointers for the overflow bucket). The cache is split into
+ * shards; each shard has its own lock, its own (growing) hash table and its
+ * own eviction queues. A page is assigned to a shard by its address.
+ *
+ * The default eviction policy is "2Q" (Johnson/Shasha). Pages which are
+ * fetched for the first time are stored in a FIFO queue ("cold"); they are
+ * purged before the pages in the LRU list ("hot"). A page is only moved to
+ * the "hot" list if it is fetched again after it was purged. This makes the
+ * cache resistant to scans: a full table scan only affects the "cold" pages,
+ * and the working set is not evicted.
+ *
+ * The "LRU" policy stores all pages in the "hot" list; whenever a page is
+ * accessed it is moved to the head. The tail therefore points to the page
+ * which was not used in a long time, and is the primary candidate for
+ * purging.
  *
  * @exception_safe: nothrow
  * @thread_safe: yes
@@ -35,11 +45,13 @@
 
 #include "0root/root.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "ups/upscaledb_int.h"
 
 // Always verify that a file of level N does not include headers > N!
+#include "1os/os.h"
 #include "2page/page.h"
 #include "2page/page_collection.h"
 #include "2config/env_config.h"
@@ -51,32 +63,24 @@
 
 namespace upscaledb {
 
-namespace Impl {
-// Calculates the hash of a page address
-static inline size_t
-calc_hash(uint64_t value)
-{
-  return (size_t)(value % CacheState::kBucketSize);
-}
-} // namespace Impl
-
 struct Cache
 {
-  template<typename Purger>
-  struct PurgeIfSelector {
-    PurgeIfSelector(Cache *cache, Purger &purger)
-      : cache_(cache), purger_(purger) {
-    }
-
-    bool operator()(Page *page) {
-      if (purger_(page))
-        cache_->del(page);
-      // don't remove page from list; it was already removed above
-      return false;
-    }
+  // Iterators over the eviction queues of all shards, used while the
+  // cache is purged
+  struct PurgeState {
+    Page *cold[CacheState::kShardCount];
+    Page *hot[CacheState::kShardCount];
+    size_t cold_left[CacheState::kShardCount];
+    size_t hot_left[CacheState::kShardCount];
+    size_t cold_total;
+    size_t hot_total;
+  };
 
-    Cache *cache_;
-    Purger &purger_;
+  // The eviction queues; stored in the Page
+  enum {
+    kQueueNone = 0,
+    kQueueCold = 1,
+    kQueueHot  = 2
   };
 
   // The default constructor
@@ -85,103 +89,223 @@ struct Cache
   }
 
   // Fills in the current metrics
-  void fill_metrics(ups_env_metrics_t *metrics) const {
-    metrics->cache_hits = state.cache_hits;
-    metrics->cache_misses = state.cache_misses;
+  void fill_metrics(ups_env_metrics_t *metrics) {
+    CacheShard::TypeMetrics types[CacheShard::kTypeMax];
+
+    metrics->cache_hits = 0;
+    metrics->cache_misses = 0;
+    for (int i = 0; i < CacheState::kShardCount; i++) {
+      CacheShard &shard = state.shards[i];
+      ScopedSpinlock lock(shard.mutex);
+      metrics->cache_hits += shard.cache_hits;
+      metrics->cache_misses += shard.cache_misses;
+      for (int t = 0; t < CacheShard::kTypeMax; t++) {
+        types[t].hits += shard.type_metrics[t].hits;
+        types[t].misses += shard.type_metrics[t].misses;
+        types[t].evictions += shard.type_metrics[t].evictions;
+        types[t].dirty_purge_candidates
+                += shard.type_metrics[t].dirty_purge_candidates;
+        types[t].residency_usec += shard.type_metrics[t].residency_usec;
+      }
+    }
+
+    fill_type_metrics(&metrics->cache_root_metrics,
+                    types[type_index(Page::kTypeBroot)]);
+    fill_type_metrics(&metrics->cache_index_metrics,
+                    types[type_index(Page::kTypeBindex)]);
+    fill_type_metrics(&metrics->cache_blob_metrics,
+                    types[type_index(Page::kTypeBlob)]);
+    fill_type_metrics(&metrics->cache_page_manager_metrics,
+                    types[type_index(Page::kTypePageManager)]);
+    metrics->cache_purge_candidates = state.purge_candidates;
+    metrics->cache_purge_garbage = state.purge_garbage;
   }
 
-  // Retrieves a page from the cache, also removes the page from the cache
-  // and re-inserts it at the front. Returns null if the page was not cached.
+  // Retrieves a page from the cache. Pages in the "hot" list are moved
+  // to the front. Returns null if the page was not cached.
   Page *get(uint64_t address) {
-    size_t hash = Impl::calc_hash(address);
+    CacheShard &shard = shard_of(address);
+    ScopedSpinlock lock(shard.mutex);
 
-    Page *page = state.buckets[hash].get(address);
+    Page *page = shard.buckets[bucket_of(shard, address)].get(address);
     if (!page) {
-      state.cache_misses++;
+      shard.cache_misses++;
       return 0;
     }
 
-    // Now re-insert the page at the head of the "totallist", and
-    // thus move far away from the tail. The pages at the tail are highest
-    // candidates to be deleted when the cache is purged.
-    state.totallist.del(page);
-    state.totallist.put(page);
-    state.cache_hits++;
+    // Re-insert the page at the head of the "hot" list, and thus move far
+    // away from the tail. The pages at the tail are highest candidates to
+    // be deleted when the cache is purged.
+    // "Cold" pages are not promoted; correlated references (i.e. of a
+    // scan) would otherwise flush the working set.
+    if (page->cache_queue() == kQueueHot) {
+      shard.hot.del(page);
+      shard.hot.put(page);
+    }
+    shard.cache_hits++;
+    shard.type_metrics[type_index(page)].hits++;
     return page;
   }
 
-  // Stores a page in the cache
-  void put(Page *page) {
-    size_t hash = Impl::calc_hash(page->address());
+  // Returns true if a page is cached. Unlike |get()|, this neither
+  // promotes the page nor updates the hit/miss counters.
+  bool contains(uint64_t address) {
+    CacheShard &shard = shard_of(address);
+    ScopedSpinlock lock(shard.mutex);
+    return shard.buckets[bucket_of(shard, address)].get(address) != 0;
+  }
+
+  // Stores a page in the cache. |fetched| is true if the page was just
+  // read from disk (after a cache miss).
+  void put(Page *page, bool fetched = false) {
+    uint64_t address = page->address();
+    CacheShard &shard = shard_of(address);
+    ScopedSpinlock lock(shard.mutex);
+
+    // already cached? then treat it like a cache hit
+    if (page->cache_queue() == kQueueHot) {
+      shard.hot.del(page);
+      shard.hot.put(page);
+      return;
+    }
+    if (page->cache_queue() == kQueueCold)
+      return;
+
+    // Pages which were recently purged from the "cold" queue are part of
+    // the working set
+    if (state.policy == UPS_CACHE_POLICY_LRU || forget_ghost(shard, address)) {
+      shard.hot.put(page);
+      page->set_cache_queue(kQueueHot);
+    }
+    else {
+      shard.cold.put(page);
+      page->set_cache_queue(kQueueCold);
+    }
 
-    /* First remove the page from the cache, if it's already cached
-     *
-     * Then re-insert the page at the head of the list. The tail will
-     * point to the least recently used page.
-     */
-    state.totallist.del(page);
-    state.totallist.put(page);
+    shard.buckets[bucket_of(shard, address)].put(page);
+    page->set_cache_timestamp(os_now_usec());
+    if (fetched)
+      shard.type_metrics[type_index(page)].misses++;
+
+    state.total_elements++;
     if (page->is_allocated())
       state.alloc_elements++;
 
-    state.buckets[hash].put(page);
+    if (shard.size() > shard.buckets.size() * 2)
+      grow(shard);
   }
 
   // Removes a page from the cache
   void del(Page *page) {
     assert(page->address() != 0);
 
-    /* remove it from the list of all cached pages */
-    if (state.totallist.del(page) && page->is_allocated())
-      state.alloc_elements--;
+    CacheShard &shard = shard_of(page->address());
+    ScopedSpinlock lock(shard.mutex);
+    del_unlocked(shard, page);
+  }
+
+  // Removes a page which was purged from the cache. If the page was
+  // "cold" then its address is remembered; if it's fetched again then it
+  // will be stored in the "hot" list.
+  void evict(Page *page) {
+    assert(page->address() != 0);
+
+    CacheShard &shard = shard_of(page->address());
+    ScopedSpinlock lock(shard.mutex);
+    if (page->cache_queue() == kQueueNone)
+      return;
+    if (page->cache_queue() == kQueueCold)
+      remember_ghost(shard, page->address());
+
+    CacheShard::TypeMetrics &tm = shard.type_metrics[type_index(page)];
+    tm.evictions++;
+    tm.residency_usec += os_now_usec() - page->cache_timestamp();
 
-    /* remove the page from the cache buckets */
-    size_t hash = Impl::calc_hash(page->address());
-    state.buckets[hash].del(page);
+    del_unlocked(shard, page);
   }
 
-  // Purges the cache. Implements a LRU eviction algorithm. Dirty pages are
-  // forwarded to the |processor()| for flushing.
+  // Collects the candidates for purging the cache. Dirty pages are
+  // stored in |candidates| (they first need to be flushed), all others
+  // are stored in |garbage|.
   // The |ignore_page| is passed by the caller; this page will not be purged
   // under any circumstance. This is used by the PageManager to make sure
   // that the "last blob page" is not evicted by the cache.
   void purge_candidates(std::vector<uint64_t> &candidates,
                   std::vector<Page *> &garbage,
                   Page *ignore_page) {
-    int limit = (int)(current_elements()
-                      - (state.capacity_bytes / state.page_size_bytes));
-
-    Page *page = state.totallist.tail();
-    for (int i = 0; i < limit && page != 0; i++) {
-      if (page->mutex().try_lock()) {
-        if (page->cursor_list.size() == 0
-              && page != ignore_page
-              && page->type() != Page::kTypeBroot) {
-          if (page->is_dirty())
-            candidates.push_back(page->address());
-          else
-            garbage.push_back(page);
-        }
-        page->mutex().unlock();
-      }
+    for (int i = 0; i < CacheState::kShardCount; i++)
+      state.shards[i].mutex.lock();
+
+    PurgeState ps = {{0}, {0}, {0}, {0}, 0, 0};
+    for (int i = 0; i < CacheState::kShardCount; i++) {
+      ps.cold[i] = state.shards[i].cold.tail();
+      ps.hot[i] = state.shards[i].hot.tail();
+      ps.cold_left[i] = state.shards[i].cold.size_;
+      ps.hot_left[i] = state.shards[i].hot.size_;
+      ps.cold_total += ps.cold_left[i];
+      ps.hot_total += ps.hot_left[i];
+    }
 
-      page = page->previous(Page::kListCache);
+    size_t old_candidates = candidates.size();
+    size_t old_garbage = garbage.size();
+    size_t total = ps.cold_total + ps.hot_total;
+    size_t capacity = capacity_pages();
+    if (total > capacity) {
+      size_t limit = total - capacity;
+
+      // 2Q: purge the "cold" pages first, but only as long as they
+      // occupy more than a quarter of the cache
+      size_t cold_min = capacity / 4;
+      size_t visited = 0;
+      if (ps.cold_total > cold_min)
+        visited += collect(ps.cold, ps.cold_left, &ps.cold_total,
+                        std::min(limit, ps.cold_total - cold_min),
+                        candidates, garbage, ignore_page);
+      if (visited < limit)
+        visited += collect(ps.hot, ps.hot_left, &ps.hot_total,
+                        limit - visited, candidates, garbage, ignore_page);
+      if (visited < limit)
+        collect(ps.cold, ps.cold_left, &ps.cold_total,
+                        limit - visited, candidates, garbage, ignore_page);
     }
+
+    for (int i = CacheState::kShardCount - 1; i >= 0; i--)
+      state.shards[i].mutex.unlock();
+
+    state.purge_candidates += candidates.size() - old_candidates;
+    state.purge_garbage += garbage.size() - old_garbage;
   }
 
-  // Visits all pages in the "totallist". If |cb| returns true then the
-  // page is removed and deleted. This is used by the Environment
-  // to flush (and delete) pages.
+  // Visits all cached pages. If |purger| returns true then the page is
+  // removed. This is used by the Environment to flush (and delete) pages.
   template<typename Purger>
   void purge_if(Purger &purger) {
-    PurgeIfSelector<Purger> selector(this, purger);
-    state.totallist.extract(selector);
+    for (int i = 0; i < CacheState::kShardCount; i++) {
+      CacheShard &shard = state.shards[i];
+      ScopedSpinlock lock(shard.mutex);
+      purge_if(shard, shard.hot, purger);
+      purge_if(shard, shard.cold, purger);
+    }
   }
 
   // Returns true if the capacity limits are exceeded
   bool is_cache_full() const {
-    return state.totallist.size() * state.page_size_bytes
-            > state.capacity_bytes;
+    return current_elements() * state.page_size_bytes > available_bytes();
+  }
+
+  // Accounts memory which is attached to a cached page (i.e. by its
+  // btree node) when its size changes from |old_bytes| to |new_bytes|.
+  // This memory reduces the capacity for the pages.
+  void account_heap(size_t old_bytes, size_t new_bytes) {
+    if (new_bytes > old_bytes)
+      state.heap_bytes += new_bytes - old_bytes;
+    else if (old_bytes > new_bytes)
+      state.heap_bytes -= old_bytes - new_bytes;
+  }
+
+  // Returns the accounted memory (see account_heap())
+  uint64_t heap_bytes() const {
+    return state.heap_bytes;
   }
 
   // Returns the capacity (in bytes)
@@ -191,7 +315,7 @@ struct Cache
 
   // Returns the number of currently cached elements
   size_t current_elements() const {
-    return state.totallist.size();
+    return state.total_elements;
   }
 
   // Returns the number of currently cached elements (excluding those that
@@ -200,6 +324,166 @@ struct Cache
     return state.alloc_elements;
   }
 
+  // Returns the number of hash buckets of all shards (for testing)
+  size_t bucket_count() const {
+    size_t count = 0;
+    for (int i = 0; i < CacheState::kShardCount; i++)
+      count += state.shards[i].buckets.size();
+    return count;
+  }
+
+  // Returns the capacity (in pages); the accounted memory is deducted
+  size_t capacity_pages() const {
+    return (size_t)(available_bytes() / state.page_size_bytes);
+  }
+
+  // Returns the capacity (in bytes) minus the accounted memory
+  uint64_t available_bytes() const {
+    uint64_t heap = state.heap_bytes;
+    return state.capacity_bytes - std::min(heap, state.capacity_bytes);
+  }
+
+  // Returns the shard of a page
+  CacheShard &shard_of(uint64_t address) {
+    uint64_t index = address / state.page_size_bytes;
+    return state.shards[index & (CacheState::kShardCount - 1)];
+  }
+
+  // Returns the hash bucket of a page in its shard
+  size_t bucket_of(CacheShard &shard, uint64_t address) const {
+    uint64_t index = address / state.page_size_bytes / CacheState::kShardCount;
+    return (size_t)(index & (shard.buckets.size() - 1));
+  }
+
+  // Removes a page from the cache; the caller has locked the |shard|
+  void del_unlocked(CacheShard &shard, Page *page) {
+    switch (page->cache_queue()) {
+      case kQueueCold:
+        shard.cold.del(page);
+        break;
+      case kQueueHot:
+        shard.hot.del(page);
+        break;
+      default:
+        return;
+    }
+    page->set_cache_queue(kQueueNone);
+
+    shard.buckets[bucket_of(shard, page->address())].del(page);
+
+    state.total_elements--;
+    if (page->is_allocated())
+      state.alloc_elements--;
+  }
+
+  // Visits up to |limit| pages from the tails of one of the queues of all
+  // shards; every shard contributes in relation to the length of its queue.
+  // |pages| and |left| store the current position in each queue, |total|
+  // is the number of remaining pages in all queues.
+  // Returns the number of visited pages.
+  size_t collect(Page **pages, size_t *left, size_t *total, size_t limit,
+                  std::vector<uint64_t> &candidates,
+                  std::vector<Page *> &garbage, Page *ignore_page) {
+    size_t visited = 0;
+    size_t initial_total = *total;
+    for (int i = 0; i < CacheState::kShardCount && visited < limit; i++) {
+      if (left[i] == 0)
+        continue;
+      size_t n = (limit * left[i] + initial_total - 1) / initial_total;
+      for (; n > 0 && pages[i] != 0 && visited < limit; n--, visited++) {
+        purge_candidate(state.shards[i], pages[i], candidates, garbage,
+                        ignore_page);
+        pages[i] = pages[i]->previous(Page::kListCache);
+        left[i]--;
+        (*total)--;
+      }
+    }
+    return visited;
+  }
+
+  // Adds |page| to the purge candidates, unless it's in use
+  static void purge_candidate(CacheShard &shard, Page *page,
+                  std::vector<uint64_t> &candidates,
+                  std::vector<Page *> &garbage, Page *ignore_page) {
+    if (page->mutex().try_lock()) {
+      if (page->cursor_list.size() == 0
+            && page != ignore_page
+            && page->type() != Page::kTypeBroot) {
+        if (page->is_dirty()) {
+          candidates.push_back(page->address());
+          shard.type_metrics[type_index(page)].dirty_purge_candidates++;
+        }
+        else
+          garbage.push_back(page);
+      }
+      page->mutex().unlock();
+    }
+  }
+
+  // Returns the index of a page type in CacheShard::type_metrics
+  static int type_index(uint32_t type) {
+    return (int)(type >> 28) & (CacheShard::kTypeMax - 1);
+  }
+
+  // Returns the index of the page's type in CacheShard::type_metrics. Pages
+  // without header are part of a (multi-page) blob
+  static int type_index(Page *page) {
+    return type_index(page->is_without_header()
+                          ? (uint32_t)Page::kTypeBlob
+                          : page->type());
+  }
+
+  // Copies the metrics of a page type
+  static void fill_type_metrics(cache_metrics_t *metrics,
+                  const CacheShard::TypeMetrics &tm) {
+    metrics->hits = tm.hits;
+    metrics->misses = tm.misses;
+    metrics->evictions = tm.evictions;
+    metrics->dirty_purge_candidates = tm.dirty_purge_candidates;
+    metrics->avg_residency_usec = tm.evictions
+                                    ? tm.residency_usec / tm.evictions
+                                    : 0;
+  }
+
+  // Applies the |purger| to all pages of a queue
+  template<typename Purger>
+  void purge_if(CacheShard &shard, CacheShard::Queue &queue,
+                  Purger &purger) {
+    Page *page = queue.head();
+    while (page) {
+      Page *next = page->next(Page::kListCache);
+      if (purger(page))
+        del_unlocked(shard, page);
+      page = next;
+    }
+  }
+
+  // Doubles the number of hash buckets of a shard
+  void grow(CacheShard &shard) {
+    std::vector<CacheShard::CacheLine> buckets(shard.buckets.size() * 2);
+    buckets.swap(shard.buckets);
+    for (size_t i = 0; i < buckets.size(); i++) {
+      while (Page *page = buckets[i].head()) {
+        buckets[i].del(page);
+        shard.buckets[bucket_of(shard, page->address())].put(page);
+      }
+    }
+  }
+
+  // Remembers the address of a page which was purged from the "cold" queue
+  void remember_ghost(CacheShard &shard, uint64_t address) {
+    size_t limit = capacity_pages() / CacheState::kShardCount / 2;
+    if (limit == 0)
+      limit = 1;
+
+    shard.ghosts.push(address, limit);
+  }
+
+  // Returns true if |address| was recently purged from the "cold" queue
+  bool forget_ghost(CacheShard &shard, uint64_t address) {
+    return shard.ghosts.erase(address);
+  }
+
   CacheState state;
 };
 
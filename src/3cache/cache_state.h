@@ -21,11 +21,15 @@
 
 #include "0root/root.h"
 
+#include <algorithm>
 #include <vector>
+#include <boost/atomic.hpp>
 
 #include "ups/types.h"
 
 // Always verify that a file of level N does not include headers > N!
+#include "1base/intrusive_list.h"
+#include "1base/spinlock.h"
 #include "2page/page.h"
 #include "2page/page_collection.h"
 #include "2config/env_config.h"
@@ -36,23 +40,273 @@
 
 namespace upscaledb {
 
-struct CacheState
+//
+// The addresses of pages which were recently evicted from the "cold" queue
+// (2Q: "A1out"). A ring buffer stores the addresses in FIFO order, an open
+// addressing hash table (linear probing) is used for lookups. Each entry
+// carries a sequence number; if an address is removed and added again then
+// its old entry in the ring is stale and ignored when it's pushed out.
+//
+// Both arrays grow (by doubling) till they reach the limit; afterwards
+// adding an address does not allocate memory.
+//
+struct GhostQueue
+{
+  struct Entry {
+    uint64_t address;
+    uint64_t sequence;
+  };
+
+  enum {
+    // The initial capacity of the ring buffer
+    kInitialCapacity = 16
+  };
+
+  GhostQueue()
+    : head(0), count(0), table_size(0), next_sequence(1) {
+  }
+
+  // Returns the number of valid addresses (for testing)
+  size_t size() const {
+    return table_size;
+  }
+
+  // Adds |address|; the oldest entry is pushed out if more than |limit|
+  // entries are stored
+  void push(uint64_t address, size_t limit) {
+    if (lookup(address) != kNotFound)
+      return;
+
+    if (count == ring.size()) {
+      if (ring.size() < limit)
+        grow(std::min(limit, std::max((size_t)kInitialCapacity,
+                                  ring.size() * 2)));
+      else
+        pop();
+    }
+
+    Entry e = {address, next_sequence++};
+    ring[(head + count) % ring.size()] = e;
+    count++;
+    insert(e);
+  }
+
+  // Removes |address|; returns true if it was stored
+  bool erase(uint64_t address) {
+    size_t slot = lookup(address);
+    if (slot == kNotFound)
+      return false;
+    erase_slot(slot);
+    return true;
+  }
+
+  private:
+    enum {
+      kNotFound = ~(size_t)0
+    };
+
+    // Marks an empty slot in the hash table; a page never has this address
+    static const uint64_t kEmpty = ~(uint64_t)0;
+
+    // Returns the slot of |address| in the hash table
+    size_t lookup(uint64_t address) const {
+      if (table.empty())
+        return kNotFound;
+      size_t mask = table.size() - 1;
+      for (size_t i = hash(address) & mask; ; i = (i + 1) & mask) {
+        if (table[i].address == address)
+          return i;
+        if (table[i].address == kEmpty)
+          return kNotFound;
+      }
+    }
+
+    // Stores |e| in the hash table
+    void insert(const Entry &e) {
+      size_t mask = table.size() - 1;
+      size_t i = hash(e.address) & mask;
+      while (table[i].address != kEmpty)
+        i = (i + 1) & mask;
+      table[i] = e;
+      table_size++;
+    }
+
+    // Removes the entry in |slot|; the following entries of the same
+    // cluster are shifted back, therefore no tombstones are required
+    void erase_slot(size_t slot) {
+      size_t mask = table.size() - 1;
+      size_t i = slot;
+      for (size_t j = (i + 1) & mask; table[j].address != kEmpty;
+                      j = (j + 1) & mask) {
+        size_t home = hash(table[j].address) & mask;
+        // move |j| to |i| if its home slot is not in the range (i, j]
+        if ((i <= j) ? (home <= i || home > j) : (home <= i && home > j)) {
+          table[i] = table[j];
+          i = j;
+        }
+      }
+      table[i].address = kEmpty;
+      table_size--;
+    }
+
+    // Removes the oldest entry from the ring; the address is only removed
+    // from the hash table if the entry is not stale
+    void pop() {
+      Entry &e = ring[head];
+      size_t slot = lookup(e.address);
+      if (slot != kNotFound && table[slot].sequence == e.sequence)
+        erase_slot(slot);
+      head = (head + 1) % ring.size();
+      count--;
+    }
+
+    // Resizes the ring to |capacity| entries and rebuilds the hash table
+    void grow(size_t capacity) {
+      std::vector<Entry> new_ring(capacity);
+      for (size_t i = 0; i < count; i++)
+        new_ring[i] = ring[(head + i) % ring.size()];
+      new_ring.swap(ring);
+      head = 0;
+
+      size_t table_capacity = 1;
+      while (table_capacity < capacity * 2)
+        table_capacity *= 2;
+      std::vector<Entry> old_table(table_capacity);
+      old_table.swap(table);
+      Entry empty = {kEmpty, 0};
+      std::fill(table.begin(), table.end(), empty);
+      table_size = 0;
+      for (size_t i = 0; i < old_table.size(); i++)
+        if (old_table[i].address != kEmpty)
+          insert(old_table[i]);
+    }
+
+    static size_t hash(uint64_t address) {
+      // Fibonacci hashing; page addresses are multiples of the page size
+      return (size_t)((address * 0x9e3779b97f4a7c15ull) >> 32);
+    }
+
+    // the FIFO queue of entries; |head| is the oldest one
+    std::vector<Entry> ring;
+    size_t head;
+    size_t count;
+
+    // the hash table; its size is a power of two
+    std::vector<Entry> table;
+    size_t table_size;
+
+    // the sequence number of the next entry
+    uint64_t next_sequence;
+};
+
+//
+// A shard of the Cache, protected by its own lock
+//
+struct CacheShard
 {
   typedef PageCollection<Page::kListBucket> CacheLine;
+  typedef IntrusiveList<Page, Page::kListCache> Queue;
+
+  // Metrics of a single page type
+  struct TypeMetrics {
+    TypeMetrics()
+      : hits(0), misses(0), evictions(0), dirty_purge_candidates(0),
+        residency_usec(0) {
+    }
+
+    // number of cache hits
+    uint64_t hits;
+
+    // number of pages fetched from disk
+    uint64_t misses;
+
+    // number of purged pages
+    uint64_t evictions;
+
+    // number of times a dirty page was selected for purging (and had to
+    // be flushed before it could be evicted)
+    uint64_t dirty_purge_candidates;
+
+    // accumulated residency time of the purged pages
+    uint64_t residency_usec;
+  };
 
   enum {
-    // The number of buckets should be a prime number or similar, as it
-    // is used in a MODULO hash scheme
-    kBucketSize = 10317,
+    // Number of page types (see Page::kType*)
+    kTypeMax = 8
+  };
+
+  CacheShard()
+    : cache_hits(0), cache_misses(0) {
+  }
+
+  // Returns the number of cached pages
+  size_t size() const {
+    return cold.size_ + hot.size_;
+  }
+
+  // protects the shard
+  Spinlock mutex;
+
+  // The hash table buckets - each is a linked list of Page pointers.
+  // The number of buckets is a power of two; the table grows with the
+  // number of cached pages
+  std::vector<CacheLine> buckets;
+
+  // Pages which were referenced only once (2Q: "A1in"); a FIFO queue.
+  // Unused by the LRU policy
+  Queue cold;
+
+  // Pages which were referenced repeatedly (2Q: "Am"); a LRU list. The
+  // LRU policy stores all pages in this list
+  Queue hot;
+
+  // Addresses of pages which were recently evicted from |cold| (2Q: "A1out");
+  // if such a page is fetched again then it's moved to |hot|
+  GhostQueue ghosts;
+
+  // counts the cache hits
+  uint64_t cache_hits;
+
+  // counts the cache misses
+  uint64_t cache_misses;
+
+  // metrics per page type, indexed by Cache::type_index()
+  TypeMetrics type_metrics[kTypeMax];
+};
+
+struct CacheState
+{
+  enum {
+    // The number of shards; must be a power of two
+    kShardCount = 16,
+
+    // The minimum number of hash buckets per shard; must be a power of two
+    kMinBuckets = 64,
+
+    // The maximum initial number of hash buckets per shard
+    kMaxInitialBuckets = 64 * 1024
   };
 
   CacheState(const EnvConfig &config)
     : capacity_bytes(ISSET(config.flags, UPS_CACHE_UNLIMITED)
                             ? std::numeric_limits<uint64_t>::max()
                             : config.cache_size_bytes),
-      page_size_bytes(config.page_size_bytes), alloc_elements(0),
-      buckets(kBucketSize), cache_hits(0), cache_misses(0) {
+      page_size_bytes(config.page_size_bytes), policy(config.cache_policy),
+      total_elements(0), alloc_elements(0), heap_bytes(0),
+      purge_candidates(0), purge_garbage(0) {
     assert(capacity_bytes > 0);
+
+    // size the hash tables for the capacity of the cache; unlimited caches
+    // start small, and the shards grow with the number of cached pages
+    size_t bucket_count = kMinBuckets;
+    if (NOTSET(config.flags, UPS_CACHE_UNLIMITED)) {
+      uint64_t pages = capacity_bytes / page_size_bytes / kShardCount;
+      while (bucket_count < pages && bucket_count < kMaxInitialBuckets)
+        bucket_count *= 2;
+    }
+    for (int i = 0; i < kShardCount; i++)
+      shards[i].buckets.resize(bucket_count);
   }
 
   // the capacity (in bytes)
@@ -61,21 +315,28 @@ struct CacheState
   // the current page size (in bytes)
   uint64_t page_size_bytes;
 
+  // the eviction policy (UPS_CACHE_POLICY_*)
+  int policy;
+
+  // the current number of cached elements
+  boost::atomic<size_t> total_elements;
+
   // the current number of cached elements that were allocated (and not
   // mapped)
-  size_t alloc_elements;
+  boost::atomic<size_t> alloc_elements;
 
-  // linked list of ALL cached pages
-  PageCollection<Page::kListCache> totallist;
+  // memory (in bytes) which is attached to the cached pages, but not
+  // part of them (i.e. the key heads of the btree nodes)
+  boost::atomic<uint64_t> heap_bytes;
 
-  // The hash table buckets - each is a linked list of Page pointers
-  std::vector<CacheLine> buckets;
+  // number of dirty pages selected for purging
+  boost::atomic<uint64_t> purge_candidates;
 
-  // counts the cache hits
-  uint64_t cache_hits;
+  // number of clean pages selected for purging
+  boost::atomic<uint64_t> purge_garbage;
 
-  // counts the cache misses
-  uint64_t cache_misses;
+  // the shards; a page is assigned to a shard by its address
+  CacheShard shards[kShardCount];
 };
 
 } // namespace upscaledb
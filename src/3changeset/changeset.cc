@@ -79,12 +79,16 @@ flush_changeset_to_file(std::vector<Page *> list, Device *device,
 
     if (likely(page->is_without_header() == false))
       page->set_lsn(lsn);
-
-    page->flush();
-    page->mutex().unlock();
-    UPS_INDUCE_ERROR(ErrorInducer::kChangesetFlush);
   }
 
+  // write the pages; adjacent pages are coalesced into a single write
+  Page::flush(device, list);
+
+  for (it = list.begin(); it != list.end(); it++)
+    (*it)->mutex().unlock();
+
+  UPS_INDUCE_ERROR(ErrorInducer::kChangesetFlush);
+
   /* flush the file handle (if required) */
   if (enable_fsync)
     device->flush();
@@ -27,7 +27,9 @@
 #include "1errorinducer/errorinducer.h"
 #include "1os/os.h"
 #include "2device/device.h"
+#include "2page/page_buffer_pool.h"
 #include "2compressor/compressor_factory.h"
+#include "2worker/worker.h"
 #include "3journal/journal.h"
 #include "3page_manager/page_manager.h"
 #include "4db/db.h"
@@ -49,19 +51,74 @@ enum {
 
   // flush buffers if this limit is exceeded
   kBufferLimit = 1024 * 1024, // 1 mb
+
+  // delta journaling: the maximum size of all buffered page images
+  kPageImageLimit = 32 * 1024 * 1024, // 32 mb
+
+  // delta journaling: modified ranges are merged if they are separated
+  // by no more unmodified bytes than the size of a range header
+  kMinRangeGap = sizeof(PJournalEntryPageRange),
+
+  // recovery: the files are read in chunks of this size
+  kReadAheadSize = 1024 * 1024, // 1 mb
+
+  // recovery: redo the buffered changeset pages if their payload
+  // exceeds this limit
+  kRedoBatchLimit = 16 * 1024 * 1024, // 16 mb
+
+  // recovery: the maximum number of threads which redo the pages
+  kMaxRedoThreads = 8,
+
+  // recovery: the minimum interval between two progress reports
+  kProgressIntervalUsec = 100 * 1000, // 100 msec
+
+  // preallocated files: writes are padded to this alignment
+  kSegmentAlignment = 4096,
+};
+
+// The leader of a group commit syncs the files without holding the
+// Environment lock (see Journal::wait_for_durable_lsn()). Truncating or
+// closing a file therefore waits till the leader is done, and keeps other
+// leaders from starting in the meantime.
+struct ScopedSyncBarrier
+{
+  ScopedSyncBarrier(JournalState &state)
+    : state_(state) {
+    ScopedLock lock(state_.sync_mutex);
+    while (state_.sync_in_progress)
+      state_.sync_done.wait(lock);
+    state_.sync_in_progress = true;
+  }
+
+  ~ScopedSyncBarrier() {
+    ScopedLock lock(state_.sync_mutex);
+    state_.sync_in_progress = false;
+    state_.sync_done.notify_all();
+  }
+
+  JournalState &state_;
 };
 
 static inline void
 clear_file(JournalState &state, int idx)
 {
+  ScopedSyncBarrier barrier(state);
+
   if (state.files[idx].is_open()) {
     state.files[idx].truncate(0);
 
-    // after truncate, the file pointer is far beyond the new end of file;
-    // reset the file pointer, or the next write will resize the file to
-    // the original size
-    state.files[idx].seek(0, File::kSeekSet);
+    // the preallocated blocks are filled with zeroes, which mark the end
+    // of the journal
+    if (state.segment_size)
+      state.files[idx].preallocate(state.segment_size);
   }
+  state.write_offsets[idx] = 0;
+  state.read_fd = -1;
+
+  // the file which is cleared becomes the current file; its pages are
+  // logged as full images when they are modified for the first time
+  state.page_images.clear();
+  state.page_image_order.clear();
 }
 
 static inline std::string
@@ -95,19 +152,135 @@ log_file_path(JournalState &state, int i)
   return (path);
 }
 
+// Appends a kEntryTypePadding entry to the buffer, therefore the buffer
+// ends at a 4 kb boundary of the file
+static inline void
+pad_buffer(JournalState &state)
+{
+  size_t size = state.buffer.size();
+  size_t padding = kSegmentAlignment - size % kSegmentAlignment;
+  if (padding == kSegmentAlignment)
+    return;
+  if (padding < sizeof(PJournalEntry))
+    padding += kSegmentAlignment;
+
+  // the padding uses the lsn of the first buffered entry; an lsn of zero
+  // would mark the end of the journal
+  PJournalEntry entry;
+  entry.lsn = ((PJournalEntry *)state.buffer.data())->lsn;
+  entry.type = Journal::kEntryTypePadding;
+  entry.followup_size = padding - sizeof(entry);
+
+  uint8_t *p = state.buffer.resize(size + padding) + size;
+  ::memset(p, 0, padding);
+  ::memcpy(p, &entry, sizeof(entry));
+}
+
 static inline void
 flush_buffer(JournalState &state, int idx, bool fsync = false)
 {
   if (likely(state.buffer.size() > 0)) {
-    state.files[idx].write(state.buffer.data(), state.buffer.size());
+    // preallocated files: the writes start at aligned offsets and do not
+    // change the file size, therefore fdatasync() only flushes the data
+    if (state.segment_size)
+      pad_buffer(state);
+
+    state.files[idx].pwrite(state.write_offsets[idx], state.buffer.data(),
+                    state.buffer.size());
+    state.write_offsets[idx] += state.buffer.size();
     state.count_bytes_flushed += state.buffer.size();
 
     state.buffer.clear();
+    state.read_fd = -1;
     if (unlikely(fsync))
       state.files[idx].flush();
+
+    // all commits in the buffer are now written. Without group commit,
+    // each write of a commit is synced (if fsync is enabled), therefore
+    // they are also durable
+    ScopedLock lock(state.sync_mutex);
+    state.written_lsn = state.committed_lsn;
+    if (fsync && !state.group_commit)
+      state.durable_lsn = state.written_lsn;
   }
 }
 
+// Returns a pointer to |size| bytes at |offset| of the file |idx|. The
+// files are read sequentially in large chunks; the pointer is valid till
+// the next call.
+static inline const uint8_t *
+read_file(JournalState &state, int idx, uint64_t offset, size_t size)
+{
+  if (state.read_fd != idx
+        || offset < state.read_offset
+        || offset + size > state.read_offset + state.read_size) {
+    uint64_t file_size = state.files[idx].file_size();
+    if (unlikely(offset + size > file_size)) {
+      ups_log(("journal entry exceeds the end of the file"));
+      throw Exception(UPS_IO_ERROR);
+    }
+
+    size_t length = std::max(size, (size_t)kReadAheadSize);
+    if (length > file_size - offset)
+      length = (size_t)(file_size - offset);
+
+    state.read_fd = -1;
+    state.read_buffer.resize(length);
+    state.files[idx].pread(offset, state.read_buffer.data(), length);
+    state.read_fd = idx;
+    state.read_offset = offset;
+    state.read_size = length;
+  }
+
+  return state.read_buffer.data() + (offset - state.read_offset);
+}
+
+// Adds |bytes| to the processed bytes of the recovery, and calls the
+// progress function (if there is one) unless it was called recently
+static inline void
+report_progress(JournalState &state, uint64_t bytes, bool done = false)
+{
+  state.recovery_processed += bytes;
+
+  ups_recovery_progress_func_t progress = state.env->config.recovery_progress;
+  if (!progress)
+    return;
+
+  uint64_t now = os_now_usec();
+  if (!done && now - state.recovery_reported_usec < kProgressIntervalUsec)
+    return;
+  state.recovery_reported_usec = now;
+
+  uint64_t total = state.recovery_total;
+  uint64_t processed = done
+                        ? total
+                        : std::min(state.recovery_processed, total);
+  uint64_t eta_msec = 0;
+  if (processed > 0 && processed < total) {
+    double elapsed = (double)(now - state.recovery_start_usec);
+    eta_msec = (uint64_t)(elapsed * (total - processed) / processed / 1000);
+  }
+
+  progress(processed, total, eta_msec,
+                  state.env->config.recovery_progress_context);
+}
+
+// Returns true if the journal file |idx| ends at |offset|. The unused
+// space of a preallocated file is filled with zeroes, and an lsn of zero
+// marks the end.
+static inline bool
+is_end_of_file(JournalState &state, int idx, uint64_t offset,
+                uint64_t filesize)
+{
+  if (offset >= filesize)
+    return true;
+  if (offset + sizeof(PJournalEntry) > filesize)
+    return false;
+  const PJournalEntry *entry = (const PJournalEntry *)read_file(state, idx,
+                  offset, sizeof(PJournalEntry));
+  return entry->lsn == 0;
+}
+
 // Sequentially returns the next journal entry, starting with
 // the oldest entry.
 //
@@ -138,7 +311,7 @@ read_entry(JournalState &state, Journal::Iterator *iter, PJournalEntry *entry,
   uint64_t filesize = state.files[iter->fdidx].file_size();
 
   // reached EOF? then either skip to the next file or we're done
-  if (filesize == iter->offset) {
+  if (is_end_of_file(state, iter->fdidx, iter->offset, filesize)) {
     if (iter->fdstart == iter->fdidx) {
       iter->fdidx = iter->fdidx == 1 ? 0 : 1;
       iter->offset = 0;
@@ -151,22 +324,22 @@ read_entry(JournalState &state, Journal::Iterator *iter, PJournalEntry *entry,
   }
 
   // second file is also empty? then return
-  if (filesize == iter->offset) {
+  if (is_end_of_file(state, iter->fdidx, iter->offset, filesize)) {
     entry->lsn = 0;
     return;
   }
 
   // now try to read the next entry
   try {
-    state.files[iter->fdidx].pread(iter->offset, entry, sizeof(*entry));
+    ::memcpy(entry, read_file(state, iter->fdidx, iter->offset,
+                            sizeof(*entry)), sizeof(*entry));
 
     iter->offset += sizeof(*entry);
 
     // read auxiliary data if it's available
     if (entry->followup_size) {
-      auxbuffer->resize((uint32_t)entry->followup_size);
-
-      state.files[iter->fdidx].pread(iter->offset, auxbuffer->data(),
+      auxbuffer->copy(read_file(state, iter->fdidx, iter->offset,
+                              (size_t)entry->followup_size),
                       (size_t)entry->followup_size);
       iter->offset += entry->followup_size;
     }
@@ -177,8 +350,6 @@ read_entry(JournalState &state, Journal::Iterator *iter, PJournalEntry *entry,
   }
 }
 
-
-// Appends an entry to the journal
 static inline void
 append_entry(JournalState &state, int idx,
             const uint8_t *ptr1 = 0, size_t ptr1_size = 0,
@@ -210,7 +381,10 @@ switch_files_maybe(JournalState &state)
   // if the "current" file is not yet full, continue to write to this file
   //
   // otherwise delete the other file and use the other file as the current file
-  if (unlikely(state.num_transactions > state.threshold)) {
+  if (unlikely(state.num_transactions > state.threshold
+          || (state.segment_size
+              && state.write_offsets[state.current_fd] + state.buffer.size()
+                    >= state.segment_size))) {
     clear_file(state, other);
     state.current_fd = other;
     state.num_transactions = 0;
@@ -290,6 +464,7 @@ static inline uint32_t
 append_changeset_page(JournalState &state, Page *page, uint32_t page_size)
 {
   PJournalEntryPageHeader header(page->address());
+  state.count_page_images++;
 
   if (state.compressor.get()) {
     state.count_bytes_before_compression += page_size;
@@ -307,31 +482,139 @@ append_changeset_page(JournalState &state, Page *page, uint32_t page_size)
   return page_size + sizeof(header);
 }
 
+// Writes the byte ranges in which |data| differs from |base| to |delta|,
+// which has room for |page_size| bytes; each range is prefixed with a
+// PJournalEntryPageRange. Returns the size of the delta, or |page_size| if
+// the delta would not be smaller than the page. |*count| receives the
+// number of ranges.
+static inline uint32_t
+diff_page(const uint8_t *base, const uint8_t *data, uint32_t page_size,
+                uint8_t *delta, uint32_t *count)
+{
+  // pages are compared in 64bit words
+  const uint64_t *b = (const uint64_t *)base;
+  const uint64_t *d = (const uint64_t *)data;
+  const uint32_t words = page_size / sizeof(uint64_t);
+  const uint32_t max_gap = kMinRangeGap / sizeof(uint64_t);
+  uint32_t size = 0;
+
+  *count = 0;
+  for (uint32_t i = 0; i < words; i++) {
+    if (b[i] == d[i])
+      continue;
+
+    // extend the range till the next gap of unmodified words
+    uint32_t end = i + 1;
+    for (uint32_t j = end; j < words && j - end <= max_gap; j++) {
+      if (b[j] != d[j])
+        end = j + 1;
+    }
+
+    PJournalEntryPageRange range(i * sizeof(uint64_t),
+                    (end - i) * sizeof(uint64_t));
+    if (size + sizeof(range) + range.size >= page_size)
+      return page_size;
+    ::memcpy(delta + size, &range, sizeof(range));
+    ::memcpy(delta + size + sizeof(range), data + range.offset, range.size);
+    size += sizeof(range) + range.size;
+    (*count)++;
+    i = end;
+  }
+
+  return size;
+}
+
+// Stores the image of |page| for computing the delta of its next
+// modification; the oldest images are discarded if the limit is exceeded
+static inline void
+store_page_image(JournalState &state, Page *page, uint32_t page_size)
+{
+  const uint8_t *data = (const uint8_t *)page->data();
+  std::vector<uint8_t> &image = state.page_images[page->address()];
+  if (image.empty()) {
+    state.page_image_order.push_back(page->address());
+    while (state.page_image_order.size() * page_size > kPageImageLimit) {
+      state.page_images.erase(state.page_image_order.front());
+      state.page_image_order.pop_front();
+    }
+  }
+  image.assign(data, data + page_size);
+}
+
+// Delta journaling: adds a single page of the changeset to the Journal.
+// Only the modified byte ranges are stored, unless the page is logged for
+// the first time in the current file, or if the ranges are not smaller
+// than the page. Returns the number of appended bytes.
+static inline uint32_t
+append_changeset_page_delta(JournalState &state, Page *page,
+                uint32_t page_size)
+{
+  PJournalEntryPageDelta header(page->address());
+  const uint8_t *payload = (const uint8_t *)page->data();
+  header.payload_size = page_size;
+
+  JournalState::PageImageMap::iterator it
+          = state.page_images.find(page->address());
+  if (it != state.page_images.end()) {
+    uint8_t *delta = state.delta_buffer.resize(page_size);
+    uint32_t count;
+    uint32_t size = diff_page(it->second.data(), payload, page_size,
+                    delta, &count);
+    if (size < page_size) {
+      header.range_count = count;
+      header.payload_size = size;
+      payload = delta;
+    }
+  }
+
+  if (header.is_full_image(page_size))
+    state.count_page_images++;
+  else
+    state.count_page_deltas++;
+
+  uint32_t payload_size = header.payload_size;
+  if (payload_size > 0 && state.compressor.get()) {
+    state.count_bytes_before_compression += payload_size;
+    header.compressed_size = state.compressor->compress(payload,
+                    payload_size);
+    state.count_bytes_after_compression += header.compressed_size;
+    payload = state.compressor->arena.data();
+    payload_size = header.compressed_size;
+  }
+
+  append_entry(state, state.current_fd, (uint8_t *)&header, sizeof(header),
+                payload, payload_size);
+
+  store_page_image(state, page, page_size);
+  return payload_size + sizeof(header);
+}
+
 // Scans a file for the oldest changeset. Returns the lsn of this
 // changeset.
 static inline uint64_t
-scan_for_oldest_changeset(JournalState &state, File *file)
+scan_for_oldest_changeset(JournalState &state, int fdidx)
 {
-  Journal::Iterator it;
+  uint64_t offset = 0;
   PJournalEntry entry;
-  ByteArray buffer;
 
   // get the next entry
   try {
-    uint64_t filesize = file->file_size();
+    uint64_t filesize = state.files[fdidx].file_size();
 
-    while (it.offset < filesize) {
-      file->pread(it.offset, &entry, sizeof(entry));
+    while (offset < filesize) {
+      ::memcpy(&entry, read_file(state, fdidx, offset, sizeof(entry)),
+                      sizeof(entry));
 
       if (entry.lsn == 0)
         break;
 
-      if (entry.type == Journal::kEntryTypeChangeset) {
+      if (entry.type == Journal::kEntryTypeChangeset
+            || entry.type == Journal::kEntryTypeChangesetDelta) {
         return entry.lsn;
       }
 
       // increment the offset
-      it.offset += sizeof(entry) + entry.followup_size;
+      offset += sizeof(entry) + entry.followup_size;
     }
   }
   catch (Exception &ex) {
@@ -341,101 +624,287 @@ scan_for_oldest_changeset(JournalState &state, File *file)
   return 0;
 }
 
-// Redo all Changesets of a log file, in chronological order
-// Returns the highest lsn of the last changeset applied
+// Scans a file for the newest checkpoint. Returns the lsn of this
+// checkpoint, or 0 if there is none.
 static inline uint64_t
-redo_all_changesets(JournalState &state, int fdidx)
+scan_for_newest_checkpoint(JournalState &state, int fdidx)
 {
-  Journal::Iterator it;
+  uint64_t offset = 0;
+  uint64_t lsn = 0;
   PJournalEntry entry;
-  ByteArray buffer;
+
+  try {
+    uint64_t filesize = state.files[fdidx].file_size();
+
+    while (offset < filesize) {
+      ::memcpy(&entry, read_file(state, fdidx, offset, sizeof(entry)),
+                      sizeof(entry));
+
+      if (entry.lsn == 0)
+        break;
+
+      if (entry.type == Journal::kEntryTypeCheckpoint)
+        lsn = entry.lsn;
+
+      offset += sizeof(entry) + entry.followup_size;
+    }
+  }
+  catch (Exception &ex) {
+    ups_log(("exception (error %d) while reading journal", ex.code));
+  }
+
+  return lsn;
+}
+
+// A page of a changeset which is redone during recovery
+struct RedoPage {
+  // the page header; full images have a |payload_size| of the page size
+  PJournalEntryPageDelta header;
+
+  // the offset of the (compressed) payload in RedoBatch::payload
+  size_t offset;
+};
+
+// Buffers the pages of the changesets and redoes them in parallel. The
+// pages are distributed to "lanes" by their address; the pages of a lane
+// are redone one after the other in the order of the journal, therefore
+// the modifications of a page are applied in the correct order. Each lane
+// is processed by a worker thread.
+struct RedoBatch {
+  RedoBatch(JournalState &state_)
+    : state(state_), page_size(state_.env->config.page_size_bytes) {
+    size_t threads = boost::thread::hardware_concurrency();
+    threads = std::max((size_t)1, std::min(threads, (size_t)kMaxRedoThreads));
+    if (threads > 1)
+      workers.reset(new WorkerPool(threads));
+
+    lanes.resize(threads);
+    status.resize(threads);
+    arenas.resize(threads);
+    // the buffers are taken from the page buffer pool, if available; they
+    // are aligned for direct I/O
+    Device *device = state.env->device.get();
+    for (size_t i = 0; i < threads; i++) {
+      pages.push_back(new Page(device));
+      if (device->buffer_pool)
+        pages[i]->assign_allocated_buffer(device->buffer_pool->allocate(), 0,
+                        device->buffer_pool);
+      else
+        pages[i]->assign_allocated_buffer(
+                        Memory::allocate<uint8_t>(page_size), 0);
+    }
+    payload.reserve(kRedoBatchLimit + page_size);
+  }
+
+  ~RedoBatch() {
+    // the workers have to complete before the pages are deleted
+    workers.reset(0);
+    for (size_t i = 0; i < pages.size(); i++)
+      delete pages[i];
+  }
+
+  // Buffers a page; |data| is the (compressed) payload
+  void add(const RedoPage &page, const uint8_t *data, size_t size) {
+    RedoPage p(page);
+    p.offset = payload.size();
+    payload.insert(payload.end(), data, data + size);
+    lanes[(p.header.address / page_size) % lanes.size()].push_back(p);
+  }
+
+  // Returns true if the buffered payload exceeds its limit
+  bool is_full() const {
+    return payload.size() >= kRedoBatchLimit;
+  }
+
+  // Redoes all buffered pages, then clears the buffers
+  void run() {
+    if (workers) {
+      for (size_t i = 0; i < lanes.size(); i++) {
+        if (!lanes[i].empty())
+          workers->enqueue(i, boost::bind(&RedoBatch::redo_lane, this, i));
+      }
+      workers->wait();
+    }
+    else
+      redo_lane(0);
+
+    for (size_t i = 0; i < lanes.size(); i++) {
+      lanes[i].clear();
+      if (unlikely(status[i] != 0))
+        throw Exception(status[i]);
+    }
+    payload.clear();
+  }
+
+  // Redoes the pages of a lane. Runs in a worker thread, but only writes
+  // to the lane's own buffers
+  void redo_lane(size_t lane) {
+    try {
+      for (std::vector<RedoPage>::iterator it = lanes[lane].begin();
+                      it != lanes[lane].end();
+                      ++it)
+        redo_page(*it, pages[lane], arenas[lane]);
+    }
+    catch (Exception &ex) {
+      status[lane] = ex.code;
+    }
+  }
+
+  // Writes a single page to disk, or applies the modified ranges
+  void redo_page(const RedoPage &rp, Page *page, ByteArray &arena) {
+    const PJournalEntryPageDelta &header = rp.header;
+    const uint8_t *data = &payload[0] + rp.offset;
+    if (header.compressed_size > 0) {
+      state.compressor->decompress(data, header.compressed_size,
+                      header.payload_size, &arena);
+      data = arena.data();
+    }
+
+    bool full_image = header.is_full_image(page_size);
+
+    // the header page is also used by the Environment
+    if (header.address == 0) {
+      page = state.env->header->header_page;
+      page->fetch(0);
+    }
+    else {
+      page->set_address(header.address);
+      if (!full_image)
+        state.env->device->read(header.address, page->data(), page_size);
+    }
+
+    // overwrite the page data, or only the modified ranges
+    if (full_image) {
+      ::memcpy(page->data(), data, page_size);
+    }
+    else {
+      const uint8_t *p = data;
+      for (uint32_t r = 0; r < header.range_count; r++) {
+        const PJournalEntryPageRange *range = (const PJournalEntryPageRange *)p;
+        p += sizeof(PJournalEntryPageRange);
+        if (unlikely(range->offset + range->size > page_size)) {
+          ups_log(("invalid page range in journal"));
+          throw Exception(UPS_INTEGRITY_VIOLATED);
+        }
+        ::memcpy((uint8_t *)page->data() + range->offset, p, range->size);
+        p += range->size;
+      }
+    }
+
+    // flush the modified page to disk
+    page->set_dirty(true);
+    page->flush();
+  }
+
+  // The journal state
+  JournalState &state;
+
+  // The page size
+  uint32_t page_size;
+
+  // The worker threads; null if only a single lane is used
+  ScopedPtr<WorkerPool> workers;
+
+  // The buffered pages of each lane, and the status of each lane
+  std::vector<std::vector<RedoPage> > lanes;
+  std::vector<ups_status_t> status;
+
+  // The page buffer and the decompression arena of each lane
+  std::vector<Page *> pages;
+  std::vector<ByteArray> arenas;
+
+  // The (compressed) payload of the buffered pages
+  std::vector<uint8_t> payload;
+};
+
+// Redo all Changesets of a log file, in chronological order; changesets
+// older than |checkpoint_lsn| are skipped because their pages were already
+// flushed. Returns the highest lsn of the last changeset
+static inline uint64_t
+redo_all_changesets(JournalState &state, int fdidx, RedoBatch &batch,
+                uint64_t checkpoint_lsn)
+{
+  PJournalEntry entry;
+  uint64_t offset = 0;
   uint64_t max_lsn = 0;
+  uint32_t page_size = state.env->config.page_size_bytes;
 
   // for each entry...
   try {
     uint64_t log_file_size = state.files[fdidx].file_size();
+    uint64_t file_size = state.env->device->file_size();
+
+    while (offset < log_file_size) {
+      ::memcpy(&entry, read_file(state, fdidx, offset, sizeof(entry)),
+                      sizeof(entry));
 
-    while (it.offset < log_file_size) {
-      state.files[fdidx].pread(it.offset, &entry, sizeof(entry));
+      // the remaining space of a preallocated file is filled with zeroes
+      if (entry.lsn == 0)
+        break;
+
+      report_progress(state, sizeof(entry) + entry.followup_size);
 
       // Skip all log entries which are NOT from a changeset
-      if (entry.type != Journal::kEntryTypeChangeset) {
-        it.offset += sizeof(entry) + entry.followup_size;
+      if (entry.type != Journal::kEntryTypeChangeset
+            && entry.type != Journal::kEntryTypeChangesetDelta) {
+        offset += sizeof(entry) + entry.followup_size;
         continue;
       }
 
       max_lsn = entry.lsn;
 
-      it.offset += sizeof(entry);
+      if (entry.lsn < checkpoint_lsn) {
+        offset += sizeof(entry) + entry.followup_size;
+        continue;
+      }
+
+      offset += sizeof(entry);
 
       // Read the Changeset header
       PJournalEntryChangeset changeset;
-      state.files[fdidx].pread(it.offset, &changeset, sizeof(changeset));
-      it.offset += sizeof(changeset);
-
-      uint32_t page_size = state.env->config.page_size_bytes;
-      ByteArray arena(page_size);
-      ByteArray tmp;
-
-      uint64_t file_size = state.env->device->file_size();
+      ::memcpy(&changeset, read_file(state, fdidx, offset, sizeof(changeset)),
+                      sizeof(changeset));
+      offset += sizeof(changeset);
 
       state.env->page_manager->set_last_blob_page_id(changeset.last_blob_page);
 
       // for each page in this changeset...
       for (uint32_t i = 0; i < changeset.num_pages; i++) {
-        PJournalEntryPageHeader page_header;
-        state.files[fdidx].pread(it.offset, &page_header,
-                        sizeof(page_header));
-        it.offset += sizeof(page_header);
-        if (page_header.compressed_size > 0) {
-          tmp.resize(page_size);
-          state.files[fdidx].pread(it.offset, tmp.data(),
-                        page_header.compressed_size);
-          it.offset += page_header.compressed_size;
-          state.compressor->decompress(tmp.data(),
-                        page_header.compressed_size, page_size, &arena);
+        RedoPage page;
+        if (entry.type == Journal::kEntryTypeChangesetDelta) {
+          ::memcpy(&page.header, read_file(state, fdidx, offset,
+                                  sizeof(page.header)), sizeof(page.header));
+          offset += sizeof(page.header);
         }
         else {
-          state.files[fdidx].pread(it.offset, arena.data(), page_size);
-          it.offset += page_size;
+          PJournalEntryPageHeader full_header;
+          ::memcpy(&full_header, read_file(state, fdidx, offset,
+                                  sizeof(full_header)), sizeof(full_header));
+          offset += sizeof(full_header);
+          page.header.address = full_header.address;
+          page.header.compressed_size = full_header.compressed_size;
+          page.header.payload_size = page_size;
         }
 
-        Page *page;
-
-        // now write the page to disk
-        if (page_header.address == file_size) {
-          file_size += page_size;
+        size_t size = page.header.compressed_size > 0
+                        ? page.header.compressed_size
+                        : page.header.payload_size;
+        batch.add(page, read_file(state, fdidx, offset, size), size);
+        offset += size;
 
-          page = new Page(state.env->device.get());
-          page->alloc(0);
-        }
-        else if (page_header.address > file_size) {
-          file_size = (size_t)page_header.address + page_size;
+        // grow the file if the page is beyond its end; the pages are
+        // written by the worker threads
+        if (page.header.address + page_size > file_size) {
+          file_size = page.header.address + page_size;
           state.env->device->truncate(file_size);
-
-          page = new Page(state.env->device.get());
-          page->fetch(page_header.address);
-        }
-        else {
-          if (page_header.address == 0)
-            page = state.env->header->header_page;
-          else
-            page = new Page(state.env->device.get());
-          page->fetch(page_header.address);
         }
-        assert(page->address() == page_header.address);
-
-        // overwrite the page data
-        ::memcpy(page->data(), arena.data(), page_size);
-
-        // flush the modified page to disk
-        page->set_dirty(true);
-        page->flush();
-
-        if (page_header.address != 0)
-          delete page;
       }
+
+      if (batch.is_full())
+        batch.run();
     }
+
+    batch.run();
   }
   catch (Exception &) {
     ups_trace(("Exception when applying changeset"));
@@ -452,18 +921,28 @@ static inline uint64_t
 recover_changeset(JournalState &state)
 {
   // scan through both files, look for the file with the oldest changeset.
-  uint64_t lsn1 = scan_for_oldest_changeset(state, &state.files[0]);
-  uint64_t lsn2 = scan_for_oldest_changeset(state, &state.files[1]);
+  uint64_t lsn1 = scan_for_oldest_changeset(state, 0);
+  uint64_t lsn2 = scan_for_oldest_changeset(state, 1);
 
   // both files are empty or do not contain a changeset?
-  if (lsn1 == 0 && lsn2 == 0)
+  if (lsn1 == 0 && lsn2 == 0) {
+    report_progress(state, state.files[0].file_size()
+                    + state.files[1].file_size());
     return 0;
+  }
+
+  // the changesets before the newest checkpoint are skipped
+  uint64_t checkpoint_lsn = std::max(scan_for_newest_checkpoint(state, 0),
+                  scan_for_newest_checkpoint(state, 1));
 
   // now redo all changesets chronologically
   state.current_fd = lsn1 < lsn2 ? 0 : 1;
 
-  uint64_t max_lsn1 = redo_all_changesets(state, state.current_fd);
-  uint64_t max_lsn2 = redo_all_changesets(state, state.current_fd == 0 ? 1 : 0);
+  RedoBatch batch(state);
+  uint64_t max_lsn1 = redo_all_changesets(state, state.current_fd, batch,
+                  checkpoint_lsn);
+  uint64_t max_lsn2 = redo_all_changesets(state, state.current_fd == 0 ? 1 : 0,
+                  batch, checkpoint_lsn);
 
   // return the lsn of the newest changeset
   return std::max(max_lsn1, max_lsn2);
@@ -507,6 +986,8 @@ recover_journal(JournalState &state, Context *context,
     if (!entry.lsn)
       break;
 
+    report_progress(state, sizeof(entry) + entry.followup_size);
+
     // re-apply this operation
     switch (entry.type) {
       case Journal::kEntryTypeTxnBegin: {
@@ -626,10 +1107,16 @@ recover_journal(JournalState &state, Context *context,
           st = 0;
         break;
       }
-      case Journal::kEntryTypeChangeset: {
+      case Journal::kEntryTypeChangeset:
+      case Journal::kEntryTypeChangesetDelta: {
         // skip this; the changeset was already applied
         break;
       }
+      case Journal::kEntryTypeCheckpoint:
+      case Journal::kEntryTypePadding: {
+        // skip this; only relevant for the changesets
+        break;
+      }
       default:
         ups_log(("invalid journal entry type or journal is corrupt"));
         st = UPS_IO_ERROR;
@@ -659,13 +1146,23 @@ bail:
 
 
 JournalState::JournalState(LocalEnv *env_)
-  : env(env_), current_fd(0), num_transactions(0),
+  : env(env_), current_fd(0), segment_size(env_->config.journal_segment_size),
+    num_transactions(0),
     threshold(env_->config.journal_switch_threshold),
     disable_logging(false), count_bytes_flushed(0),
-    count_bytes_before_compression(0), count_bytes_after_compression(0)
+    count_bytes_before_compression(0), count_bytes_after_compression(0),
+    checkpoint_bytes(0), group_commit(ISSET(env_->flags(), UPS_ENABLE_GROUP_COMMIT)
+                    && ISSET(env_->flags(), UPS_ENABLE_FSYNC)),
+    sync_in_progress(false), committed_lsn(0), written_lsn(0), durable_lsn(0),
+    count_group_syncs(0), count_group_commits(0),
+    page_deltas(ISSET(env_->flags(), UPS_ENABLE_JOURNAL_DELTAS)),
+    count_page_images(0), count_page_deltas(0), read_fd(-1), read_offset(0),
+    read_size(0), recovery_processed(0), recovery_total(0),
+    recovery_start_usec(0), recovery_reported_usec(0)
 {
   if (threshold == 0)
     threshold = kSwitchTxnThreshold;
+  write_offsets[0] = write_offsets[1] = 0;
 }
 
 Journal::Journal(LocalEnv *env)
@@ -683,6 +1180,8 @@ Journal::create()
   for (int i = 0; i < 2; i++) {
     std::string path = log_file_path(state, i);
     state.files[i].create(path.c_str(), 0644);
+    if (state.segment_size)
+      state.files[i].preallocate(state.segment_size);
   }
 }
 
@@ -695,6 +1194,12 @@ Journal::open()
     state.files[0].open(path.c_str(), false);
     path = log_file_path(state, 1);
     state.files[1].open(path.c_str(), 0);
+
+    // the new space is filled with zeroes and does not modify the journal
+    for (int i = 0; i < 2; i++) {
+      if (state.files[i].file_size() < state.segment_size)
+        state.files[i].preallocate(state.segment_size);
+    }
   }
   catch (Exception &ex) {
     state.files[1].close();
@@ -703,6 +1208,20 @@ Journal::open()
   }
 }
 
+bool
+Journal::is_empty()
+{
+  if (!state.files[0].is_open() && !state.files[1].is_open())
+    return true;
+
+  for (int i = 0; i < 2; i++) {
+    if (!is_end_of_file(state, i, 0, state.files[i].file_size()))
+      return false;
+  }
+
+  return true;
+}
+
 void
 Journal::append_txn_begin(LocalTxn *txn, const char *name, uint64_t lsn)
 {
@@ -743,10 +1262,85 @@ Journal::append_txn_commit(LocalTxn *txn, uint64_t lsn)
   entry.type = Journal::kEntryTypeTxnCommit;
 
   append_entry(state, txn->log_descriptor, (uint8_t *)&entry, sizeof(entry));
+  state.committed_lsn = lsn;
 
-  // flush after commit
-  flush_buffer(state, state.current_fd,
-                  ISSET(state.env->flags(), UPS_ENABLE_FSYNC));
+  bool fsync = ISSET(state.env->flags(), UPS_ENABLE_FSYNC);
+
+  // asynchronous commit: the entry remains in the buffer and is written
+  // with the next flush (or with flush_commits())
+  if (ISSET(txn->flags, UPS_TXN_ASYNC_COMMIT)) {
+    if (state.buffer.size() > kBufferLimit)
+      flush_buffer(state, state.current_fd, fsync && !state.group_commit);
+    return;
+  }
+
+  // flush after commit; with group commit, the fsync is performed later
+  // in wait_for_durable_lsn()
+  if (state.group_commit) {
+    flush_buffer(state, state.current_fd);
+    ScopedLock lock(state.sync_mutex);
+    state.count_group_commits++;
+    return;
+  }
+
+  flush_buffer(state, state.current_fd, fsync);
+}
+
+uint64_t
+Journal::flush_commits(uint64_t lsn)
+{
+  if (lsn == 0 || lsn > state.committed_lsn)
+    lsn = state.committed_lsn;
+
+  flush_buffer(state, state.current_fd);
+
+  ScopedLock lock(state.sync_mutex);
+  return lsn > state.durable_lsn ? lsn : 0;
+}
+
+void
+Journal::wait_for_durable_lsn(uint64_t lsn)
+{
+  ScopedLock lock(state.sync_mutex);
+
+  // commits which were not yet written cannot become durable
+  if (lsn > state.written_lsn)
+    lsn = state.written_lsn;
+
+  while (state.durable_lsn < lsn) {
+    // another thread is already syncing; wait till it's done, then check
+    // if this commit was part of its group
+    if (state.sync_in_progress) {
+      state.sync_done.wait(lock);
+      continue;
+    }
+
+    // otherwise become the leader; the fsync covers all commits which
+    // were written so far
+    uint64_t target = state.written_lsn;
+    state.sync_in_progress = true;
+    lock.unlock();
+
+    try {
+      for (int i = 0; i < 2; i++) {
+        if (state.files[i].is_open())
+          state.files[i].flush();
+      }
+    }
+    catch (Exception &) {
+      lock.lock();
+      state.sync_in_progress = false;
+      state.sync_done.notify_all();
+      throw;
+    }
+
+    lock.lock();
+    if (target > state.durable_lsn)
+      state.durable_lsn = target;
+    state.sync_in_progress = false;
+    state.count_group_syncs++;
+    state.sync_done.notify_all();
+  }
 }
 
 void
@@ -771,7 +1365,7 @@ Journal::append_insert(Db *db, LocalTxn *txn,
   int idx;
   if (ISSET(txn->flags, UPS_TXN_TEMPORARY)) {
     entry.txn_id = 0;
-    idx = switch_files_maybe(state);
+    idx = txn->log_descriptor = switch_files_maybe(state);
     state.num_transactions++;
   }
   else {
@@ -874,7 +1468,7 @@ Journal::append_erase(Db *db, LocalTxn *txn, ups_key_t *key,
   int idx;
   if (ISSET(txn->flags, UPS_TXN_TEMPORARY)) {
     entry.txn_id = 0;
-    idx = switch_files_maybe(state);
+    idx = txn->log_descriptor = switch_files_maybe(state);
     state.num_transactions++;
   }
   else {
@@ -907,7 +1501,9 @@ Journal::append_changeset(std::vector<Page *> &pages,
   entry.lsn = lsn;
   entry.dbname = 0;
   entry.txn_id = 0;
-  entry.type = Journal::kEntryTypeChangeset;
+  entry.type = state.page_deltas
+                  ? Journal::kEntryTypeChangesetDelta
+                  : Journal::kEntryTypeChangeset;
   // followup_size is incomplete - the actual page sizes are added later
   entry.followup_size = sizeof(PJournalEntryChangeset);
   changeset.num_pages = pages.size();
@@ -926,7 +1522,11 @@ Journal::append_changeset(std::vector<Page *> &pages,
   for (std::vector<Page *>::iterator it = pages.begin();
                   it != pages.end();
                   ++it) {
-    entry.followup_size += append_changeset_page(state, *it, page_size);
+    if (state.page_deltas)
+      entry.followup_size += append_changeset_page_delta(state, *it,
+                      page_size);
+    else
+      entry.followup_size += append_changeset_page(state, *it, page_size);
   }
 
   UPS_INDUCE_ERROR(ErrorInducer::kChangesetFlush);
@@ -945,6 +1545,58 @@ Journal::append_changeset(std::vector<Page *> &pages,
   return state.current_fd;
 }
 
+void
+Journal::append_checkpoint(uint64_t lsn, uint64_t oldest_lsn,
+                const std::vector<uint64_t> &page_ids, uint32_t keep_files)
+{
+  if (unlikely(state.disable_logging))
+    return;
+
+  bool fsync = ISSET(state.env->flags(), UPS_ENABLE_FSYNC);
+  int previous = state.current_fd;
+  int other = previous == 0 ? 1 : 0;
+
+  // write the buffered entries to their file
+  flush_buffer(state, previous, fsync && !state.group_commit);
+
+  // if possible then the checkpoint starts a new (empty) file. The other
+  // file is only cleared if it does not store committed Txns which are
+  // not yet flushed
+  if (NOTSET(keep_files, 1 << other)) {
+    clear_file(state, other);
+    state.current_fd = other;
+    state.num_transactions = 0;
+  }
+
+  // the pages are logged as full images when they are modified for the
+  // first time after the checkpoint
+  state.page_images.clear();
+  state.page_image_order.clear();
+
+  PJournalEntry entry;
+  PJournalEntryCheckpoint checkpoint;
+
+  entry.lsn = lsn;
+  entry.type = Journal::kEntryTypeCheckpoint;
+  entry.followup_size = sizeof(checkpoint)
+                            + page_ids.size() * sizeof(uint64_t);
+  checkpoint.oldest_lsn = oldest_lsn;
+  checkpoint.num_pages = (uint32_t)page_ids.size();
+
+  append_entry(state, state.current_fd, (uint8_t *)&entry, sizeof(entry),
+                (uint8_t *)&checkpoint, sizeof(checkpoint),
+                page_ids.empty() ? 0 : (uint8_t *)&page_ids[0],
+                page_ids.size() * sizeof(uint64_t));
+  flush_buffer(state, state.current_fd, fsync);
+
+  // the recovery skips everything before the checkpoint; now the previous
+  // file can be cleared as well
+  if (state.current_fd != previous && NOTSET(keep_files, 1 << previous))
+    clear_file(state, previous);
+
+  state.checkpoint_bytes = state.count_bytes_flushed;
+}
+
 void
 Journal::close(bool noclear)
 {
@@ -957,6 +1609,7 @@ Journal::close(bool noclear)
   if (likely(!noclear))
     clear();
 
+  ScopedSyncBarrier barrier(state);
   for (int i = 0; i < 2; i++)
     state.files[i].close();
 
@@ -968,6 +1621,13 @@ Journal::recover(LocalTxnManager *txn_manager)
 {
   Context context(state.env, 0, 0);
 
+  // the changesets are redone, then the logical journal is replayed; both
+  // steps read both files
+  state.recovery_processed = 0;
+  state.recovery_total = 2 * (state.files[0].file_size()
+                  + state.files[1].file_size());
+  state.recovery_start_usec = state.recovery_reported_usec = os_now_usec();
+
   // first redo the changesets
   uint64_t start_lsn = recover_changeset(state);
 
@@ -982,6 +1642,8 @@ Journal::recover(LocalTxnManager *txn_manager)
   if (ISSET(state.env->flags(), UPS_ENABLE_TRANSACTIONS))
     recover_journal(state, &context, txn_manager, start_lsn);
 
+  report_progress(state, 0, true);
+
   // clear the journal files
   clear();
 }
@@ -45,6 +45,13 @@
  * Otherwise the whole changeset is appended to the journal, and afterwards
  * the database file is modified.
  *
+ * With UPS_ENABLE_JOURNAL_DELTAS, a changeset only stores the modified byte
+ * ranges of a page, relative to the image of this page which was logged
+ * last. The first time a page is logged in a journal file, the full
+ * image is stored; therefore each file can be recovered without the other
+ * one. Since the ranges store the new bytes (and not a difference), they
+ * can be re-applied to a page which was only partially written.
+ *
  * For recovery to work, each page stores the lsn of its last modification.
  *
  * When recovering, the Journal first extracts the newest/latest entry.
@@ -128,7 +135,19 @@ struct Journal
     kEntryTypeErase      = 5,
 
     // marks a whole changeset operation (writes modified pages)
-    kEntryTypeChangeset  = 6
+    kEntryTypeChangeset  = 6,
+
+    // marks a changeset which stores the modified byte ranges of its
+    // pages (see UPS_ENABLE_JOURNAL_DELTAS)
+    kEntryTypeChangesetDelta = 7,
+
+    // marks a checkpoint; all changesets before this entry are
+    // already durable
+    kEntryTypeCheckpoint = 8,
+
+    // fills the remaining space of a 4 kb block if the files are
+    // preallocated (see UPS_PARAM_JOURNAL_SEGMENT_SIZE)
+    kEntryTypePadding    = 9
   };
 
   //
@@ -159,18 +178,7 @@ struct Journal
   void open();
 
   // Returns true if the journal is empty
-  bool is_empty() const {
-    if (!state.files[0].is_open() && !state.files[1].is_open())
-      return true;
-
-    for (int i = 0; i < 2; i++) {
-      uint64_t size = state.files[i].file_size();
-      if (size > 0)
-        return false;
-    }
-
-    return true;
-  }
+  bool is_empty();
 
   // Appends a journal entry for ups_txn_begin/kEntryTypeTxnBegin
   void append_txn_begin(LocalTxn *txn, const char *name,
@@ -179,6 +187,32 @@ struct Journal
   // Appends a journal entry for ups_txn_commit/kEntryTypeTxnCommit
   void append_txn_commit(LocalTxn *txn, uint64_t lsn);
 
+  // Returns the lsn of the newest commit which was written but not yet
+  // made durable; 0 if group commit is disabled
+  uint64_t pending_commit_lsn() {
+    if (!state.group_commit)
+      return 0;
+    ScopedLock lock(state.sync_mutex);
+    return state.written_lsn > state.durable_lsn ? state.written_lsn : 0;
+  }
+
+  // Returns the lsn of the newest commit, and of the newest durable commit
+  void get_commit_lsn(uint64_t *committed_lsn, uint64_t *durable_lsn) {
+    *committed_lsn = state.committed_lsn;
+    ScopedLock lock(state.sync_mutex);
+    *durable_lsn = state.durable_lsn;
+  }
+
+  // Writes all buffered commits up to |lsn| (0: all commits) to the file.
+  // Returns the lsn which has to be passed to wait_for_durable_lsn(), or 0
+  // if these commits are already durable
+  uint64_t flush_commits(uint64_t lsn);
+
+  // Blocks till all commits up to |lsn| are durable. The first thread
+  // performs the fsync for all threads that are waiting ("group commit").
+  // Must be called without holding the Environment's lock
+  void wait_for_durable_lsn(uint64_t lsn);
+
   // Appends a journal entry for ups_insert/kEntryTypeInsert
   void append_insert(Db *db, LocalTxn *txn,
                   ups_key_t *key, ups_record_t *record, uint32_t flags,
@@ -195,6 +229,21 @@ struct Journal
   int append_changeset(std::vector<Page *> &pages, uint64_t last_blob_page,
                   uint64_t lsn);
 
+  // Appends a journal entry for a checkpoint/kEntryTypeCheckpoint.
+  // |page_ids| are the pages which were flushed, |oldest_lsn| is the lsn
+  // of the oldest active Txn. Afterwards the files are truncated, unless
+  // their bit in |keep_files| is set (because they store committed Txns
+  // which were not yet flushed)
+  void append_checkpoint(uint64_t lsn, uint64_t oldest_lsn,
+                  const std::vector<uint64_t> &page_ids, uint32_t keep_files);
+
+  // Returns the number of bytes which were appended since the last
+  // checkpoint
+  uint64_t bytes_since_checkpoint() const {
+    return state.count_bytes_flushed + state.buffer.size()
+                - state.checkpoint_bytes;
+  }
+
   // Empties the journal, removes all entries
   void clear();
 
@@ -212,6 +261,11 @@ struct Journal
             = state.count_bytes_before_compression;
     metrics->journal_bytes_after_compression
             = state.count_bytes_after_compression;
+    metrics->journal_page_images = state.count_page_images;
+    metrics->journal_page_deltas = state.count_page_deltas;
+    ScopedLock lock(state.sync_mutex);
+    metrics->journal_group_syncs = state.count_group_syncs;
+    metrics->journal_group_commits = state.count_group_commits;
   }
 
   // Flushes all buffers to disk. Used for testing.
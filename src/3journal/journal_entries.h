@@ -201,6 +201,85 @@ UPS_PACK_0 struct UPS_PACK_1 PJournalEntryPageHeader {
 
 #include "1base/packstop.h"
 
+
+#include "1base/packstart.h"
+
+//
+// a Journal entry for a single page of a delta changeset
+// (kEntryTypeChangesetDelta); the payload is either the full page or
+// a sequence of PJournalEntryPageRange structures, each followed by the
+// modified bytes
+//
+UPS_PACK_0 struct UPS_PACK_1 PJournalEntryPageDelta {
+  // Constructor - sets all fields to 0
+  PJournalEntryPageDelta(uint64_t _address = 0)
+    : address(_address), compressed_size(0), payload_size(0),
+      range_count(0) {
+  }
+
+  // Returns true if the payload is the full page
+  bool is_full_image(uint32_t page_size) const {
+    return range_count == 0 && payload_size == page_size;
+  }
+
+  // the page address
+  uint64_t address;
+
+  // the compressed size of the payload, if compression is enabled
+  uint32_t compressed_size;
+
+  // the uncompressed size of the payload
+  uint32_t payload_size;
+
+  // the number of modified byte ranges in the payload
+  uint32_t range_count;
+} UPS_PACK_2;
+
+#include "1base/packstop.h"
+
+
+#include "1base/packstart.h"
+
+//
+// a modified byte range of a PJournalEntryPageDelta
+//
+UPS_PACK_0 struct UPS_PACK_1 PJournalEntryPageRange {
+  // Constructor - sets all fields to 0
+  PJournalEntryPageRange(uint32_t _offset = 0, uint32_t _size = 0)
+    : offset(_offset), size(_size) {
+  }
+
+  // the offset of the range in the page
+  uint32_t offset;
+
+  // the number of bytes
+  uint32_t size;
+} UPS_PACK_2;
+
+#include "1base/packstop.h"
+
+
+#include "1base/packstart.h"
+
+//
+// a Journal entry for a checkpoint (kEntryTypeCheckpoint); followed by the
+// addresses of the pages which were flushed
+//
+UPS_PACK_0 struct UPS_PACK_1 PJournalEntryCheckpoint {
+  // Constructor - sets all fields to 0
+  PJournalEntryCheckpoint()
+    : oldest_lsn(0), num_pages(0) {
+  }
+
+  // the lsn of the oldest active transaction, or 0 if there is none
+  uint64_t oldest_lsn;
+
+  // number of page addresses following this structure
+  uint32_t num_pages;
+} UPS_PACK_2;
+
+#include "1base/packstop.h"
+
 } // namespace upscaledb
 
 #endif /* UPS_JOURNAL_ENTRIES_H */
@@ -21,12 +21,15 @@
 
 #include "0root/root.h"
 
+#include <deque>
+#include <map>
 #include <vector>
 #include <string>
 
 #include "ups/types.h" // for metrics
 
 #include "1base/dynamic_array.h"
+#include "1base/mutex.h"
 #include "1base/scoped_ptr.h"
 #include "1os/file.h"
 #include "2page/page_collection.h"
@@ -55,6 +58,13 @@ struct JournalState {
   // The two file descriptors
   File files[2];
 
+  // The offsets of the next write in both files
+  uint64_t write_offsets[2];
+
+  // The size of the preallocated files (UPS_PARAM_JOURNAL_SEGMENT_SIZE);
+  // 0 if preallocation is disabled
+  uint64_t segment_size;
+
   // Buffer for writing data to the files
   ByteArray buffer;
 
@@ -77,12 +87,86 @@ struct JournalState {
   // Counting the bytes after compression (for ups_env_get_metrics)
   uint64_t count_bytes_after_compression;
 
+  // The value of |count_bytes_flushed| after the last checkpoint
+  uint64_t checkpoint_bytes;
+
   // A map of all opened databases
   typedef std::map<uint16_t, Db *> DatabaseMap;
   DatabaseMap database_map;
 
   // The compressor; can be null
   ScopedPtr<Compressor> compressor;
+
+  // Group commit: true if UPS_ENABLE_GROUP_COMMIT and UPS_ENABLE_FSYNC
+  // are set. Commits are then written without fsync, and the
+  // committing threads are synchronized in Journal::wait_for_durable_lsn()
+  bool group_commit;
+
+  // Protects the following members (except |committed_lsn|, which is
+  // protected by the Environment's lock)
+  Mutex sync_mutex;
+
+  // Signalled whenever a group commit's fsync is completed
+  Condition sync_done;
+
+  // True while one of the committing threads (the "leader") performs
+  // the fsync for the whole group, or while a journal file is truncated
+  // or closed
+  bool sync_in_progress;
+
+  // The lsn of the newest commit which was appended to the buffer
+  uint64_t committed_lsn;
+
+  // The lsn of the newest commit which was written to the file
+  uint64_t written_lsn;
+
+  // The lsn of the newest commit which is durable
+  uint64_t durable_lsn;
+
+  // Counts the fsyncs of the group commits (for ups_env_get_metrics)
+  uint64_t count_group_syncs;
+
+  // Counts the commits which were written with deferred fsync
+  // (for ups_env_get_metrics)
+  uint64_t count_group_commits;
+
+  // Delta journaling: true if UPS_ENABLE_JOURNAL_DELTAS is set
+  bool page_deltas;
+
+  // Delta journaling: the images of the pages as they were logged last
+  // in the current file, and their addresses in the order of insertion
+  // (the oldest images are discarded if the map exceeds its limit)
+  typedef std::map<uint64_t, std::vector<uint8_t> > PageImageMap;
+  PageImageMap page_images;
+  std::deque<uint64_t> page_image_order;
+
+  // Delta journaling: buffer for the modified ranges of a page
+  ByteArray delta_buffer;
+
+  // Counts the pages logged as full images (for ups_env_get_metrics)
+  uint64_t count_page_images;
+
+  // Counts the pages logged as byte ranges (for ups_env_get_metrics)
+  uint64_t count_page_deltas;
+
+  // Recovery: read-ahead buffer for the sequential reads of the files
+  ByteArray read_buffer;
+
+  // Recovery: the file (or -1), the file offset and the number of valid
+  // bytes of |read_buffer|
+  int read_fd;
+  uint64_t read_offset;
+  size_t read_size;
+
+  // Recovery: the number of bytes which were processed, and the total
+  // number of bytes which are read
+  uint64_t recovery_processed;
+  uint64_t recovery_total;
+
+  // Recovery: the start time, and the time of the last progress report
+  // (in microseconds)
+  uint64_t recovery_start_usec;
+  uint64_t recovery_reported_usec;
 };
 
 } // namespace upscaledb
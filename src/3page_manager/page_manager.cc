@@ -21,6 +21,7 @@
 #include "0root/root.h"
 
 #include <string.h>
+#include <algorithm>
 
 #include "3rdparty/murmurhash3/MurmurHash3.h"
 // Always verify that a file of level N does not include headers > N!
@@ -59,21 +60,25 @@ struct AsyncFlushMessage
   AsyncFlushMessage(PageManager *page_manager_, Device *device_,
           Signal *signal_)
     : page_manager(page_manager_), device(device_), signal(signal_),
-      in_progress(false) {
+      in_progress(false), pending_parts(0) {
   }
 
   PageManager *page_manager;
   Device *device;
   Signal *signal;
   boost::atomic<bool> in_progress;
+  boost::atomic<size_t> pending_parts;
   std::vector<uint64_t> page_ids;
 };
 
 static void
-async_flush_pages(AsyncFlushMessage *message)
+async_flush_pages(AsyncFlushMessage *message, std::vector<uint64_t> page_ids)
 {
-  for (std::vector<uint64_t>::iterator it = message->page_ids.begin();
-                  it != message->page_ids.end();
+  std::vector<Page *> pages;
+  pages.reserve(page_ids.size());
+
+  for (std::vector<uint64_t>::iterator it = page_ids.begin();
+                  it != page_ids.end();
                   it++) {
     // skip page if it's already in use
     Page *page = message->page_manager->try_lock_purge_candidate(*it);
@@ -82,20 +87,63 @@ async_flush_pages(AsyncFlushMessage *message)
     assert(page->mutex().try_lock() == false);
 
     // flush page if it's dirty
-    if (page->is_dirty()) {
-      try {
-        page->flush();
-      }
-      catch (Exception &) {
-        // ignore page, fall through
-      }
-    }
-    page->mutex().unlock();
+    if (page->is_dirty())
+      pages.push_back(page);
+    else
+      page->mutex().unlock();
+  }
+
+  try {
+    Page::flush(message->device, pages);
+  }
+  catch (Exception &) {
+    // ignore pages, fall through
+  }
+
+  for (std::vector<Page *>::iterator it = pages.begin();
+                  it != pages.end();
+                  it++)
+    (*it)->mutex().unlock();
+
+  // the last part signals the completion of the whole message
+  if (--message->pending_parts == 0) {
+    if (message->in_progress)
+      message->in_progress = false;
+    if (message->signal)
+      message->signal->notify();
+  }
+}
+
+// Splits the pages of |message| into parts and sends them to the queues
+// of the worker pool. All pages of a file region go to the same queue,
+// which can then coalesce adjacent pages.
+static void
+schedule_async_flush(PageManagerState *state, AsyncFlushMessage *message)
+{
+  WorkerPool *worker = state->worker.get();
+  size_t queues = worker->queue_count();
+  uint64_t region_size = (uint64_t)state->config.page_size_bytes
+                              * Page::kMaxCoalescedPages;
+
+  std::vector<std::vector<uint64_t> > parts(queues);
+  for (std::vector<uint64_t>::iterator it = message->page_ids.begin();
+                  it != message->page_ids.end();
+                  it++)
+    parts[(*it / region_size) % queues].push_back(*it);
+
+  size_t count = 0;
+  for (size_t i = 0; i < queues; i++)
+    if (!parts[i].empty())
+      count++;
+
+  // set the counter before posting the first part, otherwise a fast
+  // worker could complete the message prematurely
+  message->pending_parts = count;
+
+  for (size_t i = 0; i < queues; i++) {
+    if (!parts[i].empty())
+      worker->enqueue(i, boost::bind(&async_flush_pages, message, parts[i]));
   }
-  if (message->in_progress)
-    message->in_progress = false;
-  if (message->signal)
-    message->signal->notify();
 }
 
 static inline void
@@ -112,10 +160,48 @@ verify_crc32(Page *page)
   }
 }
 
+// Moves retired pages to the freelist as soon as no optimistic reader can
+// access them anymore. Pages which were retired since the last call are
+// tagged with the current epoch; the caller has unlinked them. If |all|
+// is true then no readers are active, and all pages are moved.
+static inline void
+free_retired_unlocked(PageManagerState *state, bool all)
+{
+  if (state->retired.empty())
+    return;
+
+  uint64_t now = state->epochs.current();
+  uint64_t oldest = all ? EpochManager::kIdle : state->epochs.advance();
+
+  size_t kept = 0;
+  for (size_t i = 0; i < state->retired.size(); i++) {
+    PageManagerState::RetiredPage &retired = state->retired[i];
+    if (retired.epoch == 0)
+      retired.epoch = now;
+    if (retired.epoch >= oldest) {
+      state->retired[kept++] = retired;
+      continue;
+    }
+
+    state->needs_flush = true;
+    state->freelist.put(retired.address, retired.page_count);
+
+    Page *page = state->cache.get(retired.address);
+    if (page && page->node_proxy()) {
+      delete page->node_proxy();
+      page->set_node_proxy(0);
+    }
+  }
+  state->retired.resize(kept);
+}
+
 static inline Page *
-add_to_changeset(Changeset *changeset, Page *page)
+add_to_changeset(Context *context, Page *page)
 {
-  changeset->put(page);
+  // concurrent readers neither lock their pages nor track them
+  if (context->shared)
+    return page;
+  context->changeset.put(page);
   assert(page->mutex().try_lock() == false);
   return page;
 }
@@ -241,7 +327,7 @@ fetch_unlocked(PageManagerState *state, Context *context, uint64_t address,
 
   if (page) {
     page->set_without_header(ISSET(flags, PageManager::kNoHeader));
-    return add_to_changeset(&context->changeset, page);
+    return add_to_changeset(context, page);
   }
 
   if (ISSET(flags, PageManager::kOnlyFromCache)
@@ -260,7 +346,8 @@ fetch_unlocked(PageManagerState *state, Context *context, uint64_t address,
   assert(page->data());
 
   /* store the page in the list */
-  state->cache.put(page);
+  page->set_without_header(ISSET(flags, PageManager::kNoHeader));
+  state->cache.put(page, true);
 
   /* write state to disk (if necessary) */
   if (NOTSET(flags, PageManager::kDisableStoreState)
@@ -268,13 +355,12 @@ fetch_unlocked(PageManagerState *state, Context *context, uint64_t address,
     maybe_store_state(state, context, false);
 
   /* only verify crc if the page has a header */
-  page->set_without_header(ISSET(flags, PageManager::kNoHeader));
   if (!page->is_without_header()
           && ISSET(state->config.flags, UPS_ENABLE_CRC32))
     verify_crc32(page);
 
   state->page_count_fetched++;
-  return add_to_changeset(&context->changeset, page);
+  return add_to_changeset(context, page);
 }
 
 static inline Page *
@@ -338,7 +424,7 @@ done:
 
   /* store the page in the cache and the Changeset */
   state->cache.put(page);
-  add_to_changeset(&context->changeset, page);
+  add_to_changeset(context, page);
 
   /* write to disk (if necessary) */
   if (NOTSET(flags, PageManager::kDisableStoreState)
@@ -366,14 +452,35 @@ done:
 }
 
 
+// Creates the pool of page buffers for file-based Environments. With
+// direct I/O, the pool is preallocated for the whole cache and registered
+// with the device.
+static PageBufferPool *
+create_buffer_pool(LocalEnv *env)
+{
+  const EnvConfig &config = env->config;
+  if (ISSET(config.flags, UPS_IN_MEMORY))
+    return 0;
+
+  bool direct_io = ISSET(config.flags, UPS_ENABLE_DIRECT_IO);
+  size_t preallocated = 0;
+  if (direct_io && NOTSET(config.flags, UPS_CACHE_UNLIMITED))
+    preallocated = config.cache_size_bytes / config.page_size_bytes;
+  return new PageBufferPool(env->device.get(), config.page_size_bytes,
+                  preallocated, direct_io);
+}
+
 PageManagerState::PageManagerState(LocalEnv *_env)
   : env(_env), config(_env->config), header(_env->header.get()),
-    device(_env->device.get()), lsn_manager(&_env->lsn_manager),
+    device(_env->device.get()), buffer_pool(create_buffer_pool(_env)),
+    lsn_manager(&_env->lsn_manager),
     cache(_env->config), freelist(config), needs_flush(false),
     state_page(0), last_blob_page(0), last_blob_page_id(0),
-    page_count_fetched(0), page_count_index(0), page_count_blob(0),
+    page_count_fetched(0), page_count_prefetched(0), page_count_index(0),
+    page_count_blob(0),
     page_count_page_manager(0), cache_hits(0), cache_misses(0), message(0),
-    worker(new WorkerPool(1))
+    worker(new WorkerPool(std::min((unsigned)kMaxFlushThreads,
+                    std::max(1u, boost::thread::hardware_concurrency()))))
 {
 }
 
@@ -430,10 +537,78 @@ PageManager::initialize(uint64_t pageid)
 Page *
 PageManager::fetch(Context *context, uint64_t address, uint32_t flags)
 {
+  // Concurrent readers look up cached pages without locking the
+  // PageManager; the cache locks its shards individually. Pages are not
+  // deleted while readers are active. A page is only returned if it
+  // does not need to be modified; otherwise the header flag is updated
+  // below, under the lock.
+  if (context->shared && address != 0
+          && !(state->state_page && address == state->state_page->address())) {
+    Page *page = state->cache.get(address);
+    if (page && page->is_without_header()
+                    == ISSET(flags, PageManager::kNoHeader))
+      return page;
+  }
+
   ScopedSpinlock lock(state->mutex);
   return fetch_unlocked(state.get(), context, address, flags);
 }
 
+void
+PageManager::prefetch(Context *context, const uint64_t *addresses,
+                size_t count)
+{
+  if (ISSET(state->config.flags, UPS_IN_MEMORY))
+    return;
+
+  ScopedSpinlock lock(state->mutex);
+
+  std::vector<Page *> pages;
+  std::vector<uint64_t> missing;
+  for (size_t i = 0; i < count; i++) {
+    uint64_t address = addresses[i];
+    if (address == 0
+          || (state->state_page && address == state->state_page->address())
+          || state->cache.contains(address))
+      continue;
+    missing.push_back(address);
+    pages.push_back(new Page(state->device, context->db));
+  }
+
+  if (pages.empty())
+    return;
+
+  // read-ahead is only a hint; errors are reported when the page is
+  // actually fetched
+  try {
+    state->device->read_pages(&pages[0], &missing[0], pages.size());
+  }
+  catch (Exception &) {
+    for (size_t i = 0; i < pages.size(); i++)
+      delete pages[i];
+    return;
+  }
+
+  for (size_t i = 0; i < pages.size(); i++) {
+    Page *page = pages[i];
+    page->set_address(missing[i]);
+
+    if (ISSET(state->config.flags, UPS_ENABLE_CRC32)) {
+      try {
+        verify_crc32(page);
+      }
+      catch (Exception &) {
+        delete page;
+        continue;
+      }
+    }
+
+    state->cache.put(page, true);
+    state->page_count_fetched++;
+    state->page_count_prefetched++;
+  }
+}
+
 Page *
 PageManager::alloc(Context *context, uint32_t page_type, uint32_t flags)
 {
@@ -496,7 +671,21 @@ void
 PageManager::fill_metrics(ups_env_metrics_t *metrics) const
 {
   metrics->page_count_fetched = state->page_count_fetched;
+  metrics->page_count_prefetched = state->page_count_prefetched;
+  if (state->buffer_pool)
+    state->buffer_pool->fill_metrics(metrics);
+  metrics->page_object_pool_capacity = Page::ms_object_pool.get_capacity();
+  metrics->page_object_pool_in_use = Page::ms_object_pool.get_in_use();
   metrics->page_count_flushed = Page::ms_page_count_flushed;
+  if (state->worker) {
+    metrics->flush_thread_count = (uint32_t)state->worker->queue_count();
+    metrics->flush_queue_depth = state->worker->queue_depth();
+    metrics->flush_peak_queue_depth = state->worker->peak_queue_depth();
+  }
+  metrics->flush_write_calls = Page::ms_flush_writes;
+  metrics->flush_avg_write_latency_usec = metrics->flush_write_calls
+          ? Page::ms_flush_write_usec / metrics->flush_write_calls
+          : 0;
   metrics->page_count_type_index = state->page_count_index;
   metrics->page_count_type_blob = state->page_count_blob;
   metrics->page_count_type_page_manager = state->page_count_page_manager;
@@ -520,6 +709,27 @@ struct FlushAllPagesVisitor
   AsyncFlushMessage *message;
 };
 
+struct CollectDirtyPagesVisitor
+{
+  bool operator()(Page *page) {
+    if (page->is_dirty())
+      pages.push_back(page);
+    return false;
+  }
+
+  std::vector<Page *> pages;
+};
+
+struct PurgeAllPagesVisitor
+{
+  bool operator()(Page *page) {
+    pages.push_back(page);
+    return true;
+  }
+
+  std::vector<Page *> pages;
+};
+
 void
 PageManager::flush_all_pages()
 {
@@ -529,6 +739,9 @@ PageManager::flush_all_pages()
 
   FlushAllPagesVisitor visitor(message);
 
+  // wait till pending flushes are completed; they keep their pages locked
+  state->worker->wait();
+
   {
     ScopedSpinlock lock(state->mutex);
 
@@ -542,13 +755,73 @@ PageManager::flush_all_pages()
   }
 
   if (message->page_ids.size() > 0) {
-    run_async(boost::bind(&async_flush_pages, message));
+    schedule_async_flush(state.get(), message);
     signal.wait();
   }
 
   delete message;
 }
 
+void
+PageManager::flush_dirty_pages(std::vector<uint64_t> *page_ids)
+{
+  CollectDirtyPagesVisitor visitor;
+  std::vector<Page *> &pages = visitor.pages;
+
+  // wait till pending flushes are completed; they keep their pages locked
+  state->worker->wait();
+
+  {
+    ScopedSpinlock lock(state->mutex);
+
+    state->cache.purge_if(visitor);
+
+    if (state->header->header_page->is_dirty())
+      pages.push_back(state->header->header_page);
+
+    if (state->state_page && state->state_page->is_dirty()
+          && std::find(pages.begin(), pages.end(), state->state_page)
+                == pages.end())
+      pages.push_back(state->state_page);
+  }
+
+  // unlike flush_all_pages(), the pages are flushed synchronously and
+  // pages with cursors are not skipped; the caller holds the Environment's
+  // lock, therefore the pages are not modified in the meantime
+  for (std::vector<Page *>::iterator it = pages.begin();
+                  it != pages.end();
+                  it++)
+    (*it)->mutex().lock();
+
+  try {
+    Page::flush(state->device, pages);
+  }
+  catch (Exception &) {
+    for (std::vector<Page *>::iterator it = pages.begin();
+                    it != pages.end();
+                    it++)
+      (*it)->mutex().unlock();
+    throw;
+  }
+
+  for (std::vector<Page *>::iterator it = pages.begin();
+                  it != pages.end();
+                  it++) {
+    (*it)->mutex().unlock();
+    page_ids->push_back((*it)->address());
+  }
+}
+
+bool
+PageManager::is_cache_full()
+{
+  ScopedSpinlock lock(state->mutex);
+
+  return NOTSET(state->config.flags, UPS_IN_MEMORY)
+      && !(state->message && state->message->in_progress == true)
+      && state->cache.is_cache_full();
+}
+
 void
 PageManager::purge_cache(Context *context)
 {
@@ -575,7 +848,7 @@ PageManager::purge_cache(Context *context)
   // don't bother if there are only few pages
   if (state->message->page_ids.size() > 10) {
     state->message->in_progress = true;
-    run_async(boost::bind(&async_flush_pages, state->message));
+    schedule_async_flush(state.get(), state->message);
   }
 
   for (std::vector<Page *>::iterator it = state->garbage.begin();
@@ -584,11 +857,16 @@ PageManager::purge_cache(Context *context)
     Page *page = *it;
     if (likely(page->mutex().try_lock())) {
       assert(page->cursor_list.is_empty());
-      state->cache.del(page);
+      state->cache.evict(page);
       page->mutex().unlock();
       delete page;
     }
   }
+
+  // return the buffers of a previous peak to the heap
+  if (state->buffer_pool.get())
+    state->buffer_pool->trim(state->cache.capacity_pages()
+                    + PageBufferPool::kSlabBuffers);
 }
 
 void
@@ -629,6 +907,15 @@ PageManager::reclaim_space(Context *context)
   }
 }
 
+uint64_t
+PageManager::first_free_page()
+{
+  ScopedSpinlock lock(state->mutex);
+  if (state->freelist.empty())
+    return 0;
+  return state->freelist.free_pages.begin()->first;
+}
+
 struct CloseDatabaseVisitor
 {
   CloseDatabaseVisitor(LocalDb *db_, AsyncFlushMessage *message_)
@@ -657,6 +944,9 @@ PageManager::close_database(Context *context, LocalDb *db)
 
   CloseDatabaseVisitor visitor(db, message);
 
+  // wait till pending flushes are completed; they keep their pages locked
+  state->worker->wait();
+
   {
     ScopedSpinlock lock(state->mutex);
 
@@ -673,7 +963,7 @@ PageManager::close_database(Context *context, LocalDb *db)
   }
 
   if (message->page_ids.size() > 0) {
-    run_async(boost::bind(&async_flush_pages, message));
+    schedule_async_flush(state.get(), message);
     signal.wait();
   }
 
@@ -713,9 +1003,18 @@ PageManager::del(Context *context, Page *page, size_t page_count)
     }
   }
 
+  assert(page->address() % state->config.page_size_bytes == 0);
+
+  // optimistic readers might still read this page; it is reused when
+  // they are gone (see free_retired_pages())
+  if (context->concurrent) {
+    PageManagerState::RetiredPage retired = {page->address(), page_count, 0};
+    state->retired.push_back(retired);
+    return;
+  }
+
   state->needs_flush = true;
   state->freelist.put(page->address(), page_count);
-  assert(page->address() % state->config.page_size_bytes == 0);
 
   if (page->node_proxy()) {
     delete page->node_proxy();
@@ -726,11 +1025,21 @@ PageManager::del(Context *context, Page *page, size_t page_count)
   // relevant for logging.
 }
 
+void
+PageManager::free_retired_pages()
+{
+  ScopedSpinlock lock(state->mutex);
+  free_retired_unlocked(state.get(), false);
+}
+
 void
 PageManager::close(Context *context)
 {
   // no need to lock the mutex; this method is called during shutdown
 
+  // there are no readers left; release the retired pages
+  free_retired_unlocked(state.get(), true);
+
   // cut off unused space at the end of the file; this space is managed
   // by the device
   state->device->reclaim_space();
@@ -763,6 +1072,18 @@ PageManager::close(Context *context)
 
   // join the worker thread
   state->worker.reset(0);
+
+  // delete the pages which are still cached (i.e. overflow pages of the
+  // PageManager state); their buffers are returned to the |buffer_pool|
+  PurgeAllPagesVisitor visitor;
+  state->cache.purge_if(visitor);
+  for (std::vector<Page *>::iterator it = visitor.pages.begin();
+          it != visitor.pages.end();
+          it++) {
+    (*it)->mutex().try_lock();
+    (*it)->mutex().unlock();
+    delete *it;
+  }
 }
 
 void
@@ -778,7 +1099,7 @@ PageManager::last_blob_page(Context *context)
   ScopedSpinlock lock(state->mutex);
 
   if (state->last_blob_page)
-    return add_to_changeset(&context->changeset, state->last_blob_page);
+    return add_to_changeset(context, state->last_blob_page);
   if (state->last_blob_page_id)
     return fetch_unlocked(state.get(), context, state->last_blob_page_id, 0);
   return 0;
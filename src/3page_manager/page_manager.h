@@ -88,6 +88,11 @@ struct PageManager
   // The page is locked and stored in |context->changeset|.
   Page *fetch(Context *context, uint64_t address, uint32_t flags = 0);
 
+  // Reads the pages at |addresses| from disk with a single batch and
+  // stores them in the cache (read-ahead). Pages which are already cached
+  // are skipped. The pages are neither locked nor added to the Changeset.
+  void prefetch(Context *context, const uint64_t *addresses, size_t count);
+
   // Allocates a new page. |page_type| is one of Page::kType* in page.h.
   // |flags| are either 0 or kClearWithZero
   // The page is locked and stored in |context->changeset|.
@@ -102,6 +107,14 @@ struct PageManager
   // Flushes all pages to disk
   void flush_all_pages();
 
+  // Flushes all dirty pages to disk, including those with attached
+  // cursors, and returns their addresses. Used for checkpoints
+  void flush_dirty_pages(std::vector<uint64_t> *page_ids);
+
+  // Returns true if the cache limits are exceeded and purge_cache() would
+  // do some work
+  bool is_cache_full();
+
   // Asks the worker thread to purge the cache if the cache limits are
   // exceeded
   void purge_cache(Context *context);
@@ -109,6 +122,10 @@ struct PageManager
   // Reclaim file space; truncates unused file space at the end of the file.
   void reclaim_space(Context *context);
 
+  // Returns the address of the first free page in the file, or 0 if the
+  // Freelist is empty
+  uint64_t first_free_page();
+
   // Flushes and closes all pages of a database
   void close_database(Context *context, LocalDb *db);
 
@@ -116,6 +133,17 @@ struct PageManager
   // to the Freelist
   void del(Context *context, Page *page, size_t page_count = 1);
 
+  // Moves the pages which were deleted by concurrent writers (see
+  // Context::concurrent) to the Freelist, but only if no optimistic
+  // reader is left which could still access them. Called when a
+  // concurrent write operation is completed.
+  void free_retired_pages();
+
+  // Returns the EpochManager of the optimistic readers
+  EpochManager *epochs() {
+    return &state->epochs;
+  }
+
   // Closes the PageManager; flushes all dirty pages
   void close(Context *context);
 
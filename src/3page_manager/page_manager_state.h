@@ -33,8 +33,11 @@
 #include <boost/atomic.hpp>
 
 // Always verify that a file of level N does not include headers > N!
+#include "1base/epoch_manager.h"
 #include "1base/spinlock.h"
+#include "1base/scoped_ptr.h"
 #include "2config/env_config.h"
+#include "2page/page_buffer_pool.h"
 #include "3cache/cache.h"
 #include "3page_manager/freelist.h"
 
@@ -56,6 +59,11 @@ struct WorkerPool;
  * The internal state of the PageManager
  */
 struct PageManagerState {
+  enum {
+    // max. number of background threads for flushing pages
+    kMaxFlushThreads = 4
+  };
+
   // constructor
   PageManagerState(LocalEnv *env);
 
@@ -77,6 +85,10 @@ struct PageManagerState {
   // The Device
   Device *device;
 
+  // Aligned page buffers for direct I/O; declared before the |cache|
+  // because it has to outlive all cached pages
+  ScopedPtr<PageBufferPool> buffer_pool;
+
   // The lsn manager
   LsnManager *lsn_manager;
 
@@ -86,6 +98,18 @@ struct PageManagerState {
   // The freelist
   Freelist freelist;
 
+  // Pages which were deleted while optimistic readers were active; they
+  // are moved to the |freelist| as soon as these readers are gone
+  struct RetiredPage {
+    uint64_t address;
+    size_t page_count;
+    uint64_t epoch;
+  };
+  std::vector<RetiredPage> retired;
+
+  // The epochs of the optimistic readers
+  EpochManager epochs;
+
   // Whether |m_free_pages| must be flushed or not
   bool needs_flush;
 
@@ -102,6 +126,9 @@ struct PageManagerState {
   // tracks number of fetched pages
   uint64_t page_count_fetched;
 
+  // tracks number of pages fetched by the read-ahead
+  uint64_t page_count_prefetched;
+
   // tracks number of index pages
   uint64_t page_count_index;
 
@@ -32,7 +32,8 @@ struct LocalEnv;
 
 struct Context {
   Context(LocalEnv *env, LocalTxn *txn = 0, LocalDb *db = 0)
-    : txn(txn), db(db), changeset(env) {
+    : txn(txn), db(db), shared(false), concurrent(false),
+      changeset(env) {
   }
 
   ~Context() {
@@ -42,6 +43,16 @@ struct Context {
   LocalTxn *txn;
   LocalDb *db;
 
+  // True if this is a read-only operation which shares the Environment's
+  // lock with other readers (see UPS_ENABLE_CONCURRENT_READS). Fetched
+  // pages are then neither locked nor added to the |changeset|.
+  bool shared;
+
+  // True if this is a modification which runs concurrently with optimistic
+  // readers (see Db::concurrent_writes). Deleted pages are not reused
+  // till these readers are gone.
+  bool concurrent;
+
   // Each operation has its own changeset which stores all locked pages
   Changeset changeset;
 };
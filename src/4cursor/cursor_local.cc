@@ -91,10 +91,12 @@ append_txn_duplicates(LocalCursor *cursor, Context *context)
 
   // now start integrating the items from the transactions
   for (op = node->oldest_op; op; op = op->next_in_node) {
-    Txn *optxn = op->txn;
+    LocalTxn *optxn = op->txn;
     // collect all ops that are valid (even those that are
-    // from conflicting transactions)
-    if (unlikely(optxn->is_aborted()))
+    // from conflicting transactions, unless they're not part of the
+    // snapshot of a read-only transaction)
+    if (unlikely(optxn->is_aborted()
+          || is_hidden_from_snapshot((LocalTxn *)cursor->txn, optxn)))
       continue;
 
     // a normal (overwriting) insert will overwrite ALL duplicates,
@@ -1127,6 +1129,7 @@ uint32_t
 LocalCursor::get_duplicate_count(uint32_t flags)
 {
   Context context(lenv(this), (LocalTxn *)txn, ldb(this));
+  context.shared = ldb(this)->concurrent_reads;
 
   if (unlikely(is_nil()))
     throw Exception(UPS_CURSOR_IS_NIL);
@@ -1149,6 +1152,7 @@ uint32_t
 LocalCursor::get_record_size()
 {
   Context context(lenv(this), (LocalTxn *)txn, ldb(this));
+  context.shared = ldb(this)->concurrent_reads;
 
   if (unlikely(is_nil()))
     throw Exception(UPS_CURSOR_IS_NIL);
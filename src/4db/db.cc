@@ -18,6 +18,9 @@
 
 #include "0root/root.h"
 
+#include <map>
+#include <set>
+
 // Always verify that a file of level N does not include headers > N!
 #include "4db/db.h"
 #include "4cursor/cursor.h"
@@ -28,6 +31,77 @@
 
 namespace upscaledb {
 
+typedef std::map<uint64_t, ArenaPair *> ThreadArenaMap;
+
+// Releases the arenas of a thread when the thread terminates
+static void
+release_thread_arenas(ThreadArenaMap *map)
+{
+  for (ThreadArenaMap::iterator it = map->begin(); it != map->end(); it++)
+    delete it->second;
+  delete map;
+}
+
+// The arenas of the current thread, indexed by Database id
+static boost::thread_specific_ptr<ThreadArenaMap>
+        thread_arena_map(release_thread_arenas);
+
+// The ids of all Databases with concurrent reads. The threads release
+// the arenas of closed Databases when they create new arenas.
+static Mutex concurrent_mutex;
+static std::set<uint64_t> concurrent_ids;
+static uint64_t concurrent_next_id;
+
+Db::~Db()
+{
+  if (concurrent_reads) {
+    ScopedLock lock(concurrent_mutex);
+    concurrent_ids.erase(concurrent_id);
+  }
+}
+
+void
+Db::enable_concurrent_reads()
+{
+  ScopedLock lock(concurrent_mutex);
+  if (!concurrent_reads) {
+    concurrent_reads = true;
+    concurrent_id = ++concurrent_next_id;
+    concurrent_ids.insert(concurrent_id);
+  }
+}
+
+ArenaPair *
+Db::thread_arenas()
+{
+  ThreadArenaMap *map = thread_arena_map.get();
+  if (unlikely(!map)) {
+    map = new ThreadArenaMap;
+    thread_arena_map.reset(map);
+  }
+
+  ThreadArenaMap::iterator it = map->find(concurrent_id);
+  if (likely(it != map->end()))
+    return it->second;
+
+  // release the arenas of Databases which were closed in the meantime
+  {
+    ScopedLock lock(concurrent_mutex);
+    for (it = map->begin(); it != map->end(); ) {
+      if (concurrent_ids.find(it->first) == concurrent_ids.end()) {
+        delete it->second;
+        map->erase(it++);
+      }
+      else
+        it++;
+    }
+  }
+
+  ArenaPair *arenas = new ArenaPair;
+  (*map)[concurrent_id] = arenas;
+  return arenas;
+}
+
 void
 Db::add_cursor(Cursor *cursor)
 {
@@ -45,6 +45,16 @@ namespace upscaledb {
 struct Cursor;
 struct ScanVisitor;
 
+// A pair of memory buffers for the keys and records which are returned
+// to the user
+struct ArenaPair {
+  // the buffer for the key data
+  ByteArray key;
+
+  // the buffer for the record data
+  ByteArray record;
+};
+
 /*
  * An abstract base class for a Database; is overwritten for local and
  * remote implementations
@@ -53,11 +63,12 @@ struct Db
 {
   // Constructor
   Db(Env *env_, DbConfig &config_)
-    : env(env_), context(0), cursor_list(0), config(config_) {
+    : env(env_), context(0), cursor_list(0), config(config_),
+      concurrent_reads(false), concurrent_writes(false), concurrent_id(0) {
   }
 
-  virtual ~Db() {
-  }
+  // Destructor
+  virtual ~Db();
 
   // Returns the runtime-flags - the flags are "mixed" with the flags from
   // the Environment
@@ -100,6 +111,11 @@ struct Db
   virtual ups_status_t find(Cursor *cursor, Txn *txn, ups_key_t *key,
                   ups_record_t *record, uint32_t flags) = 0;
 
+  // Lookup of several keys (ups_db_find_many)
+  virtual ups_status_t find_many(Txn *txn, ups_key_t *keys,
+                  ups_record_t *records, ups_status_t *results,
+                  size_t count, uint32_t flags) = 0;
+
   // Creates a cursor (ups_cursor_create)
   virtual Cursor *cursor_create(Txn *txn, uint32_t flags) = 0;
 
@@ -114,6 +130,14 @@ struct Db
   virtual ups_status_t bulk_operations(Txn *txn, ups_operation_t *operations,
                   size_t operations_length, uint32_t flags) = 0;
 
+  // Loads sorted key/record pairs (ups_db_bulk_load)
+  virtual ups_status_t bulk_load(ups_bulk_load_func_t func, void *context,
+                  uint32_t fill_factor, uint32_t flags) = 0;
+
+  // Compacts the btree (ups_db_compact)
+  virtual ups_status_t compact(uint32_t max_pages, uint32_t max_milliseconds,
+                  uint32_t flags) = 0;
+
   // Closes the database (ups_db_close)
   virtual ups_status_t close(uint32_t flags) = 0;
 
@@ -123,9 +147,19 @@ struct Db
   // Removes a cursor from the linked list of cursors
   void remove_cursor(Cursor *cursor);
 
+  // Allows read-only operations to run concurrently; from now on
+  // the key and record arenas are thread-local
+  void enable_concurrent_reads();
+
+  // Returns the key and record arenas of the current thread; only
+  // used if concurrent reads are enabled
+  ArenaPair *thread_arenas();
+
   // Returns the memory buffer for the key data: the per-database buffer
   // if |txn| is null or temporary, otherwise the buffer from the |txn|
   ByteArray &key_arena(Txn *txn) {
+    if (unlikely(concurrent_reads))
+      return thread_arenas()->key;
     return (txn == 0 || ISSET(txn->flags, UPS_TXN_TEMPORARY))
                ? _key_arena
                : txn->key_arena;
@@ -134,6 +168,8 @@ struct Db
   // Returns the memory buffer for the record data: the per-database buffer
   // if |txn| is null or temporary, otherwise the buffer from the |txn|
   ByteArray &record_arena(Txn *txn) {
+    if (unlikely(concurrent_reads))
+      return thread_arenas()->record;
     return (txn == 0 || ISSET(txn->flags, UPS_TXN_TEMPORARY))
                ? _record_arena
                : txn->record_arena;
@@ -158,6 +194,18 @@ struct Db
   // This is where record->data points to when returning a
   // record to the user; used if Txns are disabled
   ByteArray _record_arena;
+
+  // True if read-only operations can run concurrently under a shared
+  // lock (see UPS_ENABLE_CONCURRENT_READS)
+  bool concurrent_reads;
+
+  // True if inserts and erases can run concurrently with (optimistic)
+  // lookups; only for layouts whose nodes can be read without locks
+  bool concurrent_writes;
+
+  // A process-wide unique id; identifies the thread-local arenas of
+  // this Database
+  uint64_t concurrent_id;
 };
 
 } // namespace upscaledb
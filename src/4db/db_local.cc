@@ -18,18 +18,25 @@
 
 #include "0root/root.h"
 
+#include <algorithm>
+#include <vector>
+
 // Always verify that a file of level N does not include headers > N!
 #include "1globals/callbacks.h"
+#include "1os/os.h"
 #include "3page_manager/page_manager.h"
 #include "3journal/journal.h"
 #include "3blob_manager/blob_manager.h"
 #include "3btree/btree_index.h"
 #include "3btree/btree_index_factory.h"
+#include "3btree/btree_bulk_load.h"
+#include "3btree/btree_compact.h"
 #include "4db/db_local.h"
 #include "4context/context.h"
 #include "4cursor/cursor_local.h"
 #include "4txn/txn_local.h"
 #include "4txn/txn_cursor.h"
+#include "4uqi/plugin_wrapper.h"
 #include "4uqi/statements.h"
 #include "4uqi/scanvisitorfactory.h"
 #include "4uqi/result.h"
@@ -42,7 +49,11 @@ namespace upscaledb {
 
 enum {
   // The default threshold for inline records
-  kInlineRecordThreshold = 32
+  kInlineRecordThreshold = 32,
+
+  // Number of leaf pages which are visited by each step of a background
+  // compaction, if the caller did not specify a budget
+  kCompactionStepPages = 64
 };
 
 // Returns the LocalEnv instance
@@ -131,6 +142,25 @@ is_modified_by_active_transaction(TxnIndex *txn_index)
   return false;
 }
 
+// Returns true if this database has operations which were not yet flushed
+// to the btree (i.e. of committed transactions which are waiting for an
+// older transaction)
+static inline bool
+has_unflushed_operations(TxnIndex *txn_index)
+{
+  for (TxnNode *node = txn_index->first();
+                  node != 0;
+                  node = node->next_sibling()) {
+    for (TxnOperation *op = node->newest_op;
+                    op != 0;
+                    op = op->previous_in_node) {
+      if (!op->txn->is_aborted() && NOTSET(op->flags, TxnOperation::kIsFlushed))
+        return true;
+    }
+  }
+  return false;
+}
+
 static inline bool
 is_key_erased(Context *context, TxnIndex *txn_index, ups_key_t *key)
 {
@@ -144,8 +174,8 @@ is_key_erased(Context *context, TxnIndex *txn_index, ups_key_t *key)
   for (TxnOperation *op = node->newest_op;
                   op != 0;
                   op = op->previous_in_node) {
-    Txn *optxn = op->txn;
-    if (optxn->is_aborted())
+    LocalTxn *optxn = op->txn;
+    if (optxn->is_aborted() || is_hidden_from_snapshot(context->txn, optxn))
       continue;
     if (optxn->is_committed() || context->txn == optxn) {
       if (ISSET(op->flags, TxnOperation::kIsFlushed))
@@ -326,14 +356,15 @@ find_txn(LocalDb *db, Context *context, LocalCursor *cursor, ups_key_t *key,
   //    because we've found a conflict
   // - if a committed txn has erased the item then there's no need
   //    to continue checking older, committed txns
+  // - read-only txns skip all ops which are not part of their snapshot
   //
 retry:
   if (node)
     op = node->newest_op;
 
   for (; op != 0; op = op->previous_in_node) {
-    Txn *optxn = op->txn;
-    if (optxn->is_aborted())
+    LocalTxn *optxn = op->txn;
+    if (optxn->is_aborted() || is_hidden_from_snapshot(context->txn, optxn))
       continue;
 
     if (optxn->is_committed() || context->txn == optxn) {
@@ -410,6 +441,22 @@ retry:
     return UPS_TXN_CONFLICT;
   }
 
+  // a read-only txn did not see any op of this node; if approx. matching
+  // is enabled then continue with the neighbouring node
+  if (unlikely(!op && node
+          && ISSETANY(flags, UPS_FIND_LT_MATCH | UPS_FIND_GT_MATCH)
+          && context->txn
+          && ISSET(context->txn->flags, UPS_TXN_READ_ONLY))) {
+    node = ISSET(flags, UPS_FIND_LT_MATCH)
+              ? node->previous_sibling()
+              : node->next_sibling();
+    if (node) {
+      ups_key_set_intflags(key,
+          (ups_key_get_intflags(key) | BtreeKey::kApproximate));
+      goto retry;
+    }
+  }
+
   // if there was an approximate match: check if the btree provides
   // a better match
   if (unlikely(op
@@ -644,6 +691,37 @@ erase_impl(LocalDb *db, Context *context, LocalCursor *cursor, ups_key_t *key,
   return erase_txn(db, context, key, flags, cursor);
 }
 
+// Enables concurrent reads if they were requested. Databases with key or
+// record compression do not support them because the compressors are not
+// thread-safe.
+//
+// Inserts and erases can then run concurrently with lookups if the btree
+// nodes have a fixed layout: fixed length keys with a built-in compare
+// function, inline records and no duplicates. Torn reads of such nodes
+// never leave the page, and they are detected by the optimistic readers.
+// The search trees of UPS_NODE_LAYOUT_BTREE are built lazily by the
+// readers, and must not be built from a node which is modified; these
+// Databases are therefore modified under the exclusive lock.
+static inline void
+initialize_concurrent_reads(Context *context, LocalDb *db)
+{
+  if (NOTSET(db->flags(), UPS_ENABLE_CONCURRENT_READS)
+      || db->config.key_compressor != 0
+      || db->config.record_compressor != 0)
+    return;
+
+  db->enable_concurrent_reads();
+
+  db->concurrent_writes = db->config.key_size != UPS_KEY_SIZE_UNLIMITED
+      && db->config.key_type != UPS_TYPE_CUSTOM
+      && ISSET(db->config.flags, UPS_FORCE_RECORDS_INLINE)
+      && db->config.internal_node_layout != UPS_NODE_LAYOUT_BTREE
+      && NOTSET(db->flags(), UPS_ENABLE_DUPLICATE_KEYS);
+
+  // concurrent readers expect that the root page is already cached
+  db->btree_index->root_page(context);
+}
+
 ups_status_t
 LocalDb::create(Context *context, PBtreeHeader *btree_header)
 {
@@ -658,7 +736,8 @@ LocalDb::create(Context *context, PBtreeHeader *btree_header)
             | UPS_ENABLE_FSYNC
             | UPS_READ_ONLY
             | UPS_AUTO_RECOVERY
-            | UPS_ENABLE_TRANSACTIONS);
+            | UPS_ENABLE_TRANSACTIONS
+            | UPS_ENABLE_CONCURRENT_READS);
 
   switch (config.key_type) {
     case UPS_TYPE_UINT8:
@@ -743,6 +822,7 @@ LocalDb::create(Context *context, PBtreeHeader *btree_header)
   // and the TxnIndex
   txn_index.reset(new TxnIndex(this));
 
+  initialize_concurrent_reads(context, this);
   return 0;
 }
 
@@ -793,6 +873,8 @@ LocalDb::open(Context *context, PBtreeHeader *btree_header)
                                     config.record_compressor));
   }
 
+  initialize_concurrent_reads(context, this);
+
   // fetch the current record number
   if (ISSETANY(flags(), UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64))
     return fetch_record_number(context, this);
@@ -865,6 +947,7 @@ LocalDb::get_parameters(ups_parameter_t *param)
       break;
     case UPS_PARAM_MAX_KEYS_PER_PAGE: {
       Context context(lenv(this), 0, this);
+      context.shared = concurrent_reads;
       Page *page = btree_index->root_page(&context);
       if (likely(page != 0)) {
         BtreeNodeProxy *node = btree_index->get_node_from_page(page);
@@ -880,6 +963,9 @@ LocalDb::get_parameters(ups_parameter_t *param)
     case UPS_PARAM_KEY_COMPRESSION:
       p->value = config.key_compressor;
       break;
+    case UPS_PARAM_INTERNAL_NODE_LAYOUT:
+      p->value = config.internal_node_layout;
+      break;
     default:
       ups_trace(("unknown parameter %d", (int)p->name));
       return UPS_INV_PARAMETER;
@@ -908,9 +994,11 @@ LocalDb::count(Txn *htxn, bool distinct)
   LocalTxn *txn = dynamic_cast<LocalTxn *>(htxn);
 
   Context context(lenv(this), txn, this);
+  context.shared = concurrent_reads;
 
   // purge cache if necessary
-  lenv(this)->page_manager->purge_cache(&context);
+  if (!context.shared)
+    lenv(this)->page_manager->purge_cache(&context);
 
   // call the btree function - this will retrieve the number of keys
   // in the btree
@@ -1125,6 +1213,7 @@ LocalDb::insert(Cursor *hcursor, Txn *txn, ups_key_t *key,
   LocalTxn *local_txn = 0;
   LocalCursor *cursor = (LocalCursor *)hcursor;
   Context context(lenv(this), (LocalTxn *)txn, this);
+  context.concurrent = concurrent_writes && !cursor;
 
   if (cursor && NOTSET(flags, UPS_DUPLICATE) && NOTSET(flags, UPS_OVERWRITE))
     cursor->duplicate_cache_index = 0;
@@ -1146,10 +1235,14 @@ LocalDb::insert(Cursor *hcursor, Txn *txn, ups_key_t *key,
       flags |= UPS_HINT_APPEND;
   }
 
-  // purge the cache
-  lenv(this)->page_manager->purge_cache(&context);
+  // purge the cache; concurrent writers leave this to the Environment's
+  // lock because optimistic readers might still access the pages
+  if (!context.concurrent)
+    lenv(this)->page_manager->purge_cache(&context);
 
   ups_status_t st = insert_impl(this, &context, cursor, key, record, flags);
+  if (context.concurrent)
+    lenv(this)->page_manager->free_retired_pages();
   return finalize(lenv(this), &context, st, local_txn);
 }
 
@@ -1172,6 +1265,7 @@ LocalDb::erase(Cursor *hcursor, Txn *txn, ups_key_t *key, uint32_t flags)
 
   LocalTxn *local_txn = 0;
   Context context(lenv(this), (LocalTxn *)txn, this);
+  context.concurrent = concurrent_writes && !cursor;
 
   if (!txn && ISSET(this->flags(), UPS_ENABLE_TRANSACTIONS)) {
     local_txn = begin_temp_txn(lenv(this));
@@ -1179,6 +1273,8 @@ LocalDb::erase(Cursor *hcursor, Txn *txn, ups_key_t *key, uint32_t flags)
   }
 
   ups_status_t st = erase_impl(this, &context, cursor, key, flags);
+  if (context.concurrent)
+    lenv(this)->page_manager->free_retired_pages();
   // on success: 'nil' the cursor
   if (likely(st == 0)) {
     if (cursor)
@@ -1211,9 +1307,11 @@ LocalDb::find(Cursor *hcursor, Txn *txn, ups_key_t *key,
   }
 
   Context context(lenv(this), (LocalTxn *)txn, this);
+  context.shared = concurrent_reads;
 
   // purge cache if necessary
-  lenv(this)->page_manager->purge_cache(&context);
+  if (!context.shared)
+    lenv(this)->page_manager->purge_cache(&context);
 
   // if Transactions are disabled then read from the Btree
   if (NOTSET(this->flags(), UPS_ENABLE_TRANSACTIONS)) {
@@ -1253,6 +1351,57 @@ LocalDb::find(Cursor *hcursor, Txn *txn, ups_key_t *key,
   return finalize(lenv(this), &context, st, 0);
 }
 
+ups_status_t
+LocalDb::find_many(Txn *txn, ups_key_t *keys, ups_record_t *records,
+                ups_status_t *results, size_t count, uint32_t /* unused */)
+{
+  for (size_t i = 0; i < count; i++) {
+    if (unlikely(config.key_size != UPS_KEY_SIZE_UNLIMITED
+          && keys[i].size != config.key_size)) {
+      ups_trace(("invalid key size (%u instead of %u)",
+            keys[i].size, config.key_size));
+      return UPS_INV_KEY_SIZE;
+    }
+  }
+
+  ByteArray ra;
+
+  // if Transactions are disabled then the lookups are interleaved
+  if (NOTSET(this->flags(), UPS_ENABLE_TRANSACTIONS)) {
+    Context context(lenv(this), (LocalTxn *)txn, this);
+    context.shared = concurrent_reads;
+
+    // purge cache if necessary
+    if (!context.shared)
+      lenv(this)->page_manager->purge_cache(&context);
+
+    btree_index->find_many(&context, keys, records, results, count, &ra);
+    record_arena(txn).steal_from(ra);
+    return 0;
+  }
+
+  // Otherwise the keys are looked up one by one. Each lookup overwrites
+  // the record arena, therefore the records are collected in |ra|; the
+  // pointers are assigned afterwards because |ra| is reallocated when
+  // it grows.
+  std::vector<size_t> offsets(count, 0);
+  for (size_t i = 0; i < count; i++) {
+    results[i] = find(0, txn, &keys[i], &records[i], 0);
+    if (results[i] == 0 && NOTSET(records[i].flags, UPS_RECORD_USER_ALLOC)) {
+      offsets[i] = ra.size();
+      ra.append((uint8_t *)records[i].data, records[i].size);
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (results[i] == 0 && NOTSET(records[i].flags, UPS_RECORD_USER_ALLOC))
+      records[i].data = ra.data() + offsets[i];
+  }
+
+  record_arena(txn).steal_from(ra);
+  return 0;
+}
+
 Cursor *
 LocalDb::cursor_create(Txn *txn, uint32_t)
 {
@@ -1265,44 +1414,130 @@ LocalDb::cursor_clone(Cursor *src)
   return new LocalCursor(*(LocalCursor *)src);
 }
 
+// Orders the indices of a batch by the keys of their operations
+struct BulkOperationComparator
+{
+  BulkOperationComparator(BtreeIndex *btree_, ups_operation_t *ops_)
+    : btree(btree_), ops(ops_) {
+  }
+
+  bool operator()(size_t lhs, size_t rhs) const {
+    return btree->compare_keys(&ops[lhs].key, &ops[rhs].key) < 0;
+  }
+
+  BtreeIndex *btree;
+  ups_operation_t *ops;
+};
+
+// Enables the batch mode of the btree for the lifetime of this object
+struct ScopedBatchMode
+{
+  ScopedBatchMode(BtreeIndex *btree_, bool enabled_)
+    : btree(btree_), enabled(enabled_) {
+    if (enabled)
+      btree->set_batch_mode(true);
+  }
+
+  ~ScopedBatchMode() {
+    if (enabled)
+      btree->set_batch_mode(false);
+  }
+
+  BtreeIndex *btree;
+  bool enabled;
+};
+
+// Returns true if the operations of a batch can be executed in the order
+// of their keys. This is only possible if the btree is modified directly
+// (no transactions, no record numbers), if no approx. matching is used and
+// if all keys are valid.
+static inline bool
+is_sortable_batch(LocalDb *db, Txn *txn, ups_operation_t *ops,
+                size_t ops_length)
+{
+  // small batches are not worth the overhead
+  const size_t kMinimumBatchSize = 16;
+
+  if (ops_length < kMinimumBatchSize
+        || txn != 0
+        || ISSET(db->env->flags(), UPS_ENABLE_TRANSACTIONS)
+        || ISSETANY(db->flags(), UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64))
+    return false;
+
+  uint32_t key_size = db->config.key_size;
+  for (size_t i = 0; i < ops_length; i++) {
+    switch (ops[i].type) {
+      case UPS_OP_INSERT:
+      case UPS_OP_ERASE:
+        break;
+      case UPS_OP_FIND:
+        if (ISSETANY(ops[i].flags, UPS_FIND_LT_MATCH | UPS_FIND_GT_MATCH))
+          return false;
+        break;
+      default:
+        return false;
+    }
+    if (ops[i].key.size > 0 && ops[i].key.data == 0)
+      return false;
+    if (key_size != UPS_KEY_SIZE_UNLIMITED && ops[i].key.size != key_size)
+      return false;
+  }
+  return true;
+}
+
 ups_status_t
 LocalDb::bulk_operations(Txn *txn, ups_operation_t *ops, size_t ops_length,
                 uint32_t /* unused */)
 {
   ByteArray ka, ra;
-  ups_operation_t *initial_ops = ops;
+
+  // If possible then the operations are executed in the order of their
+  // keys; the btree then descends only once per leaf and applies all
+  // following operations of this leaf directly. The sort is stable, so
+  // operations with the same key are executed in their original order.
+  // The results are stored in the original |ops| array.
+  std::vector<size_t> order(ops_length);
+  for (size_t i = 0; i < ops_length; i++)
+    order[i] = i;
+
+  bool sorted = is_sortable_batch(this, txn, ops, ops_length);
+  if (sorted)
+    std::stable_sort(order.begin(), order.end(),
+                    BulkOperationComparator(btree_index.get(), ops));
+  ScopedBatchMode batch_mode(btree_index.get(), sorted);
 
   // The |ByteArray| uses realloc to grow, and existing pointers will
   // be invalidated. Therefore we will use two loops: the first one
   // accumulates all results in |ka| and |ra|, the second one lets key->data
   // and record->data pointers point into |ka| and |ra|.
-  for (size_t i = 0; i < ops_length; i++, ops++) {
-    switch (ops->type) {
+  for (size_t i = 0; i < ops_length; i++) {
+    ups_operation_t *op = &ops[order[i]];
+    switch (op->type) {
       case UPS_OP_INSERT:
-        ops->result = insert(0, txn, &ops->key, &ops->record, ops->flags);
+        op->result = insert(0, txn, &op->key, &op->record, op->flags);
         // if this a record number database? then we might have to copy the key
-        if (likely(ops->result == 0)
+        if (likely(op->result == 0)
                 && ISSETANY(flags(), UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64)
-                && NOTSET(ops->key.flags, UPS_KEY_USER_ALLOC)) {
-          ka.append((uint8_t *)ops->key.data, ops->key.size);
+                && NOTSET(op->key.flags, UPS_KEY_USER_ALLOC)) {
+          ka.append((uint8_t *)op->key.data, op->key.size);
         }
         break;
       case UPS_OP_FIND:
-        ops->result = find(0, txn, &ops->key, &ops->record, ops->flags);
-        if (likely(ops->result == 0)) {
+        op->result = find(0, txn, &op->key, &op->record, op->flags);
+        if (likely(op->result == 0)) {
           // copy key if approx. matching was used
-          if (ISSETANY(ups_key_get_intflags(&ops->key), BtreeKey::kApproximate)
-                  && NOTSET(ops->key.flags, UPS_KEY_USER_ALLOC)) {
-            ka.append((uint8_t *)ops->key.data, ops->key.size);
+          if (ISSETANY(ups_key_get_intflags(&op->key), BtreeKey::kApproximate)
+                  && NOTSET(op->key.flags, UPS_KEY_USER_ALLOC)) {
+            ka.append((uint8_t *)op->key.data, op->key.size);
           }
           // copy record unless it's allocated by the user
-          if (NOTSET(ops->record.flags, UPS_RECORD_USER_ALLOC)) {
-            ra.append((uint8_t *)ops->record.data, ops->record.size);
+          if (NOTSET(op->record.flags, UPS_RECORD_USER_ALLOC)) {
+            ra.append((uint8_t *)op->record.data, op->record.size);
           }
         }
         break;
       case UPS_OP_ERASE:
-        ops->result = erase(0, txn, &ops->key, ops->flags);
+        op->result = erase(0, txn, &op->key, op->flags);
         break;
       default:
         return UPS_INV_PARAMETER;
@@ -1314,31 +1549,31 @@ LocalDb::bulk_operations(Txn *txn, ups_operation_t *ops, size_t ops_length,
 
   uint8_t *kptr = ka.data();
   uint8_t *rptr = ra.data();
-  ops = initial_ops;
-  for (size_t i = 0; i < ops_length; i++, ops++) {
-    if (unlikely(ops->result != 0))
+  for (size_t i = 0; i < ops_length; i++) {
+    ups_operation_t *op = &ops[order[i]];
+    if (unlikely(op->result != 0))
       continue;
 
-    switch (ops->type) {
+    switch (op->type) {
       case UPS_OP_INSERT:
         // if this a record number database? then we might have to copy the key
         if (ISSETANY(flags(), UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64)
-                && NOTSET(ops->key.flags, UPS_KEY_USER_ALLOC)) {
-          ops->key.data = kptr;
-          kptr += ops->key.size;
+                && NOTSET(op->key.flags, UPS_KEY_USER_ALLOC)) {
+          op->key.data = kptr;
+          kptr += op->key.size;
         }
         break;
       case UPS_OP_FIND:
         // copy key if approx. matching was used
-        if (ISSETANY(ups_key_get_intflags(&ops->key), BtreeKey::kApproximate)
-                  && NOTSET(ops->key.flags, UPS_KEY_USER_ALLOC)) {
-          ops->key.data = kptr;
-          kptr += ops->key.size;
+        if (ISSETANY(ups_key_get_intflags(&op->key), BtreeKey::kApproximate)
+                  && NOTSET(op->key.flags, UPS_KEY_USER_ALLOC)) {
+          op->key.data = kptr;
+          kptr += op->key.size;
         }
         // copy record unless it's allocated by the user
-        if (NOTSET(ops->record.flags, UPS_RECORD_USER_ALLOC)) {
-          ops->record.data = rptr;
-          rptr += ops->record.size;
+        if (NOTSET(op->record.flags, UPS_RECORD_USER_ALLOC)) {
+          op->record.data = rptr;
+          rptr += op->record.size;
         }
         break;
       default:
@@ -1353,6 +1588,207 @@ LocalDb::bulk_operations(Txn *txn, ups_operation_t *ops, size_t ops_length,
   return 0;
 }
 
+// Releases the pages which were modified by the bulk loader or by a
+// compaction; if recovery is enabled then they're written to the journal
+static inline void
+flush_changeset(LocalDb *db, Context *context)
+{
+  if (lenv(db)->journal.get())
+    context->changeset.flush(lenv(db)->lsn_manager.next());
+  else
+    context->changeset.clear();
+}
+
+ups_status_t
+LocalDb::bulk_load(ups_bulk_load_func_t func, void *user_context,
+                uint32_t fill_factor, uint32_t /* unused */)
+{
+  // number of locked pages which triggers a flush of the changeset
+  const size_t kChangesetThreshold = 64;
+
+  Context context(lenv(this), 0, this);
+
+  // the loader writes directly to the btree; all transactions of this
+  // database therefore have to be flushed
+  if (unlikely(is_modified_by_active_transaction(txn_index.get()))) {
+    ups_trace(("cannot bulk load a Database that is modified by "
+               "a currently active Txn"));
+    return UPS_TXN_STILL_OPEN;
+  }
+  if (lenv(this)->txn_manager.get()) {
+    lenv(this)->txn_manager->flush_committed_txns(&context);
+    if (unlikely(has_unflushed_operations(txn_index.get()))) {
+      ups_trace(("cannot bulk load a Database with committed Txns which "
+                 "cannot be flushed"));
+      return UPS_TXN_STILL_OPEN;
+    }
+  }
+
+  bool is_recno = ISSETANY(config.flags,
+                  UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64);
+  ups_status_t st = 0;
+
+  try {
+    BtreeBulkLoader loader(btree_index.get(), &context, fill_factor);
+
+    while (true) {
+      ups_key_t key = {0};
+      ups_record_t record = {0};
+      int rv = func(user_context, &key, &record);
+      if (rv <= 0) {
+        st = rv;
+        break;
+      }
+
+      if (unlikely(config.key_size != UPS_KEY_SIZE_UNLIMITED
+                              && key.size != config.key_size)) {
+        ups_trace(("invalid key size (%u instead of %u)",
+              key.size, config.key_size));
+        st = UPS_INV_KEY_SIZE;
+        break;
+      }
+      if (unlikely(config.record_size != UPS_RECORD_SIZE_UNLIMITED
+                              && record.size != config.record_size)) {
+        ups_trace(("invalid record size (%u instead of %u)",
+              record.size, config.record_size));
+        st = UPS_INV_RECORD_SIZE;
+        break;
+      }
+
+      st = loader.append(&key, &record);
+      if (unlikely(st))
+        break;
+
+      if (is_recno) {
+        uint64_t recno = ISSET(config.flags, UPS_RECORD_NUMBER32)
+                            ? *(uint32_t *)key.data
+                            : *(uint64_t *)key.data;
+        if (recno > _current_record_number)
+          _current_record_number = recno;
+      }
+
+      if (context.changeset.collection.size() > kChangesetThreshold) {
+        flush_changeset(this, &context);
+        lenv(this)->page_manager->purge_cache(&context);
+      }
+    }
+
+    flush_changeset(this, &context);
+  }
+  catch (Exception &ex) {
+    st = ex.code;
+  }
+
+  // the cached boundary keys are outdated
+  histogram.reset();
+  return st;
+}
+
+// Truncates the free pages at the end of the file
+static inline void
+reclaim_file_space(LocalDb *db, Context *context)
+{
+  LocalEnv *env = lenv(db);
+  if (ISSETANY(env->config.flags,
+                UPS_IN_MEMORY | UPS_DISABLE_RECLAIM_INTERNAL))
+    return;
+
+#ifdef WIN32
+  // Win32: it's not possible to truncate the file while there's an active
+  // mapping
+  if (NOTSET(env->config.flags, UPS_DISABLE_MMAP))
+    return;
+#endif
+
+  // the pages which were preallocated by the device are not managed by
+  // the freelist; release them first
+  env->device->reclaim_space();
+  env->page_manager->reclaim_space(context);
+  flush_changeset(db, context);
+}
+
+// Performs a background compaction (see ups_db_compact). Each step
+// acquires the Environment's lock; the lock is released between two steps.
+// The job stops when the whole btree was visited, or when the Database
+// is closed.
+static void
+async_compact(LocalDb *db, uint32_t max_pages, uint32_t max_milliseconds)
+{
+  while (!db->compaction_cancelled) {
+    {
+      // do not block; close() holds the lock while it waits for this job
+      ScopedTryLock<ReadWriteMutex> lock(db->env->mutex);
+      if (lock.is_locked() && !db->compaction_cancelled) {
+        ups_status_t st = db->compact(max_pages, max_milliseconds, 0);
+        if (st != UPS_LIMITS_REACHED) {
+          if (st)
+            ups_log(("background compaction failed with status %d", st));
+          break;
+        }
+      }
+    }
+
+    // give the other threads a chance to acquire the lock
+    os_sleep_msec(1);
+  }
+
+  db->compaction_pending = false;
+}
+
+ups_status_t
+LocalDb::compact(uint32_t max_pages, uint32_t max_milliseconds,
+                uint32_t flags)
+{
+  if (ISSET(flags, UPS_COMPACT_IN_BACKGROUND)) {
+    // a background compaction is already running
+    if (compaction_pending)
+      return 0;
+
+    if (max_pages == 0 && max_milliseconds == 0)
+      max_pages = kCompactionStepPages;
+    if (!compaction_worker)
+      compaction_worker.reset(new WorkerPool(1));
+
+    compaction_pending = true;
+    compaction_cancelled = false;
+    compaction_worker->enqueue(boost::bind(&async_compact, this,
+                            max_pages, max_milliseconds));
+    return 0;
+  }
+
+  Context context(lenv(this), 0, this);
+
+  uint64_t deadline = 0;
+  if (max_milliseconds)
+    deadline = os_now_usec() + (uint64_t)max_milliseconds * 1000;
+
+  ups_status_t st = 0;
+
+  try {
+    BtreeCompactAction compactor(btree_index.get(), &context);
+
+    // the budget is checked after each internal node
+    while (compactor.run()) {
+      flush_changeset(this, &context);
+      lenv(this)->page_manager->purge_cache(&context);
+
+      if ((max_pages && compactor.page_count() >= max_pages)
+            || (deadline && os_now_usec() >= deadline)) {
+        st = UPS_LIMITS_REACHED;
+        break;
+      }
+    }
+
+    flush_changeset(this, &context);
+    reclaim_file_space(this, &context);
+  }
+  catch (Exception &ex) {
+    st = ex.code;
+  }
+
+  return st;
+}
+
 ups_status_t
 LocalDb::cursor_move(Cursor *hcursor, ups_key_t *key,
                 ups_record_t *record, uint32_t flags)
@@ -1360,9 +1796,11 @@ LocalDb::cursor_move(Cursor *hcursor, ups_key_t *key,
   LocalCursor *cursor = (LocalCursor *)hcursor;
 
   Context context(lenv(this), (LocalTxn *)cursor->txn, this);
+  context.shared = concurrent_reads;
 
   // purge cache if necessary
-  lenv(this)->page_manager->purge_cache(&context);
+  if (!context.shared)
+    lenv(this)->page_manager->purge_cache(&context);
 
   //
   // if the cursor was never used before and the user requests a NEXT then
@@ -1406,6 +1844,13 @@ LocalDb::close(uint32_t flags)
     return UPS_TXN_STILL_OPEN;
   }
 
+  // stop the background compaction; the caller holds the Environment's
+  // lock, therefore the job cannot start another step
+  if (compaction_worker) {
+    compaction_cancelled = true;
+    compaction_worker.reset();
+  }
+
   // in-memory-database: free all allocated blobs
   if (btree_index && ISSET(env->flags(), UPS_IN_MEMORY))
    btree_index->drop(&context);
@@ -1418,6 +1863,66 @@ LocalDb::close(uint32_t flags)
   return 0;
 }
 
+static inline bool
+is_numeric_type(int type)
+{
+  switch (type) {
+    case UPS_TYPE_UINT8:
+    case UPS_TYPE_UINT16:
+    case UPS_TYPE_UINT32:
+    case UPS_TYPE_UINT64:
+    case UPS_TYPE_REAL32:
+    case UPS_TYPE_REAL64:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns true if the predicate of |stmt| has a range predicate which
+// can be applied to the leaves of |db|
+static bool
+supports_range_predicate(LocalDb *db, SelectStatement *stmt)
+{
+  if (!stmt->predicate_plg || !stmt->predicate_plg->range_pred)
+    return false;
+
+  uint32_t stream = stmt->predicate.flags
+                        & (UQI_STREAM_KEY | UQI_STREAM_RECORD);
+  if (stream == UQI_STREAM_KEY)
+    return is_numeric_type(db->config.key_type);
+  if (stream == UQI_STREAM_RECORD)
+    return is_numeric_type(db->config.record_type)
+              && NOTSET(db->flags(), UPS_ENABLE_DUPLICATES);
+  return false;
+}
+
+// Returns false if no key (or record) of the leaf |node| can match the
+// predicate, which is then skipped
+static bool
+leaf_can_match(Context *context, SelectStatement *stmt,
+                PredicatePluginWrapper *plugin, BtreeNodeProxy *node)
+{
+  size_t length = node->length();
+  if (unlikely(length == 0))
+    return true;
+
+  // the keys are sorted
+  if (ISSET(stmt->predicate.flags, UQI_STREAM_KEY)) {
+    ByteArray min_arena, max_arena;
+    ups_key_t min = {0};
+    ups_key_t max = {0};
+    node->key(context, 0, &min_arena, &min);
+    node->key(context, length - 1, &max_arena, &max);
+    return plugin->range_pred(min.data, max.data, min.size);
+  }
+
+  const void *min, *max;
+  if (!node->record_range(context, &min, &max))
+    return true;
+  return plugin->range_pred(min, max, context->db->config.record_size);
+}
+
 static bool
 are_cursors_identical(LocalCursor *c1, LocalCursor *c2)
 {
@@ -1441,6 +1946,168 @@ are_cursors_identical(LocalCursor *c1, LocalCursor *c2)
   return k1 == k2;
 }
 
+// A range of leaves which is scanned by one thread of a parallel query
+struct LeafRange
+{
+  LeafRange()
+    : first_leaf(0), end_leaf(0), visitor(0), range_plugin(0), status(0) {
+  }
+
+  // The address of the first leaf
+  uint64_t first_leaf;
+
+  // The address of the first leaf of the following range, or 0
+  uint64_t end_leaf;
+
+  // Aggregates the keys of this range
+  ScanVisitor *visitor;
+
+  // Skips leaves which cannot match the predicate; can be null
+  PredicatePluginWrapper *range_plugin;
+
+  // The status of the scan
+  ups_status_t status;
+};
+
+// The state of a parallel query; the ranges are consumed by the calling
+// thread and by the query worker threads of the Environment
+struct ParallelScan
+{
+  ParallelScan(size_t count)
+    : ranges(count), pending(0) {
+  }
+
+  ~ParallelScan() {
+    for (size_t i = 0; i < ranges.size(); i++) {
+      delete ranges[i].visitor;
+      delete ranges[i].range_plugin;
+    }
+  }
+
+  // Called by a thread when it has finished its range
+  void range_done() {
+    ScopedLock lock(mutex);
+    if (--pending == 0)
+      done.notify_all();
+  }
+
+  // Blocks till all ranges were scanned
+  void wait() {
+    ScopedLock lock(mutex);
+    while (pending > 0)
+      done.wait(lock);
+  }
+
+  // The ranges, in ascending key order
+  std::vector<LeafRange> ranges;
+
+  // The number of ranges which are still scanned by the workers
+  size_t pending;
+
+  // For waiting till all workers are done
+  Mutex mutex;
+  Condition done;
+};
+
+// Returns the address of the left-most leaf in the subtree |address|
+static uint64_t
+leftmost_leaf(Context *context, LocalDb *db, uint64_t address)
+{
+  PageManager *page_manager = lenv(db)->page_manager.get();
+
+  while (true) {
+    Page *page = page_manager->fetch(context, address, PageManager::kReadOnly);
+    BtreeNodeProxy *node = db->btree_index->get_node_from_page(page);
+    if (node->is_leaf())
+      return address;
+    address = node->left_child();
+  }
+}
+
+// Scans all leaves of |range|. Runs in its own thread with its own Context,
+// which shares the Environment's lock with the thread of the query.
+static void
+scan_leaf_range(LocalDb *db, SelectStatement *stmt, LeafRange *range)
+{
+  PageManager *page_manager = lenv(db)->page_manager.get();
+
+  try {
+    Context context(lenv(db), 0, db);
+    context.shared = true;
+
+    uint64_t address = range->first_leaf;
+    do {
+      Page *page = page_manager->fetch(&context, address,
+                      PageManager::kReadOnly);
+      BtreeNodeProxy *node = db->btree_index->get_node_from_page(page);
+      if (!range->range_plugin
+            || leaf_can_match(&context, stmt, range->range_plugin, node))
+        node->scan(&context, range->visitor, stmt, 0, stmt->distinct);
+      address = node->right_sibling();
+    } while (address != 0 && address != range->end_leaf);
+  }
+  catch (Exception &ex) {
+    range->status = ex.code;
+  }
+}
+
+// Runs scan_leaf_range() in a worker thread
+static void
+scan_leaf_range_async(LocalDb *db, SelectStatement *stmt, LeafRange *range,
+                ParallelScan *scan)
+{
+  scan_leaf_range(db, stmt, range);
+  scan->range_done();
+}
+
+// Splits the children of the root node into |threads| ranges of leaves
+// which are scanned in parallel. Each range has its own visitor; the
+// partial results are then merged into |visitor| in key order.
+// Returns false (and does not scan) if the root node is a leaf.
+static bool
+select_parallel(Context *context, LocalDb *db, SelectStatement *stmt,
+                ScanVisitor *visitor, bool use_range_predicate,
+                size_t threads, ups_status_t *pst)
+{
+  Page *root = db->btree_index->root_page(context);
+  BtreeNodeProxy *node = db->btree_index->get_node_from_page(root);
+  if (node->is_leaf())
+    return false;
+
+  size_t children = node->length() + 1;
+  ParallelScan scan(std::min(threads, children));
+
+  for (size_t i = 0; i < scan.ranges.size(); i++) {
+    LeafRange &range = scan.ranges[i];
+    size_t child = i * children / scan.ranges.size();
+    range.first_leaf = leftmost_leaf(context, db, child == 0
+                                ? node->left_child()
+                                : node->record_id(context, child - 1));
+    if (i > 0)
+      scan.ranges[i - 1].end_leaf = range.first_leaf;
+    range.visitor = ScanVisitorFactory::from_select(stmt, db);
+    if (use_range_predicate)
+      range.range_plugin = new PredicatePluginWrapper(&db->config, stmt);
+  }
+
+  // the calling thread scans the first range, the workers scan the others
+  WorkerPool *workers = lenv(db)->query_workers();
+  scan.pending = scan.ranges.size() - 1;
+  for (size_t i = 1; i < scan.ranges.size(); i++)
+    workers->enqueue(boost::bind(&scan_leaf_range_async, db, stmt,
+                            &scan.ranges[i], &scan));
+  scan_leaf_range(db, stmt, &scan.ranges[0]);
+  scan.wait();
+
+  *pst = 0;
+  for (size_t i = 0; i < scan.ranges.size(); i++) {
+    if (unlikely(scan.ranges[i].status))
+      *pst = scan.ranges[i].status;
+    visitor->merge(scan.ranges[i].visitor);
+  }
+  return true;
+}
+
 ups_status_t
 LocalDb::select_range(SelectStatement *stmt, LocalCursor *begin,
                 LocalCursor *end, Result **presult)
@@ -1462,15 +2129,38 @@ LocalDb::select_range(SelectStatement *stmt, LocalCursor *begin,
   if (unlikely(!visitor.get()))
     return UPS_PARSER_ERROR;
 
+  // leaves which cannot match the predicate are skipped
+  ScopedPtr<PredicatePluginWrapper> range_plugin;
+  if (supports_range_predicate(this, stmt))
+    range_plugin.reset(new PredicatePluginWrapper(&config, stmt));
+
   Context context(lenv(this), 0, this);
+  context.shared = concurrent_reads;
 
   Result *result = new Result;
 
   // purge cache if necessary
-  lenv(this)->page_manager->purge_cache(&context);
+  if (!context.shared)
+    lenv(this)->page_manager->purge_cache(&context);
 
-  // create a cursor, move it to the first key
   ups_status_t st = 0;
+
+  // a full scan is split across several threads if the visitor can merge
+  // partial results, and if no transaction modified the Database
+  size_t threads = lenv(this)->query_thread_count();
+  if (context.shared && threads > 1 && !begin && !end
+        && visitor->is_mergeable()
+        && (!txn_index || txn_index->first() == 0)
+        && select_parallel(&context, this, stmt, visitor.get(),
+                range_plugin.get() != 0, threads, &st)) {
+    if (unlikely(st)) {
+      delete result;
+      return st;
+    }
+    goto bail;
+  }
+
+  // create a cursor, move it to the first key
   if (!cursor) {
     tmpcursor.reset(new LocalCursor(this, 0));
     cursor = tmpcursor.get();
@@ -1556,7 +2246,9 @@ LocalDb::select_range(SelectStatement *stmt, LocalCursor *begin,
     // no transactional data: the Btree will do the work. This is the
     // fastest code path
     if (use_cursors == false) {
-      node->scan(&context, visitor.get(), stmt, slot, stmt->distinct);
+      if (!range_plugin.get()
+            || leaf_can_match(&context, stmt, range_plugin.get(), node))
+        node->scan(&context, visitor.get(), stmt, slot, stmt->distinct);
       st = cursor->btree_cursor.move_to_next_page(&context);
       if (unlikely(st == UPS_KEY_NOT_FOUND))
         break;
@@ -29,6 +29,7 @@
 // is not sufficient because std::auto_ptr then fails to call the
 // destructor
 #include "2compressor/compressor.h"
+#include "2worker/worker.h"
 #include "3btree/btree_index.h"
 #include "4txn/txn_local.h"
 #include "4db/db.h"
@@ -56,7 +57,8 @@ struct LocalDb : public Db {
   // Constructor
   LocalDb(Env *env, DbConfig &config)
     : Db(env, config), compare_function(0), _current_record_number(0),
-      histogram(this) {
+      histogram(this), compaction_pending(false),
+      compaction_cancelled(false) {
   }
 
   // Creates a new database
@@ -92,6 +94,11 @@ struct LocalDb : public Db {
   virtual ups_status_t find(Cursor *cursor, Txn *txn, ups_key_t *key,
                   ups_record_t *record, uint32_t flags);
 
+  // Lookup of several keys (ups_db_find_many)
+  virtual ups_status_t find_many(Txn *txn, ups_key_t *keys,
+                  ups_record_t *records, ups_status_t *results,
+                  size_t count, uint32_t flags);
+
   // Moves a cursor, returns key and/or record (ups_cursor_move)
   virtual ups_status_t cursor_move(Cursor *cursor, ups_key_t *key,
                   ups_record_t *record, uint32_t flags);
@@ -106,6 +113,14 @@ struct LocalDb : public Db {
   virtual ups_status_t bulk_operations(Txn *txn, ups_operation_t *operations,
                   size_t operations_length, uint32_t flags);
 
+  // Loads sorted key/record pairs (ups_db_bulk_load)
+  virtual ups_status_t bulk_load(ups_bulk_load_func_t func, void *context,
+                  uint32_t fill_factor, uint32_t flags);
+
+  // Compacts the btree (ups_db_compact)
+  virtual ups_status_t compact(uint32_t max_pages, uint32_t max_milliseconds,
+                  uint32_t flags);
+
   // Closes the database (ups_db_close)
   virtual ups_status_t close(uint32_t flags);
 
@@ -134,6 +149,16 @@ struct LocalDb : public Db {
 
   // Lower/upper boundaries
   Histogram histogram;
+
+  // The thread for background compactions (ups_db_compact); created
+  // on demand
+  ScopedPtr<WorkerPool> compaction_worker;
+
+  // True while a background compaction is scheduled or running
+  boost::atomic<bool> compaction_pending;
+
+  // Set by close() to stop a running background compaction
+  boost::atomic<bool> compaction_cancelled;
 };
 
 } // namespace upscaledb
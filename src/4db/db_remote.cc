@@ -21,6 +21,7 @@
 #include "0root/root.h"
 
 #include <string.h>
+#include <vector>
 
 // Always verify that a file of level N does not include headers > N!
 #include "1base/scoped_ptr.h"
@@ -510,6 +511,45 @@ RemoteDb::bulk_operations(Txn *htxn, ups_operation_t *ops,
   return 0;
 }
 
+ups_status_t
+RemoteDb::find_many(Txn *txn, ups_key_t *keys, ups_record_t *records,
+                ups_status_t *results, size_t count, uint32_t)
+{
+  // the lookups are sent to the server as a single batch of operations
+  std::vector<ups_operation_t> ops(count);
+  for (size_t i = 0; i < count; i++) {
+    ops[i].type = UPS_OP_FIND;
+    ops[i].key = keys[i];
+    ops[i].record = records[i];
+    ops[i].flags = 0;
+  }
+
+  ups_status_t st = bulk_operations(txn, ops.data(), count, 0);
+  if (unlikely(st))
+    return st;
+
+  for (size_t i = 0; i < count; i++) {
+    results[i] = ops[i].result;
+    if (results[i] == 0)
+      records[i] = ops[i].record;
+  }
+  return 0;
+}
+
+ups_status_t
+RemoteDb::bulk_load(ups_bulk_load_func_t, void *, uint32_t, uint32_t)
+{
+  ups_trace(("ups_db_bulk_load is not supported for remote Databases"));
+  return UPS_NOT_IMPLEMENTED;
+}
+
+ups_status_t
+RemoteDb::compact(uint32_t, uint32_t, uint32_t)
+{
+  ups_trace(("ups_db_compact is not supported for remote Databases"));
+  return UPS_NOT_IMPLEMENTED;
+}
+
 ups_status_t
 RemoteDb::cursor_move(Cursor *hcursor, ups_key_t *key,
                 ups_record_t *record, uint32_t flags)
@@ -70,6 +70,11 @@ struct RemoteDb : public Db
   virtual ups_status_t find(Cursor *cursor, Txn *txn, ups_key_t *key,
                   ups_record_t *record, uint32_t flags);
 
+  // Lookup of several keys (ups_db_find_many)
+  virtual ups_status_t find_many(Txn *txn, ups_key_t *keys,
+                  ups_record_t *records, ups_status_t *results,
+                  size_t count, uint32_t flags);
+
   // Moves a cursor, returns key and/or record (ups_cursor_move)
   virtual ups_status_t cursor_move(Cursor *cursor, ups_key_t *key,
                   ups_record_t *record, uint32_t flags);
@@ -84,6 +89,14 @@ struct RemoteDb : public Db
   virtual ups_status_t bulk_operations(Txn *txn, ups_operation_t *operations,
                   size_t operations_length, uint32_t flags);
 
+  // Loads sorted key/record pairs (ups_db_bulk_load)
+  virtual ups_status_t bulk_load(ups_bulk_load_func_t func, void *context,
+                  uint32_t fill_factor, uint32_t flags);
+
+  // Compacts the btree (ups_db_compact)
+  virtual ups_status_t compact(uint32_t max_pages, uint32_t max_milliseconds,
+                  uint32_t flags);
+
   // Closes the database (ups_db_close)
   virtual ups_status_t close(uint32_t flags);
 
@@ -72,6 +72,13 @@ struct Histogram {
   // keys
   void reset_if_equal(ups_key_t *key);
 
+  // resets both stored keys. Used when the btree was modified without
+  // updating the histogram (i.e. by ups_db_bulk_load)
+  void reset() {
+    ::memset(&lower, 0, sizeof(lower));
+    ::memset(&upper, 0, sizeof(upper));
+  }
+
   // the database (used to fetch and compare keys)
   LocalDb *db;
 
@@ -95,7 +95,7 @@ Env::close(uint32_t flags)
 {
   ups_status_t st = 0;
 
-  ScopedLock lock(mutex);
+  ScopedWriteLock lock(mutex);
 
   /* auto-abort (or commit) all pending transactions */
   if (txn_manager.get()) {
@@ -132,4 +132,61 @@ Env::close(uint32_t flags)
   return do_close(flags);
 }
 
+// Purges the cache (under an exclusive lock) if an operation with a
+// shared lock exceeded the cache limits
+static inline void
+purge_cache_if_full(Env *env)
+{
+  if (unlikely(env->is_cache_full())) {
+    ScopedWriteLock lock(env->mutex);
+    try {
+      env->purge_cache();
+    }
+    catch (Exception &) {
+      // ignore; the next reader will try again
+    }
+  }
+}
+
+void
+ScopedEnvReadLock::unlock()
+{
+  if (!env_)
+    return;
+
+  Env *env = env_;
+  env_ = 0;
+
+  if (!shared_) {
+    env->mutex.unlock();
+    return;
+  }
+
+  if (!optimistic_)
+    env->write_mutex.unlock_shared();
+  env->mutex.unlock_shared();
+
+  purge_cache_if_full(env);
+}
+
+void
+ScopedEnvWriteLock::unlock()
+{
+  if (!env_)
+    return;
+
+  Env *env = env_;
+  env_ = 0;
+
+  if (!concurrent_) {
+    env->mutex.unlock();
+    return;
+  }
+
+  env->write_mutex.unlock();
+  env->mutex.unlock_shared();
+
+  purge_cache_if_full(env);
+}
+
 } // namespace upscaledb
@@ -91,6 +91,9 @@ struct Env
   // Accepted flags: UPS_FLUSH_BLOCKING
   virtual ups_status_t flush(uint32_t flags) = 0;
 
+  // Performs a checkpoint (ups_env_checkpoint)
+  virtual ups_status_t checkpoint(uint32_t flags) = 0;
+
   // Creates a new database in the environment (ups_env_create_db)
   Db *create_db(DbConfig &config, const ups_parameter_t *param);
 
@@ -123,6 +126,29 @@ struct Env
   virtual ups_status_t select_range(const char *query, Cursor *begin,
                           const Cursor *end, Result **result) = 0;
 
+  // Returns true if the cache exceeds its limits and should be purged
+  virtual bool is_cache_full() = 0;
+
+  // Purges the cache; requires exclusive access to the Environment
+  virtual void purge_cache() = 0;
+
+  // Returns the lsn of the newest commit which is not yet durable because
+  // its fsync was deferred (see UPS_ENABLE_GROUP_COMMIT); otherwise 0
+  virtual uint64_t pending_commit_lsn() = 0;
+
+  // Returns the lsn of the newest commit and of the newest durable commit
+  // (ups_env_get_commit_lsn)
+  virtual void get_commit_lsn(uint64_t *committed_lsn,
+                  uint64_t *durable_lsn) = 0;
+
+  // Writes buffered commits up to |lsn| to the journal; returns the lsn for
+  // wait_for_durable_lsn() or 0 if the commits are already durable
+  virtual uint64_t flush_commits(uint64_t lsn) = 0;
+
+  // Blocks till all commits up to |lsn| are durable. Must be called
+  // without holding the Environment's lock
+  virtual void wait_for_durable_lsn(uint64_t lsn) = 0;
+
   // Creates a new database in the environment (ups_env_create_db)
   virtual Db *do_create_db(DbConfig &config, const ups_parameter_t *param) = 0;
 
@@ -135,8 +161,14 @@ struct Env
   // Closes the Environment (ups_env_close)
   ups_status_t close(uint32_t flags);
 
-  // A mutex to serialize access to this Environment
-  Mutex mutex;
+  // A mutex to serialize access to this Environment; read-only operations
+  // acquire it in shared mode if UPS_ENABLE_CONCURRENT_READS is set
+  ReadWriteMutex mutex;
+
+  // Serializes modifications which share the |mutex| with optimistic
+  // readers (see ScopedEnvWriteLock). Shared readers which are not
+  // optimistic acquire it in shared mode. Always acquired after |mutex|.
+  ReadWriteMutex write_mutex;
 
   // The Environment's configuration
   EnvConfig config;
@@ -149,6 +181,114 @@ struct Env
   DatabaseMap _database_map;
 };
 
+//
+// Locks the Environment for a read-only operation. If |shared| is true
+// (see UPS_ENABLE_CONCURRENT_READS) then other readers can proceed in
+// parallel, otherwise the lock is exclusive.
+//
+// An |optimistic| reader can also run in parallel to the writers of a
+// ScopedEnvWriteLock; it must validate everything it reads (see
+// optimistic_lock.h). All other shared readers wait for these writers.
+//
+// Operations running under a shared lock do not purge the cache. Instead,
+// the cache is purged (under an exclusive lock) after the shared lock was
+// released, but only if the cache limits were exceeded.
+//
+struct ScopedEnvReadLock
+{
+  // Constructor; does not acquire the lock
+  ScopedEnvReadLock()
+    : env_(0), shared_(false), optimistic_(false) {
+  }
+
+  // Constructor; acquires the lock
+  ScopedEnvReadLock(Env *env, bool shared, bool optimistic = false)
+    : env_(0), shared_(false), optimistic_(false) {
+    lock(env, shared, optimistic);
+  }
+
+  // Destructor; releases the lock (if it's held)
+  ~ScopedEnvReadLock() {
+    unlock();
+  }
+
+  // Acquires the lock
+  void lock(Env *env, bool shared, bool optimistic = false) {
+    assert(env_ == 0);
+    if (shared) {
+      env->mutex.lock_shared();
+      if (!optimistic)
+        env->write_mutex.lock_shared();
+    }
+    else
+      env->mutex.lock();
+    env_ = env;
+    shared_ = shared;
+    optimistic_ = optimistic;
+  }
+
+  // Releases the lock, then purges the cache if necessary
+  void unlock();
+
+  // The locked Environment; null if the lock is not held
+  Env *env_;
+
+  // True if the lock is held in shared mode
+  bool shared_;
+
+  // True if the |write_mutex| is not held
+  bool optimistic_;
+};
+
+//
+// Locks the Environment for a modification. If |concurrent| is true then
+// the Environment's lock is shared with optimistic readers, and only the
+// writers are serialized. Otherwise the lock is exclusive.
+//
+// Like the shared readers, concurrent writers do not purge the cache while
+// they hold the lock.
+//
+struct ScopedEnvWriteLock
+{
+  // Constructor; does not acquire the lock
+  ScopedEnvWriteLock()
+    : env_(0), concurrent_(false) {
+  }
+
+  // Constructor; acquires the lock
+  ScopedEnvWriteLock(Env *env, bool concurrent)
+    : env_(0), concurrent_(false) {
+    lock(env, concurrent);
+  }
+
+  // Destructor; releases the lock (if it's held)
+  ~ScopedEnvWriteLock() {
+    unlock();
+  }
+
+  // Acquires the lock
+  void lock(Env *env, bool concurrent) {
+    assert(env_ == 0);
+    if (concurrent) {
+      env->mutex.lock_shared();
+      env->write_mutex.lock();
+    }
+    else
+      env->mutex.lock();
+    env_ = env;
+    concurrent_ = concurrent;
+  }
+
+  // Releases the lock, then purges the cache if necessary
+  void unlock();
+
+  // The locked Environment; null if the lock is not held
+  Env *env_;
+
+  // True if the lock is shared with optimistic readers
+  bool concurrent_;
+};
+
 } // namespace upscaledb
 
 #endif /* UPS_ENV_H */
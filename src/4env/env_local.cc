@@ -104,6 +104,18 @@ get_or_open_database(LocalEnv *env, uint16_t dbname, bool *is_opened)
   return (LocalDb *)it->second;
 }
 
+// Verifies the value of UPS_PARAM_INTERNAL_NODE_LAYOUT
+static inline int
+parse_node_layout(uint64_t value)
+{
+  if (unlikely(value != UPS_NODE_LAYOUT_SORTED
+                && value != UPS_NODE_LAYOUT_BTREE)) {
+    ups_trace(("invalid value for UPS_PARAM_INTERNAL_NODE_LAYOUT"));
+    throw Exception(UPS_INV_PARAMETER);
+  }
+  return (int)value;
+}
+
 // Sets the dirty-flag of the header page and adds the header page
 // to the Changeset (if recovery is enabled)
 static inline void
@@ -243,6 +255,15 @@ LocalEnv::open()
       goto fail_with_fake_cleansing;
     }
 
+    // direct I/O requires pages which are aligned to the file system blocks
+    if (unlikely(ISSET(config.flags, UPS_ENABLE_DIRECT_IO)
+          && config.page_size_bytes % File::kDirectIoAlignment != 0)) {
+      ups_trace(("UPS_ENABLE_DIRECT_IO requires a page size which is a "
+              "multiple of %u", (unsigned)File::kDirectIoAlignment));
+      st = UPS_INV_PARAMETER;
+      goto fail_with_fake_cleansing;
+    }
+
     st = 0;
 
 fail_with_fake_cleansing:
@@ -347,6 +368,21 @@ LocalEnv::get_parameters(ups_parameter_t *param)
       case UPS_PARAM_POSIX_FADVISE:
         p->value = config.posix_advice;
         break;
+      case UPS_PARAM_CACHE_POLICY:
+        p->value = config.cache_policy;
+        break;
+      case UPS_PARAM_QUERY_THREADS:
+        p->value = config.query_threads;
+        break;
+      case UPS_PARAM_CHECKPOINT_LOG_SIZE:
+        p->value = config.checkpoint_log_size;
+        break;
+      case UPS_PARAM_CHECKPOINT_INTERVAL_SEC:
+        p->value = config.checkpoint_interval_sec;
+        break;
+      case UPS_PARAM_JOURNAL_SEGMENT_SIZE:
+        p->value = config.journal_segment_size;
+        break;
       default:
         ups_trace(("unknown parameter %d", (int)p->name));
         return (UPS_INV_PARAMETER);
@@ -379,6 +415,83 @@ LocalEnv::flush(uint32_t flags)
   return 0;
 }
 
+ups_status_t
+LocalEnv::checkpoint(uint32_t)
+{
+  if (ISSETANY(this->flags(), UPS_IN_MEMORY | UPS_READ_ONLY))
+    return 0;
+
+  uint64_t start = os_now_usec();
+  Context context(this, 0, 0);
+
+  /* flush all committed transactions */
+  if (likely(txn_manager.get() != 0))
+    txn_manager->flush_committed_txns(&context);
+
+  /* the remaining transactions are either active, or committed but not
+   * yet flushed because an older transaction is still active. The journal
+   * files with the operations of the committed transactions are retained */
+  uint64_t oldest_lsn = 0;
+  uint32_t keep_files = 0;
+  if (txn_manager.get() != 0) {
+    for (Txn *t = txn_manager->oldest_txn(); t != 0; t = t->next()) {
+      LocalTxn *txn = (LocalTxn *)t;
+      if (oldest_lsn == 0)
+        oldest_lsn = txn->lsn;
+      if (txn->is_committed())
+        keep_files |= 1 << txn->log_descriptor;
+    }
+  }
+
+  /* write all modified pages, then make them durable */
+  std::vector<uint64_t> page_ids;
+  page_manager->flush_dirty_pages(&page_ids);
+  device->flush();
+
+  /* the changesets before the checkpoint are no longer required for
+   * the recovery */
+  if (journal)
+    journal->append_checkpoint(lsn_manager.next(), oldest_lsn, page_ids,
+                    keep_files);
+
+  last_checkpoint_usec = os_now_usec();
+  uint64_t usec = last_checkpoint_usec - start;
+  checkpoint_count++;
+  checkpoint_total_usec += usec;
+  if (usec > checkpoint_max_usec)
+    checkpoint_max_usec = usec;
+  return 0;
+}
+
+void
+LocalEnv::checkpoint_maybe()
+{
+  if (likely(!journal || (config.checkpoint_log_size == 0
+                            && config.checkpoint_interval_sec == 0)))
+    return;
+
+  // nothing to do if the journal did not grow
+  uint64_t bytes = journal->bytes_since_checkpoint();
+  if (bytes == 0)
+    return;
+
+  if ((config.checkpoint_log_size != 0
+            && bytes >= config.checkpoint_log_size)
+      || (config.checkpoint_interval_sec != 0
+            && os_now_usec() - last_checkpoint_usec
+                  >= config.checkpoint_interval_sec * 1000000ull)) {
+    // the commit was already successful; a failing checkpoint is
+    // repeated with the next commit
+    try {
+      checkpoint(0);
+    }
+    catch (Exception &ex) {
+      ups_log(("checkpoint failed w/ error %d (%s)", ex.code,
+                              ups_strerror(ex.code)));
+    }
+  }
+}
+
 ups_status_t
 LocalEnv::select_range(const char *query, Cursor *begin,
                             const Cursor *end, Result **result)
@@ -476,6 +589,9 @@ LocalEnv::do_create_db(DbConfig &dbconfig, const ups_parameter_t *param)
         case UPS_PARAM_CUSTOM_COMPARE_NAME:
           dbconfig.compare_name = reinterpret_cast<const char *>(param->value);
           break;
+        case UPS_PARAM_INTERNAL_NODE_LAYOUT:
+          dbconfig.internal_node_layout = parse_node_layout(param->value);
+          break;
         default:
           ups_trace(("invalid parameter 0x%x (%d)", param->name, param->name));
           throw Exception(UPS_INV_PARAMETER);
@@ -623,6 +739,9 @@ LocalEnv::do_open_db(DbConfig &dbconfig, const ups_parameter_t *param)
           ups_trace(("Key compression parameters are only allowed in "
                      "ups_env_create_db"));
           throw Exception(UPS_INV_PARAMETER);
+        case UPS_PARAM_INTERNAL_NODE_LAYOUT:
+          dbconfig.internal_node_layout = parse_node_layout(param->value);
+          break;
         default:
           ups_trace(("invalid parameter 0x%x (%d)", param->name, param->name));
           throw Exception(UPS_INV_PARAMETER);
@@ -766,9 +885,15 @@ LocalEnv::txn_begin(const char *name, uint32_t flags)
 }
 
 ups_status_t
-LocalEnv::txn_commit(Txn *txn, uint32_t)
+LocalEnv::txn_commit(Txn *txn, uint32_t flags)
 {
-  return txn_manager->commit(txn);
+  // the Journal checks the Txn flags when appending the commit
+  txn->flags &= ~UPS_TXN_ASYNC_COMMIT;
+  txn->flags |= flags & UPS_TXN_ASYNC_COMMIT;
+  ups_status_t st = txn_manager->commit(txn);
+  if (likely(st == 0))
+    checkpoint_maybe();
+  return st;
 }
 
 ups_status_t
@@ -782,6 +907,9 @@ LocalEnv::do_close(uint32_t flags)
 {
   Context context(this);
 
+  /* stop the threads for parallel queries */
+  query_pool.reset();
+
   /* flush all committed transactions */
   if (likely(txn_manager.get() != 0))
     txn_manager->flush_committed_txns(&context);
@@ -823,6 +951,10 @@ LocalEnv::fill_metrics(ups_env_metrics_t *metrics)
   // the Journal (if available)
   if (journal)
     journal->fill_metrics(metrics);
+  // the checkpoints
+  metrics->checkpoint_count = checkpoint_count;
+  metrics->checkpoint_total_usec = checkpoint_total_usec;
+  metrics->checkpoint_max_usec = checkpoint_max_usec;
   // the (first) database
   if (!_database_map.empty()) {
     LocalDb *db = (LocalDb *)_database_map.begin()->second;
@@ -832,4 +964,66 @@ LocalEnv::fill_metrics(ups_env_metrics_t *metrics)
   BtreeIndex::fill_metrics(metrics);
 }
 
+size_t
+LocalEnv::query_thread_count() const
+{
+  if (config.query_threads)
+    return config.query_threads;
+  return std::max(1u, boost::thread::hardware_concurrency());
+}
+
+WorkerPool *
+LocalEnv::query_workers()
+{
+  ScopedLock lock(query_mutex);
+  // the calling thread scans one of the ranges
+  if (!query_pool)
+    query_pool.reset(new WorkerPool(query_thread_count() - 1));
+  return query_pool.get();
+}
+
+bool
+LocalEnv::is_cache_full()
+{
+  return page_manager->is_cache_full();
+}
+
+void
+LocalEnv::purge_cache()
+{
+  Context context(this);
+  page_manager->purge_cache(&context);
+}
+
+uint64_t
+LocalEnv::pending_commit_lsn()
+{
+  return journal.get() ? journal->pending_commit_lsn() : 0;
+}
+
+void
+LocalEnv::get_commit_lsn(uint64_t *committed_lsn, uint64_t *durable_lsn)
+{
+  if (journal.get()) {
+    journal->get_commit_lsn(committed_lsn, durable_lsn);
+  }
+  else {
+    *committed_lsn = 0;
+    *durable_lsn = 0;
+  }
+}
+
+uint64_t
+LocalEnv::flush_commits(uint64_t lsn)
+{
+  return journal.get() ? journal->flush_commits(lsn) : 0;
+}
+
+void
+LocalEnv::wait_for_durable_lsn(uint64_t lsn)
+{
+  if (journal.get())
+    journal->wait_for_durable_lsn(lsn);
+}
+
 } // namespace upscaledb
@@ -24,9 +24,12 @@
 #include "0root/root.h"
 
 // Always verify that a file of level N does not include headers > N!
+#include "1base/mutex.h"
 #include "1base/scoped_ptr.h"
+#include "1os/os.h"
 #include "2lsn_manager/lsn_manager.h"
 #include "2device/device.h"
+#include "2worker/worker.h"
 #include "3journal/journal.h"
 #include "3blob_manager/blob_manager.h"
 #include "3page_manager/page_manager.h"
@@ -50,7 +53,8 @@ struct LocalTxn;
 struct LocalEnv : public Env
 {
   LocalEnv(EnvConfig &config)
-    : Env(config) {
+    : Env(config), checkpoint_count(0), checkpoint_total_usec(0),
+      checkpoint_max_usec(0), last_checkpoint_usec(os_now_usec()) {
   }
 
   // Creates a new Environment (ups_env_create)
@@ -74,6 +78,13 @@ struct LocalEnv : public Env
   // Flushes the environment and its databases to disk (ups_env_flush)
   virtual ups_status_t flush(uint32_t flags);
 
+  // Performs a checkpoint (ups_env_checkpoint)
+  virtual ups_status_t checkpoint(uint32_t flags);
+
+  // Performs a checkpoint if UPS_PARAM_CHECKPOINT_LOG_SIZE or
+  // UPS_PARAM_CHECKPOINT_INTERVAL_SEC are exceeded
+  void checkpoint_maybe();
+
   // Begins a new transaction (ups_txn_begin)
   virtual Txn *txn_begin(const char *name, uint32_t flags);
 
@@ -97,6 +108,31 @@ struct LocalEnv : public Env
   virtual ups_status_t select_range(const char *query, Cursor *begin,
                           const Cursor *end, Result **result);
 
+  // Returns the number of threads which scan a Database for a UQI query
+  size_t query_thread_count() const;
+
+  // Returns the worker threads for parallel UQI queries; they are
+  // started on demand
+  WorkerPool *query_workers();
+
+  // Returns true if the cache exceeds its limits and should be purged
+  virtual bool is_cache_full();
+
+  // Purges the cache; requires exclusive access to the Environment
+  virtual void purge_cache();
+
+  // Returns the lsn of the newest commit which is not yet durable
+  virtual uint64_t pending_commit_lsn();
+
+  // Returns the lsn of the newest commit and of the newest durable commit
+  virtual void get_commit_lsn(uint64_t *committed_lsn, uint64_t *durable_lsn);
+
+  // Writes buffered commits up to |lsn| to the journal
+  virtual uint64_t flush_commits(uint64_t lsn);
+
+  // Blocks till all commits up to |lsn| are durable
+  virtual void wait_for_durable_lsn(uint64_t lsn);
+
   // Closes the Environment (ups_env_close)
   virtual ups_status_t do_close(uint32_t flags);
 
@@ -117,6 +153,21 @@ struct LocalEnv : public Env
 
   // The lsn manager
   LsnManager lsn_manager;
+
+  // The worker threads for parallel UQI queries
+  ScopedPtr<WorkerPool> query_pool;
+
+  // Protects |query_pool|
+  Mutex query_mutex;
+
+  // Checkpoints: the number of checkpoints and their durations (for
+  // ups_env_get_metrics)
+  uint64_t checkpoint_count;
+  uint64_t checkpoint_total_usec;
+  uint64_t checkpoint_max_usec;
+
+  // Checkpoints: the time of the last checkpoint, in microseconds
+  uint64_t last_checkpoint_usec;
 };
 
 } // namespace upscaledb
@@ -330,6 +330,12 @@ RemoteEnv::flush(uint32_t flags)
   return reply->env_flush_reply().status();
 }
 
+ups_status_t
+RemoteEnv::checkpoint(uint32_t flags)
+{
+  throw Exception(UPS_NOT_IMPLEMENTED);
+}
+
 Db *
 RemoteEnv::do_create_db(DbConfig &config, const ups_parameter_t *param)
 {
@@ -505,6 +511,41 @@ RemoteEnv::fill_metrics(ups_env_metrics_t *metrics)
   throw Exception(UPS_NOT_IMPLEMENTED);
 }
 
+bool
+RemoteEnv::is_cache_full()
+{
+  return false;
+}
+
+void
+RemoteEnv::purge_cache()
+{
+}
+
+uint64_t
+RemoteEnv::pending_commit_lsn()
+{
+  return 0;
+}
+
+void
+RemoteEnv::get_commit_lsn(uint64_t *committed_lsn, uint64_t *durable_lsn)
+{
+  *committed_lsn = 0;
+  *durable_lsn = 0;
+}
+
+uint64_t
+RemoteEnv::flush_commits(uint64_t)
+{
+  return 0;
+}
+
+void
+RemoteEnv::wait_for_durable_lsn(uint64_t)
+{
+}
+
 } // namespace upscaledb
 
 #endif // UPS_ENABLE_REMOTE
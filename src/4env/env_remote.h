@@ -69,6 +69,9 @@ struct RemoteEnv : public Env
   // Flushes the environment and its databases to disk (ups_env_flush)
   virtual ups_status_t flush(uint32_t flags);
 
+  // Performs a checkpoint (ups_env_checkpoint); not supported
+  virtual ups_status_t checkpoint(uint32_t flags);
+
   // Begins a new transaction (ups_txn_begin)
   virtual Txn *txn_begin(const char *name, uint32_t flags);
 
@@ -92,6 +95,24 @@ struct RemoteEnv : public Env
   virtual ups_status_t select_range(const char *query, Cursor *begin,
                           const Cursor *end, Result **result);
 
+  // Returns true if the cache exceeds its limits and should be purged
+  virtual bool is_cache_full();
+
+  // Purges the cache; requires exclusive access to the Environment
+  virtual void purge_cache();
+
+  // Returns the lsn of the newest commit which is not yet durable
+  virtual uint64_t pending_commit_lsn();
+
+  // Returns the lsn of the newest commit and of the newest durable commit
+  virtual void get_commit_lsn(uint64_t *committed_lsn, uint64_t *durable_lsn);
+
+  // Writes buffered commits up to |lsn| to the journal
+  virtual uint64_t flush_commits(uint64_t lsn);
+
+  // Blocks till all commits up to |lsn| are durable
+  virtual void wait_for_durable_lsn(uint64_t lsn);
+
   // Creates a new database in the environment (ups_env_create_db)
   virtual Db *do_create_db(DbConfig &config, const ups_parameter_t *param);
 
@@ -18,6 +18,8 @@
 
 #include "0root/root.h"
 
+#include <limits>
+
 // Always verify that a file of level N does not include headers > N!
 #include "3btree/btree_index.h"
 #include "3journal/journal.h"
@@ -87,6 +89,20 @@ count_flushable_transactions(LocalTxnManager *tm)
   return to_flush;
 }
 
+// Returns the oldest snapshot of all active read-only transactions, or
+// UINT64_MAX if there is none
+static inline uint64_t
+oldest_snapshot_id(LocalTxnManager *tm)
+{
+  LocalTxn *txn = (LocalTxn *)tm->oldest_txn();
+  for (; txn; txn = (LocalTxn *)txn->next()) {
+    if (ISSET(txn->flags, UPS_TXN_READ_ONLY)
+          && !txn->is_committed() && !txn->is_aborted())
+      return txn->snapshot_id;
+  }
+  return std::numeric_limits<uint64_t>::max();
+}
+
 static inline void
 flush_committed_txns_impl(LocalTxnManager *tm, Context *context)
 {
@@ -95,10 +111,17 @@ flush_committed_txns_impl(LocalTxnManager *tm, Context *context)
 
   assert(context->changeset.is_empty());
 
+  // transactions which were committed after an active read-only
+  // transaction began must stay in the TxnIndex; otherwise the snapshot
+  // would see their changes in the btree
+  uint64_t snapshot_id = oldest_snapshot_id(tm);
+
   // always get the oldest transaction; if it was committed: flush
   // it; if it was aborted: discard it; otherwise return
   while ((oldest = (LocalTxn *)tm->oldest_txn())) {
     if (oldest->is_committed()) {
+      if (unlikely(oldest->commit_id > snapshot_id))
+        break;
       uint64_t lsn = tm->flush_txn_to_changeset(context, (LocalTxn *)oldest);
       if (lsn > highest_lsn)
         highest_lsn = lsn;
@@ -317,11 +340,13 @@ flush_transaction_to_journal(LocalTxn *txn)
 }
 
 LocalTxn::LocalTxn(LocalEnv *env, const char *name, uint32_t flags)
-  : Txn(env, name, flags), log_descriptor(0), oldest_op(0), newest_op(0)
+  : Txn(env, name, flags), log_descriptor(0), commit_id(0), oldest_op(0),
+    newest_op(0)
 {
   LocalTxnManager *ltm = (LocalTxnManager *)env->txn_manager.get();
   id = ltm->incremented_txn_id();
   lsn = env->lsn_manager.next();
+  snapshot_id = ltm->_commit_id;
 }
 
 LocalTxn::~LocalTxn()
@@ -494,7 +519,7 @@ struct KeyCounter : TxnIndex::Visitor {
                     op != 0;
                     op = op->previous_in_node) {
       LocalTxn *optxn = op->txn;
-      if (optxn->is_aborted())
+      if (optxn->is_aborted() || is_hidden_from_snapshot(txn, optxn))
         continue;
 
       if (optxn->is_committed() || txn == optxn) {
@@ -578,6 +603,7 @@ LocalTxnManager::commit(Txn *htxn)
 
   try {
     txn->commit();
+    txn->commit_id = incremented_commit_id();
 
     // if this transaction can NOT be flushed immediately then write its
     // operations to the journal; otherwise skip this step
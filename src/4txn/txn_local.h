@@ -267,6 +267,12 @@ struct LocalTxn : Txn {
   // the lsn of the "txn begin" operation
   uint64_t lsn;
 
+  // the commit sequence number; assigned when the Txn is committed
+  uint64_t commit_id;
+
+  // read-only Txns only see Txns with a commit_id <= snapshot_id
+  uint64_t snapshot_id;
+
   // the linked list of operations - head is oldest operation
   TxnOperation *oldest_op;
 
@@ -275,13 +281,26 @@ struct LocalTxn : Txn {
 };
 
 
+// Returns true if the operations of |optxn| are invisible to |txn|. This is
+// the case if |txn| is read-only and |optxn| was not yet committed when
+// |txn| began. Read-only Txns therefore never see uncommitted data and
+// never run into conflicts.
+static inline bool
+is_hidden_from_snapshot(const LocalTxn *txn, const LocalTxn *optxn)
+{
+  if (likely(!txn || NOTSET(txn->flags, UPS_TXN_READ_ONLY)))
+    return false;
+  return !optxn->is_committed() || optxn->commit_id > txn->snapshot_id;
+}
+
+
 //
 // A TxnManager for local Txns
 //
 struct LocalTxnManager : TxnManager {
   // Constructor
   LocalTxnManager(Env *env)
-    : TxnManager(env), _txn_id(0) {
+    : TxnManager(env), _txn_id(0), _commit_id(0) {
   }
 
   // Begins a new Txn
@@ -303,6 +322,11 @@ struct LocalTxnManager : TxnManager {
     return ++_txn_id;
   }
 
+  // Increments the commit sequence number and returns the new value
+  uint64_t incremented_commit_id() {
+    return ++_commit_id;
+  }
+
   // Sets the global transaction ID. Used by the journal during recovery.
   void set_txn_id(uint64_t id) {
     _txn_id = id;
@@ -319,6 +343,9 @@ struct LocalTxnManager : TxnManager {
 
   // The current transaction ID
   uint64_t _txn_id;
+
+  // The sequence number of the most recent commit
+  uint64_t _commit_id;
 };
 
 } // namespace upscaledb
@@ -80,6 +80,29 @@ struct AverageScanVisitor : public NumericalScanVisitor
     count += length;
   }
 
+  // Only the sum of the keys is required
+  virtual bool accepts_key_sum() const {
+    return ISSET(statement->function.flags, UQI_STREAM_KEY);
+  }
+
+  // Operates on a compressed block of uint32 keys
+  virtual void visit_key_sum(uint64_t key_sum, size_t key_count) {
+    sum += key_sum;
+    count += key_count;
+  }
+
+  // The partial results can be merged
+  virtual bool is_mergeable() const {
+    return true;
+  }
+
+  // Adds the sum and the counter of |other|
+  virtual void merge(ScanVisitor *other) {
+    AverageScanVisitor *o = static_cast<AverageScanVisitor *>(other);
+    sum += o->sum;
+    count += o->count;
+  }
+
   // Assigns the result to |result|
   virtual void assign_result(uqi_result_t *result) {
     double avg = sum / (double)count;
@@ -156,6 +179,18 @@ struct AverageIfScanVisitor : public NumericalScanVisitor
     }
   }
 
+  // The partial results can be merged
+  virtual bool is_mergeable() const {
+    return true;
+  }
+
+  // Adds the sum and the counter of |other|
+  virtual void merge(ScanVisitor *other) {
+    AverageIfScanVisitor *o = static_cast<AverageIfScanVisitor *>(other);
+    sum += o->sum;
+    count += o->count;
+  }
+
   // Assigns the result to |result|
   virtual void assign_result(uqi_result_t *result) {
     double avg = sum / (double)count;
@@ -54,6 +54,23 @@ struct CountScanVisitor : public ScanVisitor
     count += length;
   }
 
+  // Operates on a compressed block; the keys are not required
+  virtual bool visit_compressed_block(uint32_t first_key, uint32_t last_key,
+                  const void *record_array, size_t length) {
+    count += length;
+    return true;
+  }
+
+  // The partial results can be merged
+  virtual bool is_mergeable() const {
+    return true;
+  }
+
+  // Adds the counter of |other|
+  virtual void merge(ScanVisitor *other) {
+    count += static_cast<CountScanVisitor *>(other)->count;
+  }
+
   // Assigns the result to |result|
   virtual void assign_result(uqi_result_t *result) {
     uqi_result_initialize(result, UPS_TYPE_BINARY, UPS_TYPE_UINT64);
@@ -84,7 +101,7 @@ struct CountIfScanVisitor : public ScanVisitor
   };
 
   CountIfScanVisitor(const DbConfig *dbconf, SelectStatement *stmt)
-    : count(0), plugin(dbconf, stmt) {
+    : ScanVisitor(stmt), count(0), plugin(dbconf, stmt) {
     key_size = dbconf->key_size;
     record_size = dbconf->record_size;
   }
@@ -114,6 +131,16 @@ struct CountIfScanVisitor : public ScanVisitor
     }
   }
 
+  // The partial results can be merged
+  virtual bool is_mergeable() const {
+    return true;
+  }
+
+  // Adds the counter of |other|
+  virtual void merge(ScanVisitor *other) {
+    count += static_cast<CountIfScanVisitor *>(other)->count;
+  }
+
   // Assigns the result to |result|
   virtual void assign_result(uqi_result_t *result) {
     uqi_result_initialize(result, UPS_TYPE_BINARY, UPS_TYPE_UINT64);
@@ -60,6 +60,25 @@ struct MinMaxScanVisitorBase : public NumericalScanVisitor
     other.copy((const uint8_t *)data, size);
   }
 
+  // Adopts the minimum (or maximum) of |o| if |kcmp| (or |rcmp|) prefers
+  // it over the current value
+  template<typename KeyCompare, typename RecordCompare>
+  void merge_value(MinMaxScanVisitorBase *o, KeyCompare kcmp,
+                  RecordCompare rcmp) {
+    if (ISSET(statement->function.flags, UQI_STREAM_KEY)) {
+      if (kcmp(o->key.value, key.value)) {
+        key = o->key;
+        copy_value(o->other.data(), o->other.size());
+      }
+    }
+    else {
+      if (rcmp(o->record.value, record.value)) {
+        record = o->record;
+        copy_value(o->other.data(), o->other.size());
+      }
+    }
+  }
+
   // The current minimum/maximum key
   Key key;
 
@@ -133,6 +152,38 @@ struct MinMaxScanVisitor : public MinMaxScanVisitorBase<Key, Record> {
       }
     }
   }
+
+  // The partial results can be merged
+  virtual bool is_mergeable() const {
+    return true;
+  }
+
+  // Adopts the minimum (or maximum) of |other|
+  virtual void merge(ScanVisitor *other) {
+    P::merge_value(static_cast<P *>(other), Compare<typename Key::type>(),
+                    Compare<typename Record::type>());
+  }
+
+  // Operates on a compressed block of sorted keys; only its first
+  // (for MIN) or last (for MAX) key is a candidate
+  virtual bool visit_compressed_block(uint32_t first_key, uint32_t last_key,
+                  const void *record_data, size_t length) {
+    if (NOTSET(P::statement->function.flags, UQI_STREAM_KEY) || !record_data)
+      return false;
+
+    Compare<typename Key::type> cmp;
+    typename Key::type first = (typename Key::type)first_key;
+    typename Key::type last = (typename Key::type)last_key;
+    size_t i = cmp(last, first) ? length - 1 : 0;
+    typename Key::type value = i == 0 ? first : last;
+    if (cmp(value, P::key.value)) {
+      typename Sequence<Record>::iterator rit
+              = Sequence<Record>(record_data, length).begin() + i;
+      P::key = value;
+      P::copy_value(&rit->value, rit->size());
+    }
+    return true;
+  }
 };
 
 template<typename Key, typename Record>
@@ -233,6 +284,17 @@ struct MinMaxIfScanVisitor : public MinMaxScanVisitorBase<Key, Record> {
     }
   }
 
+  // The partial results can be merged
+  virtual bool is_mergeable() const {
+    return true;
+  }
+
+  // Adopts the minimum (or maximum) of |other|
+  virtual void merge(ScanVisitor *other) {
+    P::merge_value(static_cast<P *>(other), Compare<typename Key::type>(),
+                    Compare<typename Record::type>());
+  }
+
   PredicatePluginWrapper plugin;
 };
 
@@ -72,6 +72,11 @@ struct PredicatePluginWrapper : PluginWrapperBase
                   const void *record_data, uint32_t record_size) {
     return plugin->pred(state, key_data, key_size, record_data, record_size);
   }
+
+  // Returns false if no value in [min_data, max_data] can match
+  bool range_pred(const void *min_data, const void *max_data, uint32_t size) {
+    return plugin->range_pred(state, min_data, max_data, size);
+  }
 };
 
 struct AggregatePluginWrapper : PluginWrapperBase
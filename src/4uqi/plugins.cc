@@ -20,6 +20,7 @@
 
 #include <string>
 #include <map>
+#include <cstddef>
 #include <vector>
 #ifdef WIN32
 #  include <windows.h>
@@ -128,12 +129,19 @@ PluginManager::import(const char *library, const char *plugin_name)
 ups_status_t
 PluginManager::add(uqi_plugin_t *plugin)
 {
-  if (plugin->plugin_version != 0) {
-    ups_log(("Failed to load plugin %s: invalid version (%d != %d)",
-            plugin->name, 0, plugin->plugin_version));
+  if (plugin->plugin_version > 1) {
+    ups_log(("Failed to load plugin %s: invalid version (%d > %d)",
+            plugin->name, plugin->plugin_version, 1));
     return UPS_PLUGIN_NOT_FOUND;
   }
 
+  // version 0 descriptors end before |range_pred|
+  uqi_plugin_t copy = {0};
+  if (plugin->plugin_version == 0)
+    ::memcpy(&copy, plugin, offsetof(uqi_plugin_t, range_pred));
+  else
+    copy = *plugin;
+
   switch (plugin->type) {
     case UQI_PLUGIN_PREDICATE:
       if (!plugin->pred) {
@@ -161,7 +169,7 @@ PluginManager::add(uqi_plugin_t *plugin)
   }
 
   ScopedLock lock(mutex);
-  plugins.insert(PluginMap::value_type(plugin->name, *plugin));
+  plugins.insert(PluginMap::value_type(plugin->name, copy));
   return 0;
 }
 
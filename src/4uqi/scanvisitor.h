@@ -61,6 +61,38 @@ struct ScanVisitor
   virtual void operator()(const void *key_array, const void *record_array,
                   size_t key_count) = 0;
 
+  // Operates on a compressed block of |key_count| sorted uint32 keys,
+  // of which only the first and the last key are known. |record_array|
+  // contains the records of these keys, or is null if the records are
+  // not required. Returns false if the visitor requires the decompressed
+  // keys; they are then passed to the operator above.
+  virtual bool visit_compressed_block(uint32_t first_key, uint32_t last_key,
+                  const void *record_array, size_t key_count) {
+    return false;
+  }
+
+  // Returns true if the visitor only requires the sum of the keys, i.e.
+  // if visit_key_sum() can replace the operator above
+  virtual bool accepts_key_sum() const {
+    return false;
+  }
+
+  // Operates on a compressed block of |key_count| uint32 keys, of which
+  // only the sum is known. Only called if accepts_key_sum() is true.
+  virtual void visit_key_sum(uint64_t key_sum, size_t key_count) {
+  }
+
+  // Returns true if the partial results of several visitors can be
+  // combined with merge(). Only then the scan is split across threads.
+  virtual bool is_mergeable() const {
+    return false;
+  }
+
+  // Adds the partial result of |other|, which was created by the same
+  // factory and visited the keys following the keys of this visitor
+  virtual void merge(ScanVisitor *other) {
+  }
+
   // Assigns the internal result to |result|
   virtual void assign_result(uqi_result_t *result) = 0;
 
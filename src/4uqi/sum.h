@@ -76,6 +76,26 @@ struct SumScanVisitor : public NumericalScanVisitor {
     }
   }
 
+  // Only the sum of the keys is required
+  virtual bool accepts_key_sum() const {
+    return ISSET(statement->function.flags, UQI_STREAM_KEY);
+  }
+
+  // Operates on a compressed block of uint32 keys
+  virtual void visit_key_sum(uint64_t key_sum, size_t key_count) {
+    sum += key_sum;
+  }
+
+  // The partial results can be merged
+  virtual bool is_mergeable() const {
+    return true;
+  }
+
+  // Adds the sum of |other|
+  virtual void merge(ScanVisitor *other) {
+    sum += static_cast<SumScanVisitor *>(other)->sum;
+  }
+
   // Assigns the result to |result|
   virtual void assign_result(uqi_result_t *result) {
     uqi_result_initialize(result, UPS_TYPE_BINARY, UpsResultType);
@@ -183,6 +203,16 @@ struct SumIfScanVisitor : public NumericalScanVisitor {
     }
   }
 
+  // The partial results can be merged
+  virtual bool is_mergeable() const {
+    return true;
+  }
+
+  // Adds the sum of |other|
+  virtual void merge(ScanVisitor *other) {
+    sum += static_cast<SumIfScanVisitor *>(other)->sum;
+  }
+
   // Assigns the result to |result|
   virtual void assign_result(uqi_result_t *result) {
     uqi_result_initialize(result, UPS_TYPE_BINARY, UpsResultType);
@@ -77,6 +77,27 @@ struct TopScanVisitorBase : public NumericalScanVisitor {
       statement->limit = 1;
   }
 
+  // The partial results can be merged
+  virtual bool is_mergeable() const {
+    return true;
+  }
+
+  // Adds the values of |other|; only the largest values are kept
+  virtual void merge(ScanVisitor *other) {
+    TopScanVisitorBase *o = static_cast<TopScanVisitorBase *>(other);
+
+    for (typename KeyMap::iterator it = o->stored_keys.begin();
+                    it != o->stored_keys.end(); it++)
+      min_key = store_min_value(it->first, min_key,
+                      it->second.data(), it->second.size(),
+                      stored_keys, statement->limit);
+    for (typename RecordMap::iterator it = o->stored_records.begin();
+                    it != o->stored_records.end(); it++)
+      min_record = store_min_value(it->first, min_record,
+                      it->second.data(), it->second.size(),
+                      stored_records, statement->limit);
+  }
+
   // Assigns the result to |result|
   virtual void assign_result(uqi_result_t *result) {
     uqi_result_initialize(result, key_type, record_type);
@@ -22,7 +22,9 @@
 
 // Always verify that a file of level N does not include headers > N!
 #include "1base/error.h"
+#include "4db/db.h"
 #include "4env/env.h"
+#include "4uqi/parser.h"
 #include "4uqi/plugins.h"
 #include "4uqi/result.h"
 #include "4uqi/scanvisitor.h"
@@ -120,6 +122,19 @@ uqi_select(ups_env_t *env, const char *query, uqi_result_t **result)
   return uqi_select_range(env, query, 0, 0, result);
 }
 
+// Returns true if |query| can run concurrently with other readers, i.e. if
+// the Database is already open and supports concurrent reads
+static bool
+is_concurrent_query(Env *env, const char *query)
+{
+  SelectStatement stmt;
+  if (Parser::parse_select(query, stmt) != 0)
+    return false;
+
+  Env::DatabaseMap::iterator it = env->_database_map.find(stmt.dbid);
+  return it != env->_database_map.end() && it->second->concurrent_reads;
+}
+
 UPS_EXPORT ups_status_t UPS_CALLCONV
 uqi_select_range(ups_env_t *henv, const char *query, ups_cursor_t *begin,
                     const ups_cursor_t *end, uqi_result_t **result)
@@ -138,9 +153,22 @@ uqi_select_range(ups_env_t *henv, const char *query, ups_cursor_t *begin,
   }
 
   Env *env = (Env *)henv;
-  ScopedLock lock(env->mutex);
 
   try {
+    // the query shares the lock with other readers if possible; otherwise
+    // (i.e. if the Database is opened on the fly) it requires exclusive
+    // access
+    ScopedEnvReadLock lock;
+    if (ISSET(env->flags(), UPS_ENABLE_CONCURRENT_READS)) {
+      lock.lock(env, true);
+      if (!is_concurrent_query(env, query)) {
+        lock.unlock();
+        lock.lock(env, false);
+      }
+    }
+    else
+      lock.lock(env, false);
+
     return env->select_range(query,
                         (upscaledb::Cursor *)begin,
                         (upscaledb::Cursor *)end,
@@ -28,6 +28,7 @@
 #include "1base/dynamic_array.h"
 #include "1globals/callbacks.h"
 #include "1mem/mem.h"
+#include "1os/file.h"
 #include "2config/db_config.h"
 #include "2config/env_config.h"
 #include "2page/page.h"
@@ -134,9 +135,9 @@ ups_txn_begin(ups_txn_t **htxn, ups_env_t *henv, const char *name,
   Env *env = (Env *)henv;
 
   try {
-    ScopedLock lock;
+    ScopedWriteLock lock;
     if (NOTSET(flags, UPS_DONT_LOCK))
-      lock = ScopedLock(env->mutex);
+      lock = ScopedWriteLock(env->mutex);
 
     if (unlikely(NOTSET(env->config.flags, UPS_ENABLE_TRANSACTIONS))) {
       ups_trace(("transactions are disabled (see UPS_ENABLE_TRANSACTIONS)"));
@@ -176,8 +177,70 @@ ups_txn_commit(ups_txn_t *htxn, uint32_t flags)
   Env *env = txn->env;
 
   try {
-    ScopedLock lock(env->mutex);
-    return env->txn_commit(txn, flags);
+    uint64_t lsn = 0;
+    {
+      ScopedWriteLock lock(env->mutex);
+      ups_status_t st = env->txn_commit(txn, flags);
+      if (unlikely(st))
+        return st;
+      lsn = env->pending_commit_lsn();
+    }
+
+    // with group commit, the journal is synced without holding the lock,
+    // otherwise other threads could not join the group
+    if (lsn && NOTSET(flags, UPS_TXN_ASYNC_COMMIT))
+      env->wait_for_durable_lsn(lsn);
+    return 0;
+  }
+  catch (Exception &ex) {
+    return ex.code;
+  }
+}
+
+ups_status_t UPS_CALLCONV
+ups_env_get_commit_lsn(ups_env_t *henv, uint64_t *committed_lsn,
+                uint64_t *durable_lsn)
+{
+  Env *env = (Env *)henv;
+  if (unlikely(!env)) {
+    ups_trace(("parameter 'env' must not be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+  if (unlikely(!committed_lsn || !durable_lsn)) {
+    ups_trace(("parameters 'committed_lsn' and 'durable_lsn' must not "
+            "be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+
+  try {
+    ScopedWriteLock lock(env->mutex);
+    env->get_commit_lsn(committed_lsn, durable_lsn);
+    return 0;
+  }
+  catch (Exception &ex) {
+    return ex.code;
+  }
+}
+
+ups_status_t UPS_CALLCONV
+ups_env_wait_for_lsn(ups_env_t *henv, uint64_t lsn)
+{
+  Env *env = (Env *)henv;
+  if (unlikely(!env)) {
+    ups_trace(("parameter 'env' must not be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+
+  try {
+    {
+      ScopedWriteLock lock(env->mutex);
+      lsn = env->flush_commits(lsn);
+    }
+
+    // the fsync is performed without holding the lock
+    if (lsn)
+      env->wait_for_durable_lsn(lsn);
+    return 0;
   }
   catch (Exception &ex) {
     return ex.code;
@@ -195,7 +258,7 @@ ups_txn_abort(ups_txn_t *htxn, uint32_t flags)
   Txn *txn = (Txn *)htxn;
   Env *env = txn->env;
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
     return env->txn_abort(txn, flags);
   }
   catch (Exception &ex) {
@@ -319,10 +382,30 @@ ups_env_create(ups_env_t **henv, const char *filename,
     return UPS_INV_PARAMETER;
   }
 
+  /* in-memory? direct I/O is not possible */
+  if (unlikely(ISSET(flags, UPS_IN_MEMORY)
+          && ISSET(flags, UPS_ENABLE_DIRECT_IO))) {
+    ups_trace(("combination of UPS_IN_MEMORY and UPS_ENABLE_DIRECT_IO "
+            "not allowed"));
+    return UPS_INV_PARAMETER;
+  }
+
+  /* direct I/O bypasses the file system cache, and therefore mmap */
+  if (ISSET(flags, UPS_ENABLE_DIRECT_IO))
+    flags |= UPS_DISABLE_MMAP;
+
   /* flag UPS_AUTO_RECOVERY implies UPS_ENABLE_TRANSACTIONS */
   if (ISSET(flags, UPS_AUTO_RECOVERY))
     flags |= UPS_ENABLE_TRANSACTIONS;
 
+  /* concurrent readers do not support Transactions */
+  if (unlikely(ISSET(flags, UPS_ENABLE_CONCURRENT_READS)
+        && ISSET(flags, UPS_ENABLE_TRANSACTIONS))) {
+    ups_trace(("combination of UPS_ENABLE_CONCURRENT_READS and "
+            "UPS_ENABLE_TRANSACTIONS not allowed"));
+    return UPS_INV_PARAMETER;
+  }
+
   if (param) {
     for (; param->name; param++) {
       switch (param->name) {
@@ -388,6 +471,26 @@ ups_env_create(ups_env_t **henv, const char *filename,
       case UPS_PARAM_POSIX_FADVISE:
         config.posix_advice = (int)param->value;
         break;
+      case UPS_PARAM_CACHE_POLICY:
+        if (param->value != UPS_CACHE_POLICY_2Q
+                && param->value != UPS_CACHE_POLICY_LRU) {
+          ups_trace(("invalid value for UPS_PARAM_CACHE_POLICY"));
+          return UPS_INV_PARAMETER;
+        }
+        config.cache_policy = (int)param->value;
+        break;
+      case UPS_PARAM_QUERY_THREADS:
+        config.query_threads = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_CHECKPOINT_LOG_SIZE:
+        config.checkpoint_log_size = param->value;
+        break;
+      case UPS_PARAM_CHECKPOINT_INTERVAL_SEC:
+        config.checkpoint_interval_sec = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_JOURNAL_SEGMENT_SIZE:
+        config.journal_segment_size = param->value;
+        break;
       default:
         ups_trace(("unknown parameter %d", (int)param->name));
         return UPS_INV_PARAMETER;
@@ -400,6 +503,14 @@ ups_env_create(ups_env_t **henv, const char *filename,
     return UPS_INV_PARAMETER;
   }
 
+  /* direct I/O requires pages which are aligned to the file system blocks */
+  if (unlikely(ISSET(flags, UPS_ENABLE_DIRECT_IO)
+          && config.page_size_bytes % File::kDirectIoAlignment != 0)) {
+    ups_trace(("UPS_ENABLE_DIRECT_IO requires a page size which is a "
+            "multiple of %u", (unsigned)File::kDirectIoAlignment));
+    return UPS_INV_PARAMETER;
+  }
+
   config.flags = flags;
 
   /*
@@ -482,10 +593,22 @@ ups_env_open(ups_env_t **henv, const char *filename, uint32_t flags,
     return UPS_INV_PARAMETER;
   }
 
+  /* direct I/O bypasses the file system cache, and therefore mmap */
+  if (ISSET(flags, UPS_ENABLE_DIRECT_IO))
+    flags |= UPS_DISABLE_MMAP;
+
   /* flag UPS_AUTO_RECOVERY implies UPS_ENABLE_TRANSACTIONS */
   if (ISSET(flags, UPS_AUTO_RECOVERY))
     flags |= UPS_ENABLE_TRANSACTIONS;
 
+  /* concurrent readers do not support Transactions */
+  if (unlikely(ISSET(flags, UPS_ENABLE_CONCURRENT_READS)
+        && ISSET(flags, UPS_ENABLE_TRANSACTIONS))) {
+    ups_trace(("combination of UPS_ENABLE_CONCURRENT_READS and "
+            "UPS_ENABLE_TRANSACTIONS not allowed"));
+    return UPS_INV_PARAMETER;
+  }
+
   if (unlikely(config.filename.empty() && NOTSET(flags, UPS_IN_MEMORY))) {
     ups_trace(("filename is missing"));
     return UPS_INV_PARAMETER;
@@ -534,6 +657,33 @@ ups_env_open(ups_env_t **henv, const char *filename, uint32_t flags,
       case UPS_PARAM_POSIX_FADVISE:
         config.posix_advice = (int)param->value;
         break;
+      case UPS_PARAM_CACHE_POLICY:
+        if (param->value != UPS_CACHE_POLICY_2Q
+                && param->value != UPS_CACHE_POLICY_LRU) {
+          ups_trace(("invalid value for UPS_PARAM_CACHE_POLICY"));
+          return UPS_INV_PARAMETER;
+        }
+        config.cache_policy = (int)param->value;
+        break;
+      case UPS_PARAM_QUERY_THREADS:
+        config.query_threads = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_CHECKPOINT_LOG_SIZE:
+        config.checkpoint_log_size = param->value;
+        break;
+      case UPS_PARAM_CHECKPOINT_INTERVAL_SEC:
+        config.checkpoint_interval_sec = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_JOURNAL_SEGMENT_SIZE:
+        config.journal_segment_size = param->value;
+        break;
+      case UPS_PARAM_RECOVERY_PROGRESS_FUNCTION:
+        config.recovery_progress
+                = (ups_recovery_progress_func_t)param->value;
+        break;
+      case UPS_PARAM_RECOVERY_PROGRESS_CONTEXT:
+        config.recovery_progress_context = (void *)param->value;
+        break;
       default:
         ups_trace(("unknown parameter %d", (int)param->name));
         return UPS_INV_PARAMETER;
@@ -608,7 +758,7 @@ ups_env_create_db(ups_env_t *henv, ups_db_t **hdb, uint16_t db_name,
   config.flags = flags;
 
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
 
     if (unlikely(ISSET(env->flags(), UPS_READ_ONLY))) {
       ups_trace(("cannot create database in a read-only environment"));
@@ -650,7 +800,7 @@ ups_env_open_db(ups_env_t *henv, ups_db_t **hdb, uint16_t db_name,
   config.db_name = db_name;
 
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
 
     if (unlikely(ISSET(env->flags(), UPS_IN_MEMORY))) {
       ups_trace(("cannot open a Database in an In-Memory Environment"));
@@ -694,7 +844,7 @@ ups_env_rename_db(ups_env_t *henv, uint16_t oldname, uint16_t newname,
 
   /* rename the database */
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
     return env->rename_db(oldname, newname, flags);
   }
   catch (Exception &ex) {
@@ -717,7 +867,7 @@ ups_env_erase_db(ups_env_t *henv, uint16_t name, uint32_t flags)
 
   /* erase the database */
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
     return env->erase_db(name, flags);
   }
   catch (Exception &ex) {
@@ -744,7 +894,7 @@ ups_env_get_database_names(ups_env_t *henv, uint16_t *names, uint32_t *length)
 
   /* get all database names */
   try {
-    ScopedLock lock(env->mutex);
+    ScopedEnvReadLock lock(env, true);
 
     std::vector<uint16_t> vec = env->get_database_names();
     if (unlikely(vec.size() > *length)) {
@@ -779,7 +929,7 @@ ups_env_get_parameters(ups_env_t *henv, ups_parameter_t *param)
 
   /* get the parameters */
   try {
-    ScopedLock lock(env->mutex);
+    ScopedEnvReadLock lock(env, true);
     return env->get_parameters(param);
   }
   catch (Exception &ex) {
@@ -801,7 +951,7 @@ ups_env_flush(ups_env_t *henv, uint32_t flags)
   }
 
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
     return env->flush(flags);
   }
   catch (Exception &ex) {
@@ -809,6 +959,28 @@ ups_env_flush(ups_env_t *henv, uint32_t flags)
   }
 }
 
+ups_status_t UPS_CALLCONV
+ups_env_checkpoint(ups_env_t *henv, uint32_t flags)
+{
+  Env *env = (Env *)henv;
+  if (unlikely(!env)) {
+    ups_trace(("parameter 'env' must not be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+  if (unlikely(flags)) {
+    ups_trace(("parameter 'flags' is unused, set to 0"));
+    return UPS_INV_PARAMETER;
+  }
+
+  try {
+    ScopedWriteLock lock(env->mutex);
+    return env->checkpoint(flags);
+  }
+  catch (Exception &ex) {
+    return ex.code;
+  }
+}
+
 ups_status_t UPS_CALLCONV
 ups_env_close(ups_env_t *henv, uint32_t flags)
 {
@@ -849,7 +1021,7 @@ ups_db_get_parameters(ups_db_t *hdb, ups_parameter_t *param)
 
   /* get the parameters */
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedEnvReadLock lock(db->env, db->concurrent_reads);
     return db->get_parameters(param);
   }
   catch (Exception &ex) {
@@ -884,7 +1056,7 @@ ups_db_set_compare_func(ups_db_t *hdb, ups_compare_func_t foo)
     return UPS_INV_PARAMETER; 
   }
 
-  ScopedLock lock(ldb->env->mutex);
+  ScopedWriteLock lock(ldb->env->mutex);
 
   if (unlikely(db->config.key_type != UPS_TYPE_CUSTOM)) {
     ups_trace(("ups_set_compare_func only allowed for UPS_TYPE_CUSTOM "
@@ -922,7 +1094,7 @@ ups_db_find(ups_db_t *hdb, ups_txn_t *htxn, ups_key_t *key,
   Env *env = db->env;
 
   try {
-    ScopedLock lock(env->mutex);
+    ScopedEnvReadLock lock(env, db->concurrent_reads, true);
   
     if (unlikely(ISSETANY(db->flags(),
                             UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64)
@@ -938,6 +1110,59 @@ ups_db_find(ups_db_t *hdb, ups_txn_t *htxn, ups_key_t *key,
   }
 }
 
+UPS_EXPORT ups_status_t UPS_CALLCONV
+ups_db_find_many(ups_db_t *hdb, ups_txn_t *htxn, ups_key_t *keys,
+                ups_record_t *records, ups_status_t *results, uint32_t count,
+                uint32_t flags)
+{
+  Db *db = (Db *)hdb;
+  Txn *txn = (Txn *)htxn;
+
+  if (unlikely(!db)) {
+    ups_trace(("parameter 'db' must not be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+  if (unlikely(!keys)) {
+    ups_trace(("parameter 'keys' must not be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+  if (unlikely(!records)) {
+    ups_trace(("parameter 'records' must not be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+  if (unlikely(!results)) {
+    ups_trace(("parameter 'results' must not be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+  if (unlikely(flags != 0)) {
+    ups_trace(("parameter 'flags' must be 0"));
+    return UPS_INV_PARAMETER;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    if (unlikely(!prepare_key(&keys[i]) || !prepare_record(&records[i])))
+      return UPS_INV_PARAMETER;
+    if (unlikely(ISSETANY(db->flags(),
+                            UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64)
+          && !keys[i].data)) {
+      ups_trace(("key->data must not be NULL"));
+      return UPS_INV_PARAMETER;
+    }
+  }
+
+  if (unlikely(count == 0))
+    return 0;
+
+  Env *env = db->env;
+
+  try {
+    ScopedEnvReadLock lock(env, db->concurrent_reads, true);
+    return db->find_many(txn, keys, records, results, count, flags);
+  }
+  catch (Exception &ex) {
+    return ex.code;
+  }
+}
+
 UPS_EXPORT int UPS_CALLCONV
 ups_key_get_approximate_match_type(ups_key_t *key)
 {
@@ -983,14 +1208,18 @@ ups_db_insert(ups_db_t *hdb, ups_txn_t *htxn, ups_key_t *key,
   Env *env = db->env;
 
   try {
-    ScopedLock lock;
+    ScopedEnvWriteLock lock;
     if (likely(NOTSET(flags, UPS_DONT_LOCK)))
-      lock = ScopedLock(env->mutex);
+      lock.lock(env, db->concurrent_writes);
 
     if (unlikely(ISSET(db->flags(), UPS_READ_ONLY))) {
       ups_trace(("cannot insert in a read-only database"));
       return UPS_WRITE_PROTECTED;
     }
+    if (unlikely(txn && ISSET(txn->flags, UPS_TXN_READ_ONLY))) {
+      ups_trace(("cannot insert in a read-only transaction"));
+      return UPS_WRITE_PROTECTED;
+    }
     if (unlikely(ISSET(flags, UPS_DUPLICATE)
         && NOTSET(db->flags(), UPS_ENABLE_DUPLICATE_KEYS))) {
       ups_trace(("database does not support duplicate keys "
@@ -1032,14 +1261,18 @@ ups_db_erase(ups_db_t *hdb, ups_txn_t *htxn, ups_key_t *key, uint32_t flags)
   Env *env = db->env;
 
   try {
-    ScopedLock lock;
+    ScopedEnvWriteLock lock;
     if (likely(NOTSET(flags, UPS_DONT_LOCK)))
-      lock = ScopedLock(env->mutex);
+      lock.lock(env, db->concurrent_writes);
 
     if (unlikely(ISSET(db->flags(), UPS_READ_ONLY))) {
       ups_trace(("cannot erase from a read-only database"));
       return UPS_WRITE_PROTECTED;
     }
+    if (unlikely(txn && ISSET(txn->flags, UPS_TXN_READ_ONLY))) {
+      ups_trace(("cannot erase in a read-only transaction"));
+      return UPS_WRITE_PROTECTED;
+    }
 
     flags &= ~UPS_DONT_LOCK;
 
@@ -1065,7 +1298,7 @@ ups_db_check_integrity(ups_db_t *hdb, uint32_t flags)
   }
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedWriteLock lock(db->env->mutex);
     return db->check_integrity(flags);
   }
   catch (Exception &ex) {
@@ -1098,9 +1331,9 @@ ups_db_close(ups_db_t *hdb, uint32_t flags)
   }
 
   try {
-    ScopedLock lock;
+    ScopedWriteLock lock;
     if (likely(NOTSET(flags, UPS_DONT_LOCK)))
-      lock = ScopedLock(env->mutex);
+      lock = ScopedWriteLock(env->mutex);
 
     // auto-cleanup cursors?
     if (ISSET(flags, UPS_AUTO_CLEANUP)) {
@@ -1145,9 +1378,9 @@ ups_cursor_create(ups_cursor_t **hcursor, ups_db_t *hdb, ups_txn_t *htxn,
   Env *env = db->env;
 
   try {
-    ScopedLock lock;
+    ScopedWriteLock lock;
     if (likely(NOTSET(flags, UPS_DONT_LOCK)))
-      lock = ScopedLock(env->mutex);
+      lock = ScopedWriteLock(env->mutex);
 
     *cursor = db->cursor_create(txn, flags);
     db->add_cursor(*cursor);
@@ -1178,7 +1411,7 @@ ups_cursor_clone(ups_cursor_t *hsrc, ups_cursor_t **hdest)
   Db *db = src->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedWriteLock lock(db->env->mutex);
 
     *dest = db->cursor_clone(src);
     (*dest)->previous = 0;
@@ -1217,12 +1450,17 @@ ups_cursor_overwrite(ups_cursor_t *hcursor, ups_record_t *record,
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedWriteLock lock(db->env->mutex);
 
     if (unlikely(ISSET(db->flags(), UPS_READ_ONLY))) {
       ups_trace(("cannot overwrite in a read-only database"));
       return UPS_WRITE_PROTECTED;
     }
+    if (unlikely(cursor->txn
+          && ISSET(cursor->txn->flags, UPS_TXN_READ_ONLY))) {
+      ups_trace(("cannot overwrite in a read-only transaction"));
+      return UPS_WRITE_PROTECTED;
+    }
 
     return cursor->overwrite(record, flags);
   }
@@ -1256,7 +1494,7 @@ ups_cursor_move(ups_cursor_t *hcursor, ups_key_t *key,
   Env *env = db->env;
 
   try {
-    ScopedLock lock(env->mutex);
+    ScopedEnvReadLock lock(env, db->concurrent_reads);
     return db->cursor_move(cursor, key, record, flags);
   }
   catch (Exception &ex) {
@@ -1287,9 +1525,9 @@ ups_cursor_find(ups_cursor_t *hcursor, ups_key_t *key, ups_record_t *record,
   Env *env = db->env;
 
   try {
-    ScopedLock lock;
+    ScopedEnvReadLock lock;
     if (likely(NOTSET(flags, UPS_DONT_LOCK)))
-      lock = ScopedLock(env->mutex);
+      lock.lock(env, db->concurrent_reads);
 
     flags &= ~UPS_DONT_LOCK;
 
@@ -1328,12 +1566,17 @@ ups_cursor_insert(ups_cursor_t *hcursor, ups_key_t *key, ups_record_t *record,
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedWriteLock lock(db->env->mutex);
 
     if (unlikely(ISSET(db->flags(), UPS_READ_ONLY))) {
       ups_trace(("cannot insert to a read-only database"));
       return UPS_WRITE_PROTECTED;
     }
+    if (unlikely(cursor->txn
+          && ISSET(cursor->txn->flags, UPS_TXN_READ_ONLY))) {
+      ups_trace(("cannot insert in a read-only transaction"));
+      return UPS_WRITE_PROTECTED;
+    }
     if (unlikely(ISSET(flags, UPS_DUPLICATE)
         && NOTSET(db->flags(), UPS_ENABLE_DUPLICATE_KEYS))) {
       ups_trace(("database does not support duplicate keys "
@@ -1376,12 +1619,17 @@ ups_cursor_erase(ups_cursor_t *hcursor, uint32_t flags)
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedWriteLock lock(db->env->mutex);
 
     if (ISSET(db->flags(), UPS_READ_ONLY)) {
       ups_trace(("cannot erase from a read-only database"));
       return UPS_WRITE_PROTECTED;
     }
+    if (unlikely(cursor->txn
+          && ISSET(cursor->txn->flags, UPS_TXN_READ_ONLY))) {
+      ups_trace(("cannot erase in a read-only transaction"));
+      return UPS_WRITE_PROTECTED;
+    }
 
     return db->erase(cursor, cursor->txn, 0, flags);
   }
@@ -1408,7 +1656,7 @@ ups_cursor_get_duplicate_count(ups_cursor_t *hcursor, uint32_t *count,
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedEnvReadLock lock(db->env, db->concurrent_reads);
     *count = cursor->get_duplicate_count(flags);
     return 0;
   }
@@ -1435,7 +1683,7 @@ ups_cursor_get_duplicate_position(ups_cursor_t *hcursor, uint32_t *position)
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedEnvReadLock lock(db->env, db->concurrent_reads);
     *position = cursor->get_duplicate_position();
     return 0;
   }
@@ -1462,7 +1710,7 @@ ups_cursor_get_record_size(ups_cursor_t *hcursor, uint32_t *size)
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedEnvReadLock lock(db->env, db->concurrent_reads);
     *size = cursor->get_record_size();
     return 0;
   }
@@ -1485,7 +1733,7 @@ ups_cursor_close(ups_cursor_t *hcursor)
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedWriteLock lock(db->env->mutex);
     cursor->close();
     if (cursor->txn)
       cursor->txn->release();
@@ -1505,7 +1753,7 @@ ups_set_context_data(ups_db_t *hdb, void *data)
   if (unlikely(!db))
     return;
 
-  ScopedLock lock(db->env->mutex);
+  ScopedWriteLock lock(db->env->mutex);
   db->context = data;
 }
 
@@ -1519,7 +1767,7 @@ ups_get_context_data(ups_db_t *hdb, ups_bool_t dont_lock)
   if (dont_lock)
     return db->context;
 
-  ScopedLock lock(db->env->mutex);
+  ScopedReadLock lock(db->env->mutex);
   return db->context;
 }
 
@@ -1580,7 +1828,7 @@ ups_db_count(ups_db_t *hdb, ups_txn_t *htxn, uint32_t flags,
   }
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedEnvReadLock lock(db->env, db->concurrent_reads);
 
     *count = db->count(txn, ISSET(flags, UPS_SKIP_DUPLICATES));
     return 0;
@@ -1701,7 +1949,7 @@ ups_db_bulk_operations(ups_db_t *hdb, ups_txn_t *txn,
 
   Db *db = (Db *)hdb;
   try {
-    ScopedLock lock = ScopedLock(db->env->mutex);
+    ScopedWriteLock lock = ScopedWriteLock(db->env->mutex);
     return db->bulk_operations((Txn *)txn, operations,
                     operations_length, flags);
   }
@@ -1709,3 +1957,69 @@ ups_db_bulk_operations(ups_db_t *hdb, ups_txn_t *txn,
     return ex.code;
   }
 }
+
+UPS_EXPORT ups_status_t UPS_CALLCONV
+ups_db_bulk_load(ups_db_t *hdb, ups_bulk_load_func_t func, void *context,
+                uint32_t fill_factor, uint32_t flags)
+{
+  if (unlikely(hdb == 0)) {
+    ups_trace(("parameter 'db' must not be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+  if (unlikely(func == 0)) {
+    ups_trace(("parameter 'func' must not be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+  if (unlikely(fill_factor > 100)) {
+    ups_trace(("parameter 'fill_factor' must not be larger than 100"));
+    return UPS_INV_PARAMETER;
+  }
+  if (unlikely(flags != 0)) {
+    ups_trace(("parameter 'flags' must be 0"));
+    return UPS_INV_PARAMETER;
+  }
+
+  Db *db = (Db *)hdb;
+  try {
+    ScopedWriteLock lock(db->env->mutex);
+
+    if (unlikely(ISSET(db->flags(), UPS_READ_ONLY))) {
+      ups_trace(("cannot load keys into a read-only database"));
+      return UPS_WRITE_PROTECTED;
+    }
+
+    return db->bulk_load(func, context, fill_factor, flags);
+  }
+  catch (Exception &ex) {
+    return ex.code;
+  }
+}
+
+UPS_EXPORT ups_status_t UPS_CALLCONV
+ups_db_compact(ups_db_t *hdb, uint32_t max_pages, uint32_t max_milliseconds,
+                uint32_t flags)
+{
+  if (unlikely(hdb == 0)) {
+    ups_trace(("parameter 'db' must not be NULL"));
+    return UPS_INV_PARAMETER;
+  }
+  if (unlikely((flags & ~UPS_COMPACT_IN_BACKGROUND) != 0)) {
+    ups_trace(("parameter 'flags' contains an invalid flag"));
+    return UPS_INV_PARAMETER;
+  }
+
+  Db *db = (Db *)hdb;
+  try {
+    ScopedWriteLock lock(db->env->mutex);
+
+    if (unlikely(ISSET(db->flags(), UPS_READ_ONLY))) {
+      ups_trace(("cannot compact a read-only database"));
+      return UPS_WRITE_PROTECTED;
+    }
+
+    return db->compact(max_pages, max_milliseconds, flags);
+  }
+  catch (Exception &ex) {
+    return ex.code;
+  }
+}
@@ -93,7 +93,9 @@ struct Configuration
       journal_compression(0), record_compression(0), key_compression(0),
       read_only(false), enable_crc32(false), record_number32(false),
       record_number64(false), posix_fadvice(UPS_POSIX_FADVICE_NORMAL),
-      simulate_crashes(false), flush_txn_immediately(false) {
+      simulate_crashes(false), flush_txn_immediately(false),
+      group_commit(false), async_commit(false), direct_io(false),
+      journal_deltas(false), journal_segment_size(0) {
   }
 
   const char *
@@ -211,6 +213,16 @@ struct Configuration
                 << " ";
     if (simulate_crashes)
       std::cout << "--simulate-crashes ";
+    if (group_commit)
+      std::cout << "--group-commit ";
+    if (async_commit)
+      std::cout << "--async-commit ";
+    if (direct_io)
+      std::cout << "--direct-io ";
+    if (journal_deltas)
+      std::cout << "--journal-deltas ";
+    if (journal_segment_size)
+      std::cout << "--journal-segment-size=" << journal_segment_size << " ";
     if (flush_txn_immediately)
       std::cout << "--flush-txn-immediately";
     if (!filename.empty())
@@ -312,6 +324,11 @@ struct Configuration
   int posix_fadvice;
   bool simulate_crashes;
   bool flush_txn_immediately;
+  bool group_commit;
+  bool async_commit;
+  bool direct_io;
+  bool journal_deltas;
+  uint64_t journal_segment_size;
 };
 
 #endif /* UPS_BENCH_CONFIGURATION_H */
@@ -91,6 +91,11 @@
 #define ARG_POSIX_FADVICE                       71
 #define ARG_SIMULATE_CRASHES                    72
 #define ARG_FLUSH_TXN_IMMEDIATELY               73
+#define ARG_GROUP_COMMIT                        74
+#define ARG_ASYNC_COMMIT                        75
+#define ARG_DIRECT_IO                           76
+#define ARG_JOURNAL_DELTAS                      77
+#define ARG_JOURNAL_SEGMENT_SIZE                78
 
 /*
  * command line parameters
@@ -427,6 +432,36 @@ static option_t opts[] = {
     "flush-txn-immediately",
     "Immediately flushes transactions after they are committed",
     0 },
+  {
+    ARG_GROUP_COMMIT,
+    0,
+    "group-commit",
+    "Concurrent commits share a single fsync (requires --use-fsync)",
+    0 },
+  {
+    ARG_ASYNC_COMMIT,
+    0,
+    "async-commit",
+    "Commits return before the journal is written",
+    0 },
+  {
+    ARG_DIRECT_IO,
+    0,
+    "direct-io",
+    "Bypasses the file system cache (O_DIRECT)",
+    0 },
+  {
+    ARG_JOURNAL_DELTAS,
+    0,
+    "journal-deltas",
+    "Logs only the modified bytes of a page in the journal",
+    0 },
+  {
+    ARG_JOURNAL_SEGMENT_SIZE,
+    0,
+    "journal-segment-size",
+    "Preallocates the journal files with this size",
+    GETOPTS_NEED_ARGUMENT },
   {0, 0}
 };
 
@@ -821,6 +856,25 @@ parse_config(int argc, char **argv, Configuration *c)
     else if (opt == ARG_FLUSH_TXN_IMMEDIATELY) {
       c->flush_txn_immediately = true;
     }
+    else if (opt == ARG_GROUP_COMMIT) {
+      c->group_commit = true;
+    }
+    else if (opt == ARG_ASYNC_COMMIT) {
+      c->async_commit = true;
+    }
+    else if (opt == ARG_DIRECT_IO) {
+      c->direct_io = true;
+    }
+    else if (opt == ARG_JOURNAL_DELTAS) {
+      c->journal_deltas = true;
+    }
+    else if (opt == ARG_JOURNAL_SEGMENT_SIZE) {
+      c->journal_segment_size = strtoul(param, 0, 0);
+      if (!c->journal_segment_size) {
+        printf("[FAIL] invalid parameter for 'journal-segment-size'\n");
+        exit(-1);
+      }
+    }
     else if (opt == ARG_READ_ONLY) {
       c->read_only = true;
     }
@@ -850,6 +904,23 @@ parse_config(int argc, char **argv, Configuration *c)
   }
 }
 
+static void
+print_cache_metrics(const char *type, cache_metrics_t *metrics)
+{
+  double hit_ratio = metrics->hits + metrics->misses
+                      ? (double)metrics->hits
+                            / (metrics->hits + metrics->misses)
+                      : 0.0;
+  printf("\tupscaledb cache[%s] hits %lu, misses %lu (hit ratio %.2f), "
+          "evictions %lu, dirty purge candidates %lu, "
+          "avg residency %lu usec\n",
+          type, (long unsigned int)metrics->hits,
+          (long unsigned int)metrics->misses, hit_ratio,
+          (long unsigned int)metrics->evictions,
+          (long unsigned int)metrics->dirty_purge_candidates,
+          (long unsigned int)metrics->avg_residency_usec);
+}
+
 static void
 print_metrics(Metrics *metrics, Configuration *conf)
 {
@@ -952,6 +1023,16 @@ print_metrics(Metrics *metrics, Configuration *conf)
           (long unsigned int)metrics->upscaledb_metrics.page_count_fetched);
   printf("\tupscaledb page_count_flushed          %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.page_count_flushed);
+  printf("\tupscaledb page_count_prefetched       %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.page_count_prefetched);
+  printf("\tupscaledb page_buffer_pool_capacity   %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.page_buffer_pool_capacity);
+  printf("\tupscaledb page_buffer_pool_in_use     %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.page_buffer_pool_in_use);
+  printf("\tupscaledb page_object_pool_capacity   %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.page_object_pool_capacity);
+  printf("\tupscaledb page_object_pool_in_use     %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.page_object_pool_in_use);
   printf("\tupscaledb page_count_type_index       %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.page_count_type_index);
   printf("\tupscaledb page_count_type_blob        %lu\n",
@@ -966,6 +1047,26 @@ print_metrics(Metrics *metrics, Configuration *conf)
           (long unsigned int)metrics->upscaledb_metrics.cache_hits);
   printf("\tupscaledb cache_misses                %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.cache_misses);
+  print_cache_metrics("root", &metrics->upscaledb_metrics.cache_root_metrics);
+  print_cache_metrics("index",
+          &metrics->upscaledb_metrics.cache_index_metrics);
+  print_cache_metrics("blob", &metrics->upscaledb_metrics.cache_blob_metrics);
+  print_cache_metrics("page_manager",
+          &metrics->upscaledb_metrics.cache_page_manager_metrics);
+  printf("\tupscaledb cache_purge_candidates      %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_purge_candidates);
+  printf("\tupscaledb cache_purge_garbage         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_purge_garbage);
+  printf("\tupscaledb flush_thread_count          %u\n",
+          (unsigned)metrics->upscaledb_metrics.flush_thread_count);
+  printf("\tupscaledb flush_queue_depth           %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.flush_queue_depth);
+  printf("\tupscaledb flush_peak_queue_depth      %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.flush_peak_queue_depth);
+  printf("\tupscaledb flush_write_calls           %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.flush_write_calls);
+  printf("\tupscaledb flush_avg_write_latency_usec %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.flush_avg_write_latency_usec);
   printf("\tupscaledb blob_total_allocated        %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.blob_total_allocated);
   printf("\tupscaledb blob_total_read             %lu\n",
@@ -974,12 +1075,28 @@ print_metrics(Metrics *metrics, Configuration *conf)
           (long unsigned int)metrics->upscaledb_metrics.btree_smo_split);
   printf("\tupscaledb btree_smo_merge             %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.btree_smo_merge);
+  printf("\tupscaledb btree_smo_relocate          %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.btree_smo_relocate);
   printf("\tupscaledb extended_keys               %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.extended_keys);
   printf("\tupscaledb extended_duptables          %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.extended_duptables);
   printf("\tupscaledb journal_bytes_flushed       %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.journal_bytes_flushed);
+  printf("\tupscaledb journal_group_syncs         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.journal_group_syncs);
+  printf("\tupscaledb journal_group_commits       %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.journal_group_commits);
+  printf("\tupscaledb journal_page_images         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.journal_page_images);
+  printf("\tupscaledb journal_page_deltas         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.journal_page_deltas);
+  printf("\tupscaledb checkpoint_count            %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.checkpoint_count);
+  printf("\tupscaledb checkpoint_total_usec       %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.checkpoint_total_usec);
+  printf("\tupscaledb checkpoint_max_usec         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.checkpoint_max_usec);
 }
 
 struct Callable {
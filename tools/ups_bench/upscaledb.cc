@@ -73,7 +73,7 @@ UpscaleDatabase::do_create_env()
 {
   ups_status_t st = 0;
   uint32_t flags = 0;
-  ups_parameter_t params[6] = {{0, 0}};
+  ups_parameter_t params[7] = {{0, 0}};
 
   ScopedLock lock(ms_mutex);
 
@@ -103,6 +103,11 @@ UpscaleDatabase::do_create_env()
       params[p].value = m_config->journal_compression;
       p++;
     }
+    if (m_config->journal_segment_size) {
+      params[p].name = UPS_PARAM_JOURNAL_SEGMENT_SIZE;
+      params[p].value = m_config->journal_segment_size;
+      p++;
+    }
 
     flags |= m_config->inmemory ? UPS_IN_MEMORY : 0; 
     flags |= m_config->no_mmap ? UPS_DISABLE_MMAP : 0; 
@@ -110,6 +115,9 @@ UpscaleDatabase::do_create_env()
     flags |= m_config->use_transactions ? UPS_ENABLE_TRANSACTIONS : 0;
     flags |= m_config->flush_txn_immediately ? UPS_FLUSH_TRANSACTIONS_IMMEDIATELY : 0;
     flags |= m_config->use_fsync ? UPS_ENABLE_FSYNC : 0;
+    flags |= m_config->group_commit ? UPS_ENABLE_GROUP_COMMIT : 0;
+    flags |= m_config->direct_io ? UPS_ENABLE_DIRECT_IO : 0;
+    flags |= m_config->journal_deltas ? UPS_ENABLE_JOURNAL_DELTAS : 0;
     flags |= m_config->disable_recovery ? UPS_DISABLE_RECOVERY : 0;
     flags |= m_config->enable_crc32 ? UPS_ENABLE_CRC32 : 0;
 
@@ -179,6 +187,11 @@ UpscaleDatabase::do_open_env()
       params[p].value = (uint64_t)"1234567890123456";
       p++;
     }
+    if (m_config->journal_segment_size) {
+      params[p].name = UPS_PARAM_JOURNAL_SEGMENT_SIZE;
+      params[p].value = m_config->journal_segment_size;
+      p++;
+    }
 
     flags |= m_config->no_mmap ? UPS_DISABLE_MMAP : 0; 
     flags |= m_config->cacheunlimited ? UPS_CACHE_UNLIMITED : 0;
@@ -187,6 +200,9 @@ UpscaleDatabase::do_open_env()
                 : 0;
     flags |= m_config->flush_txn_immediately ? UPS_FLUSH_TRANSACTIONS_IMMEDIATELY : 0;
     flags |= m_config->use_fsync ? UPS_ENABLE_FSYNC : 0;
+    flags |= m_config->group_commit ? UPS_ENABLE_GROUP_COMMIT : 0;
+    flags |= m_config->direct_io ? UPS_ENABLE_DIRECT_IO : 0;
+    flags |= m_config->journal_deltas ? UPS_ENABLE_JOURNAL_DELTAS : 0;
     flags |= m_config->disable_recovery ? UPS_DISABLE_RECOVERY : 0;
     flags |= m_config->read_only ? UPS_READ_ONLY : 0;
     flags |= m_config->enable_crc32 ? UPS_ENABLE_CRC32 : 0;
@@ -502,7 +518,8 @@ UpscaleDatabase::do_txn_commit(Txn *txn)
 {
   assert((ups_txn_t *)txn == m_txn);
 
-  ups_status_t st = ups_txn_commit((ups_txn_t *)txn, 0);
+  ups_status_t st = ups_txn_commit((ups_txn_t *)txn,
+                  m_config->async_commit ? UPS_TXN_ASYNC_COMMIT : 0);
   if (st)
     LOG_ERROR(("ups_txn_commit failed with error %d (%s)\n",
                 st, ups_strerror(st)));
@@ -30,6 +30,8 @@
 #define ARG_HELP          1
 #define ARG_STDIN         2
 #define ARG_MERGE         3
+#define ARG_BULK_LOAD     4
+#define ARG_FILL_FACTOR   5
 
 
 /*
@@ -54,6 +56,18 @@ static option_t opts[] = {
     "merge",
     "merge database dump into existing file",
     0 },
+  {
+    ARG_BULK_LOAD,
+    "bulk",
+    "bulk-load",
+    "load the (sorted) items with ups_db_bulk_load",
+    0 },
+  {
+    ARG_FILL_FACTOR,
+    "ff",
+    "fill-factor",
+    "fill factor of the bulk loaded pages (in percent)",
+    GETOPTS_NEED_ARGUMENT },
   { 0, 0, 0, 0, 0 } /* terminating element */
 };
 
@@ -81,9 +95,11 @@ class Importer {
 
 class BinaryImporter : public Importer {
   public:
-    BinaryImporter(FILE *f, ups_env_t *env, const char *outfilename)
+    BinaryImporter(FILE *f, ups_env_t *env, const char *outfilename,
+                bool bulk_load = false, uint32_t fill_factor = 0)
       : Importer(f, env, outfilename), m_db(0), m_insert_flags(0),
-        m_db_counter(0), m_item_counter(0) {
+        m_db_counter(0), m_item_counter(0), m_bulk_load(bulk_load),
+        m_fill_factor(fill_factor), m_has_pending(false) {
       m_buffer = (char *)malloc(1024 * 1024);
     }
 
@@ -96,23 +112,8 @@ class BinaryImporter : public Importer {
     }
 
     virtual void run() {
-      while (!feof(m_f)) {
-        // read the next message from the stream
-        uint32_t size = read_size();
-        if (!size)
-          return;
-
-        m_buffer = (char *)realloc(0, size);
-        if (size != fread(m_buffer, 1, size, m_f)) {
-          fprintf(stderr, "Error reading %u bytes: %s\n", size,
-                  strerror(errno));
-          exit(-1);
-        }
-
-        // unpack serialized datum
-        HamsterTool::Datum datum;
-        datum.ParseFromArray(m_buffer, size);
-
+      HamsterTool::Datum datum;
+      while (read_datum(datum)) {
         switch (datum.type()) {
           case HamsterTool::Datum::ENVIRONMENT:
             read_environment(datum);
@@ -120,6 +121,15 @@ class BinaryImporter : public Importer {
           case HamsterTool::Datum::DATABASE:
             read_database(datum);
             m_db_counter++;
+            // the items of this database follow in sorted order; the bulk
+            // loader pulls them from the stream till the next database
+            // starts
+            if (m_bulk_load) {
+              ups_status_t st = ups_db_bulk_load(m_db, next_item, this,
+                                m_fill_factor, 0);
+              if (st)
+                error("ups_db_bulk_load", st);
+            }
             break;
           case HamsterTool::Datum::ITEM:
             read_item(datum);
@@ -133,6 +143,59 @@ class BinaryImporter : public Importer {
     }
 
   private:
+    // Reads the next datum from the stream; returns false at the end
+    bool read_datum(HamsterTool::Datum &datum) {
+      if (m_has_pending) {
+        datum = m_pending;
+        m_has_pending = false;
+        return true;
+      }
+
+      if (feof(m_f))
+        return false;
+
+      // read the next message from the stream
+      uint32_t size = read_size();
+      if (!size)
+        return false;
+
+      m_buffer = (char *)realloc(m_buffer, size);
+      if (size != fread(m_buffer, 1, size, m_f)) {
+        fprintf(stderr, "Error reading %u bytes: %s\n", size,
+                strerror(errno));
+        exit(-1);
+      }
+
+      // unpack serialized datum
+      datum.ParseFromArray(m_buffer, size);
+      return true;
+    }
+
+    // Input function for ups_db_bulk_load; supplies the items of the
+    // current database
+    static int UPS_CALLCONV next_item(void *context, ups_key_t *key,
+                    ups_record_t *record) {
+      BinaryImporter *self = (BinaryImporter *)context;
+      if (!self->read_datum(self->m_current))
+        return 0;
+
+      // this datum does not belong to the current database; process it
+      // in run()
+      if (self->m_current.type() != HamsterTool::Datum::ITEM) {
+        self->m_pending = self->m_current;
+        self->m_has_pending = true;
+        return 0;
+      }
+
+      const HamsterTool::Item &item = self->m_current.item();
+      key->data = (void *)item.key().data();
+      key->size = (uint16_t)item.key().size();
+      record->data = (void *)item.record().data();
+      record->size = (uint32_t)item.record().size();
+      self->m_item_counter++;
+      return 1;
+    }
+
     void read_environment(HamsterTool::Datum &datum) {
       // only process if the Environment does not yet exist
       if (m_env)
@@ -233,6 +296,15 @@ class BinaryImporter : public Importer {
     uint32_t m_insert_flags;
     size_t m_db_counter;
     size_t m_item_counter;
+    bool m_bulk_load;
+    uint32_t m_fill_factor;
+
+    // the item which is currently bulk loaded
+    HamsterTool::Datum m_current;
+
+    // a datum which was read by next_item(), but not yet processed
+    HamsterTool::Datum m_pending;
+    bool m_has_pending;
 };
 
 int
@@ -241,6 +313,9 @@ main(int argc, char **argv) {
   const char *param, *dumpfilename = 0, *envfilename = 0;
   bool merge = false;
   bool use_stdin = false;
+  bool bulk_load = false;
+  uint32_t fill_factor = 0;
+  char *endptr = 0;
 
   getopts_init(argc, argv, "ups_import");
 
@@ -252,6 +327,17 @@ main(int argc, char **argv) {
       case ARG_MERGE:
         merge = true;
         break;
+      case ARG_BULK_LOAD:
+        bulk_load = true;
+        break;
+      case ARG_FILL_FACTOR:
+        fill_factor = (uint32_t)strtoul(param, &endptr, 0);
+        if ((endptr && *endptr) || fill_factor > 100) {
+          printf("Invalid parameter `fill-factor'; numerical value "
+             "between 1 and 100 expected.\n");
+          return (-1);
+        }
+        break;
       case GETOPTS_PARAMETER:
         if (!dumpfilename && !use_stdin)
           dumpfilename = param;
@@ -267,11 +353,16 @@ main(int argc, char **argv) {
       case ARG_HELP:
         print_banner("ups_import");
 
-        printf("usage: ups_import [--stdin] [--merge] <data> <environ>\n");
+        printf("usage: ups_import [--stdin] [--merge] [--bulk-load "
+               "[--fill-factor <n>]] <data> <environ>\n");
         printf("usage: ups_import --help\n");
         printf("       --help:       this help screen\n");
         printf("       --stdin:      read dump data from stdin\n");
         printf("       --merge:      merge data into existing environment\n");
+        printf("       --bulk-load:  build the databases bottom-up from the "
+               "sorted dump\n");
+        printf("       --fill-factor: fill factor of the bulk loaded pages "
+               "(1-100)\n");
         printf("       <data>:       filename with exported data\n");
         printf("       <environ>:    upscaledb environment which will be created (or filled)\n");
         return (0);
@@ -334,7 +425,8 @@ main(int argc, char **argv) {
   }
 
   // now run the import; the importer will create the environment
-  Importer *importer = new BinaryImporter(f, env, envfilename);
+  Importer *importer = new BinaryImporter(f, env, envfilename, bulk_load,
+                  fill_factor);
   importer->run();
   delete importer;
   fclose(f);
@@ -405,4 +405,163 @@ TEST_CASE("Btree/forceInternalNodeTest", "")
   f.forceInternalNodeTest();
 }
 
+template<typename T>
+struct SearchTreeFixture : BaseFixture {
+  uint64_t key_type;
+
+  // Small pages give internal nodes with a few dozen keys, larger pages
+  // give search trees with several levels
+  SearchTreeFixture(uint64_t key_type_, uint32_t page_size)
+    : key_type(key_type_) {
+    ups_parameter_t env_params[] = {
+      { UPS_PARAM_PAGESIZE, page_size },
+      { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+      { UPS_PARAM_KEY_TYPE, key_type },
+      { UPS_PARAM_INTERNAL_NODE_LAYOUT, UPS_NODE_LAYOUT_BTREE },
+      { 0, 0 }
+    };
+    require_create(0, env_params, 0, db_params);
+  }
+
+  // Stores every other key, i.e. 0, 2, 4...
+  void insert_keys(int start, int end) {
+    for (int i = start; i < end; i++) {
+      T t = (T)(2 * i);
+      ups_key_t key = ups_make_key(&t, sizeof(t));
+      ups_record_t record = ups_make_record(&i, sizeof(i));
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+    }
+  }
+
+  void erase_keys(int start, int end) {
+    for (int i = start; i < end; i++) {
+      T t = (T)(2 * i);
+      ups_key_t key = ups_make_key(&t, sizeof(t));
+      REQUIRE(0 == ups_db_erase(db, 0, &key, 0));
+    }
+  }
+
+  // Looks up |i| with |flags|; returns the index of the key that was
+  // found, or -1
+  int find(int i, uint32_t flags) {
+    T t = (T)i;
+    ups_key_t key = ups_make_key(&t, sizeof(t));
+    ups_record_t record = {0};
+    ups_status_t st = ups_db_find(db, 0, &key, &record, flags);
+    if (st == UPS_KEY_NOT_FOUND)
+      return -1;
+    REQUIRE(st == 0);
+    REQUIRE(record.size == sizeof(int));
+    REQUIRE(*(T *)key.data == (T)(2 * *(int *)record.data));
+    return *(int *)record.data;
+  }
+
+  // Verifies exact and approximate lookups of all keys in [start, end[,
+  // and of the values between them
+  void verify(int start, int end) {
+    REQUIRE(0 == ups_db_check_integrity(db, 0));
+
+    for (int i = start; i < end; i++) {
+      REQUIRE(find(2 * i, 0) == i);
+      REQUIRE(find(2 * i + 1, 0) == -1);
+      REQUIRE(find(2 * i + 1, UPS_FIND_LT_MATCH) == i);
+      REQUIRE(find(2 * i + 1, UPS_FIND_GT_MATCH)
+                      == (i + 1 < end ? i + 1 : -1));
+      REQUIRE(find(2 * i, UPS_FIND_LEQ_MATCH) == i);
+    }
+  }
+
+  void lookupTest(int count) {
+    insert_keys(0, count);
+    verify(0, count);
+
+    // the search tree is rebuilt after the nodes were modified
+    erase_keys(0, count / 2);
+    verify(count / 2, count);
+    insert_keys(0, count / 2);
+    verify(0, count);
+
+    // the layout is not persisted, but can be set when the Database
+    // is opened
+    close();
+    require_open();
+    verify(0, count);
+    close();
+    ups_parameter_t params[] = {
+      { UPS_PARAM_INTERNAL_NODE_LAYOUT, UPS_NODE_LAYOUT_BTREE },
+      { 0, 0 }
+    };
+    REQUIRE(0 == ups_env_open(&env, "test.db", 0, 0));
+    REQUIRE(0 == ups_env_open_db(env, &db, 1, 0, params));
+    verify(0, count);
+  }
+
+  void parameterTest() {
+    ups_parameter_t query[] = {
+      { UPS_PARAM_INTERNAL_NODE_LAYOUT, 0 },
+      { 0, 0 }
+    };
+    REQUIRE(0 == ups_db_get_parameters(db, query));
+    REQUIRE(UPS_NODE_LAYOUT_BTREE == query[0].value);
+
+    ups_db_t *db2;
+    ups_parameter_t params[] = {
+      { UPS_PARAM_INTERNAL_NODE_LAYOUT, 2 },
+      { 0, 0 }
+    };
+    REQUIRE(UPS_INV_PARAMETER == ups_env_create_db(env, &db2, 2, 0, params));
+
+    close();
+    REQUIRE(0 == ups_env_open(&env, "test.db", 0, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_env_open_db(env, &db, 1, 0, params));
+    REQUIRE(0 == ups_env_open_db(env, &db, 1, 0, 0));
+    REQUIRE(0 == ups_db_get_parameters(db, query));
+    REQUIRE(UPS_NODE_LAYOUT_SORTED == query[0].value);
+  }
+};
+
+TEST_CASE("Btree/SearchTree/uint16Test", "")
+{
+  SearchTreeFixture<uint16_t> f(UPS_TYPE_UINT16, 1024);
+  f.lookupTest(10000);
+}
+
+TEST_CASE("Btree/SearchTree/uint32Test", "")
+{
+  SearchTreeFixture<uint32_t> f(UPS_TYPE_UINT32, 1024);
+  f.lookupTest(20000);
+}
+
+TEST_CASE("Btree/SearchTree/uint64Test", "")
+{
+  SearchTreeFixture<uint64_t> f(UPS_TYPE_UINT64, 1024);
+  f.lookupTest(20000);
+}
+
+TEST_CASE("Btree/SearchTree/real32Test", "")
+{
+  SearchTreeFixture<float> f(UPS_TYPE_REAL32, 1024);
+  f.lookupTest(20000);
+}
+
+TEST_CASE("Btree/SearchTree/real64Test", "")
+{
+  SearchTreeFixture<double> f(UPS_TYPE_REAL64, 1024);
+  f.lookupTest(20000);
+}
+
+TEST_CASE("Btree/SearchTree/multiLevelTest", "")
+{
+  SearchTreeFixture<uint64_t> f(UPS_TYPE_UINT64, 1024 * 2);
+  f.lookupTest(30000);
+}
+
+TEST_CASE("Btree/SearchTree/parameterTest", "")
+{
+  SearchTreeFixture<uint32_t> f(UPS_TYPE_UINT32, 1024 * 16);
+  f.parameterTest();
+}
+
 } // namespace upscaledb
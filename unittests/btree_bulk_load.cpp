@@ -0,0 +1,405 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+#include "3rdparty/catch/catch.hpp"
+
+#include "4context/context.h"
+
+#include "os.hpp"
+#include "fixture.hpp"
+
+using namespace upscaledb;
+
+// Supplies the keys |start| ... |end| (each one |duplicates| times) to
+// ups_db_bulk_load
+struct BulkLoadSource {
+  BulkLoadSource(uint32_t start_, uint32_t end_, bool binary_ = false,
+                  int duplicates_ = 1)
+    : current(start_), end(end_), binary(binary_), duplicates(duplicates_),
+      dupe(0) {
+  }
+
+  static int UPS_CALLCONV next(void *context, ups_key_t *key,
+                  ups_record_t *record) {
+    BulkLoadSource *s = (BulkLoadSource *)context;
+    if (s->current >= s->end)
+      return 0;
+
+    if (s->binary) {
+      ::snprintf(s->key_buffer, sizeof(s->key_buffer), "key%010u", s->current);
+      key->data = s->key_buffer;
+      key->size = (uint16_t)::strlen(s->key_buffer) + 1;
+    }
+    else {
+      s->key_value = s->current;
+      key->data = &s->key_value;
+      key->size = sizeof(s->key_value);
+    }
+    s->record_value = s->current + s->dupe;
+    record->data = &s->record_value;
+    record->size = sizeof(s->record_value);
+
+    if (++s->dupe == s->duplicates) {
+      s->dupe = 0;
+      s->current++;
+    }
+    return 1;
+  }
+
+  uint32_t current;
+  uint32_t end;
+  bool binary;
+  int duplicates;
+  int dupe;
+  uint32_t key_value;
+  uint32_t record_value;
+  char key_buffer[32];
+};
+
+// Supplies the keys in |keys|
+struct UnsortedSource {
+  static int UPS_CALLCONV next(void *context, ups_key_t *key,
+                  ups_record_t *record) {
+    UnsortedSource *s = (UnsortedSource *)context;
+    if (s->index >= s->keys.size())
+      return 0;
+    key->data = &s->keys[s->index];
+    key->size = sizeof(uint32_t);
+    record->data = &s->keys[s->index++];
+    record->size = sizeof(uint32_t);
+    return 1;
+  }
+
+  std::vector<uint32_t> keys;
+  size_t index;
+};
+
+static int UPS_CALLCONV
+failing_source(void *, ups_key_t *, ups_record_t *)
+{
+  return UPS_IO_ERROR;
+}
+
+struct BtreeBulkLoadFixture : BaseFixture {
+  ScopedPtr<Context> context;
+
+  BtreeBulkLoadFixture(uint32_t env_flags = 0, uint32_t db_flags = 0,
+                  uint64_t key_type = UPS_TYPE_UINT32,
+                  uint64_t key_compression = 0) {
+    // uint32 compression requires 16kb pages
+    ups_parameter_t env_params[] = {
+      { UPS_PARAM_PAGESIZE, key_compression ? 1024 * 16u : 1024 * 4u },
+      { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+      { UPS_PARAM_KEY_TYPE, key_type },
+      { UPS_PARAM_RECORD_SIZE, sizeof(uint32_t) },
+      { UPS_PARAM_KEY_COMPRESSION, key_compression },
+      { 0, 0 }
+    };
+    if (!key_compression)
+      db_params[2].name = 0;
+
+    require_create(env_flags, env_params, db_flags, db_params);
+    context.reset(new Context(lenv(), 0, 0));
+  }
+
+  ~BtreeBulkLoadFixture() {
+    context->changeset.clear();
+    close();
+  }
+
+  // Returns the number of leaf pages
+  size_t count_leaves() {
+    BtreeIndex *btree = btree_index();
+    Page *page = btree->root_page(context.get());
+    BtreeNodeProxy *node = btree->get_node_from_page(page);
+    while (!node->is_leaf()) {
+      page = page_manager()->fetch(context.get(), node->left_child());
+      node = btree->get_node_from_page(page);
+    }
+
+    size_t leaves = 1;
+    while (node->right_sibling()) {
+      page = page_manager()->fetch(context.get(), node->right_sibling());
+      node = btree->get_node_from_page(page);
+      leaves++;
+    }
+    context->changeset.clear();
+    return leaves;
+  }
+
+  void require_keys(uint32_t start, uint32_t end, bool binary = false,
+                  uint64_t expected_count = 0) {
+    REQUIRE(0 == ups_db_check_integrity(db, 0));
+
+    uint64_t count;
+    REQUIRE(0 == ups_db_count(db, 0, 0, &count));
+    REQUIRE(count == (expected_count ? expected_count : end - start));
+
+    BulkLoadSource source(start, end, binary);
+    ups_key_t key = {0};
+    ups_record_t record = {0};
+    ups_record_t found = {0};
+    while (BulkLoadSource::next(&source, &key, &record)) {
+      REQUIRE(0 == ups_db_find(db, 0, &key, &found, 0));
+      REQUIRE(found.size == record.size);
+      REQUIRE(0 == ::memcmp(found.data, record.data, record.size));
+    }
+  }
+
+  void podKeysTest() {
+    BulkLoadSource source(0, 50000);
+    REQUIRE(0 == ups_db_bulk_load(db, BulkLoadSource::next, &source, 0, 0));
+    require_keys(0, 50000);
+
+    // the leaves are completely filled
+    size_t capacity = btree_index()->get_node_from_page(
+                page_manager()->fetch(context.get(),
+                    btree_index()->root_page(context.get())->address()))
+                        ->estimate_capacity();
+    context->changeset.clear();
+    REQUIRE(count_leaves() <= 50000 / capacity + 2);
+
+    // the keys survive closing and reopening the Environment
+    close();
+    require_open();
+    require_keys(0, 50000);
+  }
+
+  void binaryKeysTest() {
+    BulkLoadSource source(0, 20000, true);
+    REQUIRE(0 == ups_db_bulk_load(db, BulkLoadSource::next, &source, 0, 0));
+    require_keys(0, 20000, true);
+  }
+
+  void appendTest() {
+    for (uint32_t i = 0; i < 1000; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t record = ups_make_record(&i, sizeof(i));
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+    }
+
+    BulkLoadSource source(1000, 20000);
+    REQUIRE(0 == ups_db_bulk_load(db, BulkLoadSource::next, &source, 0, 0));
+    BulkLoadSource source2(20000, 30000);
+    REQUIRE(0 == ups_db_bulk_load(db, BulkLoadSource::next, &source2, 0, 0));
+    require_keys(0, 30000);
+
+    // regular inserts still work
+    uint32_t i = 40000;
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(&i, sizeof(i));
+    REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+    REQUIRE(0 == ups_db_check_integrity(db, 0));
+  }
+
+  void unsortedTest() {
+    UnsortedSource source;
+    source.index = 0;
+    source.keys.push_back(1);
+    source.keys.push_back(3);
+    source.keys.push_back(2);
+    REQUIRE(UPS_INV_PARAMETER == ups_db_bulk_load(db, UnsortedSource::next,
+                            &source, 0, 0));
+
+    // the keys before the error were loaded
+    REQUIRE(0 == ups_db_check_integrity(db, 0));
+    uint64_t count;
+    REQUIRE(0 == ups_db_count(db, 0, 0, &count));
+    REQUIRE(count == 2);
+
+    // keys which are smaller than the existing ones are rejected
+    source.index = 0;
+    source.keys.clear();
+    source.keys.push_back(0);
+    REQUIRE(UPS_INV_PARAMETER == ups_db_bulk_load(db, UnsortedSource::next,
+                            &source, 0, 0));
+
+    // without duplicates, equal keys are rejected
+    source.index = 0;
+    source.keys.clear();
+    source.keys.push_back(5);
+    source.keys.push_back(5);
+    REQUIRE(UPS_DUPLICATE_KEY == ups_db_bulk_load(db, UnsortedSource::next,
+                            &source, 0, 0));
+  }
+
+  void invalidParametersTest() {
+    BulkLoadSource source(0, 10);
+    REQUIRE(UPS_INV_PARAMETER == ups_db_bulk_load(0, BulkLoadSource::next,
+                            &source, 0, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_db_bulk_load(db, 0, &source, 0, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_db_bulk_load(db, BulkLoadSource::next,
+                            &source, 101, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_db_bulk_load(db, BulkLoadSource::next,
+                            &source, 0, 1));
+
+    // errors of the source are returned to the caller
+    REQUIRE(UPS_IO_ERROR == ups_db_bulk_load(db, failing_source, 0, 0, 0));
+  }
+
+  void fillFactorTest() {
+    BulkLoadSource source(0, 20000);
+    REQUIRE(0 == ups_db_bulk_load(db, BulkLoadSource::next, &source, 0, 0));
+    size_t full = count_leaves();
+
+    ups_db_t *db2;
+    ups_parameter_t db_params[] = {
+      { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+      { UPS_PARAM_RECORD_SIZE, sizeof(uint32_t) },
+      { 0, 0 }
+    };
+    REQUIRE(0 == ups_env_create_db(env, &db2, 2, 0, &db_params[0]));
+    std::swap(db, db2);
+    BulkLoadSource source2(0, 20000);
+    REQUIRE(0 == ups_db_bulk_load(db, BulkLoadSource::next, &source2, 50, 0));
+    size_t half = count_leaves();
+    require_keys(0, 20000);
+    std::swap(db, db2);
+
+    REQUIRE(half >= full * 2 - 2);
+    REQUIRE(half <= full * 2 + 2);
+  }
+
+  void duplicatesTest() {
+    BulkLoadSource source(0, 5000, false, 3);
+    REQUIRE(0 == ups_db_bulk_load(db, BulkLoadSource::next, &source, 0, 0));
+    REQUIRE(0 == ups_db_check_integrity(db, 0));
+
+    uint64_t count;
+    REQUIRE(0 == ups_db_count(db, 0, 0, &count));
+    REQUIRE(count == 5000 * 3);
+    REQUIRE(0 == ups_db_count(db, 0, UPS_SKIP_DUPLICATES, &count));
+    REQUIRE(count == 5000);
+
+    uint32_t k = 4321;
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    uint32_t dupes;
+    ups_cursor_t *cursor;
+    REQUIRE(0 == ups_cursor_create(&cursor, db, 0, 0));
+    REQUIRE(0 == ups_cursor_find(cursor, &key, 0, 0));
+    REQUIRE(0 == ups_cursor_get_duplicate_count(cursor, &dupes, 0));
+    REQUIRE(dupes == 3);
+    REQUIRE(0 == ups_cursor_close(cursor));
+  }
+
+  void txnTest() {
+    ups_txn_t *txn;
+    uint32_t k = 1;
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    ups_record_t record = ups_make_record(&k, sizeof(k));
+    REQUIRE(0 == ups_txn_begin(&txn, env, 0, 0, 0));
+    REQUIRE(0 == ups_db_insert(db, txn, &key, &record, 0));
+
+    BulkLoadSource source(100, 10000);
+    REQUIRE(UPS_TXN_STILL_OPEN == ups_db_bulk_load(db, BulkLoadSource::next,
+                            &source, 0, 0));
+    REQUIRE(0 == ups_txn_commit(txn, 0));
+    REQUIRE(0 == ups_db_bulk_load(db, BulkLoadSource::next, &source, 0, 0));
+    require_keys(100, 10000, false, 10000 - 100 + 1);
+    ups_record_t found = {0};
+    REQUIRE(0 == ups_db_find(db, 0, &key, &found, 0));
+
+    // the loaded keys are visible to the Transactions
+    k = 9999;
+    REQUIRE(UPS_DUPLICATE_KEY == ups_db_insert(db, 0, &key, &record, 0));
+    k = 10000;
+    REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+
+    // ... and the journal can be recovered
+    close(UPS_AUTO_CLEANUP | UPS_DONT_CLEAR_LOG);
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY);
+    require_keys(100, 10001, false, 10001 - 100 + 1);
+  }
+
+  void recordNumberTest() {
+    BulkLoadSource source(1, 10001);
+    REQUIRE(0 == ups_db_bulk_load(db, BulkLoadSource::next, &source, 0, 0));
+    require_keys(1, 10001);
+
+    // the next record number follows the loaded keys
+    uint32_t recno = 0;
+    ups_key_t key = ups_make_key(&recno, sizeof(recno));
+    key.flags = UPS_KEY_USER_ALLOC;
+    ups_record_t record = ups_make_record(&recno, sizeof(recno));
+    REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+    REQUIRE(recno == 10001);
+  }
+};
+
+TEST_CASE("BtreeBulkLoad/podKeysTest", "")
+{
+  BtreeBulkLoadFixture f;
+  f.podKeysTest();
+}
+
+TEST_CASE("BtreeBulkLoad/zint32KeysTest", "")
+{
+  BtreeBulkLoadFixture f(0, 0, UPS_TYPE_UINT32,
+                  UPS_COMPRESSOR_UINT32_VARBYTE);
+  f.podKeysTest();
+}
+
+TEST_CASE("BtreeBulkLoad/binaryKeysTest", "")
+{
+  BtreeBulkLoadFixture f(0, 0, UPS_TYPE_BINARY);
+  f.binaryKeysTest();
+}
+
+TEST_CASE("BtreeBulkLoad/appendTest", "")
+{
+  BtreeBulkLoadFixture f;
+  f.appendTest();
+}
+
+TEST_CASE("BtreeBulkLoad/unsortedTest", "")
+{
+  BtreeBulkLoadFixture f;
+  f.unsortedTest();
+}
+
+TEST_CASE("BtreeBulkLoad/invalidParametersTest", "")
+{
+  BtreeBulkLoadFixture f;
+  f.invalidParametersTest();
+}
+
+TEST_CASE("BtreeBulkLoad/fillFactorTest", "")
+{
+  BtreeBulkLoadFixture f;
+  f.fillFactorTest();
+}
+
+TEST_CASE("BtreeBulkLoad/duplicatesTest", "")
+{
+  BtreeBulkLoadFixture f(0, UPS_ENABLE_DUPLICATE_KEYS);
+  f.duplicatesTest();
+}
+
+TEST_CASE("BtreeBulkLoad/txnTest", "")
+{
+  BtreeBulkLoadFixture f(UPS_ENABLE_TRANSACTIONS);
+  f.txnTest();
+}
+
+TEST_CASE("BtreeBulkLoad/recordNumberTest", "")
+{
+  BtreeBulkLoadFixture f(0, UPS_RECORD_NUMBER32);
+  f.recordNumberTest();
+}
@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+#include "3rdparty/catch/catch.hpp"
+
+#include "1os/os.h"
+
+#include "os.hpp"
+#include "fixture.hpp"
+
+using namespace upscaledb;
+
+struct BtreeCompactFixture : BaseFixture {
+  uint64_t key_type;
+
+  BtreeCompactFixture(uint32_t env_flags = 0,
+                  uint64_t key_type_ = UPS_TYPE_UINT32)
+    : key_type(key_type_) {
+    ups_parameter_t env_params[] = {
+      { UPS_PARAM_PAGESIZE, 1024 * 4 },
+      { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+      { UPS_PARAM_KEY_TYPE, key_type },
+      { UPS_PARAM_RECORD_SIZE, sizeof(uint32_t) },
+      { 0, 0 }
+    };
+
+    require_create(env_flags, env_params, 0, db_params);
+  }
+
+  // Returns the key for |i|
+  ups_key_t make_key(uint32_t *i, char *buffer, size_t buffer_size) {
+    if (key_type == UPS_TYPE_BINARY) {
+      ::snprintf(buffer, buffer_size, "key%010u", *i);
+      return ups_make_key(buffer, (uint16_t)(::strlen(buffer) + 1));
+    }
+    return ups_make_key(i, sizeof(*i));
+  }
+
+  void insert_keys(uint32_t start, uint32_t end) {
+    char buffer[32];
+    for (uint32_t i = start; i < end; i++) {
+      ups_key_t key = make_key(&i, buffer, sizeof(buffer));
+      ups_record_t record = ups_make_record(&i, sizeof(i));
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+    }
+  }
+
+  // Erases all keys in [start, end[ except every |keep|th key
+  void erase_keys(uint32_t start, uint32_t end, uint32_t keep = 0) {
+    char buffer[32];
+    for (uint32_t i = start; i < end; i++) {
+      if (keep && i % keep == 0)
+        continue;
+      ups_key_t key = make_key(&i, buffer, sizeof(buffer));
+      REQUIRE(0 == ups_db_erase(db, 0, &key, 0));
+    }
+  }
+
+  // Verifies that the keys in [start, end[ (every |keep|th key, or all
+  // keys if |keep| is 0) exist, and that the erased keys do not exist
+  void require_keys(uint32_t start, uint32_t end, uint32_t keep = 0) {
+    REQUIRE(0 == ups_db_check_integrity(db, 0));
+
+    char buffer[32];
+    for (uint32_t i = start; i < end; i++) {
+      ups_key_t key = make_key(&i, buffer, sizeof(buffer));
+      ups_record_t record = {0};
+      if (!keep || i % keep == 0) {
+        REQUIRE(0 == ups_db_find(db, 0, &key, &record, 0));
+        REQUIRE(record.size == sizeof(i));
+        REQUIRE(*(uint32_t *)record.data == i);
+      }
+      else
+        REQUIRE(UPS_KEY_NOT_FOUND == ups_db_find(db, 0, &key, &record, 0));
+    }
+  }
+
+  ups_env_metrics_t metrics() {
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    return metrics;
+  }
+
+  uint64_t count_leaves() {
+    return metrics().btree_leaf_metrics.number_of_pages;
+  }
+
+  void podKeysTest() {
+    insert_keys(0, 50000);
+    erase_keys(0, 50000, 10);
+    uint64_t leaves = count_leaves();
+    uint64_t file_size = device()->file_size();
+    uint64_t relocated = metrics().btree_smo_relocate;
+
+    REQUIRE(0 == ups_db_compact(db, 0, 0, 0));
+    require_keys(0, 50000, 10);
+
+    // the remaining keys fit into a quarter of the leaves
+    REQUIRE(count_leaves() < leaves / 4);
+    // ... which were moved to the beginning of the file
+    REQUIRE(metrics().btree_smo_relocate > relocated);
+    REQUIRE(device()->file_size() < file_size);
+
+    // the btree is still usable, and survives reopening the Environment
+    insert_keys(50000, 60000);
+    close();
+    require_open();
+    require_keys(0, 50000, 10);
+    require_keys(50000, 60000);
+  }
+
+  void binaryKeysTest() {
+    insert_keys(0, 20000);
+    // leave only few keys in each leaf, and a range of empty leaves
+    erase_keys(0, 10000, 100);
+    erase_keys(10000, 15000);
+    uint64_t leaves = count_leaves();
+
+    REQUIRE(0 == ups_db_compact(db, 0, 0, 0));
+    require_keys(0, 10000, 100);
+    require_keys(15000, 20000);
+    REQUIRE(count_leaves() < leaves);
+  }
+
+  void emptyTest() {
+    // an empty btree and a single leaf are not modified
+    REQUIRE(0 == ups_db_compact(db, 0, 0, 0));
+    insert_keys(0, 10);
+    REQUIRE(0 == ups_db_compact(db, 0, 0, 0));
+    require_keys(0, 10);
+
+    // all leaves are merged into the root
+    insert_keys(10, 5000);
+    erase_keys(0, 5000, 1000);
+    REQUIRE(0 == ups_db_compact(db, 0, 0, 0));
+    require_keys(0, 5000, 1000);
+    REQUIRE(count_leaves() == 1);
+  }
+
+  void budgetTest() {
+    // requires more than one internal node above the leaves
+    insert_keys(0, 400000);
+    erase_keys(0, 400000, 10);
+
+    // each call visits at least one page, and continues where the previous
+    // call stopped
+    int calls = 0;
+    ups_status_t st;
+    while ((st = ups_db_compact(db, 1, 0, 0)) == UPS_LIMITS_REACHED) {
+      calls++;
+      REQUIRE(0 == ups_db_check_integrity(db, 0));
+
+      // modifications between two calls are allowed
+      if (calls == 2) {
+        insert_keys(400000, 401000);
+        erase_keys(400000, 401000);
+      }
+    }
+    REQUIRE(st == 0);
+    REQUIRE(calls > 1);
+    require_keys(0, 400000, 10);
+
+    // the next call starts again at the left edge
+    REQUIRE(UPS_LIMITS_REACHED == ups_db_compact(db, 1, 0, 0));
+    REQUIRE(0 == ups_db_compact(db, 0, 0, 0));
+  }
+
+  void cursorTest() {
+    insert_keys(0, 20000);
+    erase_keys(0, 20000, 10);
+
+    ups_cursor_t *cursor;
+    REQUIRE(0 == ups_cursor_create(&cursor, db, 0, 0));
+    uint32_t k = 12340;
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    REQUIRE(0 == ups_cursor_find(cursor, &key, 0, 0));
+
+    REQUIRE(0 == ups_db_compact(db, 0, 0, 0));
+
+    // the cursor still points to its key
+    ups_key_t found = {0};
+    REQUIRE(0 == ups_cursor_move(cursor, &found, 0, 0));
+    REQUIRE(*(uint32_t *)found.data == 12340);
+    REQUIRE(0 == ups_cursor_move(cursor, &found, 0, UPS_CURSOR_NEXT));
+    REQUIRE(*(uint32_t *)found.data == 12350);
+    REQUIRE(0 == ups_cursor_close(cursor));
+  }
+
+  void recoveryTest() {
+    insert_keys(0, 20000);
+    erase_keys(0, 20000, 10);
+    REQUIRE(0 == ups_db_compact(db, 0, 0, 0));
+    require_keys(0, 20000, 10);
+
+    close(UPS_AUTO_CLEANUP | UPS_DONT_CLEAR_LOG);
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY);
+    require_keys(0, 20000, 10);
+  }
+
+  void inMemoryTest() {
+    insert_keys(0, 20000);
+    erase_keys(0, 20000, 10);
+    uint64_t leaves = count_leaves();
+
+    REQUIRE(0 == ups_db_compact(db, 0, 0, 0));
+    require_keys(0, 20000, 10);
+    REQUIRE(count_leaves() < leaves / 4);
+  }
+
+  void backgroundTest() {
+    insert_keys(0, 50000);
+    erase_keys(0, 50000, 10);
+    uint64_t leaves = count_leaves();
+
+    REQUIRE(0 == ups_db_compact(db, 0, 0, UPS_COMPACT_IN_BACKGROUND));
+
+    // the Database can be used while the compaction is running
+    require_keys(0, 50000, 10);
+
+    while (ldb()->compaction_pending)
+      os_sleep_msec(1);
+    require_keys(0, 50000, 10);
+    REQUIRE(count_leaves() < leaves / 4);
+
+    // closing the Database cancels the compaction
+    insert_keys(50000, 100000);
+    erase_keys(50000, 100000, 10);
+    REQUIRE(0 == ups_db_compact(db, 1, 0, UPS_COMPACT_IN_BACKGROUND));
+    close();
+    require_open();
+    require_keys(0, 100000, 10);
+  }
+
+  void invalidParametersTest() {
+    REQUIRE(UPS_INV_PARAMETER == ups_db_compact(0, 0, 0, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_db_compact(db, 0, 0, 2));
+
+    close();
+    require_open(UPS_READ_ONLY);
+    REQUIRE(UPS_WRITE_PROTECTED == ups_db_compact(db, 0, 0, 0));
+  }
+};
+
+TEST_CASE("BtreeCompact/podKeysTest", "")
+{
+  BtreeCompactFixture f;
+  f.podKeysTest();
+}
+
+TEST_CASE("BtreeCompact/binaryKeysTest", "")
+{
+  BtreeCompactFixture f(0, UPS_TYPE_BINARY);
+  f.binaryKeysTest();
+}
+
+TEST_CASE("BtreeCompact/emptyTest", "")
+{
+  BtreeCompactFixture f;
+  f.emptyTest();
+}
+
+TEST_CASE("BtreeCompact/budgetTest", "")
+{
+  BtreeCompactFixture f;
+  f.budgetTest();
+}
+
+TEST_CASE("BtreeCompact/cursorTest", "")
+{
+  BtreeCompactFixture f;
+  f.cursorTest();
+}
+
+TEST_CASE("BtreeCompact/recoveryTest", "")
+{
+  BtreeCompactFixture f(UPS_ENABLE_TRANSACTIONS);
+  f.recoveryTest();
+}
+
+TEST_CASE("BtreeCompact/inMemoryTest", "")
+{
+  BtreeCompactFixture f(UPS_IN_MEMORY);
+  f.inMemoryTest();
+}
+
+TEST_CASE("BtreeCompact/backgroundTest", "")
+{
+  BtreeCompactFixture f;
+  f.backgroundTest();
+}
+
+TEST_CASE("BtreeCompact/invalidParametersTest", "")
+{
+  BtreeCompactFixture f;
+  f.invalidParametersTest();
+}
@@ -283,6 +283,41 @@ struct BtreeCursorFixture : BaseFixture {
     REQUIRE(btc->is_coupled() == true);
     REQUIRE(btc->is_uncoupled() == false);
   }
+
+  void readAheadTest() {
+    const int kCount = 5000;
+    char buffer[16];
+    ups_key_t key = {0};
+    ups_record_t rec = {0};
+
+    for (int i = 0; i < kCount; i++) {
+      ::snprintf(buffer, sizeof(buffer), "%08d", i);
+      key = ups_make_key(buffer, 9);
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &rec, 0));
+    }
+
+    /* reopen the file; only the root page is cached */
+    context->changeset.clear();
+    close();
+    require_open(UPS_DISABLE_MMAP);
+    context.reset(new Context(lenv(), 0, 0));
+
+    ups_cursor_t *c;
+    REQUIRE(0 == ups_cursor_create(&c, db, 0, 0));
+    int i = 0;
+    while (0 == ups_cursor_move(c, &key, 0, UPS_CURSOR_NEXT)) {
+      ::snprintf(buffer, sizeof(buffer), "%08d", i++);
+      REQUIRE(0 == ::strcmp(buffer, (const char *)key.data));
+    }
+    REQUIRE(i == kCount);
+    REQUIRE(0 == ups_cursor_close(c));
+
+    /* the leafs were read ahead */
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.page_count_prefetched > 0);
+    REQUIRE(metrics.page_count_prefetched < metrics.page_count_fetched);
+  }
 };
 
 TEST_CASE("BtreeCursor/createCloseTest", "")
@@ -339,6 +374,12 @@ TEST_CASE("BtreeCursor/couplingTest", "")
   f.couplingTest();
 }
 
+TEST_CASE("BtreeCursor/readAheadTest", "")
+{
+  BtreeCursorFixture f;
+  f.readAheadTest();
+}
+
 
 TEST_CASE("BtreeCursor/64k/createCloseTest", "")
 {
@@ -16,6 +16,8 @@
  * See the file COPYING for License information.
  */
 
+#include <set>
+#include <string>
 #include <vector>
 #include <algorithm>
 
@@ -1761,4 +1763,237 @@ TEST_CASE("BtreeDefault/UpfrontIndex/splitMergeTest", "")
   }
 }
 
+static int
+reverse_compare(ups_db_t *db, const uint8_t *lhs, uint32_t lhs_size,
+                const uint8_t *rhs, uint32_t rhs_size)
+{
+  int m = ::memcmp(lhs, rhs, std::min(lhs_size, rhs_size));
+  if (m == 0)
+    m = lhs_size < rhs_size ? -1 : (lhs_size > rhs_size ? +1 : 0);
+  return -m;
+}
+
+struct KeyHeadsFixture : BaseFixture {
+  typedef std::set<std::string> StringSet;
+
+  bool reverse;
+  StringSet keys;
+
+  KeyHeadsFixture(uint32_t compressor = 0, bool reverse_ = false)
+    : reverse(reverse_) {
+    ups_parameter_t p1[] = {
+      { UPS_PARAM_PAGESIZE, 1024 * 4 },
+      { 0, 0 }
+    };
+    ups_parameter_t p2[] = {
+      { UPS_PARAM_KEY_TYPE,
+            (uint64_t)(reverse ? UPS_TYPE_CUSTOM : UPS_TYPE_BINARY) },
+      { (uint32_t)(compressor ? UPS_PARAM_KEY_COMPRESSION : 0), compressor },
+      { 0, 0 }
+    };
+
+    require_create(0, p1, 0, p2);
+    if (reverse)
+      REQUIRE(0 == ups_db_set_compare_func(db, reverse_compare));
+  }
+
+  // Most keys share a long prefix; a few of them are extended keys,
+  // others do not share the prefix or are shorter than the prefix
+  std::string make_key(int i) {
+    char buffer[32];
+    ::snprintf(buffer, sizeof(buffer), "%08d", i);
+    if (i % 97 == 0)
+      return buffer;
+    if (i % 13 == 0)
+      return std::string("ftp://example.com/") + buffer;
+    std::string key("http://www.example.com/index/");
+    if (i % 7 == 0)
+      key += std::string(200, 'x');
+    return key + buffer;
+  }
+
+  void insert(const std::string &s) {
+    ups_key_t key = ups_make_key((void *)s.data(), (uint16_t)s.size());
+    ups_record_t record = {0};
+    REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+    keys.insert(s);
+  }
+
+  void erase(const std::string &s) {
+    ups_key_t key = ups_make_key((void *)s.data(), (uint16_t)s.size());
+    REQUIRE(0 == ups_db_erase(db, 0, &key, 0));
+    keys.erase(s);
+  }
+
+  // Looks up |s| with |flags|; returns the key that was found, or "-" if
+  // no key was found
+  std::string find(const std::string &s, uint32_t flags) {
+    ups_key_t key = ups_make_key((void *)s.data(), (uint16_t)s.size());
+    ups_record_t record = {0};
+    ups_status_t st = ups_db_find(db, 0, &key, &record, flags);
+    if (st == UPS_KEY_NOT_FOUND)
+      return "-";
+    REQUIRE(st == 0);
+    return std::string((const char *)key.data, key.size);
+  }
+
+  void verify() {
+    REQUIRE(0 == ups_db_check_integrity(db, 0));
+
+    // the cursor returns the keys in the order of the comparator
+    ups_cursor_t *cursor;
+    REQUIRE(0 == ups_cursor_create(&cursor, db, 0, 0));
+    ups_key_t key = {0};
+    if (reverse) {
+      for (StringSet::reverse_iterator it = keys.rbegin();
+              it != keys.rend(); it++) {
+        REQUIRE(0 == ups_cursor_move(cursor, &key, 0, UPS_CURSOR_NEXT));
+        REQUIRE(*it == std::string((const char *)key.data, key.size));
+      }
+    }
+    else {
+      for (StringSet::iterator it = keys.begin(); it != keys.end(); it++) {
+        REQUIRE(0 == ups_cursor_move(cursor, &key, 0, UPS_CURSOR_NEXT));
+        REQUIRE(*it == std::string((const char *)key.data, key.size));
+      }
+    }
+    REQUIRE(UPS_KEY_NOT_FOUND == ups_cursor_move(cursor, &key, 0,
+                            UPS_CURSOR_NEXT));
+    REQUIRE(0 == ups_cursor_close(cursor));
+
+    for (StringSet::iterator it = keys.begin(); it != keys.end(); it++) {
+      REQUIRE(*it == find(*it, 0));
+
+      // approximate matches between two keys
+      if (reverse)
+        continue;
+      std::string probe = *it + '\0';
+      StringSet::iterator next = keys.upper_bound(probe);
+      REQUIRE(*it == find(probe, UPS_FIND_LT_MATCH));
+      REQUIRE((next == keys.end() ? "-" : *next)
+                      == find(probe, UPS_FIND_GT_MATCH));
+    }
+  }
+
+  void insertEraseTest() {
+    const int kMax = 5003;
+
+    // insert in pseudo-random order
+    for (int i = 0; i < kMax; i++)
+      insert(make_key((i * 7919) % kMax));
+    verify();
+
+    // erase every third key; keys which are not found are rejected
+    for (int i = 0; i < kMax; i += 3) {
+      erase(make_key((i * 4001) % kMax));
+      REQUIRE("-" == find(make_key((i * 4001) % kMax), 0));
+    }
+    verify();
+
+    // insert keys which are smaller and greater than all existing keys
+    insert("");
+    insert("a");
+    insert("http://www.example.com/index");
+    insert("http://www.example.com/index/~");
+    insert("zzzzzzzz");
+    verify();
+
+    // and everything survives reopening the Environment (custom compare
+    // functions would have to be registered for this)
+    if (!reverse) {
+      close();
+      require_open();
+      verify();
+    }
+  }
+
+  void keyHeadTest() {
+    const char *strings[] = {
+      "", "\0", "\0\0", "a", "a\0", "a\0\x01", "ab", "abcdefgh", "abcdefgh\0",
+      "abcdefghi", "abcdefgi", "b", "\xff", "\xff\xff\xff\xff\xff\xff\xff\xff"
+    };
+    size_t sizes[] = {0, 1, 2, 1, 2, 3, 2, 8, 9, 9, 8, 1, 1, 8};
+
+    // the key heads are in the same order as the keys; identical heads
+    // are possible
+    for (size_t i = 0; i + 1 < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      uint64_t lhs = VariableLengthKeyList::key_head(
+                      (const uint8_t *)strings[i], sizes[i]);
+      uint64_t rhs = VariableLengthKeyList::key_head(
+                      (const uint8_t *)strings[i + 1], sizes[i + 1]);
+      REQUIRE(lhs <= rhs);
+    }
+    REQUIRE(VariableLengthKeyList::key_head((const uint8_t *)"a", 1)
+              == VariableLengthKeyList::key_head((const uint8_t *)"a\0", 2));
+    REQUIRE(VariableLengthKeyList::key_head((const uint8_t *)"abcdefgh", 8)
+                    == 0x6162636465666768ull);
+  }
+
+  uint64_t blobs_read() {
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    return metrics.blob_total_read;
+  }
+
+  void unresolvedHeadsTest() {
+    const int kMax = 2000;
+    for (int i = 0; i < kMax; i++)
+      insert(make_key(i));
+    close();
+    require_open();
+
+    Cache &cache = lenv()->page_manager->state->cache;
+    REQUIRE(cache.heap_bytes() == 0u);
+
+    // the extended keys are not loaded when the heads are built; only
+    // the first and the last key of a node, and the keys that are
+    // compared in the search
+    uint64_t before = blobs_read();
+    REQUIRE(make_key(1001) == find(make_key(1001), 0));
+    REQUIRE(blobs_read() - before < 4);
+
+    // the heads are accounted by the cache, and released with the nodes
+    REQUIRE(cache.heap_bytes() > 0u);
+    size_t capacity = cache.capacity_pages();
+    cache.account_heap(0, cache.capacity() / 2);
+    REQUIRE(cache.capacity_pages() < capacity);
+    cache.account_heap(cache.capacity() / 2, 0);
+
+    verify();
+    REQUIRE(0 == ups_db_close(db, 0));
+    db = 0;
+    REQUIRE(cache.heap_bytes() == 0u);
+  }
+};
+
+TEST_CASE("BtreeDefault/KeyHeads/keyHeadTest", "")
+{
+  KeyHeadsFixture f;
+  f.keyHeadTest();
+}
+
+TEST_CASE("BtreeDefault/KeyHeads/insertEraseTest", "")
+{
+  KeyHeadsFixture f;
+  f.insertEraseTest();
+}
+
+TEST_CASE("BtreeDefault/KeyHeads/compressedTest", "")
+{
+  KeyHeadsFixture f(UPS_COMPRESSOR_LZF);
+  f.insertEraseTest();
+}
+
+TEST_CASE("BtreeDefault/KeyHeads/customCompareTest", "")
+{
+  KeyHeadsFixture f(0, true);
+  f.insertEraseTest();
+}
+
+TEST_CASE("BtreeDefault/KeyHeads/unresolvedHeadsTest", "")
+{
+  KeyHeadsFixture f;
+  f.unresolvedHeadsTest();
+}
+
 } // namespace upscaledb
@@ -178,6 +178,48 @@ struct DeviceFixture : BaseFixture {
       pp.require_payload(temp, page_size - Page::kSizeofPersistentHeader);
     }
   }
+
+  void batchReadWriteTest() {
+    uint32_t page_size = UPS_DEFAULT_PAGE_SIZE;
+    std::vector<std::vector<uint8_t>> buffers(10);
+    std::vector<uint8_t> temp(page_size);
+
+    EnvConfig &cfg = const_cast<EnvConfig &>(lenv()->config);
+    cfg.flags |= UPS_DISABLE_MMAP;
+
+    DeviceProxy dp(lenv());
+    dp.require_open()
+      .require_truncate(page_size * 20);
+
+    // pages 0-4 are adjacent, pages 5-9 have gaps
+    std::vector<IoRequest> requests(10);
+    for (uint8_t i = 0; i < 10; i++) {
+      buffers[i].resize(page_size);
+      std::fill(buffers[i].begin(), buffers[i].end(), i + 1);
+      requests[i].offset = (i < 5 ? i : i * 2) * page_size;
+      requests[i].buffer = buffers[i].data();
+      requests[i].length = page_size;
+    }
+    REQUIRE(device()->write_batch(requests.data(), requests.size()) > 0);
+
+    for (uint8_t i = 0; i < 10; i++) {
+      dp.require_read(requests[i].offset, temp.data(), page_size);
+      REQUIRE(0 == ::memcmp(buffers[i].data(), temp.data(), page_size));
+    }
+
+    std::vector<Page *> pages(10);
+    std::vector<uint64_t> addresses(10);
+    for (uint8_t i = 0; i < 10; i++) {
+      pages[i] = new Page(device());
+      addresses[i] = requests[i].offset;
+    }
+    device()->read_pages(pages.data(), addresses.data(), pages.size());
+    for (uint8_t i = 0; i < 10; i++) {
+      REQUIRE(pages[i]->address() == addresses[i]);
+      REQUIRE(0 == ::memcmp(buffers[i].data(), pages[i]->data(), page_size));
+      delete pages[i];
+    }
+  }
 };
 
 TEST_CASE("Device/newDelete", "")
@@ -234,6 +276,12 @@ TEST_CASE("Device/readWritePage", "")
   f.readWritePageTest();
 }
 
+TEST_CASE("Device/batchReadWrite", "")
+{
+  DeviceFixture f(false);
+  f.batchReadWriteTest();
+}
+
 
 TEST_CASE("Device/inmem/newDelete", "")
 {
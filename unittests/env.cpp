@@ -19,7 +19,12 @@
 #include "3rdparty/catch/catch.hpp"
 
 #include <stdint.h>
+#include <string>
+#include <vector>
 
+#include "ups/upscaledb_uqi.h"
+
+#include "1os/os.h"
 #include "4db/db_local.h"
 #include "4env/env_local.h"
 
@@ -851,6 +856,374 @@ struct EnvFixture {
     for (int i = 0; i < 10; i++)
       REQUIRE(0 == ups_env_create_db(bf.env, &db[i], (uint16_t)i + 1, 0, 0));
   }
+
+  // every 10th key is an extended key
+  static std::string concurrent_key(const char *prefix, int i) {
+    char buffer[32];
+    ::sprintf(buffer, "%s%08d", prefix, i);
+    std::string s(buffer);
+    if (i % 10 == 0)
+      s.append(600, 'x');
+    return s;
+  }
+
+  static void concurrent_reader(ups_env_t *env, ups_db_t *db, int count,
+                  boost::atomic<int> *errors) {
+    char buffer[32];
+
+    for (int i = 0; i < count; i++) {
+      std::string s = concurrent_key("key", i);
+      ups_key_t key = ups_make_key((void *)s.data(), (uint16_t)s.size());
+      ups_record_t record = {0};
+      ::sprintf(buffer, "rec%08d", i);
+      if (0 != ups_db_find(db, 0, &key, &record, 0)
+          || record.size != ::strlen(buffer) + 1
+          || ::strcmp(buffer, (const char *)record.data))
+        (*errors)++;
+    }
+
+    // the concurrent writer inserts keys with a different prefix
+    ups_cursor_t *cursor;
+    if (0 != ups_cursor_create(&cursor, db, 0, 0)) {
+      (*errors)++;
+      return;
+    }
+    int found = 0;
+    ups_key_t key = {0};
+    while (0 == ups_cursor_move(cursor, &key, 0, UPS_CURSOR_NEXT)) {
+      if (::strncmp("key", (const char *)key.data, 3) == 0)
+        found++;
+    }
+    if (found != count)
+      (*errors)++;
+    ups_cursor_close(cursor);
+
+    uint64_t keycount;
+    if (0 != ups_db_count(db, 0, 0, &keycount) || keycount < (uint64_t)count)
+      (*errors)++;
+
+    uqi_result_t *result;
+    if (0 != uqi_select(env, "count($key) from database 1", &result)) {
+      (*errors)++;
+      return;
+    }
+    uint32_t size;
+    uint64_t *value = (uint64_t *)uqi_result_get_record_data(result, &size);
+    if (*value < (uint64_t)count)
+      (*errors)++;
+    uqi_result_close(result);
+
+    // these only require the shared lock
+    ups_parameter_t params[] = {
+        { UPS_PARAM_MAX_KEYS_PER_PAGE, 0 },
+        { 0, 0 }
+    };
+    if (0 != ups_db_get_parameters(db, params) || params[0].value == 0)
+      (*errors)++;
+    params[0].name = UPS_PARAM_PAGE_SIZE;
+    if (0 != ups_env_get_parameters(env, params) || params[0].value == 0)
+      (*errors)++;
+    uint16_t names[4];
+    uint32_t length = 4;
+    if (0 != ups_env_get_database_names(env, names, &length) || length != 1)
+      (*errors)++;
+    if (ups_get_context_data(db, false) != (void *)env)
+      (*errors)++;
+  }
+
+  static void concurrent_writer(ups_db_t *db, int count,
+                  boost::atomic<int> *errors) {
+    for (int i = 0; i < count; i++) {
+      std::string s = concurrent_key("new", i);
+      ups_key_t key = ups_make_key((void *)s.data(), (uint16_t)s.size());
+      ups_record_t record = ups_make_record((void *)s.data(),
+                      (uint32_t)s.size());
+      if (0 != ups_db_insert(db, 0, &key, &record, 0))
+        (*errors)++;
+    }
+  }
+
+  void concurrentReadsTest() {
+    const int kCount = 5000;
+    const int kReaders = 4;
+    char buffer[32];
+
+    // not allowed in combination with Transactions
+    BaseFixture bf;
+    bf.require_create(m_flags | UPS_ENABLE_CONCURRENT_READS
+                    | UPS_ENABLE_TRANSACTIONS, UPS_INV_PARAMETER);
+
+    // use a small cache to make sure that the cache is purged
+    ups_parameter_t params[] = {
+        { UPS_PARAM_CACHE_SIZE, 64 * 1024 },
+        { 0, 0 }
+    };
+    bf.require_create(m_flags | UPS_ENABLE_CONCURRENT_READS,
+                    NOTSET(m_flags, UPS_IN_MEMORY) ? params : 0);
+    REQUIRE(bf.ldb()->concurrent_reads == true);
+
+    for (int i = 0; i < kCount; i++) {
+      std::string s = concurrent_key("key", i);
+      ups_key_t key = ups_make_key((void *)s.data(), (uint16_t)s.size());
+      ::sprintf(buffer, "rec%08d", i);
+      ups_record_t record = ups_make_record(buffer,
+                      (uint32_t)::strlen(buffer) + 1);
+      REQUIRE(0 == ups_db_insert(bf.db, 0, &key, &record, 0));
+    }
+
+    ups_set_context_data(bf.db, bf.env);
+
+    boost::atomic<int> errors(0);
+    std::vector<Thread *> threads;
+    for (int i = 0; i < kReaders; i++)
+      threads.push_back(new Thread(boost::bind(&concurrent_reader, bf.env,
+                              bf.db, kCount, &errors)));
+    threads.push_back(new Thread(boost::bind(&concurrent_writer, bf.db,
+                              kCount / 10, &errors)));
+    for (size_t i = 0; i < threads.size(); i++) {
+      threads[i]->join();
+      delete threads[i];
+    }
+    REQUIRE(errors == 0);
+
+    DbProxy dbp(bf.db);
+    dbp.require_check_integrity()
+       .require_key_count(kCount + kCount / 10);
+  }
+
+  // looks up the stable (even) keys while the writers modify the tree;
+  // the temporary keys are either missing or have the correct record
+  static void optimistic_reader(ups_db_t *db, int count, uint64_t seed,
+                  boost::atomic<bool> *done, boost::atomic<int> *errors) {
+    while (!*done) {
+      seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+      uint64_t k = ((seed >> 33) % count) * 2;
+      ups_key_t key = ups_make_key(&k, sizeof(k));
+      ups_record_t record = {0};
+      if (0 != ups_db_find(db, 0, &key, &record, 0)
+          || record.size != sizeof(uint64_t)
+          || *(uint64_t *)record.data != k)
+        (*errors)++;
+
+      k += 1;
+      key = ups_make_key(&k, sizeof(k));
+      ups_status_t st = ups_db_find(db, 0, &key, &record, 0);
+      if (st == 0 && *(uint64_t *)record.data != k)
+        (*errors)++;
+      else if (st != 0 && st != UPS_KEY_NOT_FOUND)
+        (*errors)++;
+
+      uint64_t keydata[16];
+      ups_key_t keys[16];
+      ups_record_t records[16];
+      ups_status_t results[16];
+      for (int i = 0; i < 16; i++) {
+        keydata[i] = (((seed >> 20) + i * 97) % count) * 2;
+        keys[i] = ups_make_key(&keydata[i], sizeof(uint64_t));
+        records[i] = ups_make_record(0, 0);
+      }
+      if (0 != ups_db_find_many(db, 0, keys, records, results, 16, 0))
+        (*errors)++;
+      for (int i = 0; i < 16; i++) {
+        if (results[i] != 0 || *(uint64_t *)records[i].data != keydata[i])
+          (*errors)++;
+      }
+    }
+  }
+
+  // inserts and erases the odd keys (splitting the leaves), and a range
+  // of keys at the end of the tree (merging the leaves)
+  static void optimistic_writer(ups_db_t *db, int count, uint64_t first,
+                  int rounds, boost::atomic<int> *errors) {
+    for (int r = 0; r < rounds; r++) {
+      for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < count / 4; i++) {
+          uint64_t ks[2] = {(first + i) * 2 + 1, 1000000 + first * 10 + i};
+          for (int j = 0; j < 2; j++) {
+            ups_key_t key = ups_make_key(&ks[j], sizeof(uint64_t));
+            ups_record_t record = ups_make_record(&ks[j], sizeof(uint64_t));
+            ups_status_t st = pass == 0
+                    ? ups_db_insert(db, 0, &key, &record, 0)
+                    : ups_db_erase(db, 0, &key, 0);
+            if (st != 0)
+              (*errors)++;
+          }
+        }
+      }
+    }
+  }
+
+  static void blocked_reader(ups_db_t *db, boost::atomic<int> *state) {
+    uint64_t k = 2;
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    ups_record_t record = {0};
+    if (0 == ups_db_find(db, 0, &key, &record, 0)
+        && *(uint64_t *)record.data == k)
+      *state = 1;
+    else
+      *state = 2;
+  }
+
+  // |layout| is the UPS_PARAM_INTERNAL_NODE_LAYOUT; the search trees of
+  // UPS_NODE_LAYOUT_BTREE are built by the readers, and writers then
+  // lock the Environment exclusively
+  void concurrentWritesTest(int layout) {
+    const int kCount = 10000;
+    const int kReaders = 4;
+    const int kWriters = 2;
+
+    // small pages for a deep tree with many splits and merges
+    ups_parameter_t env_params[] = {
+        { UPS_PARAM_PAGE_SIZE, 1024 },
+        { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+        { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT64 },
+        { UPS_PARAM_RECORD_SIZE, sizeof(uint64_t) },
+        { UPS_PARAM_INTERNAL_NODE_LAYOUT, (uint64_t)layout },
+        { 0, 0 }
+    };
+    bool concurrent = layout != UPS_NODE_LAYOUT_BTREE;
+
+    // not with variable length keys
+    BaseFixture bf;
+    bf.require_create(m_flags | UPS_ENABLE_CONCURRENT_READS);
+    REQUIRE(bf.ldb()->concurrent_reads == true);
+    REQUIRE(bf.ldb()->concurrent_writes == false);
+    bf.close();
+
+    bf.require_create(m_flags | UPS_ENABLE_CONCURRENT_READS, env_params,
+                    0, db_params);
+    REQUIRE(bf.ldb()->concurrent_writes == concurrent);
+
+    for (int i = 0; i < kCount; i++) {
+      uint64_t k = i * 2;
+      ups_key_t key = ups_make_key(&k, sizeof(k));
+      ups_record_t record = ups_make_record(&k, sizeof(k));
+      REQUIRE(0 == ups_db_insert(bf.db, 0, &key, &record, 0));
+    }
+
+    // a lookup is not blocked by a writer; it restarts while a page is
+    // locked, and completes as soon as the page is unlocked
+    if (concurrent) {
+      ScopedEnvWriteLock lock(bf.lenv(), true);
+      Page *root = bf.btree_index()->state.root_page;
+      root->version_lock().write_lock();
+
+      boost::atomic<int> state(0);
+      Thread thread(boost::bind(&blocked_reader, bf.db, &state));
+      os_sleep_msec(50);
+      REQUIRE(state == 0);
+      root->version_lock().write_unlock();
+      for (int i = 0; i < 5000 && state == 0; i++)
+        os_sleep_msec(1);
+      REQUIRE(state == 1);
+      lock.unlock();
+      thread.join();
+    }
+
+    boost::atomic<bool> done(false);
+    boost::atomic<int> errors(0);
+    std::vector<Thread *> readers;
+    for (int i = 0; i < kReaders; i++)
+      readers.push_back(new Thread(boost::bind(&optimistic_reader, bf.db,
+                              kCount, (uint64_t)i + 1, &done, &errors)));
+    std::vector<Thread *> writers;
+    for (int i = 0; i < kWriters; i++)
+      writers.push_back(new Thread(boost::bind(&optimistic_writer, bf.db,
+                              kCount, (uint64_t)i * kCount / 2, 3, &errors)));
+    for (size_t i = 0; i < writers.size(); i++) {
+      writers[i]->join();
+      delete writers[i];
+    }
+    done = true;
+    for (size_t i = 0; i < readers.size(); i++) {
+      readers[i]->join();
+      delete readers[i];
+    }
+    REQUIRE(errors == 0);
+
+    // the merged pages were retired, and are released as soon as the
+    // readers are gone (in-memory Environments do not reuse pages)
+    PageManager *page_manager = bf.lenv()->page_manager.get();
+    uint64_t k = 1;
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    REQUIRE(UPS_KEY_NOT_FOUND == ups_db_erase(bf.db, 0, &key, 0));
+    REQUIRE(page_manager->state->retired.empty());
+    if (NOTSET(m_flags, UPS_IN_MEMORY)) {
+      REQUIRE((page_manager->state->epochs.current() > 1) == concurrent);
+      REQUIRE(page_manager->state->freelist.free_pages.size() > 0);
+    }
+
+    DbProxy dbp(bf.db);
+    dbp.require_check_integrity()
+       .require_key_count(kCount);
+  }
+
+  void directIoTest() {
+    const int kCount = 20000;
+    char buffer[32];
+
+    // not allowed in combination with in-memory Environments
+    BaseFixture bf;
+    bf.require_create(UPS_IN_MEMORY | UPS_ENABLE_DIRECT_IO, UPS_INV_PARAMETER);
+
+    // the page size has to be a multiple of 4096 bytes
+    ups_parameter_t small[] = {
+        { UPS_PARAM_PAGE_SIZE, 2048 },
+        { 0, 0 }
+    };
+    bf.require_create(m_flags | UPS_ENABLE_DIRECT_IO, small,
+                    UPS_INV_PARAMETER);
+    if (NOTSET(m_flags, UPS_IN_MEMORY)) {
+      bf.require_create(m_flags, small);
+      bf.close();
+      bf.require_open(UPS_ENABLE_DIRECT_IO, 0, UPS_INV_PARAMETER);
+    }
+
+    // use a small cache to make sure that buffers are recycled
+    ups_parameter_t params[] = {
+        { UPS_PARAM_PAGE_SIZE, 16 * 1024 },
+        { UPS_PARAM_CACHE_SIZE, 1024 * 1024 },
+        { 0, 0 }
+    };
+    bf.require_create(m_flags | UPS_ENABLE_DIRECT_IO, params)
+      .require_flags(UPS_DISABLE_MMAP, true);
+    REQUIRE(bf.device()->buffer_pool != 0);
+
+    for (int i = 0; i < kCount; i++) {
+      ::sprintf(buffer, "key%08d", i);
+      ups_key_t key = ups_make_key(buffer,
+                      (uint16_t)(::strlen(buffer) + 1));
+      ups_record_t record = ups_make_record(buffer,
+                      (uint32_t)::strlen(buffer) + 1);
+      REQUIRE(0 == ups_db_insert(bf.db, 0, &key, &record, 0));
+    }
+
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(bf.env, &metrics));
+    REQUIRE(metrics.page_buffer_pool_capacity >= 64);
+    REQUIRE(metrics.page_buffer_pool_in_use > 0);
+    REQUIRE(metrics.page_buffer_pool_in_use
+                    <= metrics.page_buffer_pool_capacity);
+
+    bf.close();
+    bf.require_open(UPS_ENABLE_DIRECT_IO, &params[1]);
+    REQUIRE(bf.device()->buffer_pool != 0);
+
+    for (int i = 0; i < kCount; i++) {
+      ::sprintf(buffer, "key%08d", i);
+      ups_key_t key = ups_make_key(buffer,
+                      (uint16_t)(::strlen(buffer) + 1));
+      ups_record_t record = {0};
+      REQUIRE(0 == ups_db_find(bf.db, 0, &key, &record, 0));
+      REQUIRE(0 == ::strcmp(buffer, (const char *)record.data));
+    }
+
+    DbProxy dbp(bf.db);
+    dbp.require_check_integrity()
+       .require_key_count(kCount);
+  }
 };
 
 TEST_CASE("Env/createCloseTest", "")
@@ -1021,6 +1394,30 @@ TEST_CASE("Env/createOpenEmptyTest", "")
   f.createOpenEmptyTest();
 }
 
+TEST_CASE("Env/concurrentReadsTest", "")
+{
+  EnvFixture f;
+  f.concurrentReadsTest();
+}
+
+TEST_CASE("Env/concurrentWritesTest", "")
+{
+  EnvFixture f;
+  f.concurrentWritesTest(UPS_NODE_LAYOUT_SORTED);
+}
+
+TEST_CASE("Env/concurrentWritesBtreeLayoutTest", "")
+{
+  EnvFixture f;
+  f.concurrentWritesTest(UPS_NODE_LAYOUT_BTREE);
+}
+
+TEST_CASE("Env/directIoTest", "")
+{
+  EnvFixture f;
+  f.directIoTest();
+}
+
 
 TEST_CASE("Env/inmem/createCloseTest", "")
 {
@@ -1148,3 +1545,21 @@ TEST_CASE("Env/inmem/createOpenEmptyTest", "")
   f.createOpenEmptyTest();
 }
 
+TEST_CASE("Env/inmem/concurrentReadsTest", "")
+{
+  EnvFixture f(UPS_IN_MEMORY);
+  f.concurrentReadsTest();
+}
+
+TEST_CASE("Env/inmem/concurrentWritesTest", "")
+{
+  EnvFixture f(UPS_IN_MEMORY);
+  f.concurrentWritesTest(UPS_NODE_LAYOUT_SORTED);
+}
+
+TEST_CASE("Env/inmem/concurrentWritesBtreeLayoutTest", "")
+{
+  EnvFixture f(UPS_IN_MEMORY);
+  f.concurrentWritesTest(UPS_NODE_LAYOUT_BTREE);
+}
+
@@ -1039,6 +1039,395 @@ struct JournalFixture : BaseFixture {
     require_parameter(params[0].name, params[0].value);
   }
 
+  // Inserts |count| records, each in its own transaction, and returns
+  // the journal metrics
+  ups_env_metrics_t pageDeltaWorkload(uint32_t flags, uint32_t count) {
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_SWITCH_THRESHOLD, 1000 },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS | flags, params, 0, 0);
+
+    // keep a copy of the empty database; recovery has to rebuild all
+    // modified pages from the journal
+    REQUIRE(0 == ups_env_flush(env, 0));
+    REQUIRE(true == os::copy("test.db", "test.db.bak"));
+
+    std::vector<uint8_t> rvec(32);
+    for (uint32_t i = 0; i < count; i++) {
+      TxnProxy tp(env, nullptr, true);
+      DbProxy dbp(db);
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_insert(tp.txn, i, rvec);
+    }
+
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    return metrics;
+  }
+
+  void pageDeltaTest() {
+#ifndef WIN32
+    const uint32_t count = 200;
+    ups_env_metrics_t full = pageDeltaWorkload(0, count);
+    REQUIRE(full.journal_page_images > 0);
+    REQUIRE(full.journal_page_deltas == 0);
+
+    ups_env_metrics_t delta = pageDeltaWorkload(UPS_ENABLE_JOURNAL_DELTAS,
+                    count);
+    REQUIRE(delta.journal_page_images > 0);
+    REQUIRE(delta.journal_page_deltas > delta.journal_page_images);
+    REQUIRE(delta.journal_bytes_flushed * 4 < full.journal_bytes_flushed);
+
+    // recover from the empty database file and the journal
+    REQUIRE(true == os::copy("test.db.jrn0", "test.db.bak0"));
+    REQUIRE(true == os::copy("test.db.jrn1", "test.db.bak1"));
+    close(UPS_AUTO_CLEANUP);
+    restore();
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY);
+
+    DbProxy dbp(db);
+    std::vector<uint8_t> rvec(32);
+    for (uint32_t i = 0; i < count; i++) {
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_find(i, rvec);
+    }
+    dbp.require_key_count(count);
+    dbp.require_check_integrity();
+#endif
+  }
+
+  void compressedPageDeltaTest() {
+#ifdef HAVE_ZLIB_H
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_COMPRESSION, UPS_COMPRESSOR_ZLIB },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS | UPS_ENABLE_JOURNAL_DELTAS,
+                    params, 0, 0);
+
+    std::vector<uint8_t> rvec(32);
+    for (uint32_t i = 0; i < 50; i++) {
+      TxnProxy tp(env, nullptr, true);
+      DbProxy dbp(db);
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_insert(tp.txn, i, rvec);
+    }
+
+    close(UPS_AUTO_CLEANUP | UPS_DONT_CLEAR_LOG);
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY);
+
+    DbProxy dbp(db);
+    for (uint32_t i = 0; i < 50; i++) {
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_find(i, rvec);
+    }
+    dbp.require_check_integrity();
+#endif
+  }
+
+  void redoManyPagesTest() {
+#ifndef WIN32
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_SWITCH_THRESHOLD, 1000 },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS, params, 0, 0);
+
+    // keep a copy of the empty database; the changesets modify many pages,
+    // which are redone in parallel
+    REQUIRE(0 == ups_env_flush(env, 0));
+    REQUIRE(true == os::copy("test.db", "test.db.bak"));
+
+    const uint32_t count = 300;
+    std::vector<uint8_t> rvec(1024);
+    for (uint32_t i = 0; i < count; i++) {
+      TxnProxy tp(env, nullptr, true);
+      DbProxy dbp(db);
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_insert(tp.txn, i, rvec);
+    }
+
+    REQUIRE(true == os::copy("test.db.jrn0", "test.db.bak0"));
+    REQUIRE(true == os::copy("test.db.jrn1", "test.db.bak1"));
+    close(UPS_AUTO_CLEANUP);
+    restore();
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY);
+
+    DbProxy dbp(db);
+    for (uint32_t i = 0; i < count; i++) {
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_find(i, rvec);
+    }
+    dbp.require_key_count(count);
+    dbp.require_check_integrity();
+#endif
+  }
+
+  struct RecoveryProgress {
+    RecoveryProgress()
+      : calls(0), processed(0), total(0), eta_msec(0) {
+    }
+
+    int calls;
+    uint64_t processed;
+    uint64_t total;
+    uint64_t eta_msec;
+  };
+
+  static void UPS_CALLCONV
+  recovery_progress(uint64_t processed, uint64_t total, uint64_t eta_msec,
+                  void *context) {
+    RecoveryProgress *p = (RecoveryProgress *)context;
+    REQUIRE(processed >= p->processed);
+    REQUIRE(processed <= total);
+    p->calls++;
+    p->processed = processed;
+    p->total = total;
+    p->eta_msec = eta_msec;
+  }
+
+  void recoveryProgressTest() {
+    std::vector<uint8_t> rvec(32);
+    for (uint32_t i = 0; i < 20; i++) {
+      TxnProxy tp(env, nullptr, true);
+      DbProxy dbp(db);
+      dbp.require_insert(tp.txn, i, rvec);
+    }
+
+    // the journal is flushed when the Environment is closed
+    close(UPS_AUTO_CLEANUP | UPS_DONT_CLEAR_LOG);
+
+    uint64_t size = 0;
+    for (const char *filename : {"test.db.jrn0", "test.db.jrn1"}) {
+      File f;
+      f.open(filename, 0);
+      size += f.file_size();
+      f.close();
+    }
+    REQUIRE(size > 0);
+
+    RecoveryProgress progress;
+    ups_parameter_t params[] = {
+        { UPS_PARAM_RECOVERY_PROGRESS_FUNCTION, (uint64_t)&recovery_progress },
+        { UPS_PARAM_RECOVERY_PROGRESS_CONTEXT, (uint64_t)&progress },
+        { 0, 0 }
+    };
+
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY, params);
+
+    // the last call reports the completed recovery
+    REQUIRE(progress.calls >= 1);
+    REQUIRE(progress.total == 2 * size);
+    REQUIRE(progress.processed == progress.total);
+    REQUIRE(progress.eta_msec == 0);
+
+    DbProxy dbp(db);
+    dbp.require_key_count(20);
+  }
+
+  uint64_t journal_size() {
+    Journal *j = lenv()->journal.get();
+    return j->state.files[0].file_size() + j->state.files[1].file_size();
+  }
+
+  void checkpointTest() {
+    REQUIRE(UPS_INV_PARAMETER == ups_env_checkpoint(0, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_env_checkpoint(env, 1));
+
+    std::vector<uint8_t> rvec(64);
+    for (uint32_t i = 0; i < 50; i++) {
+      TxnProxy tp(env, nullptr, true);
+      DbProxy dbp(db);
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_insert(tp.txn, i, rvec);
+    }
+    uint64_t size = journal_size();
+    REQUIRE(size > 0);
+
+    // the journal is truncated; only the checkpoint remains
+    REQUIRE(0 == ups_env_checkpoint(env, 0));
+    Journal *j = lenv()->journal.get();
+    REQUIRE(j->state.files[j->state.current_fd ? 0 : 1].file_size() == 0);
+    REQUIRE(journal_size() < size);
+    REQUIRE((journal_size() - sizeof(PJournalEntry)
+                - sizeof(PJournalEntryCheckpoint)) % sizeof(uint64_t) == 0);
+
+    // a second checkpoint does not write any pages
+    REQUIRE(0 == ups_env_checkpoint(env, 0));
+    REQUIRE(journal_size() == sizeof(PJournalEntry)
+                    + sizeof(PJournalEntryCheckpoint));
+
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.checkpoint_count == 2);
+    REQUIRE(metrics.checkpoint_total_usec >= metrics.checkpoint_max_usec);
+
+    // the modifications after the checkpoint are recovered
+    for (uint32_t i = 50; i < 100; i++) {
+      TxnProxy tp(env, nullptr, true);
+      DbProxy dbp(db);
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_insert(tp.txn, i, rvec);
+    }
+
+    backup();
+    close(UPS_AUTO_CLEANUP);
+    restore();
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY);
+
+    DbProxy dbp(db);
+    for (uint32_t i = 0; i < 100; i++) {
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_find(i, rvec);
+    }
+    dbp.require_key_count(100);
+    dbp.require_check_integrity();
+  }
+
+  void checkpointWithActiveTxnTest() {
+    ups_txn_t *txn1, *txn2;
+    uint32_t k = 1;
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    ups_record_t record = ups_make_record(&k, sizeof(k));
+
+    // |txn2| is committed, but cannot be flushed because |txn1| is
+    // still active
+    REQUIRE(0 == ups_txn_begin(&txn1, env, 0, 0, 0));
+    REQUIRE(0 == ups_txn_begin(&txn2, env, 0, 0, 0));
+    REQUIRE(0 == ups_db_insert(db, txn2, &key, &record, 0));
+    REQUIRE(0 == ups_txn_commit(txn2, 0));
+
+    // the journal file of |txn2| is retained
+    uint64_t size = journal_size();
+    REQUIRE(0 == ups_env_checkpoint(env, 0));
+    REQUIRE(journal_size() > size);
+
+    backup();
+    REQUIRE(0 == ups_txn_abort(txn1, 0));
+    close(UPS_AUTO_CLEANUP);
+    restore();
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY);
+
+    record = ups_make_record(0, 0);
+    REQUIRE(0 == ups_db_find(db, 0, &key, &record, 0));
+    REQUIRE(record.size == sizeof(k));
+    REQUIRE(*(uint32_t *)record.data == k);
+  }
+
+  void checkpointLogSizeTest() {
+    ups_parameter_t params[] = {
+        { UPS_PARAM_CHECKPOINT_LOG_SIZE, 16 * 1024 },
+        { UPS_PARAM_CHECKPOINT_INTERVAL_SEC, 3600 },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS, params, 0, 0);
+
+    ups_parameter_t query[] = {
+        { UPS_PARAM_CHECKPOINT_LOG_SIZE, 0 },
+        { UPS_PARAM_CHECKPOINT_INTERVAL_SEC, 0 },
+        { 0, 0 }
+    };
+    REQUIRE(0 == ups_env_get_parameters(env, query));
+    REQUIRE(query[0].value == 16 * 1024);
+    REQUIRE(query[1].value == 3600);
+
+    std::vector<uint8_t> rvec(1024);
+    for (uint32_t i = 0; i < 200; i++) {
+      TxnProxy tp(env, nullptr, true);
+      DbProxy dbp(db);
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_insert(tp.txn, i, rvec);
+    }
+
+    // the journal does not grow much beyond the limit
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.checkpoint_count > 0);
+    REQUIRE(journal_size() < 2 * 16 * 1024 + 4 * rvec.size());
+
+    close(UPS_AUTO_CLEANUP | UPS_DONT_CLEAR_LOG);
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY);
+
+    DbProxy dbp(db);
+    for (uint32_t i = 0; i < 200; i++) {
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_find(i, rvec);
+    }
+    dbp.require_key_count(200);
+    dbp.require_check_integrity();
+  }
+
+  void segmentTest() {
+    const uint64_t segment_size = 1024 * 1024;
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_SEGMENT_SIZE, segment_size },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS, params, 0, 0);
+
+    ups_parameter_t query[] = {
+        { UPS_PARAM_JOURNAL_SEGMENT_SIZE, 0 },
+        { 0, 0 }
+    };
+    REQUIRE(0 == ups_env_get_parameters(env, query));
+    REQUIRE(query[0].value == segment_size);
+
+    // both files are preallocated
+    Journal *j = lenv()->journal.get();
+    REQUIRE(j->state.files[0].file_size() == segment_size);
+    REQUIRE(j->state.files[1].file_size() == segment_size);
+
+    // all writes are aligned
+    std::vector<uint8_t> rvec(64);
+    for (uint32_t i = 0; i < 100; i++) {
+      TxnProxy tp(env, nullptr, true);
+      DbProxy dbp(db);
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_insert(tp.txn, i, rvec);
+      REQUIRE(j->state.write_offsets[0] % 4096 == 0);
+      REQUIRE(j->state.write_offsets[1] % 4096 == 0);
+    }
+
+    // the files are switched when they are full; they only grow by the
+    // entries which are appended after the switch was checked
+    for (int i = 0; i < 2; i++) {
+      REQUIRE(j->state.files[i].file_size() >= segment_size);
+      REQUIRE(j->state.files[i].file_size() < segment_size + 256 * 1024);
+    }
+
+    // recover the journal, then reopen the recovered Environment
+    backup();
+    close(UPS_AUTO_CLEANUP);
+    restore();
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY, params);
+
+    DbProxy dbp(db);
+    for (uint32_t i = 0; i < 100; i++) {
+      ::memset(rvec.data(), (int)i, rvec.size());
+      dbp.require_find(i, rvec);
+    }
+    dbp.require_key_count(100);
+    dbp.require_check_integrity();
+
+    // the cleared (preallocated) files are empty
+    close();
+    require_open(UPS_ENABLE_TRANSACTIONS, params);
+    REQUIRE(lenv()->journal->is_empty());
+    DbProxy dbp2(db);
+    dbp2.require_key_count(100);
+  }
+
   void issue45Test() {
     // create a transaction with one insert
     TxnProxy tp(env);
@@ -1107,6 +1496,187 @@ struct JournalFixture : BaseFixture {
     require_flags(UPS_ENABLE_CRC32, true);
     require_flags(UPS_ENABLE_FSYNC, true);
   }
+
+  static void group_committer(ups_env_t *env, ups_db_t *db, uint32_t id,
+                  uint32_t count, boost::atomic<int> *errors) {
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t k = id * count + i;
+      ups_key_t key = ups_make_key(&k, sizeof(k));
+      ups_record_t record = ups_make_record(&k, sizeof(k));
+      ups_txn_t *txn;
+      if (0 != ups_txn_begin(&txn, env, 0, 0, 0)) {
+        (*errors)++;
+        continue;
+      }
+      if (0 != ups_db_insert(db, txn, &key, &record, 0)
+          || 0 != ups_txn_commit(txn, 0))
+        (*errors)++;
+    }
+  }
+
+  void groupCommitTest() {
+    const uint32_t kThreads = 4;
+    const uint32_t kCount = 50;
+    Journal *j = lenv()->journal.get();
+    REQUIRE(j->state.group_commit == true);
+
+    boost::atomic<int> errors(0);
+    std::vector<Thread *> threads;
+    for (uint32_t i = 0; i < kThreads; i++)
+      threads.push_back(new Thread(boost::bind(&group_committer, env, db,
+                              i, kCount, &errors)));
+    for (size_t i = 0; i < threads.size(); i++) {
+      threads[i]->join();
+      delete threads[i];
+    }
+    REQUIRE(errors == 0);
+
+    // all commits are durable
+    REQUIRE(j->pending_commit_lsn() == 0);
+    REQUIRE(j->state.durable_lsn == j->state.written_lsn);
+
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.journal_group_commits == kThreads * kCount);
+    REQUIRE(metrics.journal_group_syncs > 0);
+    REQUIRE(metrics.journal_group_syncs <= kThreads * kCount);
+
+    // reopen and recover; all keys are available
+    close(UPS_AUTO_CLEANUP | UPS_DONT_CLEAR_LOG);
+    require_open(UPS_AUTO_RECOVERY | UPS_ENABLE_FSYNC
+                    | UPS_ENABLE_GROUP_COMMIT);
+    for (uint32_t k = 0; k < kThreads * kCount; k++) {
+      ups_key_t key = ups_make_key(&k, sizeof(k));
+      ups_record_t record = {0};
+      REQUIRE(0 == ups_db_find(db, 0, &key, &record, 0));
+      REQUIRE(record.size == sizeof(k));
+      REQUIRE(*(uint32_t *)record.data == k);
+    }
+  }
+
+  // the files are switched (and truncated) while the leader of a group
+  // commit syncs them
+  void groupCommitSwitchTest() {
+    const uint32_t kThreads = 4;
+    const uint32_t kCount = 100;
+    Journal *j = lenv()->journal.get();
+    j->state.threshold = 5;
+
+    boost::atomic<int> errors(0);
+    std::vector<Thread *> threads;
+    for (uint32_t i = 0; i < kThreads; i++)
+      threads.push_back(new Thread(boost::bind(&group_committer, env, db,
+                              i, kCount, &errors)));
+    for (size_t i = 0; i < threads.size(); i++) {
+      threads[i]->join();
+      delete threads[i];
+    }
+    REQUIRE(errors == 0);
+    REQUIRE(j->pending_commit_lsn() == 0);
+    REQUIRE(j->state.sync_in_progress == false);
+
+    for (uint32_t k = 0; k < kThreads * kCount; k++) {
+      ups_key_t key = ups_make_key(&k, sizeof(k));
+      ups_record_t record = {0};
+      REQUIRE(0 == ups_db_find(db, 0, &key, &record, 0));
+      REQUIRE(*(uint32_t *)record.data == k);
+    }
+  }
+
+  void groupCommitDisabledTest() {
+    // group commit requires UPS_ENABLE_FSYNC
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS | UPS_ENABLE_GROUP_COMMIT);
+    REQUIRE(lenv()->journal->state.group_commit == false);
+
+    ups_txn_t *txn;
+    uint32_t k = 1;
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    ups_record_t record = ups_make_record(&k, sizeof(k));
+    REQUIRE(0 == ups_txn_begin(&txn, env, 0, 0, 0));
+    REQUIRE(0 == ups_db_insert(db, txn, &key, &record, 0));
+    REQUIRE(0 == ups_txn_commit(txn, 0));
+    REQUIRE(lenv()->journal->pending_commit_lsn() == 0);
+  }
+
+  void commit_key(uint32_t k, uint32_t flags) {
+    ups_txn_t *txn;
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    ups_record_t record = ups_make_record(&k, sizeof(k));
+    REQUIRE(0 == ups_txn_begin(&txn, env, 0, 0, 0));
+    REQUIRE(0 == ups_db_insert(db, txn, &key, &record, 0));
+    REQUIRE(0 == ups_txn_commit(txn, flags));
+  }
+
+  void asyncCommitTest() {
+    Journal *j = lenv()->journal.get();
+    uint64_t committed, durable;
+
+    REQUIRE(UPS_INV_PARAMETER == ups_env_get_commit_lsn(0, &committed,
+                            &durable));
+    REQUIRE(UPS_INV_PARAMETER == ups_env_get_commit_lsn(env, 0, &durable));
+    REQUIRE(UPS_INV_PARAMETER == ups_env_get_commit_lsn(env, &committed, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_env_wait_for_lsn(0, 0));
+
+    // the asynchronous commit remains in the buffer
+    commit_key(1, UPS_TXN_ASYNC_COMMIT);
+    REQUIRE(0 == ups_env_get_commit_lsn(env, &committed, &durable));
+    REQUIRE(committed > 0);
+    REQUIRE(durable < committed);
+    REQUIRE(j->state.buffer.size() > 0);
+    REQUIRE(j->state.written_lsn < committed);
+
+    // wait till it's durable
+    REQUIRE(0 == ups_env_wait_for_lsn(env, 0));
+    REQUIRE(0 == ups_env_get_commit_lsn(env, &committed, &durable));
+    REQUIRE(durable == committed);
+    REQUIRE(j->state.buffer.size() == 0);
+
+    // without UPS_ENABLE_FSYNC, a synchronous commit is written, but
+    // not synced
+    commit_key(2, 0);
+    uint64_t lsn = committed;
+    REQUIRE(0 == ups_env_get_commit_lsn(env, &committed, &durable));
+    REQUIRE(committed > lsn);
+    REQUIRE(durable == lsn);
+    REQUIRE(j->state.written_lsn == committed);
+    REQUIRE(0 == ups_env_wait_for_lsn(env, committed));
+    REQUIRE(0 == ups_env_get_commit_lsn(env, &committed, &durable));
+    REQUIRE(durable == committed);
+
+    // waiting for an older lsn returns immediately
+    REQUIRE(0 == ups_env_wait_for_lsn(env, 1));
+
+    // the durable commits are recovered
+    commit_key(3, UPS_TXN_ASYNC_COMMIT);
+    REQUIRE(0 == ups_env_wait_for_lsn(env, 0));
+    close(UPS_AUTO_CLEANUP | UPS_DONT_CLEAR_LOG);
+    require_open(UPS_AUTO_RECOVERY);
+    for (uint32_t k = 1; k <= 3; k++) {
+      ups_key_t key = ups_make_key(&k, sizeof(k));
+      ups_record_t record = {0};
+      REQUIRE(0 == ups_db_find(db, 0, &key, &record, 0));
+    }
+  }
+
+  void asyncCommitFsyncTest() {
+    uint64_t committed, durable;
+
+    // with UPS_ENABLE_FSYNC, a synchronous commit is durable immediately
+    commit_key(1, 0);
+    REQUIRE(0 == ups_env_get_commit_lsn(env, &committed, &durable));
+    REQUIRE(durable == committed);
+
+    commit_key(2, UPS_TXN_ASYNC_COMMIT);
+    commit_key(3, UPS_TXN_ASYNC_COMMIT);
+    REQUIRE(0 == ups_env_get_commit_lsn(env, &committed, &durable));
+    REQUIRE(durable < committed);
+
+    // the next synchronous commit also flushes the asynchronous commits
+    commit_key(4, 0);
+    REQUIRE(0 == ups_env_get_commit_lsn(env, &committed, &durable));
+    REQUIRE(durable == committed);
+  }
 };
 
 TEST_CASE("Journal/createClose", "")
@@ -1259,6 +1829,54 @@ TEST_CASE("Journal/switchThresholdTest", "")
   f.switchThresholdTest();
 }
 
+TEST_CASE("Journal/pageDeltaTest", "")
+{
+  JournalFixture f;
+  f.pageDeltaTest();
+}
+
+TEST_CASE("Journal/compressedPageDeltaTest", "")
+{
+  JournalFixture f;
+  f.compressedPageDeltaTest();
+}
+
+TEST_CASE("Journal/redoManyPagesTest", "")
+{
+  JournalFixture f;
+  f.redoManyPagesTest();
+}
+
+TEST_CASE("Journal/recoveryProgressTest", "")
+{
+  JournalFixture f;
+  f.recoveryProgressTest();
+}
+
+TEST_CASE("Journal/checkpointTest", "")
+{
+  JournalFixture f;
+  f.checkpointTest();
+}
+
+TEST_CASE("Journal/checkpointWithActiveTxnTest", "")
+{
+  JournalFixture f;
+  f.checkpointWithActiveTxnTest();
+}
+
+TEST_CASE("Journal/checkpointLogSizeTest", "")
+{
+  JournalFixture f;
+  f.checkpointLogSizeTest();
+}
+
+TEST_CASE("Journal/segmentTest", "")
+{
+  JournalFixture f;
+  f.segmentTest();
+}
+
 TEST_CASE("Journal/issue45Test", "")
 {
   JournalFixture f;
@@ -1277,5 +1895,41 @@ TEST_CASE("Journal/recoverWithCrc32Test", "")
   f.recoverWithCrc32Test();
 }
 
+TEST_CASE("Journal/groupCommitTest", "")
+{
+  JournalFixture f(UPS_ENABLE_FSYNC | UPS_ENABLE_GROUP_COMMIT);
+  f.groupCommitTest();
+}
+
+TEST_CASE("Journal/groupCommitSwitchTest", "")
+{
+  JournalFixture f(UPS_ENABLE_FSYNC | UPS_ENABLE_GROUP_COMMIT);
+  f.groupCommitSwitchTest();
+}
+
+TEST_CASE("Journal/groupCommitDisabledTest", "")
+{
+  JournalFixture f;
+  f.groupCommitDisabledTest();
+}
+
+TEST_CASE("Journal/asyncCommitTest", "")
+{
+  JournalFixture f;
+  f.asyncCommitTest();
+}
+
+TEST_CASE("Journal/asyncCommitFsyncTest", "")
+{
+  JournalFixture f(UPS_ENABLE_FSYNC);
+  f.asyncCommitFsyncTest();
+}
+
+TEST_CASE("Journal/asyncGroupCommitTest", "")
+{
+  JournalFixture f(UPS_ENABLE_FSYNC | UPS_ENABLE_GROUP_COMMIT);
+  f.asyncCommitFsyncTest();
+}
+
 } // namespace upscaledb
 
@@ -18,6 +18,7 @@
 
 #include "3rdparty/catch/catch.hpp"
 
+#include "1mem/slab_pool.h"
 #include "2page/page.h"
 #include "2device/device.h"
 #include "4db/db.h"
@@ -68,6 +69,61 @@ struct PageFixture : public BaseFixture {
   }
 };
 
+TEST_CASE("Page/versionLock", "")
+{
+  PageFixture f;
+  PageProxy pp(f.lenv()->device.get());
+  OptimisticLock &lock = pp.page->version_lock();
+
+  bool restart = false;
+  uint64_t version = lock.read_lock(&restart);
+  REQUIRE(restart == false);
+  REQUIRE(lock.validate(version) == true);
+
+  lock.write_lock();
+  REQUIRE(lock.is_locked() == true);
+  REQUIRE(lock.validate(version) == false);
+  lock.read_lock(&restart);
+  REQUIRE(restart == true);
+  lock.write_unlock();
+
+  REQUIRE(lock.is_locked() == false);
+  REQUIRE(lock.validate(version) == false);
+  REQUIRE(lock.version() == version + 2);
+
+  restart = false;
+  version = lock.read_lock(&restart);
+  REQUIRE(restart == false);
+  {
+    ScopedOptimisticWriteLock guard(lock);
+  }
+  REQUIRE(lock.validate(version) == false);
+}
+
+TEST_CASE("Page/slabPool", "")
+{
+  SlabPool pool(40, 8);
+  REQUIRE(pool.get_capacity() == 0);
+
+  // an idle pool keeps its first slab
+  void *p = pool.allocate();
+  REQUIRE(pool.get_capacity() == 8);
+  pool.release(p);
+  REQUIRE(pool.get_capacity() == 8);
+  REQUIRE(pool.allocate() == p);
+  pool.release(p);
+
+  // ... but releases all others
+  std::vector<void *> v;
+  for (int i = 0; i < 20; i++)
+    v.push_back(pool.allocate());
+  REQUIRE(pool.get_capacity() == 24);
+  for (size_t i = 0; i < v.size(); i++)
+    pool.release(v[i]);
+  REQUIRE(pool.get_capacity() == 8);
+  REQUIRE(pool.get_in_use() == 0);
+}
+
 TEST_CASE("Page/newDelete", "")
 {
   PageFixture f;
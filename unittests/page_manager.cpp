@@ -16,6 +16,8 @@
  * See the file COPYING for License information.
  */
 
+#include <algorithm>
+
 #include "3rdparty/catch/catch.hpp"
 
 #include "1base/pickle.h"
@@ -226,6 +228,320 @@ struct PageManagerFixture : BaseFixture {
     REQUIRE(false == page_manager->state->cache.is_cache_full());
   }
 
+  // Creates a (fake) page for the cache tests
+  Page *create_cached_page(PPageData *pers, uint64_t address) {
+    Page *p = new Page(lenv()->device.get());
+    p->set_without_header(true);
+    p->assign_allocated_buffer(pers, address);
+    return p;
+  }
+
+  void cacheScanResistanceTest() {
+    Cache &cache = lenv()->page_manager->state->cache;
+    uint32_t page_size = lenv()->config.page_size_bytes;
+
+    PPageData pers;
+    ::memset(&pers, 0, sizeof(pers));
+    std::vector<Page *> hot;
+    std::vector<Page *> scan;
+
+    // the working set is fetched twice, therefore it's "hot"
+    for (uint64_t i = 0; i < 4; i++) {
+      Page *p = create_cached_page(&pers, (1000 + i) * page_size);
+      cache.put(p);
+      REQUIRE(p->cache_queue() == Cache::kQueueCold);
+      cache.evict(p);
+      cache.put(p);
+      REQUIRE(p->cache_queue() == Cache::kQueueHot);
+      hot.push_back(p);
+    }
+
+    // now run a "scan" which exceeds the capacity
+    for (uint64_t i = 0; i < 40; i++) {
+      Page *p = create_cached_page(&pers, (2000 + i) * page_size);
+      cache.put(p);
+      REQUIRE(cache.get(p->address()) == p);
+      REQUIRE(p->cache_queue() == Cache::kQueueCold);
+      scan.push_back(p);
+    }
+    REQUIRE(true == cache.is_cache_full());
+
+    // the scanned pages are purged, the working set survives
+    std::vector<uint64_t> candidates;
+    std::vector<Page *> garbage;
+    cache.purge_candidates(candidates, garbage, 0);
+    REQUIRE(garbage.size() > 0);
+    for (size_t i = 0; i < hot.size(); i++) {
+      REQUIRE(std::find(garbage.begin(), garbage.end(), hot[i])
+                      == garbage.end());
+      REQUIRE(std::find(candidates.begin(), candidates.end(),
+                              hot[i]->address()) == candidates.end());
+    }
+
+    scan.insert(scan.end(), hot.begin(), hot.end());
+    for (size_t i = 0; i < scan.size(); i++) {
+      cache.del(scan[i]);
+      scan[i]->set_data(0);
+      delete scan[i];
+    }
+  }
+
+  // A page which is fetched again, purged and evicted once more must stay
+  // a "ghost" even when its first (stale) entry is pushed out of the queue
+  void cacheGhostTest() {
+    Cache &cache = lenv()->page_manager->state->cache;
+    uint32_t page_size = lenv()->config.page_size_bytes;
+    size_t limit = std::max((size_t)1,
+                    cache.capacity_pages() / CacheState::kShardCount / 2);
+
+    PPageData pers;
+    ::memset(&pers, 0, sizeof(pers));
+
+    // all pages are stored in the same shard
+    Page *p = create_cached_page(&pers, 1000 * CacheState::kShardCount
+                    * (uint64_t)page_size);
+    cache.put(p);
+    cache.evict(p);
+    cache.put(p);
+    REQUIRE(p->cache_queue() == Cache::kQueueHot);
+    cache.del(p);
+    cache.put(p);
+    REQUIRE(p->cache_queue() == Cache::kQueueCold);
+    cache.evict(p);
+
+    // push the stale entry out of the queue
+    std::vector<Page *> v;
+    for (size_t i = 1; i < limit; i++) {
+      Page *q = create_cached_page(&pers, (1000 + i)
+                      * CacheState::kShardCount * (uint64_t)page_size);
+      cache.put(q);
+      cache.evict(q);
+      v.push_back(q);
+    }
+
+    cache.put(p);
+    REQUIRE(p->cache_queue() == Cache::kQueueHot);
+
+    v.push_back(p);
+    for (size_t i = 0; i < v.size(); i++) {
+      cache.del(v[i]);
+      v[i]->set_data(0);
+      delete v[i];
+    }
+  }
+
+  void cacheLruPolicyTest() {
+    ups_parameter_t param[] = {
+        { UPS_PARAM_CACHE_POLICY, UPS_CACHE_POLICY_LRU },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(0, param);
+
+    require_parameter(UPS_PARAM_CACHE_POLICY, UPS_CACHE_POLICY_LRU);
+
+    PPageData pers;
+    ::memset(&pers, 0, sizeof(pers));
+    Cache &cache = lenv()->page_manager->state->cache;
+    Page *p = create_cached_page(&pers, 1000 * lenv()->config.page_size_bytes);
+    cache.put(p);
+    REQUIRE(p->cache_queue() == Cache::kQueueHot);
+    cache.del(p);
+    REQUIRE(p->cache_queue() == Cache::kQueueNone);
+    p->set_data(0);
+    delete p;
+
+    param[0].value = 99;
+    close();
+    REQUIRE(UPS_INV_PARAMETER == create_env(0, param));
+  }
+
+  void cacheGrowTest(uint32_t flags = 0) {
+    if (flags) {
+      close();
+      require_create(flags);
+    }
+
+    Cache &cache = lenv()->page_manager->state->cache;
+    uint32_t page_size = lenv()->config.page_size_bytes;
+    size_t bucket_count = cache.bucket_count();
+
+    // unlimited caches start with the smallest hash tables
+    if (ISSET(flags, UPS_CACHE_UNLIMITED))
+      REQUIRE(bucket_count
+                  == CacheState::kMinBuckets * CacheState::kShardCount);
+
+    PPageData pers;
+    ::memset(&pers, 0, sizeof(pers));
+    std::vector<Page *> v;
+
+    for (uint64_t i = 0; i < bucket_count * 4; i++) {
+      Page *p = create_cached_page(&pers, (1000 + i) * page_size);
+      cache.put(p);
+      v.push_back(p);
+    }
+    REQUIRE(cache.bucket_count() > bucket_count);
+
+    for (size_t i = 0; i < v.size(); i++)
+      REQUIRE(cache.get(v[i]->address()) == v[i]);
+
+    for (size_t i = 0; i < v.size(); i++) {
+      cache.del(v[i]);
+      REQUIRE(cache.get(v[i]->address()) == (Page *)0);
+      v[i]->set_data(0);
+      delete v[i];
+    }
+  }
+
+  void cacheMetricsTest() {
+    char buffer[1024] = {0};
+    ups_parameter_t param[] = {
+        { UPS_PARAM_CACHE_SIZE, 16 * UPS_DEFAULT_PAGE_SIZE },
+        { 0, 0 }
+    };
+
+    for (uint32_t i = 0; i < 2000; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = ups_make_record(buffer, sizeof(buffer));
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &rec, 0));
+    }
+
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.cache_purge_candidates > 0);
+    REQUIRE(metrics.cache_blob_metrics.dirty_purge_candidates > 0);
+    REQUIRE(metrics.cache_root_metrics.evictions == 0);
+
+    close();
+    require_open(0, param);
+
+    for (uint32_t i = 0; i < 2000; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = {0};
+      REQUIRE(0 == ups_db_find(db, 0, &key, &rec, 0));
+    }
+
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.cache_index_metrics.misses > 0);
+    REQUIRE(metrics.cache_index_metrics.hits > 0);
+    REQUIRE(metrics.cache_blob_metrics.misses > 0);
+    REQUIRE(metrics.cache_blob_metrics.evictions > 0);
+    REQUIRE(metrics.cache_purge_garbage > 0);
+  }
+
+  void pagePoolTest() {
+    char buffer[1024] = {0};
+    uint32_t page_size = lenv()->config.page_size_bytes;
+
+    for (uint32_t i = 0; i < 5000; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = ups_make_record(buffer, sizeof(buffer));
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &rec, 0));
+    }
+
+    // the buffers of evicted pages were recycled
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.page_buffer_pool_in_use > 0);
+    REQUIRE(metrics.page_buffer_pool_in_use
+                    <= metrics.page_buffer_pool_capacity);
+    REQUIRE(metrics.page_buffer_pool_capacity
+                    < lenv()->device->file_size() / page_size);
+    REQUIRE(metrics.page_object_pool_in_use
+                    >= metrics.page_buffer_pool_in_use);
+    REQUIRE(metrics.page_object_pool_in_use
+                    <= metrics.page_object_pool_capacity);
+
+    // a Page returns its buffer and its memory when it is deleted
+    uint64_t buffers_in_use = metrics.page_buffer_pool_in_use;
+    uint64_t objects_in_use = metrics.page_object_pool_in_use;
+    Page *page = new Page(lenv()->device.get());
+    page->alloc(Page::kTypeBlob);
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.page_buffer_pool_in_use == buffers_in_use + 1);
+    REQUIRE(metrics.page_object_pool_in_use == objects_in_use + 1);
+    delete page;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.page_buffer_pool_in_use == buffers_in_use);
+    REQUIRE(metrics.page_object_pool_in_use == objects_in_use);
+  }
+
+  void bufferPoolTrimTest() {
+    PageBufferPool *pool = lenv()->page_manager->state->buffer_pool.get();
+    size_t in_use = pool->in_use;
+    size_t capacity = pool->capacity;
+
+    std::vector<uint8_t *> v;
+    for (int i = 0; i < 4 * PageBufferPool::kSlabBuffers; i++)
+      v.push_back(pool->allocate());
+    REQUIRE(pool->capacity > capacity);
+
+    // slabs with buffers in use are not released
+    uint8_t *last = v.back();
+    v.pop_back();
+    for (size_t i = 0; i < v.size(); i++)
+      pool->release(v[i]);
+    size_t peak = pool->capacity;
+    pool->trim(0);
+    REQUIRE(pool->capacity < peak);
+    REQUIRE(pool->capacity >= pool->in_use + PageBufferPool::kSlabBuffers - 1);
+    ::memset(last, 0, pool->buffer_size);
+    pool->release(last);
+
+    pool->trim(0);
+    REQUIRE(pool->capacity <= capacity);
+    REQUIRE(pool->in_use == in_use);
+
+    // the remaining buffers are still usable
+    uint8_t *p = pool->allocate();
+    ::memset(p, 0, pool->buffer_size);
+    pool->release(p);
+  }
+
+  void flushCoalescedTest() {
+    Device *device = lenv()->device.get();
+    uint32_t page_size = lenv()->config.page_size_bytes;
+    lenv()->page_manager->state->worker->wait();
+
+    // allocate adjacent pages and fill them with a pattern
+    std::vector<Page *> pages;
+    for (int i = 0; i < 4; i++) {
+      Page *page = new Page(device);
+      page->alloc(Page::kTypeBlob);
+      ::memset(page->payload(), 'a' + i,
+                      page_size - Page::kSizeofPersistentHeader);
+      page->set_dirty(true);
+      pages.push_back(page);
+    }
+    for (int i = 1; i < 4; i++)
+      REQUIRE(pages[i]->address() == pages[i - 1]->address() + page_size);
+
+    uint64_t writes = Page::ms_flush_writes;
+    uint64_t flushed = Page::ms_page_count_flushed;
+
+    // the pages are sorted and written with a single call
+    std::vector<Page *> list(pages.rbegin(), pages.rend());
+    Page::flush(device, list);
+    REQUIRE(Page::ms_flush_writes == writes + 1);
+    REQUIRE(Page::ms_page_count_flushed == flushed + 4);
+
+    std::vector<uint8_t> buffer(page_size);
+    for (int i = 0; i < 4; i++) {
+      REQUIRE(pages[i]->is_dirty() == false);
+      device->read(pages[i]->address(), &buffer[0], page_size);
+      REQUIRE(0 == ::memcmp(&buffer[0], pages[i]->persisted_data.raw_data,
+                              page_size));
+      delete pages[i];
+    }
+
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.flush_thread_count > 0);
+    REQUIRE(metrics.flush_queue_depth == 0);
+    REQUIRE(metrics.flush_write_calls >= writes + 1);
+  }
+
   void storeStateTest() {
     PageManagerState *state = lenv()->page_manager->state.get();
     uint32_t page_size = lenv()->config.page_size_bytes;
@@ -466,6 +782,60 @@ TEST_CASE("PageManager/cacheFullTest", "")
   f.cacheFullTest();
 }
 
+TEST_CASE("PageManager/cacheScanResistanceTest", "")
+{
+  PageManagerFixture f(false, 16 * UPS_DEFAULT_PAGE_SIZE);
+  f.cacheScanResistanceTest();
+}
+
+TEST_CASE("PageManager/cacheGhostTest", "")
+{
+  PageManagerFixture f;
+  f.cacheGhostTest();
+}
+
+TEST_CASE("PageManager/cacheLruPolicyTest", "")
+{
+  PageManagerFixture f;
+  f.cacheLruPolicyTest();
+}
+
+TEST_CASE("PageManager/cacheGrowTest", "")
+{
+  PageManagerFixture f(false, 16 * UPS_DEFAULT_PAGE_SIZE);
+  f.cacheGrowTest();
+}
+
+TEST_CASE("PageManager/cacheGrowUnlimitedTest", "")
+{
+  PageManagerFixture f;
+  f.cacheGrowTest(UPS_CACHE_UNLIMITED);
+}
+
+TEST_CASE("PageManager/cacheMetricsTest", "")
+{
+  PageManagerFixture f(false, 16 * UPS_DEFAULT_PAGE_SIZE);
+  f.cacheMetricsTest();
+}
+
+TEST_CASE("PageManager/pagePoolTest", "")
+{
+  PageManagerFixture f(false, 16 * UPS_DEFAULT_PAGE_SIZE);
+  f.pagePoolTest();
+}
+
+TEST_CASE("PageManager/bufferPoolTrimTest", "")
+{
+  PageManagerFixture f;
+  f.bufferPoolTrimTest();
+}
+
+TEST_CASE("PageManager/flushCoalescedTest", "")
+{
+  PageManagerFixture f;
+  f.flushCoalescedTest();
+}
+
 TEST_CASE("PageManager/storeStateTest", "")
 {
   PageManagerFixture f(false, 16 * UPS_DEFAULT_PAGE_SIZE);
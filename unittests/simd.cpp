@@ -16,56 +16,155 @@
  * See the file COPYING for License information.
  */
 
-#ifdef __SSE__
-
 #include "3rdparty/catch/catch.hpp"
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
 #include "2simd/simd.h"
-#include <array>
 
 using namespace upscaledb;
 
-template<typename T, int S>
-static inline void
-test_linear_search_sse()
-{
-  std::array<T, S> values;
-  for (size_t i = 0; i < values.size(); i++)
-    values[i] = i + 1;
+template<typename T>
+struct SimdFixture {
+  ~SimdFixture() {
+    simd_select_isa(simd_detect_isa());
+  }
+
+  // Compares the kernels of all supported instruction sets with
+  // std::lower_bound
+  void verify(const std::vector<T> &values, T key) {
+    const T *data = values.empty() ? 0 : &values[0];
+    int count = (int)values.size();
+    int expected = (int)(std::lower_bound(values.begin(), values.end(), key)
+                    - values.begin());
+    bool exists = expected < count && values[expected] == key;
+
+    for (int isa = kSimdScalar; isa <= simd_detect_isa(); isa++) {
+      simd_select_isa(isa);
+      REQUIRE(simd_count_less<T>(isa, data, count, key) == expected);
+      REQUIRE(simd_lower_bound<T>(data, count, key) == expected);
+      REQUIRE(simd_find<T>(data, count, key) == (exists ? expected : -1));
+    }
+  }
+
+  // Searches arrays of all sizes up to a few vector lengths for all
+  // stored keys and for keys in between (the values must also fit into
+  // an uint8_t)
+  void sequenceTest() {
+    std::vector<T> values;
+    for (int count = 0; count < 128; count++) {
+      values.clear();
+      for (int i = 0; i < count; i++)
+        values.push_back((T)(2 * i + 1));
+
+      for (int i = 0; i <= 2 * count + 1; i++)
+        verify(values, (T)i);
+    }
+  }
+
+  // Searches an array of the size of a btree node, with duplicates
+  void duplicateTest() {
+    std::vector<T> values;
+    for (int i = 0; i < 1000; i++)
+      values.push_back((T)(i / 8));
+
+    for (int i = 0; i < 130; i++)
+      verify(values, (T)i);
+  }
+
+  // Searches for the limits of the type and for values with the sign bit
+  // set; they reveal errors in the handling of unsigned integers
+  void boundaryTest() {
+    T min = std::numeric_limits<T>::is_integer
+                ? std::numeric_limits<T>::min()
+                : -std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::max();
+    T sign = std::numeric_limits<T>::is_integer
+                ? (T)(max / 2 + 1)
+                : (T)0;
 
-  REQUIRE((-1 == linear_search_sse<T>(&values[0], 0, values.size(), (T)0)));
+    std::vector<T> keys;
+    keys.push_back(min);
+    keys.push_back((T)(min + 1));
+    keys.push_back((T)(sign - 1));
+    keys.push_back(sign);
+    keys.push_back((T)(sign + 1));
+    keys.push_back((T)(max - 1));
+    keys.push_back(max);
 
-  REQUIRE((-1 == linear_search_sse<T>(&values[0], 0, values.size(),
-                          (T)values.size() + 1)));
+    std::vector<T> values;
+    for (int i = 0; i < 100; i++)
+      values.push_back(min);
+    for (int i = 0; i < 100; i++)
+      values.push_back(sign);
+    for (int i = 0; i < 100; i++)
+      values.push_back(max);
 
-  for (size_t i = 0; i < values.size(); i++)
-    REQUIRE((int)i == linear_search_sse<T>(&values[0], 0, values.size(),
-                            (T)(i + 1)));
+    for (int count = 0; count <= (int)values.size(); count += 17) {
+      std::vector<T> v(values.begin(), values.begin() + count);
+      for (size_t i = 0; i < keys.size(); i++)
+        verify(v, keys[i]);
+    }
+  }
+};
+
+template<typename T>
+static void
+run_simd_tests()
+{
+  SimdFixture<T> f;
+  f.sequenceTest();
+  f.duplicateTest();
+  f.boundaryTest();
+}
+
+TEST_CASE("Simd/uint8Test")
+{
+  run_simd_tests<uint8_t>();
 }
 
-TEST_CASE("Simd/uint16SseTest")
+TEST_CASE("Simd/uint16Test")
 {
-  test_linear_search_sse<uint16_t, 16>();
+  run_simd_tests<uint16_t>();
 }
 
-TEST_CASE("Simd/uint32SseTest")
+TEST_CASE("Simd/uint32Test")
 {
-  test_linear_search_sse<uint32_t, 16>();
+  run_simd_tests<uint32_t>();
 }
 
-TEST_CASE("Simd/uint64SseTest")
+TEST_CASE("Simd/uint64Test")
 {
-  test_linear_search_sse<uint64_t, 4>();
+  run_simd_tests<uint64_t>();
 }
 
-TEST_CASE("Simd/floatSseTest")
+TEST_CASE("Simd/floatTest")
 {
-  test_linear_search_sse<float, 16>();
+  run_simd_tests<float>();
 }
 
-TEST_CASE("Simd/doubleSseTest", "")
+TEST_CASE("Simd/doubleTest", "")
 {
-  test_linear_search_sse<double, 4>();
+  run_simd_tests<double>();
 }
 
-#endif // __SSE__
+TEST_CASE("Simd/selectIsaTest", "")
+{
+  int best = simd_detect_isa();
+  REQUIRE(simd_isa() == best);
+
+  // unsupported instruction sets are not selected
+  simd_select_isa(kSimdMax - 1);
+  REQUIRE(simd_isa() == best);
+  simd_select_isa(kSimdScalar);
+  REQUIRE(simd_isa() == kSimdScalar);
+  simd_select_isa(best);
+  REQUIRE(simd_isa() == best);
+
+  for (int isa = kSimdScalar; isa < kSimdMax; isa++) {
+    REQUIRE(simd_isa_name(isa) != 0);
+    REQUIRE(simd_threshold<uint32_t>(isa) > 0);
+  }
+}
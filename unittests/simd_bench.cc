@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/**
+ * Microbenchmark for the SIMD search functions in src/2simd. Measures
+ * random lookups in sorted arrays of the size of a btree node with
+ * different thresholds, and prints the fastest threshold of each key type
+ * and instruction set in the format of the table in src/2simd/simd.cc.
+ *
+ * Usage: simd_bench [node_size_in_bytes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include <boost/chrono.hpp>
+
+#include "2simd/simd.h"
+
+using namespace upscaledb;
+
+static const int kThresholds[] = { 4, 8, 16, 32, 64, 128, 256 };
+static const int kLookups = 2000000;
+
+// prevents that the compiler removes the lookups
+static volatile int sink;
+
+// Returns the duration of |kLookups| random lookups, in nanoseconds
+template<typename T>
+static double
+run(const std::vector<T> &values, const std::vector<T> &keys)
+{
+  boost::chrono::high_resolution_clock::time_point start
+          = boost::chrono::high_resolution_clock::now();
+
+  int sum = 0;
+  for (int i = 0; i < kLookups; i++)
+    sum += simd_lower_bound<T>(&values[0], (int)values.size(),
+                    keys[i % keys.size()]);
+  sink = sum;
+
+  return (double)boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+          boost::chrono::high_resolution_clock::now() - start).count();
+}
+
+template<typename T>
+static void
+bench(const char *name, int node_size)
+{
+  int count = node_size / (int)sizeof(T);
+
+  // every other value is stored; half of the lookups fail
+  std::vector<T> values;
+  for (int i = 0; i < count; i++)
+    values.push_back((T)(2 * i));
+  std::vector<T> keys;
+  for (int i = 0; i < 4096; i++)
+    keys.push_back((T)(::rand() % (2 * count)));
+
+  int best[kSimdMax];
+  for (int isa = kSimdScalar; isa < kSimdMax; isa++)
+    best[isa] = simd_threshold<T>(isa);
+
+  for (int isa = kSimdScalar; isa <= simd_detect_isa(); isa++) {
+    simd_select_isa(isa);
+    double best_time = 0;
+
+    for (size_t t = 0; t < sizeof(kThresholds) / sizeof(kThresholds[0]);
+                    t++) {
+      simd_set_threshold<T>(isa, kThresholds[t]);
+      run<T>(values, keys); // warm up
+      double time = run<T>(values, keys);
+      ::printf("%-8s %-7s threshold %3d: %6.2f ns/lookup\n", name,
+                      simd_isa_name(isa), kThresholds[t], time / kLookups);
+      if (t == 0 || time < best_time) {
+        best_time = time;
+        best[isa] = kThresholds[t];
+      }
+    }
+
+    simd_set_threshold<T>(isa, best[isa]);
+  }
+
+  simd_select_isa(simd_detect_isa());
+  ::printf("SIMD_THRESHOLDS(%s, %d, %d, %d, %d)\n\n", name,
+                  best[kSimdScalar], best[kSimdSse2], best[kSimdAvx2],
+                  best[kSimdAvx512]);
+}
+
+int
+main(int argc, char **argv)
+{
+  // the payload of a 16kb page (the default page size)
+  int node_size = argc > 1 ? ::atoi(argv[1]) : 16 * 1024;
+
+  ::printf("node size: %d bytes, best instruction set: %s\n\n", node_size,
+                  simd_isa_name(simd_detect_isa()));
+
+  bench<uint8_t>("uint8_t", std::min(node_size, 128));
+  bench<uint16_t>("uint16_t", node_size);
+  bench<uint32_t>("uint32_t", node_size);
+  bench<uint64_t>("uint64_t", node_size);
+  bench<float>("float", node_size);
+  bench<double>("double", node_size);
+  return 0;
+}
@@ -836,6 +836,106 @@ struct HighLevelTxnFixture : BaseFixture {
     REQUIRE(3ull == count);
   }
 
+  ups_status_t erase(ups_txn_t *txn, const char *keydata) {
+    ups_key_t key = ups_make_key((void *)keydata,
+                    (uint16_t)(::strlen(keydata) + 1));
+    return ups_db_erase(db, txn, &key, 0);
+  }
+
+  void readOnlySnapshotTest() {
+    ups_txn_t *writers[10], *reader;
+    uint64_t count;
+
+    require_create(UPS_ENABLE_TRANSACTIONS);
+
+    REQUIRE(0 == insert(0, "key1", "rec1", 0));
+    for (int i = 0; i < 10; i++)
+      REQUIRE(0 == ups_txn_begin(&writers[i], env, 0, 0, 0));
+    REQUIRE(0 == insert(writers[0], "key1", "new1", UPS_OVERWRITE));
+    REQUIRE(0 == insert(writers[0], "key2", "rec2", 0));
+
+    // the reader does not see the changes of the active writer, and it
+    // does not run into conflicts
+    REQUIRE(0 == ups_txn_begin(&reader, env, 0, 0, UPS_TXN_READ_ONLY));
+    REQUIRE(0 == find(reader, "key1", "rec1"));
+    REQUIRE(UPS_KEY_NOT_FOUND == find(reader, "key2", "rec2"));
+    REQUIRE(UPS_TXN_CONFLICT == find(0, "key2", "rec2"));
+
+    // changes which are committed later are invisible as well, even if
+    // enough transactions were committed to trigger a flush
+    for (int i = 0; i < 10; i++)
+      REQUIRE(0 == ups_txn_commit(writers[i], 0));
+    REQUIRE(0 == insert(0, "key3", "rec3", 0));
+    REQUIRE(0 == erase(0, "key1"));
+    REQUIRE(0 == find(reader, "key1", "rec1"));
+    REQUIRE(UPS_KEY_NOT_FOUND == find(reader, "key2", "rec2"));
+    REQUIRE(UPS_KEY_NOT_FOUND == find(reader, "key3", "rec3"));
+    REQUIRE(0 == ups_db_count(db, reader, 0, &count));
+    REQUIRE(1ull == count);
+
+    // a read-only txn cannot modify the database
+    REQUIRE(UPS_WRITE_PROTECTED == insert(reader, "key4", "rec4", 0));
+    REQUIRE(UPS_WRITE_PROTECTED == erase(reader, "key1"));
+    REQUIRE(0 == ups_txn_commit(reader, 0));
+
+    // a new snapshot sees the current state
+    REQUIRE(0 == ups_txn_begin(&reader, env, 0, 0, UPS_TXN_READ_ONLY));
+    REQUIRE(UPS_KEY_NOT_FOUND == find(reader, "key1", "new1"));
+    REQUIRE(0 == find(reader, "key2", "rec2"));
+    REQUIRE(0 == find(reader, "key3", "rec3"));
+    REQUIRE(0 == ups_txn_commit(reader, 0));
+
+    REQUIRE(UPS_KEY_NOT_FOUND == find(0, "key1", "new1"));
+    REQUIRE(0 == find(0, "key2", "rec2"));
+    REQUIRE(0 == find(0, "key3", "rec3"));
+  }
+
+  void readOnlySnapshotCursorTest() {
+    ups_txn_t *writer, *reader;
+    ups_cursor_t *cursor;
+    ups_key_t key = {0};
+    ups_record_t rec = {0};
+
+    require_create(UPS_ENABLE_TRANSACTIONS);
+
+    REQUIRE(0 == insert(0, "a", "rec1", 0));
+    REQUIRE(0 == insert(0, "b", "rec2", 0));
+    REQUIRE(0 == ups_txn_begin(&writer, env, 0, 0, 0));
+    REQUIRE(0 == insert(writer, "c", "rec3", 0));
+    REQUIRE(0 == erase(writer, "a"));
+    REQUIRE(0 == ups_txn_begin(&reader, env, 0, 0, UPS_TXN_READ_ONLY));
+    REQUIRE(0 == insert(0, "0", "rec0", 0));
+    REQUIRE(0 == insert(0, "d", "rec4", 0));
+    REQUIRE(0 == ups_cursor_create(&cursor, db, reader, 0));
+
+    REQUIRE(0 == ups_cursor_move(cursor, &key, &rec, UPS_CURSOR_FIRST));
+    REQUIRE(0 == ::strcmp("a", (char *)key.data));
+    REQUIRE(0 == ::strcmp("rec1", (char *)rec.data));
+    REQUIRE(0 == ups_cursor_move(cursor, &key, &rec, UPS_CURSOR_NEXT));
+    REQUIRE(0 == ::strcmp("b", (char *)key.data));
+    REQUIRE(UPS_KEY_NOT_FOUND
+                == ups_cursor_move(cursor, &key, &rec, UPS_CURSOR_NEXT));
+
+    REQUIRE(0 == ups_cursor_move(cursor, &key, &rec, UPS_CURSOR_LAST));
+    REQUIRE(0 == ::strcmp("b", (char *)key.data));
+    REQUIRE(0 == ups_cursor_move(cursor, &key, &rec, UPS_CURSOR_PREVIOUS));
+    REQUIRE(0 == ::strcmp("a", (char *)key.data));
+    REQUIRE(UPS_KEY_NOT_FOUND
+                == ups_cursor_move(cursor, &key, &rec, UPS_CURSOR_PREVIOUS));
+
+    key = ups_make_key((void *)"bb", 3);
+    REQUIRE(UPS_KEY_NOT_FOUND == ups_cursor_find(cursor, &key, &rec, 0));
+    REQUIRE(0 == ups_cursor_find(cursor, &key, &rec, UPS_FIND_LEQ_MATCH));
+    REQUIRE(0 == ::strcmp("b", (char *)key.data));
+    key = ups_make_key((void *)"bb", 3);
+    REQUIRE(UPS_KEY_NOT_FOUND
+                == ups_cursor_find(cursor, &key, &rec, UPS_FIND_GEQ_MATCH));
+
+    REQUIRE(0 == ups_cursor_close(cursor));
+    REQUIRE(0 == ups_txn_commit(reader, 0));
+    REQUIRE(0 == ups_txn_commit(writer, 0));
+  }
+
   void insertTxnsWithDelay(int loop) {
     ups_txn_t *txn;
 
@@ -950,6 +1050,18 @@ TEST_CASE("Txn/high/getKeyCountOverwriteTest", "")
   f.getKeyCountOverwriteTest();
 }
 
+TEST_CASE("Txn/high/readOnlySnapshotTest", "")
+{
+  HighLevelTxnFixture f;
+  f.readOnlySnapshotTest();
+}
+
+TEST_CASE("Txn/high/readOnlySnapshotCursorTest", "")
+{
+  HighLevelTxnFixture f;
+  f.readOnlySnapshotCursorTest();
+}
+
 TEST_CASE("Txn/high/insertTxnsWithDelay", "")
 {
   HighLevelTxnFixture f;
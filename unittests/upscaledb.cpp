@@ -18,6 +18,8 @@
 
 #include "3rdparty/catch/catch.hpp"
 
+#include <map>
+
 #include "1os/file.h"
 #include "1errorinducer/errorinducer.h"
 #include "2page/page.h"
@@ -2097,6 +2099,232 @@ struct UpscaledbFixture : BaseFixture {
     REQUIRE(UPS_INV_PARAMETER == ups_db_bulk_operations(db, 0,
                             ops.data(), 2, 0));
   }
+
+  // Large batches of random operations are sorted by key and executed
+  // leaf by leaf; the results must be identical to a sequential execution
+  void bulkSortedTest(uint64_t key_type) {
+    close();
+    ups_parameter_t env_params[] = {
+        {UPS_PARAM_PAGESIZE, 1024},
+        {0, 0}
+    };
+    ups_parameter_t db_params[] = {
+        {UPS_PARAM_KEY_TYPE, key_type},
+        {UPS_PARAM_RECORD_SIZE, sizeof(uint32_t)},
+        {0, 0}
+    };
+    require_create(0, env_params, 0, db_params);
+
+    const int kBatches = 20;
+    const int kBatchSize = 1000;
+    const uint32_t kKeyRange = 3000;
+
+    std::map<std::string, uint32_t> model;
+    std::vector<std::string> keys(kBatchSize);
+    std::vector<uint32_t> values(kBatchSize);
+    std::vector<ups_status_t> expected(kBatchSize);
+    std::vector<ups_operation_t> ops(kBatchSize);
+
+    ::srand(13);
+    for (int b = 0; b < kBatches; b++) {
+      for (int i = 0; i < kBatchSize; i++) {
+        uint32_t k = (uint32_t)::rand() % kKeyRange;
+        if (key_type == UPS_TYPE_UINT32)
+          keys[i].assign((const char *)&k, sizeof(k));
+        else
+          keys[i] = std::string(1 + k % 40, 'x') + std::to_string(k);
+        values[i] = (uint32_t)(b * kBatchSize + i);
+
+        ups_operation_t &op = ops[i];
+        ::memset(&op, 0, sizeof(op));
+        op.key = ups_make_key((void *)keys[i].data(),
+                        (uint16_t)keys[i].size());
+        switch (::rand() % 3) {
+          case 0:
+            op.type = UPS_OP_INSERT;
+            op.record = ups_make_record(&values[i], sizeof(values[i]));
+            op.flags = (::rand() % 2) ? UPS_OVERWRITE : 0;
+            if (model.find(keys[i]) != model.end()
+                    && NOTSET(op.flags, UPS_OVERWRITE)) {
+              expected[i] = UPS_DUPLICATE_KEY;
+            }
+            else {
+              model[keys[i]] = values[i];
+              expected[i] = 0;
+            }
+            break;
+          case 1:
+            op.type = UPS_OP_FIND;
+            expected[i] = model.find(keys[i]) != model.end()
+                            ? 0
+                            : UPS_KEY_NOT_FOUND;
+            // remember the record which is expected
+            values[i] = expected[i] == 0 ? model[keys[i]] : 0;
+            break;
+          default:
+            op.type = UPS_OP_ERASE;
+            expected[i] = model.erase(keys[i]) ? 0 : UPS_KEY_NOT_FOUND;
+            break;
+        }
+      }
+
+      REQUIRE(0 == ups_db_bulk_operations(db, 0, ops.data(), ops.size(), 0));
+
+      // the results are returned in the original order
+      for (int i = 0; i < kBatchSize; i++) {
+        REQUIRE(expected[i] == ops[i].result);
+        if (ops[i].type == UPS_OP_FIND && ops[i].result == 0) {
+          REQUIRE(ops[i].record.size == sizeof(uint32_t));
+          REQUIRE(values[i] == *(uint32_t *)ops[i].record.data);
+        }
+      }
+    }
+
+    REQUIRE(0 == ups_db_check_integrity(db, 0));
+
+    uint64_t count;
+    REQUIRE(0 == ups_db_count(db, 0, 0, &count));
+    REQUIRE(model.size() == count);
+    for (std::map<std::string, uint32_t>::iterator it = model.begin();
+            it != model.end(); ++it) {
+      ups_key_t key = ups_make_key((void *)it->first.data(),
+                      (uint16_t)it->first.size());
+      ups_record_t record = {0};
+      REQUIRE(0 == ups_db_find(db, 0, &key, &record, 0));
+      REQUIRE(it->second == *(uint32_t *)record.data);
+    }
+  }
+
+  // Operations on the same key are executed in their original order,
+  // even if the batch is sorted
+  void bulkSortedDuplicatesTest() {
+    close();
+    ups_parameter_t db_params[] = {
+        {UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32},
+        {0, 0}
+    };
+    require_create(0, 0, UPS_ENABLE_DUPLICATE_KEYS, db_params);
+
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> values;
+    for (uint32_t i = 0; i < 64; i++) {
+      keys.push_back(63 - i);
+      values.push_back(i);
+    }
+
+    std::vector<ups_operation_t> ops;
+    for (uint32_t i = 0; i < 64; i++) {
+      ups_key_t key = ups_make_key(&keys[i], sizeof(uint32_t));
+      ups_record_t record = ups_make_record(&values[i], sizeof(uint32_t));
+      ups_record_t empty = {0};
+      ops.push_back({UPS_OP_INSERT, key, record, UPS_DUPLICATE});
+      ops.push_back({UPS_OP_INSERT, key, record, UPS_DUPLICATE});
+      ops.push_back({UPS_OP_FIND, key, empty, 0});
+      if (i % 2) {
+        ops.push_back({UPS_OP_ERASE, key, empty, 0});
+        ops.push_back({UPS_OP_FIND, key, empty, 0});
+      }
+    }
+
+    REQUIRE(0 == ups_db_bulk_operations(db, 0, ops.data(), ops.size(), 0));
+
+    size_t j = 0;
+    for (uint32_t i = 0; i < 64; i++) {
+      REQUIRE(0 == ops[j++].result);
+      REQUIRE(0 == ops[j++].result);
+      REQUIRE(0 == ops[j].result);
+      REQUIRE(values[i] == *(uint32_t *)ops[j++].record.data);
+      if (i % 2) {
+        REQUIRE(0 == ops[j++].result);
+        REQUIRE(UPS_KEY_NOT_FOUND == ops[j++].result);
+      }
+    }
+
+    uint64_t count;
+    REQUIRE(0 == ups_db_count(db, 0, 0, &count));
+    REQUIRE(64u == count);
+  }
+
+  // Looks up existing and missing keys with ups_db_find_many and compares
+  // the results with ups_db_find
+  void findManyTest(uint32_t env_flags) {
+    close();
+    ups_parameter_t env_params[] = {
+        {UPS_PARAM_PAGESIZE, 1024},
+        {0, 0}
+    };
+    ups_parameter_t db_params[] = {
+        {UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32},
+        {0, 0}
+    };
+    require_create(env_flags, env_params, 0, db_params);
+
+    const uint32_t kKeys = 20000;
+    for (uint32_t i = 0; i < kKeys; i += 2) {
+      uint32_t value = i * 3;
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t record = ups_make_record(&value, sizeof(value));
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+    }
+
+    const size_t kBatch = 1000;
+    std::vector<uint32_t> k(kBatch);
+    std::vector<ups_key_t> keys(kBatch);
+    std::vector<ups_record_t> records(kBatch);
+    std::vector<ups_status_t> results(kBatch);
+
+    ::srand(7);
+    for (int round = 0; round < 10; round++) {
+      for (size_t i = 0; i < kBatch; i++) {
+        k[i] = (uint32_t)::rand() % (kKeys + 100);
+        keys[i] = ups_make_key(&k[i], sizeof(k[i]));
+        ::memset(&records[i], 0, sizeof(records[i]));
+      }
+
+      REQUIRE(0 == ups_db_find_many(db, 0, keys.data(), records.data(),
+                              results.data(), kBatch, 0));
+
+      for (size_t i = 0; i < kBatch; i++) {
+        if (k[i] % 2 == 0 && k[i] < kKeys) {
+          REQUIRE(0 == results[i]);
+          REQUIRE(sizeof(uint32_t) == records[i].size);
+          REQUIRE(k[i] * 3 == *(uint32_t *)records[i].data);
+        }
+        else
+          REQUIRE(UPS_KEY_NOT_FOUND == results[i]);
+      }
+    }
+
+    // user-allocated records are filled in directly
+    uint32_t k1 = 42, k2 = 43, v1 = 0;
+    ups_key_t ukeys[2] = {ups_make_key(&k1, sizeof(k1)),
+                          ups_make_key(&k2, sizeof(k2))};
+    ups_record_t urecords[2] = {ups_make_record(&v1, sizeof(v1)), {0}};
+    urecords[0].flags = UPS_RECORD_USER_ALLOC;
+    ups_status_t uresults[2];
+    REQUIRE(0 == ups_db_find_many(db, 0, ukeys, urecords, uresults, 2, 0));
+    REQUIRE(0 == uresults[0]);
+    REQUIRE(42u * 3 == v1);
+    REQUIRE(UPS_KEY_NOT_FOUND == uresults[1]);
+  }
+
+  void findManyNegativeTest() {
+    ups_key_t key = {0};
+    ups_record_t record = {0};
+    ups_status_t result;
+
+    REQUIRE(UPS_INV_PARAMETER == ups_db_find_many(0, 0, &key, &record,
+                            &result, 1, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_db_find_many(db, 0, 0, &record,
+                            &result, 1, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_db_find_many(db, 0, &key, 0,
+                            &result, 1, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_db_find_many(db, 0, &key, &record,
+                            0, 1, 0));
+    REQUIRE(UPS_INV_PARAMETER == ups_db_find_many(db, 0, &key, &record,
+                            &result, 1, UPS_FIND_LT_MATCH));
+    REQUIRE(0 == ups_db_find_many(db, 0, &key, &record, &result, 0, 0));
+  }
 };
 
 TEST_CASE("Upscaledb/versionTest", "")
@@ -2575,4 +2803,46 @@ TEST_CASE("Upscaledb/bulkNegativeTests", "")
   f.bulkNegativeTests();
 }
 
+TEST_CASE("Upscaledb/bulkSortedTest", "")
+{
+  UpscaledbFixture f;
+  f.bulkSortedTest(UPS_TYPE_UINT32);
+}
+
+TEST_CASE("Upscaledb/bulkSortedBinaryTest", "")
+{
+  UpscaledbFixture f;
+  f.bulkSortedTest(UPS_TYPE_BINARY);
+}
+
+TEST_CASE("Upscaledb/bulkSortedDuplicatesTest", "")
+{
+  UpscaledbFixture f;
+  f.bulkSortedDuplicatesTest();
+}
+
+TEST_CASE("Upscaledb/findManyTest", "")
+{
+  UpscaledbFixture f;
+  f.findManyTest(0);
+}
+
+TEST_CASE("Upscaledb/findManyInMemoryTest", "")
+{
+  UpscaledbFixture f;
+  f.findManyTest(UPS_IN_MEMORY);
+}
+
+TEST_CASE("Upscaledb/findManyTxnTest", "")
+{
+  UpscaledbFixture f;
+  f.findManyTest(UPS_ENABLE_TRANSACTIONS);
+}
+
+TEST_CASE("Upscaledb/findManyNegativeTest", "")
+{
+  UpscaledbFixture f;
+  f.findManyNegativeTest();
+}
+
 } // namespace upscaledb
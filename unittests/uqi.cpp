@@ -21,6 +21,7 @@
 #include "ups/upscaledb_uqi.h"
 
 #include "4context/context.h"
+#include "4env/env_local.h"
 #include "4uqi/plugins.h"
 #include "4uqi/parser.h"
 #include "4uqi/result.h"
@@ -231,6 +232,42 @@ lt10_predicate(void *state, const void *key_data, uint32_t key_size,
   return *f < 10.0f;
 }
 
+static int range_calls;
+static int range_pred_calls;
+
+// the state is the stream of the predicate
+static void *
+range_init(int flags, int key_type, uint32_t key_size, int record_type,
+                uint32_t record_size, const char *reserved)
+{
+  return (void *)(intptr_t)flags;
+}
+
+// matches values in [1000, 1999]
+static int
+range_predicate(void *state, const void *key_data, uint32_t key_size,
+                const void *record_data, uint32_t record_size)
+{
+  range_pred_calls++;
+  const void *data = (intptr_t)state == UQI_STREAM_KEY
+                        ? key_data
+                        : record_data;
+  uint64_t v = *(const uint64_t *)data;
+  return v >= 1000 && v < 2000;
+}
+
+static int
+range_range_predicate(void *state, const void *min_data,
+                const void *max_data, uint32_t size)
+{
+  range_calls++;
+  REQUIRE(size == sizeof(uint64_t));
+  uint64_t min = *(const uint64_t *)min_data;
+  uint64_t max = *(const uint64_t *)max_data;
+  REQUIRE(min <= max);
+  return max >= 1000 && min < 2000;
+}
+
 struct UqiFixture : BaseFixture {
   bool use_transactions;
 
@@ -772,6 +809,151 @@ struct UqiFixture : BaseFixture {
     rp.require("COUNT", UPS_TYPE_UINT64, c);
   }
 
+  // The predicate is applied to ascending keys (or records); most leaves
+  // are skipped by the range predicate
+  void rangePredicateTest(const char *query, bool use_range_pred) {
+    close();
+    ups_parameter_t env_params[] = {
+        {UPS_PARAM_PAGE_SIZE, 1024},
+        {0, 0}
+    };
+    ups_parameter_t db_params[] = {
+        {UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT64},
+        {UPS_PARAM_RECORD_TYPE, UPS_TYPE_UINT64},
+        {0, 0}
+    };
+    require_create(0, env_params, 0, db_params);
+
+    const int count = 10000;
+    for (uint64_t i = 0; i < count; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t record = ups_make_record(&i, sizeof(i));
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+    }
+
+    uqi_plugin_t plugin = {0};
+    plugin.name = use_range_pred ? "in_range" : "in_range_v0";
+    plugin.type = UQI_PLUGIN_PREDICATE;
+    plugin.plugin_version = use_range_pred ? 1 : 0;
+    plugin.init = range_init;
+    plugin.pred = range_predicate;
+    plugin.range_pred = range_range_predicate;
+    REQUIRE(0 == uqi_register_plugin(&plugin));
+
+    ResultProxy rp;
+    for (int i = 0; i < 2; i++) {
+      range_calls = 0;
+      range_pred_calls = 0;
+      REQUIRE(0 == uqi_select(env, query, &rp.result));
+      rp.require("COUNT", UPS_TYPE_UINT64, 1000ull)
+        .close();
+
+      if (use_range_pred) {
+        REQUIRE(range_calls > 0);
+        REQUIRE(range_pred_calls < count / 2);
+      }
+      else {
+        // version 0 descriptors do not have a range predicate
+        REQUIRE(range_calls == 0);
+        REQUIRE(range_pred_calls == count);
+      }
+    }
+
+    // modify a record; the summary of its leaf is updated
+    uint64_t k = 5000;
+    uint64_t r = 1500;
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    ups_record_t record = ups_make_record(&r, sizeof(r));
+    REQUIRE(0 == ups_db_insert(db, 0, &key, &record, UPS_OVERWRITE));
+    REQUIRE(0 == uqi_select(env, query, &rp.result));
+    uint64_t expected = ::strstr(query, "$record") ? 1001 : 1000;
+    rp.require("COUNT", UPS_TYPE_UINT64, expected);
+  }
+
+  void parallelTest(uint32_t threads) {
+    close();
+    ups_parameter_t env_params[] = {
+        {UPS_PARAM_PAGE_SIZE, 1024},
+        {UPS_PARAM_QUERY_THREADS, threads},
+        {0, 0}
+    };
+    ups_parameter_t db_params[] = {
+        {UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT64},
+        {UPS_PARAM_RECORD_TYPE, UPS_TYPE_UINT64},
+        {0, 0}
+    };
+    require_create(UPS_ENABLE_CONCURRENT_READS, env_params, 0, db_params);
+
+    const uint64_t count = 10000;
+    for (uint64_t i = 0; i < count; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t record = ups_make_record(&i, sizeof(i));
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+    }
+
+    uqi_plugin_t plugin = {0};
+    plugin.name = "in_range";
+    plugin.type = UQI_PLUGIN_PREDICATE;
+    plugin.plugin_version = 1;
+    plugin.init = range_init;
+    plugin.pred = range_predicate;
+    plugin.range_pred = range_range_predicate;
+    REQUIRE(0 == uqi_register_plugin(&plugin));
+
+    ResultProxy rp;
+    REQUIRE(0 == uqi_select(env, "COUNT($key) from database 1", &rp.result));
+    rp.require("COUNT", UPS_TYPE_UINT64, count)
+      .close();
+    REQUIRE(0 == uqi_select(env, "COUNT($key) from database 1 "
+                            "WHERE in_range($record)", &rp.result));
+    rp.require("COUNT", UPS_TYPE_UINT64, 1000ull)
+      .close();
+    REQUIRE(0 == uqi_select(env, "SUM($key) from database 1", &rp.result));
+    rp.require("SUM", UPS_TYPE_UINT64, count * (count - 1) / 2)
+      .close();
+    REQUIRE(0 == uqi_select(env, "SUM($record) from database 1 "
+                            "WHERE in_range($key)", &rp.result));
+    rp.require("SUM", UPS_TYPE_UINT64, 1499500ull)
+      .close();
+    REQUIRE(0 == uqi_select(env, "AVERAGE($record) from database 1",
+                            &rp.result));
+    rp.require("AVERAGE", UPS_TYPE_REAL64, (count - 1) / 2.0)
+      .close();
+
+    uint64_t min = 0;
+    uint64_t max = count - 1;
+    REQUIRE(0 == uqi_select(env, "MIN($key) from database 1", &rp.result));
+    rp.require_row_count(1)
+      .require_key(0, &min, sizeof(min))
+      .require_record(0, &min, sizeof(min))
+      .close();
+    REQUIRE(0 == uqi_select(env, "MAX($record) from database 1",
+                            &rp.result));
+    rp.require_row_count(1)
+      .require_key(0, &max, sizeof(max))
+      .require_record(0, &max, sizeof(max))
+      .close();
+
+    REQUIRE(0 == uqi_select(env, "TOP($key) from database 1 limit 3",
+                            &rp.result));
+    rp.require_row_count(3);
+    for (uint64_t i = 0; i < 3; i++) {
+      uint64_t k = count - 3 + i;
+      rp.require_key(i, &k, sizeof(k));
+    }
+    rp.close();
+    REQUIRE(0 == uqi_select(env, "BOTTOM($record) from database 1 limit 3",
+                            &rp.result));
+    rp.require_row_count(3);
+    for (uint64_t i = 0; i < 3; i++)
+      rp.require_record(i, &i, sizeof(i));
+    rp.close();
+
+    // the workers are only started if the query is split
+    LocalEnv *lenv = (LocalEnv *)env;
+    REQUIRE((lenv->query_pool.get() != 0) == (threads > 1));
+  }
+
   void countDistinctIfTest(int count) {
     ups_key_t key = {0};
     ups_record_t record = {0};
@@ -859,6 +1041,39 @@ TEST_CASE("Uqi/countDistinctIfTest", "")
   f.countIfTest(20);
 }
 
+TEST_CASE("Uqi/rangePredicateOnKeysTest", "")
+{
+  UqiFixture f(false, UPS_TYPE_UINT64);
+  f.rangePredicateTest("COUNT($key) from database 1 WHERE in_range($key)",
+                  true);
+}
+
+TEST_CASE("Uqi/rangePredicateOnRecordsTest", "")
+{
+  UqiFixture f(false, UPS_TYPE_UINT64);
+  f.rangePredicateTest("COUNT($key) from database 1 WHERE in_range($record)",
+                  true);
+}
+
+TEST_CASE("Uqi/rangePredicateVersion0Test", "")
+{
+  UqiFixture f(false, UPS_TYPE_UINT64);
+  f.rangePredicateTest("COUNT($key) from database 1 "
+                  "WHERE in_range_v0($record)", false);
+}
+
+TEST_CASE("Uqi/parallelTest", "")
+{
+  UqiFixture f(false, UPS_TYPE_UINT64);
+  f.parallelTest(4);
+}
+
+TEST_CASE("Uqi/parallelSingleThreadTest", "")
+{
+  UqiFixture f(false, UPS_TYPE_UINT64);
+  f.parallelTest(1);
+}
+
 TEST_CASE("Uqi/pluginTest", "")
 {
   REQUIRE(upscaledb::PluginManager::get("foo") == 0);
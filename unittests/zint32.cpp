@@ -151,6 +151,87 @@ struct Zint32Fixture : BaseFixture {
     REQUIRE(*(double *)uqi_result_get_record_data(result, &size) == 14999.5);
 
     uqi_result_close(result);
+
+    // COUNT, MIN and MAX do not decompress the blocks
+    REQUIRE(0 == uqi_select(env, "COUNT($key) from database 1", &result));
+    REQUIRE(*(uint64_t *)uqi_result_get_record_data(result, &size) == 30000ull);
+    uqi_result_close(result);
+
+    REQUIRE(0 == uqi_select(env, "MIN($key) from database 1", &result));
+    REQUIRE(*(uint32_t *)uqi_result_get_key_data(result, &size) == 0u);
+    uqi_result_close(result);
+
+    REQUIRE(0 == uqi_select(env, "MAX($key) from database 1", &result));
+    REQUIRE(*(uint32_t *)uqi_result_get_key_data(result, &size) == 29999u);
+    uqi_result_close(result);
+
+    // start in the middle of a block
+    ups_cursor_t *cursor;
+    REQUIRE(0 == ups_cursor_create(&cursor, db, 0, 0));
+    uint32_t start = 12345;
+    key.data = (void *)&start;
+    REQUIRE(0 == ups_cursor_find(cursor, &key, 0, 0));
+
+    REQUIRE(0 == uqi_select_range(env, "SUM($key) from database 1",
+                            cursor, 0, &result));
+    REQUIRE(*(uint64_t *)uqi_result_get_record_data(result, &size)
+                    == 449985000ull - 12344ull * 12345 / 2);
+    uqi_result_close(result);
+
+    REQUIRE(0 == ups_cursor_find(cursor, &key, 0, 0));
+    REQUIRE(0 == uqi_select_range(env, "COUNT($key) from database 1",
+                            cursor, 0, &result));
+    REQUIRE(*(uint64_t *)uqi_result_get_record_data(result, &size)
+                    == 30000ull - 12345);
+    uqi_result_close(result);
+
+    REQUIRE(0 == ups_cursor_find(cursor, &key, 0, 0));
+    REQUIRE(0 == uqi_select_range(env, "MIN($key) from database 1",
+                            cursor, 0, &result));
+    REQUIRE(*(uint32_t *)uqi_result_get_key_data(result, &size) == 12345u);
+    uqi_result_close(result);
+
+    REQUIRE(0 == ups_cursor_close(cursor));
+  }
+
+  // SUM and AVERAGE over keys with gaps of various sizes; FOR sums up
+  // the frames of such blocks without decompressing them
+  void uqiSumTest() {
+    ups_key_t key = {0};
+    ups_record_t record = {0};
+    uint64_t sum = 0;
+    uint32_t k = 0;
+
+    std::srand(0); // make this reproducible
+    for (uint32_t i = 0; i < 20000; i++) {
+      // the gaps grow from 1 bit up to 20 bits
+      k += 1 + (uint32_t)(std::rand() % (1u << (1 + (i / 1000))));
+      key.data = (void *)&k;
+      key.size = sizeof(k);
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+      sum += k;
+    }
+
+    // a few keys which require the full 32 bits
+    for (uint32_t i = 0; i < 10; i++) {
+      k = 0xfffffff0u + i;
+      key.data = (void *)&k;
+      key.size = sizeof(k);
+      REQUIRE(0 == ups_db_insert(db, 0, &key, &record, 0));
+      sum += k;
+    }
+
+    uqi_result_t *result;
+    uint32_t size;
+
+    REQUIRE(0 == uqi_select(env, "SUM($key) from database 1", &result));
+    REQUIRE(*(uint64_t *)uqi_result_get_record_data(result, &size) == sum);
+    uqi_result_close(result);
+
+    REQUIRE(0 == uqi_select(env, "AVERAGE($key) from database 1", &result));
+    REQUIRE(*(double *)uqi_result_get_record_data(result, &size)
+                    == (double)sum / 20010.0);
+    uqi_result_close(result);
   }
 
   void uqiTestDuplicate() {
@@ -274,6 +355,12 @@ TEST_CASE("Zint32/Varbyte/uqiTest", "")
   f.uqiTest();
 }
 
+TEST_CASE("Zint32/Varbyte/uqiSumTest", "")
+{
+  Zint32Fixture f(UPS_COMPRESSOR_UINT32_VARBYTE, false, 0);
+  f.uqiSumTest();
+}
+
 TEST_CASE("Zint32/Varbyte/uqiTest-duplicate", "")
 {
   Zint32Fixture f(UPS_COMPRESSOR_UINT32_VARBYTE, true, 0);
@@ -488,6 +575,12 @@ TEST_CASE("Zint32/FOR/uqiTest", "")
   f.uqiTest();
 }
 
+TEST_CASE("Zint32/FOR/uqiSumTest", "")
+{
+  Zint32Fixture f(UPS_COMPRESSOR_UINT32_FOR, false, 0);
+  f.uqiSumTest();
+}
+
 TEST_CASE("Zint32/FOR/uqiTest-duplicate", "")
 {
   Zint32Fixture f(UPS_COMPRESSOR_UINT32_FOR, true, 0);